@@ -0,0 +1,1610 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_bench.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_bench.c
+ * @brief Parser benchmarks.
+ */
+
+/*
+ * Build from the repository root with "make nfc_bench" (add ARCH=-march=native
+ * for the AVX2/SSSE3 paths); the binary is build/nfc_bench.
+ *
+ * Usage: nfc_bench [--json] [--images N] [--repeat N] [parsers|null-skip|batch|ring|text|archive|emu|async ...]
+ *
+ * With --json every result is printed as one JSON object per line so the
+ * output of two builds can be compared mechanically. --repeat N times each
+ * parser case N times and reports the fastest run, which keeps single-digit
+ * nanosecond differences visible on a noisy host.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC  1
+#else
+#define BENCH_HAVE_TSC  0
+#endif
+
+#include "nfc_archive.h"
+#include "nfc_async.h"
+#include "nfc_batch.h"
+#include "nfc_corpus.h"
+#include "nfc_ndef.h"
+#include "nfc_ring.h"
+#include "nfc_rtd.h"
+#include "nfc_t2t_emu.h"
+#include "nfc_tlv_block.h"
+#include "type_2_tag.h"
+
+#define BENCH_MIN_NS        200000000ULL    /* Run each case for at least 200 ms. */
+#define BENCH_MAX_TLVS      8
+#define BENCH_MAX_SEGS      64
+#define BENCH_MAX_RECORDS   64
+
+static int    bench_json       = 0;
+static size_t bench_image_cnt  = 2000;
+static size_t bench_repeat     = 1;
+
+/*
+ * @brief Corpus plus the location of the NDEF message TLV of every image.
+ */
+typedef struct
+{
+    nfc_corpus_t corpus;
+    uint8_t      **ndef;         /* NDEF message of each image */
+    size_t       *ndef_len;      /* Length of each NDEF message */
+    size_t       data_bytes;     /* Total data area bytes       */
+    size_t       ndef_bytes;     /* Total NDEF message bytes    */
+} bench_ctx_t;
+
+typedef size_t (*bench_fn_t)(const bench_ctx_t *ctx);
+
+/*
+ * @brief Monotonic time in nanoseconds.
+ */
+static unsigned long long bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static unsigned long long bench_cycles(void)
+{
+#if BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/*
+ * @brief Print one result as a table row or a JSON line.
+ */
+static void bench_report(const char *bench, const char *corpus, double ns_per_record,
+                         double bytes_per_s, double cycles_per_byte)
+{
+    if(bench_json)
+    {
+        printf("{\"bench\":\"%s\",\"corpus\":\"%s\",\"ns_per_record\":%.3f,\"bytes_per_s\":%.0f,",
+               bench, corpus, ns_per_record, bytes_per_s);
+        if(BENCH_HAVE_TSC)
+            printf("\"cycles_per_byte\":%.4f}\n", cycles_per_byte);
+        else
+            printf("\"cycles_per_byte\":null}\n");
+    }
+    else
+    {
+        printf("%-14s %-14s %12.2f %14.1f %10.3f\n",
+               bench, corpus, ns_per_record, bytes_per_s / 1e6, cycles_per_byte);
+    }
+}
+
+/*
+ * @brief Run a benchmark over the whole corpus repeatedly and report it.
+ */
+static void bench_run(const char *name, bench_fn_t fn, const bench_ctx_t *ctx, size_t bytes_per_pass)
+{
+    volatile size_t sink     = 0;
+    double          best_ns  = 0.0;
+    double          best_cyc  = 0.0;
+
+    for(size_t rep = 0; rep < bench_repeat; rep++)
+    {
+        unsigned long      iters = 0;
+        unsigned long long start = bench_now_ns(), elapsed;
+        unsigned long long c0    = bench_cycles();
+
+        do
+        {
+            sink += fn(ctx);
+            iters++;
+            elapsed = bench_now_ns() - start;
+        } while(elapsed < BENCH_MIN_NS);
+
+        double ns  = (double)elapsed / (double)iters;
+        double cyc = (double)(bench_cycles() - c0) / (double)iters;
+
+        if((rep == 0) || (ns < best_ns))
+        {
+            best_ns  = ns;
+            best_cyc = cyc;
+        }
+    }
+
+    (void)sink;
+    bench_report(name, nfc_corpus_name(ctx->corpus.kind),
+                 best_ns / (double)ctx->corpus.record_cnt,
+                 (double)bytes_per_pass * 1e9 / best_ns,
+                 best_cyc / (double)bytes_per_pass);
+}
+
+/* ---- Benchmarked paths ---------------------------------------------------------------- */
+
+static size_t bench_tlv_walk(const bench_ctx_t *ctx)
+{
+    size_t found = 0;
+
+    for(size_t n = 0; n < ctx->corpus.image_cnt; n++)
+    {
+        uint8_t *img  = nfc_corpus_image(&ctx->corpus, n);
+        size_t   size = ctx->corpus.image_size;
+        size_t   offset = T2T_FIRST_DATA_BLOCK_OFFSET;
+
+        while(offset < size)
+        {
+            tlv_t  tlv;
+            size_t br = 1;
+
+            if(t2t_parse_next_tlv(img + offset, size - offset, &tlv, &br) == TLV_OK)
+            {
+                if(tlv.type == TLV_TERMINATOR)
+                    break;
+                found++;
+            }
+            offset += br;
+        }
+    }
+
+    return found;
+}
+
+static size_t bench_tlv_stream(const bench_ctx_t *ctx)
+{
+    size_t found = 0;
+
+    for(size_t n = 0; n < ctx->corpus.image_cnt; n++)
+    {
+        uint8_t     *img  = nfc_corpus_image(&ctx->corpus, n);
+        size_t       size = ctx->corpus.image_size;
+        tlv_stream_t stream;
+
+        /* READ responses land in place in the image buffer, as a reader would store them. */
+        tlv_stream_init(&stream, img + T2T_FIRST_DATA_BLOCK_OFFSET, size - T2T_FIRST_DATA_BLOCK_OFFSET);
+
+        for(size_t off = T2T_FIRST_DATA_BLOCK_OFFSET; off < size && !stream.done; off += T2T_READ_SIZE)
+        {
+            size_t       chunk = (size - off < T2T_READ_SIZE) ? size - off : T2T_READ_SIZE;
+            tlv_t        tlv;
+            tlv_status_t rslt;
+
+            tlv_stream_feed(&stream, img + off, chunk);
+            while(((rslt = tlv_stream_next(&stream, &tlv)) != TLV_E_INCOMPLETE) && (rslt != TLV_E_END))
+            {
+                if(rslt == TLV_OK)
+                    found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+static size_t bench_t2t_parse(const bench_ctx_t *ctx)
+{
+    tlv_t  tlvs[BENCH_MAX_TLVS];
+    size_t found = 0;
+
+    for(size_t n = 0; n < ctx->corpus.image_cnt; n++)
+    {
+        type_2_tag_t tag = { .max_tlv_blocks = BENCH_MAX_TLVS, .p_tlv_block_array = tlvs };
+
+        if(type_2_tag_parse(&tag, nfc_corpus_image(&ctx->corpus, n)) == T2T_OK)
+            found += tag.tlv_count;
+    }
+
+    return found;
+}
+
+static size_t bench_ndef_walk(const bench_ctx_t *ctx)
+{
+    size_t found = 0;
+
+    for(size_t n = 0; n < ctx->corpus.image_cnt; n++)
+    {
+        size_t offset = 0;
+
+        while(offset < ctx->ndef_len[n])
+        {
+            ndef_record_t rec;
+            size_t        br;
+
+            if(ndef_parse_next_rec(ctx->ndef[n] + offset, ctx->ndef_len[n] - offset, &rec, &br) != NDEF_OK)
+                break;
+            offset += br;
+            found++;
+        }
+    }
+
+    return found;
+}
+
+static size_t bench_ndef_index(const bench_ctx_t *ctx)
+{
+    uint32_t     storage[NDEF_INDEX_STORAGE_WORDS(BENCH_MAX_RECORDS)];
+    ndef_index_t idx;
+    size_t       found = 0;
+
+    ndef_index_init(&idx, storage, BENCH_MAX_RECORDS);
+
+    for(size_t n = 0; n < ctx->corpus.image_cnt; n++)
+    {
+        if(ndef_index_build(&idx, ctx->ndef[n], ctx->ndef_len[n]) == NDEF_OK)
+            found += idx.rec_cnt;
+    }
+
+    return found;
+}
+
+static size_t bench_ndef_chunked(const bench_ctx_t *ctx)
+{
+    ndef_segment_t        segs[BENCH_MAX_SEGS];
+    ndef_chunked_record_t crec = { .segs = segs, .max_segs = BENCH_MAX_SEGS };
+    size_t                found = 0;
+
+    for(size_t n = 0; n < ctx->corpus.image_cnt; n++)
+    {
+        size_t offset = 0;
+
+        while(offset < ctx->ndef_len[n])
+        {
+            size_t br;
+
+            if(ndef_parse_next_chunked_rec(ctx->ndef[n] + offset, ctx->ndef_len[n] - offset, &crec, &br) != NDEF_OK)
+                break;
+            offset += br;
+            found  += crec.seg_cnt;
+        }
+    }
+
+    return found;
+}
+
+/* ---- Groups ---------------------------------------------------------------------------- */
+
+static int bench_ctx_init(bench_ctx_t *ctx, nfc_corpus_kind_t kind, size_t image_cnt)
+{
+    memset(ctx, 0, sizeof(*ctx));
+
+    if(nfc_corpus_generate(&ctx->corpus, kind, image_cnt, 0x1234567u + (uint32_t)kind) != 0)
+        return -1;
+
+    ctx->ndef     = malloc(image_cnt * sizeof(*ctx->ndef));
+    ctx->ndef_len = malloc(image_cnt * sizeof(*ctx->ndef_len));
+    if((ctx->ndef == NULL) || (ctx->ndef_len == NULL))
+        return -1;
+
+    for(size_t n = 0; n < image_cnt; n++)
+    {
+        tlv_t        tlvs[BENCH_MAX_TLVS];
+        type_2_tag_t tag = { .max_tlv_blocks = BENCH_MAX_TLVS, .p_tlv_block_array = tlvs };
+
+        ctx->ndef[n]     = NULL;
+        ctx->ndef_len[n] = 0;
+        ctx->data_bytes += ctx->corpus.image_size - T2T_FIRST_DATA_BLOCK_OFFSET;
+
+        type_2_tag_parse(&tag, nfc_corpus_image(&ctx->corpus, n));
+        for(uint16_t i = 0; i < tag.tlv_count; i++)
+        {
+            if(tlvs[i].type == TLV_NDEF_MESSAGE)
+            {
+                ctx->ndef[n]     = tlvs[i].value;
+                ctx->ndef_len[n] = tlvs[i].length;
+                ctx->ndef_bytes += tlvs[i].length;
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void bench_ctx_free(bench_ctx_t *ctx)
+{
+    nfc_corpus_free(&ctx->corpus);
+    free(ctx->ndef);
+    free(ctx->ndef_len);
+}
+
+static void bench_parsers(void)
+{
+    if(!bench_json)
+        printf("%-14s %-14s %12s %14s %10s\n", "bench", "corpus", "ns/record", "MB/s", "cyc/byte");
+
+    for(int kind = 0; kind < NFC_CORPUS_KIND_CNT; kind++)
+    {
+        bench_ctx_t ctx;
+
+        if(bench_ctx_init(&ctx, (nfc_corpus_kind_t)kind, bench_image_cnt) == 0)
+        {
+            bench_run("tlv_walk",     bench_tlv_walk,     &ctx, ctx.data_bytes);
+            bench_run("tlv_stream",   bench_tlv_stream,   &ctx, ctx.data_bytes);
+            bench_run("t2t_parse",    bench_t2t_parse,    &ctx, ctx.data_bytes);
+            bench_run("ndef_walk",    bench_ndef_walk,    &ctx, ctx.ndef_bytes);
+            bench_run("ndef_index",   bench_ndef_index,   &ctx, ctx.ndef_bytes);
+            bench_run("ndef_chunked", bench_ndef_chunked, &ctx, ctx.ndef_bytes);
+        }
+
+        bench_ctx_free(&ctx);
+    }
+}
+
+/*
+ * @brief Build a TLV image of the given size that is mostly NULL padding.
+ *
+ * Lock control TLV, padding, a short NDEF message TLV near the end and a TERMINATOR.
+ */
+static void bench_make_padded_image(uint8_t *img, size_t size)
+{
+    static const uint8_t lock_ctrl[] = { TLV_LOCK_CONTROL, 3, 0xA0, 0x10, 0x44 };
+    static const uint8_t ndef[]      = { TLV_NDEF_MESSAGE, 7, 0xD1, 0x01, 0x03, 'U', 0x04, 'a', '.' };
+
+    memset(img, TLV_NULL, size);
+    memcpy(img, lock_ctrl, sizeof(lock_ctrl));
+    memcpy(img + size - sizeof(ndef) - 1, ndef, sizeof(ndef));
+    img[size - 1] = TLV_TERMINATOR;
+}
+
+/*
+ * @brief Walk the image one TLV at a time, as callers did before tlv_skip_null().
+ */
+static size_t bench_walk_bytewise(uint8_t *img, size_t size)
+{
+    size_t offset = 0, found = 0;
+
+    while(offset < size)
+    {
+        tlv_t  tlv;
+        size_t br = 1;
+
+        if(t2t_parse_next_tlv(img + offset, size - offset, &tlv, &br) == TLV_OK)
+        {
+            if(tlv.type == TLV_TERMINATOR)
+                break;
+            if(tlv.type != TLV_NULL)
+                found++;
+        }
+        offset += br;
+    }
+
+    return found;
+}
+
+/*
+ * @brief Walk the image jumping over NULL padding.
+ */
+static size_t bench_walk_skip(uint8_t *img, size_t size)
+{
+    size_t offset = 0, found = 0;
+
+    while(offset < size)
+    {
+        offset += tlv_skip_null(img + offset, size - offset);
+        if(offset == size)
+            break;
+
+        tlv_t  tlv;
+        size_t br = 1;
+
+        if(t2t_parse_next_tlv(img + offset, size - offset, &tlv, &br) == TLV_OK)
+        {
+            if(tlv.type == TLV_TERMINATOR)
+                break;
+            found++;
+        }
+        offset += br;
+    }
+
+    return found;
+}
+
+/*
+ * @brief Time a walker over the image, returning nanoseconds per image.
+ */
+static double bench_time(size_t (*walk)(uint8_t *, size_t), uint8_t *img, size_t size)
+{
+    unsigned long long start = bench_now_ns(), elapsed;
+    unsigned long      iters = 0;
+    volatile size_t    sink  = 0;
+
+    do
+    {
+        for(int i = 0; i < 64; i++)
+            sink += walk(img, size);
+        iters += 64;
+        elapsed = bench_now_ns() - start;
+    } while(elapsed < BENCH_MIN_NS);
+
+    (void)sink;
+    return (double)elapsed / (double)iters;
+}
+
+static void bench_null_skip(void)
+{
+    /* Type 2 (NTAG213..NTAG216, 1 KB) and Type 5 (up to 8 KB) sized images. */
+    static const size_t sizes[] = { 144, 504, 888, 1024, 2048, 4096, 8192 };
+
+    if(!bench_json)
+        printf("%-8s %14s %14s %8s\n", "size", "bytewise ns", "skip ns", "speedup");
+
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        uint8_t *img = malloc(sizes[i]);
+        if(img == NULL)
+            return;
+
+        bench_make_padded_image(img, sizes[i]);
+
+        double slow = bench_time(bench_walk_bytewise, img, sizes[i]);
+        double fast = bench_time(bench_walk_skip, img, sizes[i]);
+
+        if(bench_json)
+            printf("{\"bench\":\"null_skip\",\"size\":%lu,\"bytewise_ns\":%.1f,\"skip_ns\":%.1f}\n",
+                   (unsigned long)sizes[i], slow, fast);
+        else
+            printf("%-8lu %14.1f %14.1f %7.1fx\n", (unsigned long)sizes[i], slow, fast, slow / fast);
+        free(img);
+    }
+}
+
+#define BENCH_TEXT_SIZE     512     /* UTF-8 bytes per Text record, about a full NTAG216. */
+
+/*
+ * @brief Sample sentences the Text records are filled with.
+ */
+static const struct
+{
+    const char *lang;
+    const char *sample;
+} bench_texts[] =
+{
+    { "en",    "The quick brown fox jumps over the lazy dog. " },
+    { "de",    "Zw\xC3\xB6lf Boxk\xC3\xA4mpfer jagen Viktor quer \xC3\xBC" "ber den gro\xC3\x9F" "en Sylter Deich. " },
+    { "ru",    "\xD0\xA1\xD1\x8A\xD0\xB5\xD1\x88\xD1\x8C \xD0\xB6\xD0\xB5 \xD0\xB5\xD1\x89\xD1\x91 "
+               "\xD1\x8D\xD1\x82\xD0\xB8\xD1\x85 \xD0\xBC\xD1\x8F\xD0\xB3\xD0\xBA\xD0\xB8\xD1\x85 "
+               "\xD0\xB1\xD1\x83\xD0\xBB\xD0\xBE\xD0\xBA. " },
+    { "ja",    "\xE3\x81\x84\xE3\x82\x8D\xE3\x81\xAF\xE3\x81\xAB\xE3\x81\xBB\xE3\x81\xB8\xE3\x81\xA8"
+               "\xE3\x81\xA1\xE3\x82\x8A\xE3\x81\xAC\xE3\x82\x8B\xE3\x82\x92\xE3\x80\x82" },
+    { "zh",    "\xE6\x88\x91\xE8\x83\xBD\xE5\x90\x9E\xE4\xB8\x8B\xE7\x8E\xBB\xE7\x92\x83\xE8\x80\x8C"
+               "\xE4\xB8\x8D\xE4\xBC\xA4\xE8\xBA\xAB\xE4\xBD\x93\xE3\x80\x82" },
+    { "emoji", "Tap here \xF0\x9F\x91\x89 to check in \xE2\x9C\x85 \xF0\x9F\x8E\x89 " },
+};
+
+static uint8_t bench_text_out[RTD_TEXT_UTF8_MAX_SIZE(2 * BENCH_TEXT_SIZE)];
+
+/*
+ * @brief Fill a buffer with whole repetitions of a sample, cut at a character boundary.
+ */
+static size_t bench_make_text(uint8_t *buf, size_t size, const char *sample)
+{
+    size_t len = 0, n = strlen(sample);
+
+    while(len < size)
+    {
+        size_t k = (size - len < n) ? size - len : n;
+        memcpy(buf + len, sample, k);
+        len += k;
+    }
+    while((len > 0) && ((buf[len - 1] & 0xC0) == 0x80))
+        len--;
+    if((len > 0) && (buf[len - 1] >= 0xC0))
+        len--;
+
+    return len;
+}
+
+/*
+ * @brief Convert valid UTF-8 to UTF-16BE.
+ */
+static size_t bench_make_utf16(uint8_t *out, const uint8_t *s, size_t len)
+{
+    size_t o = 0;
+
+    for(size_t i = 0; i < len;)
+    {
+        uint32_t cp;
+        if(s[i] < 0x80)      { cp = s[i]; i += 1; }
+        else if(s[i] < 0xE0) { cp = ((s[i] & 0x1Fu) << 6) | (s[i + 1] & 0x3Fu); i += 2; }
+        else if(s[i] < 0xF0) { cp = ((s[i] & 0x0Fu) << 12) | ((s[i + 1] & 0x3Fu) << 6) | (s[i + 2] & 0x3Fu); i += 3; }
+        else                 { cp = ((s[i] & 0x07u) << 18) | ((s[i + 1] & 0x3Fu) << 12) |
+                               ((s[i + 2] & 0x3Fu) << 6) | (s[i + 3] & 0x3Fu); i += 4; }
+
+        if(cp >= 0x10000)
+        {
+            cp -= 0x10000;
+            out[o++] = (uint8_t)(0xD8 | (cp >> 18));
+            out[o++] = (uint8_t)(cp >> 10);
+            cp = 0xDC00 | (cp & 0x3FF);
+        }
+        out[o++] = (uint8_t)(cp >> 8);
+        out[o++] = (uint8_t)cp;
+    }
+
+    return o;
+}
+
+/*
+ * @brief Validate UTF-8 one byte at a time, as a per-character library call would.
+ */
+static size_t bench_utf8_bytewise(uint8_t *s, size_t len)
+{
+    size_t i = 0;
+
+    while(i < len)
+    {
+        uint8_t  c = s[i];
+        size_t   n = (c < 0x80) ? 0 : (c < 0xC2) ? 4 : (c < 0xE0) ? 1 : (c < 0xF0) ? 2 : (c < 0xF5) ? 3 : 4;
+        uint32_t cp = (n == 0) ? c : (n == 1) ? (c & 0x1Fu) : (n == 2) ? (c & 0x0Fu) : (c & 0x07u);
+
+        if((n == 4) || (len - i - 1 < n))
+            return i;
+        for(size_t k = 1; k <= n; k++)
+        {
+            if((s[i + k] & 0xC0) != 0x80)
+                return i;
+            cp = (cp << 6) | (s[i + k] & 0x3Fu);
+        }
+        if(((n == 2) && (cp < 0x800)) || ((n == 3) && (cp < 0x10000)) ||
+           ((cp >= 0xD800) && (cp <= 0xDFFF)) || (cp > 0x10FFFF))
+            return i;
+        i += n + 1;
+    }
+
+    return i;
+}
+
+static size_t bench_utf8_simd(uint8_t *s, size_t len)
+{
+    size_t valid;
+    rtd_utf8_validate(s, len, &valid);
+    return valid;
+}
+
+/*
+ * @brief Convert UTF-16BE to UTF-8 one code unit at a time.
+ */
+static size_t bench_utf16_unitwise(uint8_t *s, size_t len)
+{
+    size_t o = 0;
+
+    for(size_t i = 0; i + 1 < len; i += 2)
+    {
+        uint32_t cp = ((uint32_t)s[i] << 8) | s[i + 1];
+
+        if((cp >= 0xD800) && (cp <= 0xDBFF) && (i + 3 < len))
+        {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + ((((uint32_t)s[i + 2] << 8) | s[i + 3]) - 0xDC00);
+            i += 2;
+        }
+
+        if(cp < 0x80)
+        {
+            bench_text_out[o++] = (uint8_t)cp;
+        }
+        else if(cp < 0x800)
+        {
+            bench_text_out[o++] = (uint8_t)(0xC0 | (cp >> 6));
+            bench_text_out[o++] = (uint8_t)(0x80 | (cp & 0x3F));
+        }
+        else if(cp < 0x10000)
+        {
+            bench_text_out[o++] = (uint8_t)(0xE0 | (cp >> 12));
+            bench_text_out[o++] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+            bench_text_out[o++] = (uint8_t)(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            bench_text_out[o++] = (uint8_t)(0xF0 | (cp >> 18));
+            bench_text_out[o++] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+            bench_text_out[o++] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+            bench_text_out[o++] = (uint8_t)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    return o;
+}
+
+static size_t bench_utf16_simd(uint8_t *s, size_t len)
+{
+    size_t bw = 0;
+    rtd_utf16_to_utf8(s, len, 0, (char *)bench_text_out, sizeof(bench_text_out), &bw);
+    return bw;
+}
+
+static void bench_text(void)
+{
+    static uint8_t utf8[BENCH_TEXT_SIZE], utf16[2 * BENCH_TEXT_SIZE];
+
+    if(!bench_json)
+        printf("%-6s %-7s %6s %14s %14s %8s\n", "lang", "from", "bytes", "scalar ns", "simd ns", "speedup");
+
+    for(size_t i = 0; i < sizeof(bench_texts) / sizeof(bench_texts[0]); i++)
+    {
+        size_t len8  = bench_make_text(utf8, sizeof(utf8), bench_texts[i].sample);
+        size_t len16 = bench_make_utf16(utf16, utf8, len8);
+
+        const struct
+        {
+            const char *from;
+            uint8_t    *buf;
+            size_t     len;
+            size_t     (*scalar)(uint8_t *, size_t);
+            size_t     (*simd)(uint8_t *, size_t);
+        } cases[] =
+        {
+            { "utf-8",  utf8,  len8,  bench_utf8_bytewise,  bench_utf8_simd  },
+            { "utf-16", utf16, len16, bench_utf16_unitwise, bench_utf16_simd },
+        };
+
+        for(size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+        {
+            double slow = bench_time(cases[c].scalar, cases[c].buf, cases[c].len);
+            double fast = bench_time(cases[c].simd, cases[c].buf, cases[c].len);
+
+            if(bench_json)
+                printf("{\"bench\":\"text\",\"lang\":\"%s\",\"from\":\"%s\",\"bytes\":%lu,"
+                       "\"scalar_ns\":%.1f,\"simd_ns\":%.1f}\n",
+                       bench_texts[i].lang, cases[c].from, (unsigned long)cases[c].len, slow, fast);
+            else
+                printf("%-6s %-7s %6lu %14.1f %14.1f %7.1fx\n", bench_texts[i].lang, cases[c].from,
+                       (unsigned long)cases[c].len, slow, fast, slow / fast);
+        }
+    }
+}
+
+static void bench_batch(void)
+{
+    const size_t image_cnt = bench_image_cnt * 100;
+    long         cpus      = sysconf(_SC_NPROCESSORS_ONLN);
+    nfc_corpus_t corpus;
+
+    if(nfc_corpus_generate(&corpus, NFC_CORPUS_NTAG216, image_cnt, 42) != 0)
+        return;
+
+    nfc_image_t        *images  = malloc(image_cnt * sizeof(nfc_image_t));
+    nfc_batch_result_t *results = malloc(image_cnt * sizeof(nfc_batch_result_t));
+    nfc_batch_storage_t storage = { .max_tlvs = 4, .max_records = 4 };
+
+    storage.tlv_storage   = malloc(image_cnt * storage.max_tlvs * sizeof(tlv_t));
+    storage.index_storage = malloc(image_cnt * NDEF_INDEX_STORAGE_WORDS(storage.max_records) * sizeof(uint32_t));
+
+    if(images && results && storage.tlv_storage && storage.index_storage)
+    {
+        for(size_t n = 0; n < image_cnt; n++)
+        {
+            images[n].data = nfc_corpus_image(&corpus, n);
+            images[n].len  = corpus.image_size;
+        }
+
+        if(!bench_json)
+            printf("%-8s %16s %8s\n", "threads", "images/s", "scaling");
+
+        double base = 0;
+        for(unsigned threads = 1; threads <= (unsigned)((cpus > 0) ? cpus : 1); threads *= 2)
+        {
+            unsigned long long start = bench_now_ns();
+            nfc_batch_parse_parallel(images, image_cnt, results, &storage, threads);
+            double rate = (double)image_cnt * 1e9 / (double)(bench_now_ns() - start);
+
+            if(base == 0)
+                base = rate;
+            if(bench_json)
+                printf("{\"bench\":\"batch\",\"threads\":%u,\"images_per_s\":%.0f}\n", threads, rate);
+            else
+                printf("%-8u %16.0f %7.2fx\n", threads, rate, rate / base);
+        }
+    }
+
+    nfc_corpus_free(&corpus);
+    free(images);
+    free(results);
+    free(storage.tlv_storage);
+    free(storage.index_storage);
+}
+
+#define BENCH_RING_SLOTS    256     /* Slots shared by the producers and consumers. */
+#define BENCH_RING_BURST    16      /* Images batch-parsed per consume. */
+#define BENCH_RING_MAX_THREADS  4   /* Most producers or consumers in one run. */
+
+/*
+ * @brief Mutex-protected queue of slot numbers, the baseline for the ring.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    uint32_t        free_slots[BENCH_RING_SLOTS];
+    uint32_t        full_slots[BENCH_RING_SLOTS];
+    size_t          free_head, free_cnt;
+    size_t          full_head, full_cnt;
+    uint8_t         *data;
+    size_t          lens[BENCH_RING_SLOTS];
+} bench_lock_queue_t;
+
+typedef struct
+{
+    nfc_ring_t          *ring;      /* Lock-free ring, or NULL for lock_q */
+    bench_lock_queue_t  *lock_q;
+    const nfc_corpus_t  *corpus;
+    size_t              per_producer;
+    size_t              total;
+    atomic_size_t       consumed;
+} bench_ring_job_t;
+
+static int bench_lq_take(bench_lock_queue_t *q, int full, uint32_t *slots, size_t max)
+{
+    uint32_t *ring = full ? q->full_slots : q->free_slots;
+    size_t   *head = full ? &q->full_head : &q->free_head;
+    size_t   *cnt  = full ? &q->full_cnt  : &q->free_cnt;
+    size_t   n     = 0;
+
+    pthread_mutex_lock(&q->lock);
+    for(; (n < max) && (*cnt != 0); n++, (*cnt)--)
+    {
+        slots[n] = ring[*head];
+        *head    = (*head + 1) % BENCH_RING_SLOTS;
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return (int)n;
+}
+
+static void bench_lq_put(bench_lock_queue_t *q, int full, const uint32_t *slots, size_t n)
+{
+    uint32_t *ring = full ? q->full_slots : q->free_slots;
+    size_t   *head = full ? &q->full_head : &q->free_head;
+    size_t   *cnt  = full ? &q->full_cnt  : &q->free_cnt;
+
+    pthread_mutex_lock(&q->lock);
+    for(size_t i = 0; i < n; i++, (*cnt)++)
+        ring[(*head + *cnt) % BENCH_RING_SLOTS] = slots[i];
+    pthread_mutex_unlock(&q->lock);
+}
+
+/*
+ * @brief Reader thread: copy corpus images into free slots, as a reader
+ *        storing READ responses would, and publish them.
+ */
+static void *bench_ring_producer(void *arg)
+{
+    bench_ring_job_t *job = arg;
+
+    for(size_t i = 0; i < job->per_producer; i++)
+    {
+        const uint8_t *src = nfc_corpus_image(job->corpus, i % job->corpus->image_cnt);
+        uint32_t      slot;
+        nfc_image_t   image;
+
+        if(job->ring != NULL)
+        {
+            while(nfc_ring_acquire(job->ring, &slot, &image) != NFC_RING_OK)
+                sched_yield();
+            memcpy(image.data, src, job->corpus->image_size);
+            nfc_ring_publish(job->ring, slot, job->corpus->image_size);
+        }
+        else
+        {
+            while(bench_lq_take(job->lock_q, 0, &slot, 1) == 0)
+                sched_yield();
+            memcpy(job->lock_q->data + (size_t)slot * job->corpus->image_size, src, job->corpus->image_size);
+            job->lock_q->lens[slot] = job->corpus->image_size;
+            bench_lq_put(job->lock_q, 1, &slot, 1);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * @brief Parser worker: take bursts of images and batch-parse them in place.
+ */
+static void *bench_ring_consumer(void *arg)
+{
+    bench_ring_job_t    *job = arg;
+    uint32_t            slots[BENCH_RING_BURST];
+    nfc_image_t         images[BENCH_RING_BURST];
+    nfc_batch_result_t  results[BENCH_RING_BURST];
+    tlv_t               tlvs[BENCH_RING_BURST * BENCH_MAX_TLVS];
+    uint32_t            index[BENCH_RING_BURST * NDEF_INDEX_STORAGE_WORDS(BENCH_MAX_RECORDS)];
+    nfc_batch_storage_t storage = { BENCH_MAX_TLVS, BENCH_MAX_RECORDS, tlvs, index };
+
+    while(atomic_load_explicit(&job->consumed, memory_order_relaxed) < job->total)
+    {
+        size_t cnt = 0;
+
+        if(job->ring != NULL)
+        {
+            nfc_ring_consume_batch(job->ring, slots, images, BENCH_RING_BURST, &cnt);
+        }
+        else
+        {
+            cnt = (size_t)bench_lq_take(job->lock_q, 1, slots, BENCH_RING_BURST);
+            for(size_t i = 0; i < cnt; i++)
+            {
+                images[i].data = job->lock_q->data + (size_t)slots[i] * job->corpus->image_size;
+                images[i].len  = job->lock_q->lens[slots[i]];
+            }
+        }
+
+        if(cnt == 0)
+        {
+            sched_yield();
+            continue;
+        }
+
+        nfc_batch_parse(images, cnt, results, &storage);
+
+        if(job->ring != NULL)
+            nfc_ring_release_batch(job->ring, slots, cnt);
+        else
+            bench_lq_put(job->lock_q, 0, slots, cnt);
+
+        atomic_fetch_add_explicit(&job->consumed, cnt, memory_order_relaxed);
+    }
+
+    return NULL;
+}
+
+/*
+ * @brief Images per second moved from producers to consumers through one queue.
+ */
+static double bench_ring_run(bench_ring_job_t *job, unsigned producers, unsigned consumers)
+{
+    pthread_t threads[2 * BENCH_RING_MAX_THREADS];
+    unsigned  started = 0;
+
+    job->total = job->per_producer * producers;
+    atomic_store(&job->consumed, 0);
+
+    unsigned long long start = bench_now_ns();
+
+    for(unsigned i = 0; i < consumers; i++)
+        started += (pthread_create(&threads[started], NULL, bench_ring_consumer, job) == 0);
+    for(unsigned i = 0; i < producers; i++)
+        started += (pthread_create(&threads[started], NULL, bench_ring_producer, job) == 0);
+    for(unsigned i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    return (double)job->total * 1e9 / (double)(bench_now_ns() - start);
+}
+
+static void bench_ring(void)
+{
+    static const unsigned pairs[][2] = { { 1, 1 }, { 2, 2 }, { 4, 2 }, { 4, 4 } };
+
+    nfc_corpus_t       corpus;
+    bench_lock_queue_t lock_q;
+    bench_ring_job_t   job = { .corpus = &corpus, .per_producer = bench_image_cnt * 50 };
+
+    if(nfc_corpus_generate(&corpus, NFC_CORPUS_NTAG216, bench_image_cnt, 42) != 0)
+        return;
+
+    lock_q.data = malloc(BENCH_RING_SLOTS * corpus.image_size);
+    if((lock_q.data == NULL) ||
+       (nfc_ring_create(&job.ring, BENCH_RING_SLOTS, corpus.image_size) != NFC_RING_OK))
+    {
+        free(lock_q.data);
+        nfc_corpus_free(&corpus);
+        return;
+    }
+    pthread_mutex_init(&lock_q.lock, NULL);
+
+    if(!bench_json)
+        printf("%-10s %-10s %16s %16s %8s\n", "producers", "consumers", "mutex images/s", "ring images/s", "speedup");
+
+    for(size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++)
+    {
+        nfc_ring_t *ring = job.ring;
+
+        lock_q.free_head = lock_q.full_head = lock_q.full_cnt = 0;
+        lock_q.free_cnt  = BENCH_RING_SLOTS;
+        for(uint32_t s = 0; s < BENCH_RING_SLOTS; s++)
+            lock_q.free_slots[s] = s;
+
+        job.ring   = NULL;
+        job.lock_q = &lock_q;
+        double locked = bench_ring_run(&job, pairs[i][0], pairs[i][1]);
+
+        job.ring = ring;
+        double lock_free = bench_ring_run(&job, pairs[i][0], pairs[i][1]);
+
+        if(bench_json)
+            printf("{\"bench\":\"ring\",\"producers\":%u,\"consumers\":%u,"
+                   "\"mutex_images_per_s\":%.0f,\"ring_images_per_s\":%.0f}\n",
+                   pairs[i][0], pairs[i][1], locked, lock_free);
+        else
+            printf("%-10u %-10u %16.0f %16.0f %7.2fx\n",
+                   pairs[i][0], pairs[i][1], locked, lock_free, lock_free / locked);
+    }
+
+    pthread_mutex_destroy(&lock_q.lock);
+    nfc_ring_destroy(job.ring);
+    free(lock_q.data);
+    nfc_corpus_free(&corpus);
+}
+
+#define BENCH_ARCHIVE_SCAN  256     /* Records collected per nfc_archive_scan_type call. */
+
+/*
+ * @brief Growable memory sink for nfc_archive_write.
+ */
+typedef struct
+{
+    uint8_t *data;
+    size_t  len;
+    size_t  cap;
+} bench_sink_t;
+
+/*
+ * @brief Query "tags with a URI record whose host is 'host'", over raw images or an archive.
+ */
+typedef struct
+{
+    const nfc_corpus_t  *corpus;
+    const nfc_archive_t *arc;
+    rtd_str_t           host;
+} bench_query_t;
+
+static int bench_sink_write(void *ctx, const void *data, size_t len)
+{
+    bench_sink_t *sink = ctx;
+
+    if(sink->cap - sink->len < len)
+    {
+        size_t  cap = (sink->len + len) * 2;
+        uint8_t *p  = realloc(sink->data, cap);
+        if(p == NULL)
+            return -1;
+        sink->data = p;
+        sink->cap  = cap;
+    }
+
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    return 0;
+}
+
+/*
+ * @brief Host part of a URI record: the URI after its prefix, up to the first '/' or ':'.
+ */
+static rtd_str_t bench_uri_host(const ndef_record_t *rec)
+{
+    rtd_uri_t uri;
+    rtd_str_t host = { NULL, 0 };
+
+    if(rtd_uri_decode(rec, &uri) == RTD_OK)
+    {
+        host.data = uri.rest.data;
+        while((host.len < uri.rest.len) && (host.data[host.len] != '/') && (host.data[host.len] != ':'))
+            host.len++;
+    }
+
+    return host;
+}
+
+static int bench_host_is(const ndef_record_t *rec, rtd_str_t host)
+{
+    rtd_str_t h = bench_uri_host(rec);
+    return (h.data != NULL) && (h.len == host.len) && !memcmp(h.data, host.data, h.len);
+}
+
+static size_t bench_query_reparse(const bench_query_t *q)
+{
+    tlv_t  tlvs[BENCH_MAX_TLVS];
+    size_t found = 0;
+
+    for(size_t n = 0; n < q->corpus->image_cnt; n++)
+    {
+        type_2_tag_t tag = { .max_tlv_blocks = BENCH_MAX_TLVS, .p_tlv_block_array = tlvs };
+
+        if(type_2_tag_parse(&tag, nfc_corpus_image(q->corpus, n)) != T2T_OK)
+            continue;
+
+        for(uint16_t t = 0; t < tag.tlv_count; t++)
+        {
+            if(tlvs[t].type != TLV_NDEF_MESSAGE)
+                continue;
+
+            uint8_t       *buf = tlvs[t].value;
+            size_t        len  = tlvs[t].length, br;
+            ndef_record_t rec;
+
+            while(ndef_parse_next_rec(buf, len, &rec, &br) == NDEF_OK)
+            {
+                if(rtd_is_well_known(&rec, "U") && bench_host_is(&rec, q->host))
+                {
+                    found++;
+                    break;
+                }
+                buf += br;
+                len -= br;
+            }
+            break;
+        }
+    }
+
+    return found;
+}
+
+static size_t bench_query_archive(const bench_query_t *q)
+{
+    uint32_t recs[BENCH_ARCHIVE_SCAN], pos = 0, last_tag = UINT32_MAX;
+    uint16_t uri_type;
+    size_t   found = 0;
+
+    if(nfc_archive_find_type(q->arc, TNF_WELL_KNOWN, (const uint8_t *)"U", 1, &uri_type) != NFC_ARCHIVE_OK)
+        return 0;
+
+    while(pos < q->arc->rec_cnt)
+    {
+        size_t cnt = nfc_archive_scan_type(q->arc, uri_type, &pos, recs, BENCH_ARCHIVE_SCAN);
+
+        for(size_t i = 0; i < cnt; i++)
+        {
+            ndef_record_t rec;
+
+            if((nfc_archive_get_record(q->arc, recs[i], &rec) == NFC_ARCHIVE_OK) && bench_host_is(&rec, q->host))
+            {
+                uint32_t tag = nfc_archive_rec_tag(q->arc, recs[i]);
+                found   += (tag != last_tag);
+                last_tag = tag;
+            }
+        }
+    }
+
+    return found;
+}
+
+/*
+ * @brief Time a query, returning nanoseconds per pass.
+ */
+static double bench_time_query(size_t (*query)(const bench_query_t *), const bench_query_t *q, size_t *p_found)
+{
+    unsigned long long start = bench_now_ns(), elapsed;
+    unsigned long      iters = 0;
+
+    do
+    {
+        *p_found = query(q);
+        iters++;
+        elapsed = bench_now_ns() - start;
+    } while(elapsed < BENCH_MIN_NS);
+
+    return (double)elapsed / (double)iters;
+}
+
+/*
+ * @brief Archive every image of a corpus into 'sink'.
+ *
+ * @return Build time in nanoseconds per tag, or 0 on failure.
+ */
+static double bench_archive_build(const nfc_corpus_t *corpus, bench_sink_t *sink)
+{
+    static uint8_t       arena_mem[NFC_BATCH_ARENA_SIZE(888)];
+    nfc_archive_writer_t *writer;
+    nfc_arena_t          arena;
+    int                  ok = 1;
+
+    if(nfc_archive_writer_create(&writer) != NFC_ARCHIVE_OK)
+        return 0;
+
+    nfc_arena_init(&arena, arena_mem, sizeof(arena_mem));
+
+    unsigned long long start = bench_now_ns();
+    for(size_t n = 0; ok && (n < corpus->image_cnt); n++)
+    {
+        nfc_image_t        image = { nfc_corpus_image(corpus, n), corpus->image_size };
+        nfc_batch_result_t result;
+        nfc_archive_tag_t  tag;
+
+        nfc_arena_reset(&arena);
+        nfc_batch_parse_arena(&image, &result, &arena);
+        nfc_archive_tag_from_t2t(&tag, image.data);
+        ok = (nfc_archive_add(writer, &tag, (result.ndef_status == NDEF_OK) ? &result.ndef : NULL) == NFC_ARCHIVE_OK);
+    }
+
+    ok = ok && (nfc_archive_write(writer, bench_sink_write, sink) == NFC_ARCHIVE_OK);
+    double elapsed = (double)(bench_now_ns() - start);
+
+    nfc_archive_writer_destroy(writer);
+    return ok ? elapsed / (double)corpus->image_cnt : 0;
+}
+
+static void bench_archive(void)
+{
+    const size_t  image_cnt = bench_image_cnt * 50;
+    nfc_corpus_t  corpus;
+    bench_sink_t  sink = { NULL, 0, 0 };
+    nfc_archive_t arc;
+    uint16_t      uri_type;
+
+    if(nfc_corpus_generate(&corpus, NFC_CORPUS_NTAG216, image_cnt, 42) != 0)
+        return;
+
+    double build = bench_archive_build(&corpus, &sink);
+
+    if((build > 0) && (nfc_archive_open(&arc, sink.data, sink.len) == NFC_ARCHIVE_OK) &&
+       (nfc_archive_find_type(&arc, TNF_WELL_KNOWN, (const uint8_t *)"U", 1, &uri_type) == NFC_ARCHIVE_OK))
+    {
+        /* Look for the host of a tag in the middle of the corpus. */
+        bench_query_t q   = { &corpus, &arc, { NULL, 0 } };
+        uint32_t      pos = arc.rec_cnt / 2, rec = 0;
+        ndef_record_t uri;
+
+        nfc_archive_scan_type(&arc, uri_type, &pos, &rec, 1);
+        nfc_archive_get_record(&arc, rec, &uri);
+        q.host = bench_uri_host(&uri);
+
+        size_t found_raw, found_arc;
+        double raw = bench_time_query(bench_query_reparse, &q, &found_raw);
+        double col = bench_time_query(bench_query_archive, &q, &found_arc);
+
+        if(found_raw != found_arc)
+            fprintf(stderr, "archive: query found %lu tags, re-parse %lu\n",
+                    (unsigned long)found_arc, (unsigned long)found_raw);
+
+        if(bench_json)
+            printf("{\"bench\":\"archive\",\"tags\":%lu,\"raw_bytes\":%lu,\"archive_bytes\":%lu,"
+                   "\"build_ns_per_tag\":%.1f,\"reparse_ns\":%.0f,\"archive_ns\":%.0f}\n",
+                   (unsigned long)image_cnt, (unsigned long)(image_cnt * corpus.image_size),
+                   (unsigned long)sink.len, build, raw, col);
+        else
+            printf("%lu tags, raw %.1f MB, archive %.1f MB, build %.0f ns/tag\n"
+                   "%-10s %14s %8s\n%-10s %14.2f\n%-10s %14.2f %7.1fx\n",
+                   (unsigned long)image_cnt, (double)(image_cnt * corpus.image_size) / 1e6,
+                   (double)sink.len / 1e6, build, "host query", "ms", "speedup",
+                   "re-parse", raw / 1e6, "archive", col / 1e6, raw / col);
+    }
+
+    free(sink.data);
+    nfc_corpus_free(&corpus);
+}
+
+#define BENCH_EMU_MAX_THREADS   4   /* Most reader threads in one run. */
+
+/*
+ * @brief Emulated tag with the descriptor its image is parsed into.
+ */
+typedef struct
+{
+    nfc_t2t_emu_t emu;
+    type_2_tag_t  tag;
+    tlv_t         tlvs[BENCH_MAX_TLVS];
+} bench_emu_tag_t;
+
+typedef struct
+{
+    bench_emu_tag_t *tags;
+    size_t          tag_cnt;
+    size_t          raw_size;       /* Reader buffer: the tag memory plus one READ */
+    unsigned        id;
+    unsigned        thread_cnt;
+    size_t          taps;           /* Taps made by this thread       */
+    unsigned long   reads;          /* READ commands they needed      */
+} bench_emu_job_t;
+
+/*
+ * @brief Keep the CPU busy, standing in for decoding work.
+ *
+ * Yields on the way so that, on a single core, a transport thread can still
+ * put the next command on the air as a radio would without the CPU.
+ */
+static void bench_spin_us(unsigned us)
+{
+    if(us == 0)
+        return;
+
+    unsigned long long end = bench_now_ns() + (unsigned long long)us * 1000ULL;
+
+    while(bench_now_ns() < end)
+        sched_yield();
+}
+
+/*
+ * @brief Read the NDEF message of an emulated tag as a reader would on a tap.
+ *
+ * @param[in] decode_us : Decoding time spent on each page before the next READ.
+ * @return Number of READ commands issued.
+ */
+static unsigned bench_emu_tap(nfc_t2t_emu_t *emu, uint8_t *raw, size_t raw_size, ndef_index_t *idx,
+                              unsigned decode_us)
+{
+    type_2_tag_read_plan_t plan;
+    uint8_t                block;
+
+    type_2_tag_read_plan_init(&plan, raw_size);
+
+    while((type_2_tag_read_plan_next(&plan, raw, &block) == T2T_OK) && !plan.done)
+    {
+        if(nfc_t2t_emu_read(emu, block, raw + (size_t)block * T2T_BLOCK_SIZE) != NFC_T2T_EMU_OK)
+            break;
+        bench_spin_us(decode_us);
+    }
+
+    if(plan.done && (plan.ndef_offset != 0))
+        ndef_index_build(idx, raw + plan.ndef_offset, plan.ndef_length);
+
+    return plan.read_count;
+}
+
+/*
+ * @brief Reader thread: tap the tags round-robin, starting from its own.
+ */
+static void *bench_emu_reader(void *arg)
+{
+    bench_emu_job_t *job = arg;
+    uint8_t         *raw = malloc(job->raw_size);
+    uint32_t        idx_mem[NDEF_INDEX_STORAGE_WORDS(BENCH_MAX_RECORDS)];
+    ndef_index_t    idx;
+
+    job->reads = 0;
+    if(raw == NULL)
+    {
+        job->taps = 0;
+        return NULL;
+    }
+
+    ndef_index_init(&idx, idx_mem, BENCH_MAX_RECORDS);
+
+    for(size_t i = 0; i < job->taps; i++)
+    {
+        bench_emu_tag_t *t = &job->tags[(job->id + i * job->thread_cnt) % job->tag_cnt];
+        job->reads += bench_emu_tap(&t->emu, raw, job->raw_size, &idx, 0);
+    }
+
+    free(raw);
+    return NULL;
+}
+
+static void bench_emu(void)
+{
+    static const size_t   tag_cnts[]    = { 1, 64 };
+    static const unsigned thread_cnts[] = { 1, 2, 4 };
+
+    const size_t  taps     = bench_image_cnt * 200;
+    const size_t  max_tags = tag_cnts[sizeof(tag_cnts) / sizeof(tag_cnts[0]) - 1];
+    nfc_corpus_t  corpus;
+
+    if(nfc_corpus_generate(&corpus, NFC_CORPUS_NTAG216, max_tags, 42) != 0)
+        return;
+
+    bench_emu_tag_t *tags = malloc(max_tags * sizeof(*tags));
+    size_t          ready = 0;
+
+    for(; (tags != NULL) && (ready < max_tags); ready++)
+    {
+        type_2_tag_t tag = { .max_tlv_blocks = BENCH_MAX_TLVS };
+
+        memcpy(&tags[ready].tag, &tag, sizeof(tag));
+        tags[ready].tag.p_tlv_block_array = tags[ready].tlvs;
+
+        if(nfc_t2t_emu_init(&tags[ready].emu, nfc_corpus_image(&corpus, ready), corpus.image_size,
+                            &tags[ready].tag, NULL) != NFC_T2T_EMU_OK)
+            break;
+    }
+
+    if(ready == max_tags)
+    {
+        if(!bench_json)
+            printf("%-6s %-8s %14s %10s\n", "tags", "threads", "taps/s", "READs/tap");
+
+        for(size_t t = 0; t < sizeof(tag_cnts) / sizeof(tag_cnts[0]); t++)
+        {
+            for(size_t m = 0; m < sizeof(thread_cnts) / sizeof(thread_cnts[0]); m++)
+            {
+                bench_emu_job_t jobs[BENCH_EMU_MAX_THREADS];
+                pthread_t       threads[BENCH_EMU_MAX_THREADS];
+                unsigned        started = 0;
+                size_t          total_taps = 0;
+                unsigned long   total_reads = 0;
+
+                unsigned long long start = bench_now_ns();
+
+                for(unsigned j = 0; j < thread_cnts[m]; j++)
+                {
+                    jobs[j] = (bench_emu_job_t){ tags, tag_cnts[t], corpus.image_size + T2T_READ_SIZE,
+                                                 j, thread_cnts[m], taps, 0 };
+                    if(pthread_create(&threads[started], NULL, bench_emu_reader, &jobs[j]) == 0)
+                        started++;
+                }
+                for(unsigned j = 0; j < started; j++)
+                {
+                    pthread_join(threads[j], NULL);
+                    total_taps  += jobs[j].taps;
+                    total_reads += jobs[j].reads;
+                }
+
+                double rate    = (double)total_taps * 1e9 / (double)(bench_now_ns() - start);
+                double per_tap = (total_taps != 0) ? (double)total_reads / (double)total_taps : 0.0;
+
+                if(bench_json)
+                    printf("{\"bench\":\"emu\",\"tags\":%lu,\"threads\":%u,\"taps_per_s\":%.0f,"
+                           "\"reads_per_tap\":%.2f}\n",
+                           (unsigned long)tag_cnts[t], thread_cnts[m], rate, per_tap);
+                else
+                    printf("%-6lu %-8u %14.0f %10.2f\n",
+                           (unsigned long)tag_cnts[t], thread_cnts[m], rate, per_tap);
+            }
+        }
+    }
+
+    while(ready > 0)
+        nfc_t2t_emu_deinit(&tags[--ready].emu);
+    free(tags);
+    nfc_corpus_free(&corpus);
+}
+
+#define BENCH_ASYNC_TAPS    20  /* Taps timed per latency and decode cost. */
+
+/*
+ * @brief Transport wrapping the simulated one, adding a decode cost per received page.
+ *
+ * The cost is spent after the pipeline's own completion handler has
+ * submitted the next READ and decoded the page, as extra decoding would be.
+ */
+typedef struct bench_async_link
+{
+    nfc_async_transport_t sim;          /* Wrapped simulated transport            */
+    unsigned              decode_us;    /* Busy time added per received page      */
+    pthread_mutex_t       lock;
+    pthread_cond_t        cond;
+    uint8_t               finished;     /* Operation reported its result          */
+    uint8_t               reported;     /* ... and its last page has been decoded */
+    uint8_t               next;         /* Next slot of 'cmds'                    */
+    struct bench_async_cmd
+    {
+        struct bench_async_link *link;
+        nfc_async_io_done_t     done;
+        void                    *ctx;
+    } cmds[NFC_ASYNC_SIM_QUEUE_LEN];
+} bench_async_link_t;
+
+static void bench_async_page_done(void *ctx, nfc_async_status_t status)
+{
+    struct bench_async_cmd *cmd  = ctx;
+    bench_async_link_t     *link = cmd->link;
+
+    cmd->done(cmd->ctx, status);
+    bench_spin_us(link->decode_us);
+
+    pthread_mutex_lock(&link->lock);
+    if(link->finished)
+    {
+        link->reported = 1;
+        pthread_cond_signal(&link->cond);
+    }
+    pthread_mutex_unlock(&link->lock);
+}
+
+static nfc_async_status_t bench_async_read(void *impl, uint8_t block, uint8_t *data,
+                                           nfc_async_io_done_t done, void *ctx)
+{
+    bench_async_link_t *link = impl;
+
+    /* At most two READs of one operation are in flight, far fewer than the slots. */
+    uint8_t slot = link->next;
+    link->next   = (uint8_t)((slot + 1) % NFC_ASYNC_SIM_QUEUE_LEN);
+
+    link->cmds[slot].link = link;
+    link->cmds[slot].done = done;
+    link->cmds[slot].ctx  = ctx;
+
+    return link->sim.read(link->sim.impl, block, data, bench_async_page_done, &link->cmds[slot]);
+}
+
+static void bench_async_op_done(nfc_async_read_t *op, nfc_async_status_t status)
+{
+    bench_async_link_t *link = op->user_ctx;
+
+    (void)status;
+    pthread_mutex_lock(&link->lock);
+    link->finished = 1;
+    pthread_mutex_unlock(&link->lock);
+}
+
+static void bench_async(void)
+{
+    static const unsigned latencies[] = { 100, 500 };
+    static const unsigned decodes[]   = { 0, 100, 500 };
+
+    nfc_corpus_t       corpus;
+    nfc_t2t_emu_t      emu;
+    type_2_tag_t       tag = { .max_tlv_blocks = BENCH_MAX_TLVS };
+    tlv_t              tlvs[BENCH_MAX_TLVS];
+    uint32_t           idx_mem[NDEF_INDEX_STORAGE_WORDS(BENCH_MAX_RECORDS)];
+    ndef_index_t       idx;
+    nfc_async_sim_t    sim;
+    nfc_async_read_t   op;
+    bench_async_link_t link = { .next = 0 };
+    nfc_async_transport_t transport = { &link, bench_async_read };
+
+    if(nfc_corpus_generate(&corpus, NFC_CORPUS_NTAG216, 1, 42) != 0)
+        return;
+
+    size_t  raw_size = corpus.image_size + T2T_READ_SIZE;
+    uint8_t *raw     = malloc(raw_size);
+
+    tag.p_tlv_block_array = tlvs;
+    ndef_index_init(&idx, idx_mem, BENCH_MAX_RECORDS);
+
+    if((raw == NULL) ||
+       (nfc_t2t_emu_init(&emu, nfc_corpus_image(&corpus, 0), corpus.image_size, &tag, NULL) != NFC_T2T_EMU_OK))
+    {
+        free(raw);
+        nfc_corpus_free(&corpus);
+        return;
+    }
+
+    if(nfc_async_sim_init(&sim, &emu, &link.sim) != NFC_ASYNC_OK)
+    {
+        nfc_t2t_emu_deinit(&emu);
+        free(raw);
+        nfc_corpus_free(&corpus);
+        return;
+    }
+
+    pthread_mutex_init(&link.lock, NULL);
+    pthread_cond_init(&link.cond, NULL);
+    nfc_async_read_init(&op, &transport, raw, raw_size, idx_mem, BENCH_MAX_RECORDS, bench_async_op_done, &link);
+
+    if(!bench_json)
+        printf("%-11s %-10s %14s %14s %8s\n", "latency us", "decode us", "sequential ms", "async ms", "speedup");
+
+    for(size_t l = 0; l < sizeof(latencies) / sizeof(latencies[0]); l++)
+    {
+        for(size_t d = 0; d < sizeof(decodes) / sizeof(decodes[0]); d++)
+        {
+            emu.latency.read_us = latencies[l];
+            link.decode_us      = decodes[d];
+
+            unsigned long long start = bench_now_ns();
+            for(int i = 0; i < BENCH_ASYNC_TAPS; i++)
+                bench_emu_tap(&emu, raw, raw_size, &idx, decodes[d]);
+            double seq = (double)(bench_now_ns() - start) / 1e6 / BENCH_ASYNC_TAPS;
+
+            start = bench_now_ns();
+            for(int i = 0; i < BENCH_ASYNC_TAPS; i++)
+            {
+                link.finished = link.reported = 0;
+                if(nfc_async_read_start(&op) != NFC_ASYNC_OK)
+                    break;
+
+                pthread_mutex_lock(&link.lock);
+                while(!link.reported)
+                    pthread_cond_wait(&link.cond, &link.lock);
+                pthread_mutex_unlock(&link.lock);
+            }
+            double async = (double)(bench_now_ns() - start) / 1e6 / BENCH_ASYNC_TAPS;
+
+            if(bench_json)
+                printf("{\"bench\":\"async\",\"latency_us\":%u,\"decode_us\":%u,"
+                       "\"sequential_ms\":%.3f,\"async_ms\":%.3f}\n", latencies[l], decodes[d], seq, async);
+            else
+                printf("%-11u %-10u %14.3f %14.3f %7.2fx\n", latencies[l], decodes[d], seq, async, seq / async);
+        }
+    }
+
+    nfc_async_read_deinit(&op);
+    nfc_async_sim_deinit(&sim);
+    pthread_cond_destroy(&link.cond);
+    pthread_mutex_destroy(&link.lock);
+    nfc_t2t_emu_deinit(&emu);
+    free(raw);
+    nfc_corpus_free(&corpus);
+}
+
+static const struct
+{
+    const char *name;
+    void       (*fn)(void);
+} bench_groups[] =
+{
+    { "parsers",   bench_parsers   },
+    { "null-skip", bench_null_skip },
+    { "batch",     bench_batch     },
+    { "ring",      bench_ring      },
+    { "text",      bench_text      },
+    { "archive",   bench_archive   },
+    { "emu",       bench_emu       },
+    { "async",     bench_async     },
+};
+
+#define BENCH_GROUP_CNT (sizeof(bench_groups) / sizeof(bench_groups[0]))
+
+int main(int argc, char **argv)
+{
+    int selected[BENCH_GROUP_CNT] = { 0 };
+    int any = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "--json"))
+        {
+            bench_json = 1;
+        }
+        else if(!strcmp(argv[i], "--images") && (i + 1 < argc))
+        {
+            bench_image_cnt = strtoul(argv[++i], NULL, 0);
+        }
+        else if(!strcmp(argv[i], "--repeat") && (i + 1 < argc))
+        {
+            bench_repeat = strtoul(argv[++i], NULL, 0);
+            if(bench_repeat == 0)
+                bench_repeat = 1;
+        }
+        else
+        {
+            size_t g = 0;
+            while((g < BENCH_GROUP_CNT) && strcmp(argv[i], bench_groups[g].name))
+                g++;
+            if(g == BENCH_GROUP_CNT)
+            {
+                fprintf(stderr, "unknown benchmark group '%s'\n", argv[i]);
+                return 1;
+            }
+            selected[g] = any = 1;
+        }
+    }
+
+    for(size_t g = 0; g < BENCH_GROUP_CNT; g++)
+    {
+        if(!any || selected[g])
+            bench_groups[g].fn();
+    }
+
+    return 0;
+}
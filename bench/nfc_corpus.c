@@ -0,0 +1,306 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_corpus.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_corpus.c
+ * @brief Synthetic tag-image corpus generator for the benchmarks.
+ */
+#include "nfc_corpus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nfc_ndef.h"
+#include "nfc_tlv_block.h"
+#include "type_2_tag.h"
+
+#define CORPUS_ULTRALIGHT_DATA_SIZE     48
+#define CORPUS_NTAG216_DATA_SIZE        888
+#define CORPUS_MAX_RECORDS              64
+#define CORPUS_CHUNK_SIZE               32
+
+static const char *corpus_names[NFC_CORPUS_KIND_CNT] =
+{
+    "ultralight", "ntag216", "short-records", "long-records", "chunked", "null-padding", "smart-poster",
+    "mixed-records"
+};
+
+/*
+ * @brief xorshift32 generator, good enough for varying the record contents.
+ */
+static uint32_t corpus_rand(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void corpus_fill_text(uint8_t *buf, size_t len, uint32_t *state)
+{
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789 ";
+
+    for(size_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)alphabet[corpus_rand(state) % (sizeof(alphabet) - 1)];
+}
+
+/*
+ * @brief Write UID, check bytes and CC for a tag with the given data area size.
+ */
+static void corpus_write_header(uint8_t *img, size_t data_area_size, uint32_t *state)
+{
+    uint32_t r = corpus_rand(state);
+
+    img[0] = 0x04;
+    img[1] = (uint8_t)r;
+    img[2] = (uint8_t)(r >> 8);
+    img[3] = T2T_CASCADE_TAG ^ img[0] ^ img[1] ^ img[2];
+    img[4] = (uint8_t)(r >> 16);
+    img[5] = (uint8_t)(r >> 24);
+    img[6] = (uint8_t)corpus_rand(state);
+    img[7] = 0x80;
+    img[8] = img[4] ^ img[5] ^ img[6] ^ img[7];
+
+    img[T2T_CC_BLOCK_OFFSET]     = T2T_NFC_FORUM_DEFINED_DATA;
+    img[T2T_CC_BLOCK_OFFSET + 1] = 0x10;
+    img[T2T_CC_BLOCK_OFFSET + 2] = (uint8_t)(data_area_size / T2T_DATA_AREA_SIZE_UNIT);
+    img[T2T_CC_BLOCK_OFFSET + 3] = 0x00;
+}
+
+static void corpus_set_rec(ndef_record_t *rec, uint8_t tnf, const char *type, uint8_t *payload, size_t payload_len)
+{
+    memset(rec, 0, sizeof(*rec));
+    rec->header      = tnf;
+    rec->type_len    = (uint8_t)strlen(type);
+    rec->type        = (uint8_t *)type;
+    rec->payload     = payload;
+    rec->payload_len = payload_len;
+}
+
+/*
+ * @brief Build the records of one image into 'recs', using 'scratch' for payloads.
+ *
+ * @return Number of records.
+ */
+static size_t corpus_build_records(nfc_corpus_kind_t kind, ndef_record_t *recs, uint8_t *scratch, uint32_t *state)
+{
+    size_t  cnt = 0;
+    uint8_t *p  = scratch;
+
+    switch(kind)
+    {
+    case NFC_CORPUS_ULTRALIGHT:
+    case NFC_CORPUS_NULL_PADDING:
+    {
+        size_t len = 8 + corpus_rand(state) % 8;
+        p[0] = 0x04; /* https:// */
+        corpus_fill_text(p + 1, len, state);
+        corpus_set_rec(&recs[cnt++], TNF_WELL_KNOWN, "U", p, len + 1);
+        break;
+    }
+    case NFC_CORPUS_NTAG216:
+    {
+        size_t len = 20 + corpus_rand(state) % 40;
+        p[0] = 0x04;
+        corpus_fill_text(p + 1, len, state);
+        corpus_set_rec(&recs[cnt++], TNF_WELL_KNOWN, "U", p, len + 1);
+        p += len + 1;
+
+        len = 40 + corpus_rand(state) % 120;
+        p[0] = 0x02;
+        p[1] = 'e';
+        p[2] = 'n';
+        corpus_fill_text(p + 3, len, state);
+        corpus_set_rec(&recs[cnt++], TNF_WELL_KNOWN, "T", p, len + 3);
+        break;
+    }
+    case NFC_CORPUS_SHORT_RECORDS:
+    {
+        /* Stay within the 888-byte data area: at most 24 records of at most 28 bytes. */
+        size_t target = 16 + corpus_rand(state) % 9;
+        for(size_t i = 0; i < target; i++)
+        {
+            size_t len = 4 + corpus_rand(state) % 12;
+            corpus_fill_text(p, len, state);
+            corpus_set_rec(&recs[cnt++], TNF_MEDIA_TYPE, "text/plain", p, len);
+            p += len;
+        }
+        break;
+    }
+    case NFC_CORPUS_LONG_RECORDS:
+    {
+        size_t len = 400 + corpus_rand(state) % 400;
+        corpus_fill_text(p, len, state);
+        corpus_set_rec(&recs[cnt++], TNF_EXTERNAL_TYPE, "example.com:blob", p, len);
+        break;
+    }
+    case NFC_CORPUS_CHUNKED:
+    {
+        size_t len = 300 + corpus_rand(state) % 300;
+        corpus_fill_text(p, len, state);
+        for(size_t off = 0; off < len; off += CORPUS_CHUNK_SIZE)
+        {
+            size_t chunk = (len - off < CORPUS_CHUNK_SIZE) ? len - off : CORPUS_CHUNK_SIZE;
+            if(off == 0)
+                corpus_set_rec(&recs[cnt], TNF_MEDIA_TYPE, "text/vcard", p, chunk);
+            else
+                corpus_set_rec(&recs[cnt], TNF_UNCHANGED, "", p + off, chunk);
+            if(off + chunk < len)
+                recs[cnt].header |= NDEF_RECORD_FLAG_CF;
+            cnt++;
+        }
+        break;
+    }
+    case NFC_CORPUS_SMART_POSTER:
+    {
+        ndef_record_t inner[4];
+        uint8_t       *q   = p + 512;
+        size_t        len  = 20 + corpus_rand(state) % 30;
+        uint8_t       *uri = q;
+
+        uri[0] = 0x04;
+        corpus_fill_text(uri + 1, len, state);
+        corpus_set_rec(&inner[0], TNF_WELL_KNOWN, "U", uri, len + 1);
+        q += len + 1;
+
+        for(int t = 0; t < 2; t++)
+        {
+            size_t tlen = 10 + corpus_rand(state) % 30;
+            q[0] = 0x02;
+            q[1] = t ? 'd' : 'e';
+            q[2] = t ? 'e' : 'n';
+            corpus_fill_text(q + 3, tlen, state);
+            corpus_set_rec(&inner[1 + t], TNF_WELL_KNOWN, "T", q, tlen + 3);
+            q += tlen + 3;
+        }
+
+        q[0] = 0x00; /* Action: do the action */
+        corpus_set_rec(&inner[3], TNF_WELL_KNOWN, "act", q, 1);
+
+        size_t sp_len = 0;
+        ndef_msg_encode(inner, 4, p, 512, &sp_len);
+        corpus_set_rec(&recs[cnt++], TNF_WELL_KNOWN, "Sp", p, sp_len);
+        break;
+    }
+    case NFC_CORPUS_MIXED_RECORDS:
+    {
+        /* Random SR/IL combinations so the header decode cannot be predicted. */
+        size_t budget = 800;
+        corpus_fill_text(p, 300, state);
+        while(cnt < 40)
+        {
+            uint32_t r   = corpus_rand(state);
+            /* Payloads of 256 bytes or more force the 4-byte length form. */
+            size_t   len = ((r & 3) == 0) ? 256 + (r >> 8) % 32 : (r >> 8) % 16;
+            size_t   rec = len + 3 + 6 + 3;
+            if(rec > budget)
+                break;
+            corpus_set_rec(&recs[cnt], TNF_MEDIA_TYPE, "a/b", p, len);
+            if(r & 4)
+            {
+                recs[cnt].id     = (uint8_t *)"id";
+                recs[cnt].id_len = 2;
+            }
+            budget -= rec;
+            cnt++;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    return cnt;
+}
+
+int nfc_corpus_generate(nfc_corpus_t *corpus, nfc_corpus_kind_t kind, size_t image_cnt, uint32_t seed)
+{
+    size_t data_area_size = (kind == NFC_CORPUS_ULTRALIGHT) ? CORPUS_ULTRALIGHT_DATA_SIZE : CORPUS_NTAG216_DATA_SIZE;
+
+    corpus->kind       = kind;
+    corpus->image_size = T2T_FIRST_DATA_BLOCK_OFFSET + data_area_size;
+    corpus->image_cnt  = image_cnt;
+    corpus->record_cnt = 0;
+    corpus->data       = calloc(image_cnt, corpus->image_size);
+
+    if(corpus->data == NULL)
+        return -1;
+
+    uint32_t      state = seed ? seed : 1;
+    ndef_record_t recs[CORPUS_MAX_RECORDS];
+    uint8_t       scratch[1024];
+
+    for(size_t n = 0; n < image_cnt; n++)
+    {
+        uint8_t *img  = nfc_corpus_image(corpus, n);
+        uint8_t *data = img + T2T_FIRST_DATA_BLOCK_OFFSET;
+        uint8_t *end  = data + data_area_size;
+
+        corpus_write_header(img, data_area_size, &state);
+
+        if(kind != NFC_CORPUS_ULTRALIGHT)
+        {
+            /* NTAG216 dynamic lock bytes: 37 bits at byte 904 (page 14 of 64 bytes, offset 8),
+             * just past the data area. */
+            static const uint8_t lock_ctrl[] = { TLV_LOCK_CONTROL, 3, 0xE8, 0x25, 0x66 };
+            memcpy(data, lock_ctrl, sizeof(lock_ctrl));
+            data += sizeof(lock_ctrl);
+        }
+
+        if(kind == NFC_CORPUS_NULL_PADDING)
+            data += 600 + corpus_rand(&state) % 200;
+
+        size_t rec_cnt = corpus_build_records(kind, recs, scratch, &state);
+        size_t bw      = 0;
+
+        if(ndef_msg_encode_tlv(recs, rec_cnt, data, (size_t)(end - data) - 1, &bw) != NDEF_OK)
+        {
+            nfc_corpus_free(corpus);
+            return -1;
+        }
+
+        data[bw] = TLV_TERMINATOR;
+        corpus->record_cnt += rec_cnt;
+    }
+
+    return 0;
+}
+
+void nfc_corpus_free(nfc_corpus_t *corpus)
+{
+    free(corpus->data);
+    corpus->data      = NULL;
+    corpus->image_cnt = 0;
+}
+
+const char *nfc_corpus_name(nfc_corpus_kind_t kind)
+{
+    return (kind < NFC_CORPUS_KIND_CNT) ? corpus_names[kind] : "unknown";
+}
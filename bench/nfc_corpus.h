@@ -0,0 +1,88 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_corpus.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_corpus.h
+ * @brief Synthetic tag-image corpus generator for the benchmarks.
+ */
+#ifndef _NFC_CORPUS_H_
+#define _NFC_CORPUS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*!
+ * @brief Kinds of synthetic Type 2 Tag images.
+ */
+typedef enum
+{
+    NFC_CORPUS_ULTRALIGHT,      /* 48-byte data area, one short URI record            */
+    NFC_CORPUS_NTAG216,         /* 888-byte data area, lock control TLV, URI + text   */
+    NFC_CORPUS_SHORT_RECORDS,   /* NTAG216 filled with many small records             */
+    NFC_CORPUS_LONG_RECORDS,    /* NTAG216 with one record needing a 4-byte length    */
+    NFC_CORPUS_CHUNKED,         /* NTAG216 with a payload split into 32-byte chunks   */
+    NFC_CORPUS_NULL_PADDING,    /* NTAG216 with most of the data area NULL padding    */
+    NFC_CORPUS_SMART_POSTER,    /* NTAG216 with a Smart Poster (URI, titles, action)  */
+    NFC_CORPUS_MIXED_RECORDS,   /* NTAG216 with short, long and ID records interleaved */
+    NFC_CORPUS_KIND_CNT
+} nfc_corpus_kind_t;
+
+/*!
+ * @brief Corpus of equally sized images stored back to back.
+ */
+typedef struct
+{
+    nfc_corpus_kind_t kind;
+    uint8_t *data;          /* image_cnt * image_size bytes              */
+    size_t  image_size;     /* Size of each image (block 0 to data end)  */
+    size_t  image_cnt;      /* Number of images                          */
+    size_t  record_cnt;     /* Total number of NDEF records (chunks count individually) */
+} nfc_corpus_t;
+
+/*
+ * @brief Generate a corpus of images of one kind.
+ *
+ * @param[out] corpus    : Corpus to fill; free with nfc_corpus_free().
+ * @param[in]  kind      : Kind of image.
+ * @param[in]  image_cnt : Number of images.
+ * @param[in]  seed      : Seed for the UIDs and record contents.
+ *
+ * @return 0 on success, -1 if memory could not be allocated.
+ */
+int nfc_corpus_generate(nfc_corpus_t *corpus, nfc_corpus_kind_t kind, size_t image_cnt, uint32_t seed);
+
+void nfc_corpus_free(nfc_corpus_t *corpus);
+
+const char *nfc_corpus_name(nfc_corpus_kind_t kind);
+
+static inline uint8_t *nfc_corpus_image(const nfc_corpus_t *corpus, size_t n)
+{
+    return corpus->data + n * corpus->image_size;
+}
+
+#endif /* _NFC_CORPUS_H_ */
@@ -0,0 +1,701 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_archive.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_archive.c
+ * @brief Columnar archive of parsed tags.
+ */
+#include "nfc_archive.h"
+#include "type_2_tag.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#define NFC_ARCHIVE_ROUND_UP(__N__)     (((__N__) + NFC_ARCHIVE_ALIGN - 1) & ~(uint64_t)(NFC_ARCHIVE_ALIGN - 1))
+#define NFC_ARCHIVE_DIR_END             (sizeof(nfc_archive_header_t) + NFC_ARCHIVE_COL_CNT * sizeof(nfc_archive_column_t))
+#define NFC_ARCHIVE_DICT_MIN            64  /* Initial number of dictionary slots. */
+
+/*!
+ * @brief Growable column buffer.
+ */
+typedef struct
+{
+    uint8_t *data;
+    size_t  len;
+    size_t  cap;
+} nfc_archive_buf_t;
+
+struct nfc_archive_writer
+{
+    nfc_archive_buf_t cols[NFC_ARCHIVE_COL_CNT];
+    uint32_t          tag_cnt;
+    uint32_t          rec_cnt;
+    uint32_t          type_cnt;
+    uint32_t          *dict;        /* Open-addressed type ids + 1, 0 for a free slot */
+    uint32_t          dict_size;    /* Number of slots, a power of two                */
+};
+
+/*
+ * @brief Check that the host stores words little endian, as the format does.
+ */
+static inline int nfc_archive_host_le(void)
+{
+    const uint16_t one = 1;
+    return *(const uint8_t *)&one == 1;
+}
+
+/*
+ * @brief Count trailing zero bits of a non-zero value.
+ */
+static inline unsigned nfc_archive_ctz32(uint32_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(v);
+#else
+    unsigned n = 0;
+    while((v & 1) == 0) { v >>= 1; n++; }
+    return n;
+#endif
+}
+
+/*
+ * @brief Make room for 'len' more bytes in a column buffer.
+ */
+static int nfc_archive_buf_reserve(nfc_archive_buf_t *buf, size_t len)
+{
+    if(buf->cap - buf->len >= len)
+        return 0;
+
+    size_t cap = buf->cap ? buf->cap : NFC_ARCHIVE_ALIGN;
+    while(cap - buf->len < len)
+    {
+        if(cap > SIZE_MAX / 2)
+            return -1;
+        cap *= 2;
+    }
+
+    uint8_t *data = realloc(buf->data, cap);
+    if(data == NULL)
+        return -1;
+
+    buf->data = data;
+    buf->cap  = cap;
+    return 0;
+}
+
+/*
+ * @brief Append bytes to a column buffer that has room for them.
+ */
+static inline void nfc_archive_buf_put(nfc_archive_buf_t *buf, const void *data, size_t len)
+{
+    if(len != 0)
+        memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+/*
+ * @brief Hash of a dictionary key (FNV-1a over the TNF and the type name).
+ */
+static uint32_t nfc_archive_type_hash(uint8_t tnf, const uint8_t *type, uint8_t type_len)
+{
+    uint32_t h = (2166136261U ^ tnf) * 16777619U;
+
+    for(uint8_t i = 0; i < type_len; i++)
+        h = (h ^ type[i]) * 16777619U;
+
+    return h;
+}
+
+/*
+ * @brief Compare dictionary entry 'id' of the writer with a key.
+ */
+static int nfc_archive_type_equal(const nfc_archive_writer_t *writer, uint32_t id,
+                                  uint8_t tnf, const uint8_t *type, uint8_t type_len)
+{
+    const uint32_t *ofs   = (const uint32_t *)writer->cols[NFC_ARCHIVE_COL_TYPE_OFS].data;
+    const uint8_t  *names = writer->cols[NFC_ARCHIVE_COL_TYPE_DATA].data;
+
+    return (writer->cols[NFC_ARCHIVE_COL_TYPE_TNF].data[id] == tnf) &&
+           (ofs[id + 1] - ofs[id] == type_len) &&
+           ((type_len == 0) || (memcmp(names + ofs[id], type, type_len) == 0));
+}
+
+/*
+ * @brief Rebuild the dictionary hash table with the given number of slots.
+ */
+static int nfc_archive_dict_rehash(nfc_archive_writer_t *writer, uint32_t size)
+{
+    uint32_t *dict = calloc(size, sizeof(uint32_t));
+    if(dict == NULL)
+        return -1;
+
+    const uint32_t *ofs   = (const uint32_t *)writer->cols[NFC_ARCHIVE_COL_TYPE_OFS].data;
+    const uint8_t  *names = writer->cols[NFC_ARCHIVE_COL_TYPE_DATA].data;
+
+    for(uint32_t id = 0; id < writer->type_cnt; id++)
+    {
+        uint32_t h = nfc_archive_type_hash(writer->cols[NFC_ARCHIVE_COL_TYPE_TNF].data[id],
+                                           names + ofs[id], (uint8_t)(ofs[id + 1] - ofs[id]));
+        while(dict[h & (size - 1)] != 0)
+            h++;
+        dict[h & (size - 1)] = id + 1;
+    }
+
+    free(writer->dict);
+    writer->dict      = dict;
+    writer->dict_size = size;
+    return 0;
+}
+
+/*
+ * @brief Remove the dictionary entries from 'type_cnt' on.
+ *
+ * Entries are inserted in id order, so the probe run of a kept entry only
+ * crosses older entries and clearing the newer slots does not break it.
+ */
+static void nfc_archive_dict_truncate(nfc_archive_writer_t *writer, uint32_t type_cnt)
+{
+    if(writer->type_cnt == type_cnt)
+        return;
+
+    for(uint32_t s = 0; s < writer->dict_size; s++)
+    {
+        if(writer->dict[s] > type_cnt)
+            writer->dict[s] = 0;
+    }
+
+    writer->type_cnt = type_cnt;
+}
+
+/*
+ * @brief Look up a record type, adding it to the dictionary if it is new.
+ *
+ * The type columns must already have room for one more entry.
+ */
+static nfc_archive_status_t nfc_archive_intern_type(nfc_archive_writer_t *writer, uint8_t tnf,
+                                                    const uint8_t *type, uint8_t type_len, uint16_t *p_id)
+{
+    uint32_t h = nfc_archive_type_hash(tnf, type, type_len);
+
+    for(;; h++)
+    {
+        uint32_t slot = writer->dict[h & (writer->dict_size - 1)];
+        if(slot == 0)
+            break;
+        if(nfc_archive_type_equal(writer, slot - 1, tnf, type, type_len))
+        {
+            *p_id = (uint16_t)(slot - 1);
+            return NFC_ARCHIVE_OK;
+        }
+    }
+
+    if(writer->type_cnt >= NFC_ARCHIVE_MAX_TYPES)
+        return NFC_ARCHIVE_E_NO_MEM;
+
+    /* Keep the table at most half full so probe runs stay short. */
+    if(2 * (writer->type_cnt + 1) > writer->dict_size)
+    {
+        if(nfc_archive_dict_rehash(writer, 2 * writer->dict_size) != 0)
+            return NFC_ARCHIVE_E_NO_MEM;
+        h = nfc_archive_type_hash(tnf, type, type_len);
+        while(writer->dict[h & (writer->dict_size - 1)] != 0)
+            h++;
+    }
+
+    nfc_archive_buf_t *names = &writer->cols[NFC_ARCHIVE_COL_TYPE_DATA];
+    uint32_t          end;
+
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_TYPE_TNF], &tnf, 1);
+    nfc_archive_buf_put(names, type, type_len);
+    end = (uint32_t)names->len;
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_TYPE_OFS], &end, sizeof(end));
+
+    writer->dict[h & (writer->dict_size - 1)] = writer->type_cnt + 1;
+    *p_id = (uint16_t)writer->type_cnt++;
+
+    return NFC_ARCHIVE_OK;
+}
+
+/*
+ * @brief This API fills the tag fields from a raw Type 2 Tag image.
+ */
+void nfc_archive_tag_from_t2t(nfc_archive_tag_t *tag, const uint8_t *raw_data)
+{
+    memset(tag, 0, sizeof(*tag));
+
+    /* UID0-2 precede check byte 0, UID3-6 follow it. */
+    memcpy(tag->uid, raw_data, 3);
+    memcpy(tag->uid + 3, raw_data + 4, 4);
+    tag->uid_len = 7;
+
+    tag->cc_version = raw_data[T2T_CC_BLOCK_OFFSET + 1];
+    tag->cc_size    = (uint32_t)raw_data[T2T_CC_BLOCK_OFFSET + 2] * T2T_DATA_AREA_SIZE_UNIT;
+    tag->cc_access  = raw_data[T2T_CC_BLOCK_OFFSET + 3];
+}
+
+/*
+ * @brief This API allocates an empty archive writer.
+ */
+nfc_archive_status_t nfc_archive_writer_create(nfc_archive_writer_t **p_writer)
+{
+    if(p_writer == NULL)
+        return NFC_ARCHIVE_E_INVALID_ARGS;
+
+    *p_writer = NULL;
+
+    if(!nfc_archive_host_le())
+        return NFC_ARCHIVE_E_NOT_SUPPORTED;
+
+    nfc_archive_writer_t *writer = calloc(1, sizeof(*writer));
+    if(writer == NULL)
+        return NFC_ARCHIVE_E_NO_MEM;
+
+    /* Offset columns start with the offset of row 0. */
+    static const uint64_t zero = 0;
+    int                   err  = nfc_archive_dict_rehash(writer, NFC_ARCHIVE_DICT_MIN);
+
+    err |= nfc_archive_buf_reserve(&writer->cols[NFC_ARCHIVE_COL_TAG_REC], sizeof(uint32_t));
+    err |= nfc_archive_buf_reserve(&writer->cols[NFC_ARCHIVE_COL_PAYLOAD_OFS], sizeof(uint64_t));
+    err |= nfc_archive_buf_reserve(&writer->cols[NFC_ARCHIVE_COL_TYPE_OFS], sizeof(uint32_t));
+    if(err != 0)
+    {
+        nfc_archive_writer_destroy(writer);
+        return NFC_ARCHIVE_E_NO_MEM;
+    }
+
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_TAG_REC], &zero, sizeof(uint32_t));
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_PAYLOAD_OFS], &zero, sizeof(uint64_t));
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_TYPE_OFS], &zero, sizeof(uint32_t));
+
+    *p_writer = writer;
+    return NFC_ARCHIVE_OK;
+}
+
+/*
+ * @brief This API frees an archive writer.
+ */
+void nfc_archive_writer_destroy(nfc_archive_writer_t *writer)
+{
+    if(writer == NULL)
+        return;
+
+    for(int c = 0; c < NFC_ARCHIVE_COL_CNT; c++)
+        free(writer->cols[c].data);
+    free(writer->dict);
+    free(writer);
+}
+
+/*
+ * @brief This API appends a tag and the records of its NDEF message.
+ */
+nfc_archive_status_t nfc_archive_add(nfc_archive_writer_t *writer, const nfc_archive_tag_t *tag,
+                                     const ndef_index_t *ndef)
+{
+    if((writer == NULL) || (tag == NULL) || (tag->uid_len > NFC_ARCHIVE_UID_SIZE))
+        return NFC_ARCHIVE_E_INVALID_ARGS;
+
+    uint32_t rec_cnt = (ndef != NULL) ? ndef->rec_cnt : 0;
+
+    if((writer->tag_cnt == UINT32_MAX - 1) || (rec_cnt > UINT32_MAX - 1 - writer->rec_cnt))
+        return NFC_ARCHIVE_E_NO_MEM;
+
+    /* Size every column for the worst case (each record of a new type) up
+     * front, so the appends below cannot fail half way through a tag. */
+    size_t payload_len = 0, type_len = 0;
+    for(uint32_t n = 0; n < rec_cnt; n++)
+    {
+        ndef_record_t rec;
+        if(ndef_index_get(ndef, n, &rec) != NDEF_OK)
+            return NFC_ARCHIVE_E_INVALID_DATA;
+        payload_len += rec.payload_len;
+        type_len    += rec.type_len;
+    }
+
+    const size_t need[NFC_ARCHIVE_COL_CNT] =
+    {
+        [NFC_ARCHIVE_COL_UID]         = NFC_ARCHIVE_UID_SIZE,
+        [NFC_ARCHIVE_COL_UID_LEN]     = 1,
+        [NFC_ARCHIVE_COL_CC_VERSION]  = 1,
+        [NFC_ARCHIVE_COL_CC_ACCESS]   = 1,
+        [NFC_ARCHIVE_COL_CC_SIZE]     = sizeof(uint32_t),
+        [NFC_ARCHIVE_COL_TAG_REC]     = sizeof(uint32_t),
+        [NFC_ARCHIVE_COL_REC_HEADER]  = rec_cnt,
+        [NFC_ARCHIVE_COL_REC_TYPE]    = (size_t)rec_cnt * sizeof(uint16_t),
+        [NFC_ARCHIVE_COL_PAYLOAD_OFS] = (size_t)rec_cnt * sizeof(uint64_t),
+        [NFC_ARCHIVE_COL_PAYLOAD]     = payload_len,
+        [NFC_ARCHIVE_COL_TYPE_TNF]    = rec_cnt,
+        [NFC_ARCHIVE_COL_TYPE_OFS]    = (size_t)rec_cnt * sizeof(uint32_t),
+        [NFC_ARCHIVE_COL_TYPE_DATA]   = type_len,
+    };
+
+    for(int c = 0; c < NFC_ARCHIVE_COL_CNT; c++)
+    {
+        if(nfc_archive_buf_reserve(&writer->cols[c], need[c]) != 0)
+            return NFC_ARCHIVE_E_NO_MEM;
+    }
+
+    size_t   saved_len[NFC_ARCHIVE_COL_CNT];
+    uint32_t saved_types = writer->type_cnt;
+    for(int c = 0; c < NFC_ARCHIVE_COL_CNT; c++)
+        saved_len[c] = writer->cols[c].len;
+
+    nfc_archive_buf_t *payloads = &writer->cols[NFC_ARCHIVE_COL_PAYLOAD];
+    for(uint32_t n = 0; n < rec_cnt; n++)
+    {
+        ndef_record_t rec;
+        uint16_t      id;
+
+        ndef_index_get(ndef, n, &rec);
+        if(nfc_archive_intern_type(writer, rec.header & NDEF_RECORD_FLAG_TNF_Msk,
+                                   rec.type, rec.type_len, &id) != NFC_ARCHIVE_OK)
+        {
+            /* Drop the rows and any types added by this call. */
+            for(int c = 0; c < NFC_ARCHIVE_COL_CNT; c++)
+                writer->cols[c].len = saved_len[c];
+            nfc_archive_dict_truncate(writer, saved_types);
+            return NFC_ARCHIVE_E_NO_MEM;
+        }
+
+        nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_REC_HEADER], &rec.header, 1);
+        nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_REC_TYPE], &id, sizeof(id));
+        nfc_archive_buf_put(payloads, rec.payload, rec.payload_len);
+
+        uint64_t end = payloads->len;
+        nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_PAYLOAD_OFS], &end, sizeof(end));
+    }
+
+    static const uint8_t pad[NFC_ARCHIVE_UID_SIZE] = { 0 };
+    uint32_t             rec_end = writer->rec_cnt + rec_cnt;
+
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_UID], tag->uid, tag->uid_len);
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_UID], pad, NFC_ARCHIVE_UID_SIZE - tag->uid_len);
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_UID_LEN], &tag->uid_len, 1);
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_CC_VERSION], &tag->cc_version, 1);
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_CC_ACCESS], &tag->cc_access, 1);
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_CC_SIZE], &tag->cc_size, sizeof(uint32_t));
+    nfc_archive_buf_put(&writer->cols[NFC_ARCHIVE_COL_TAG_REC], &rec_end, sizeof(rec_end));
+
+    writer->tag_cnt++;
+    writer->rec_cnt = rec_end;
+
+    return NFC_ARCHIVE_OK;
+}
+
+/*
+ * @brief This API writes the archive of every tag added so far.
+ */
+nfc_archive_status_t nfc_archive_write(const nfc_archive_writer_t *writer, nfc_archive_write_fn_t fn, void *ctx)
+{
+    if((writer == NULL) || (fn == NULL))
+        return NFC_ARCHIVE_E_INVALID_ARGS;
+
+    static const uint8_t zero[NFC_ARCHIVE_ALIGN] = { 0 };
+    nfc_archive_column_t dir[NFC_ARCHIVE_COL_CNT];
+    uint64_t             offset = NFC_ARCHIVE_ROUND_UP(NFC_ARCHIVE_DIR_END);
+
+    for(int c = 0; c < NFC_ARCHIVE_COL_CNT; c++)
+    {
+        dir[c].codec    = NFC_ARCHIVE_CODEC_NONE;
+        dir[c].reserved = 0;
+        dir[c].offset   = offset;
+        dir[c].size     = writer->cols[c].len;
+        dir[c].raw_size = writer->cols[c].len;
+        offset = NFC_ARCHIVE_ROUND_UP(offset + dir[c].size);
+    }
+
+    nfc_archive_header_t hdr =
+    {
+        .magic     = NFC_ARCHIVE_MAGIC,
+        .version   = NFC_ARCHIVE_VERSION,
+        .col_cnt   = NFC_ARCHIVE_COL_CNT,
+        .tag_cnt   = writer->tag_cnt,
+        .rec_cnt   = writer->rec_cnt,
+        .type_cnt  = writer->type_cnt,
+        .flags     = 0,
+        .file_size = offset
+    };
+
+    if((fn(ctx, &hdr, sizeof(hdr)) != 0) || (fn(ctx, dir, sizeof(dir)) != 0))
+        return NFC_ARCHIVE_E_IO;
+
+    uint64_t pos = NFC_ARCHIVE_DIR_END;
+    for(int c = 0; c < NFC_ARCHIVE_COL_CNT; c++)
+    {
+        if(((dir[c].offset != pos) && (fn(ctx, zero, (size_t)(dir[c].offset - pos)) != 0)) ||
+           ((dir[c].size != 0) && (fn(ctx, writer->cols[c].data, writer->cols[c].len) != 0)))
+            return NFC_ARCHIVE_E_IO;
+        pos = dir[c].offset + dir[c].size;
+    }
+
+    if((offset != pos) && (fn(ctx, zero, (size_t)(offset - pos)) != 0))
+        return NFC_ARCHIVE_E_IO;
+
+    return NFC_ARCHIVE_OK;
+}
+
+/*
+ * @brief This API opens an archive held in memory.
+ */
+nfc_archive_status_t nfc_archive_open(nfc_archive_t *arc, const void *buf, size_t len)
+{
+    if((arc == NULL) || (buf == NULL) || (((uintptr_t)buf & 7) != 0))
+        return NFC_ARCHIVE_E_INVALID_ARGS;
+
+    if(!nfc_archive_host_le())
+        return NFC_ARCHIVE_E_NOT_SUPPORTED;
+
+    const uint8_t        *base = buf;
+    nfc_archive_header_t hdr;
+
+    if(len < sizeof(hdr))
+        return NFC_ARCHIVE_E_INVALID_DATA;
+    memcpy(&hdr, base, sizeof(hdr));
+
+    if(hdr.magic != NFC_ARCHIVE_MAGIC)
+        return NFC_ARCHIVE_E_INVALID_DATA;
+    if(hdr.version != NFC_ARCHIVE_VERSION)
+        return NFC_ARCHIVE_E_NOT_SUPPORTED;
+    if((hdr.col_cnt < NFC_ARCHIVE_COL_CNT) || (hdr.file_size > len) || (hdr.type_cnt > NFC_ARCHIVE_MAX_TYPES) ||
+       (hdr.tag_cnt == UINT32_MAX) || (hdr.rec_cnt == UINT32_MAX) ||
+       (sizeof(hdr) + (uint64_t)hdr.col_cnt * sizeof(nfc_archive_column_t) > hdr.file_size))
+        return NFC_ARCHIVE_E_INVALID_DATA;
+
+    /* Expected sizes; 0 marks the byte columns whose size comes from an offset column. */
+    const uint64_t tags = hdr.tag_cnt, recs = hdr.rec_cnt, types = hdr.type_cnt;
+    const uint64_t expect[NFC_ARCHIVE_COL_CNT] =
+    {
+        [NFC_ARCHIVE_COL_UID]         = tags * NFC_ARCHIVE_UID_SIZE,
+        [NFC_ARCHIVE_COL_UID_LEN]     = tags,
+        [NFC_ARCHIVE_COL_CC_VERSION]  = tags,
+        [NFC_ARCHIVE_COL_CC_ACCESS]   = tags,
+        [NFC_ARCHIVE_COL_CC_SIZE]     = tags * sizeof(uint32_t),
+        [NFC_ARCHIVE_COL_TAG_REC]     = (tags + 1) * sizeof(uint32_t),
+        [NFC_ARCHIVE_COL_REC_HEADER]  = recs,
+        [NFC_ARCHIVE_COL_REC_TYPE]    = recs * sizeof(uint16_t),
+        [NFC_ARCHIVE_COL_PAYLOAD_OFS] = (recs + 1) * sizeof(uint64_t),
+        [NFC_ARCHIVE_COL_PAYLOAD]     = 0,
+        [NFC_ARCHIVE_COL_TYPE_TNF]    = types,
+        [NFC_ARCHIVE_COL_TYPE_OFS]    = (types + 1) * sizeof(uint32_t),
+        [NFC_ARCHIVE_COL_TYPE_DATA]   = 0,
+    };
+    const uint8_t *col[NFC_ARCHIVE_COL_CNT];
+    uint64_t      size[NFC_ARCHIVE_COL_CNT];
+
+    for(int c = 0; c < NFC_ARCHIVE_COL_CNT; c++)
+    {
+        nfc_archive_column_t d;
+        memcpy(&d, base + sizeof(hdr) + (size_t)c * sizeof(d), sizeof(d));
+
+        if(d.codec != NFC_ARCHIVE_CODEC_NONE)
+            return NFC_ARCHIVE_E_NOT_SUPPORTED;
+        if(((d.offset & 7) != 0) || (d.size != d.raw_size) || (d.offset > hdr.file_size) ||
+           (d.size > hdr.file_size - d.offset) || ((expect[c] != 0) && (d.size != expect[c])))
+            return NFC_ARCHIVE_E_INVALID_DATA;
+
+        col[c]  = base + d.offset;
+        size[c] = d.size;
+    }
+
+    arc->base           = base;
+    arc->len            = len;
+    arc->tag_cnt        = hdr.tag_cnt;
+    arc->rec_cnt        = hdr.rec_cnt;
+    arc->type_cnt       = hdr.type_cnt;
+    arc->payload_size   = size[NFC_ARCHIVE_COL_PAYLOAD];
+    arc->type_data_size = (uint32_t)size[NFC_ARCHIVE_COL_TYPE_DATA];
+    arc->uid            = col[NFC_ARCHIVE_COL_UID];
+    arc->uid_len        = col[NFC_ARCHIVE_COL_UID_LEN];
+    arc->cc_version     = col[NFC_ARCHIVE_COL_CC_VERSION];
+    arc->cc_access      = col[NFC_ARCHIVE_COL_CC_ACCESS];
+    arc->cc_size        = (const uint32_t *)col[NFC_ARCHIVE_COL_CC_SIZE];
+    arc->tag_rec        = (const uint32_t *)col[NFC_ARCHIVE_COL_TAG_REC];
+    arc->rec_header     = col[NFC_ARCHIVE_COL_REC_HEADER];
+    arc->rec_type       = (const uint16_t *)col[NFC_ARCHIVE_COL_REC_TYPE];
+    arc->payload_ofs    = (const uint64_t *)col[NFC_ARCHIVE_COL_PAYLOAD_OFS];
+    arc->payload        = col[NFC_ARCHIVE_COL_PAYLOAD];
+    arc->type_tnf       = col[NFC_ARCHIVE_COL_TYPE_TNF];
+    arc->type_ofs       = (const uint32_t *)col[NFC_ARCHIVE_COL_TYPE_OFS];
+    arc->type_data      = col[NFC_ARCHIVE_COL_TYPE_DATA];
+
+    if((size[NFC_ARCHIVE_COL_TYPE_DATA] > UINT32_MAX) ||
+       (arc->tag_rec[0] != 0) || (arc->tag_rec[arc->tag_cnt] != arc->rec_cnt) ||
+       (arc->payload_ofs[0] != 0) || (arc->payload_ofs[arc->rec_cnt] != arc->payload_size) ||
+       (arc->type_ofs[0] != 0) || (arc->type_ofs[arc->type_cnt] != arc->type_data_size))
+        return NFC_ARCHIVE_E_INVALID_DATA;
+
+    return NFC_ARCHIVE_OK;
+}
+
+/*
+ * @brief This API copies the fields of a tag.
+ */
+nfc_archive_status_t nfc_archive_get_tag(const nfc_archive_t *arc, uint32_t n, nfc_archive_tag_t *tag)
+{
+    if((arc == NULL) || (tag == NULL) || (n >= arc->tag_cnt))
+        return NFC_ARCHIVE_E_INVALID_ARGS;
+
+    if(arc->uid_len[n] > NFC_ARCHIVE_UID_SIZE)
+        return NFC_ARCHIVE_E_INVALID_DATA;
+
+    memcpy(tag->uid, arc->uid + (size_t)n * NFC_ARCHIVE_UID_SIZE, NFC_ARCHIVE_UID_SIZE);
+    tag->uid_len    = arc->uid_len[n];
+    tag->cc_version = arc->cc_version[n];
+    tag->cc_access  = arc->cc_access[n];
+    tag->cc_size    = arc->cc_size[n];
+
+    return NFC_ARCHIVE_OK;
+}
+
+/*
+ * @brief This API returns the tag a record belongs to.
+ */
+uint32_t nfc_archive_rec_tag(const nfc_archive_t *arc, uint32_t rec)
+{
+    /* Last tag whose first record is at or before 'rec'. */
+    uint32_t lo = 0, hi = arc->tag_cnt;
+
+    while(hi - lo > 1)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(arc->tag_rec[mid] <= rec)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/*
+ * @brief This API looks up the dictionary id of a record type.
+ */
+nfc_archive_status_t nfc_archive_find_type(const nfc_archive_t *arc, uint8_t tnf, const uint8_t *type,
+                                           uint8_t type_len, uint16_t *p_id)
+{
+    if((arc == NULL) || (p_id == NULL) || ((type == NULL) && (type_len != 0)))
+        return NFC_ARCHIVE_E_INVALID_ARGS;
+
+    /* The dictionary holds a handful of entries, a linear search is enough. */
+    for(uint32_t id = 0; id < arc->type_cnt; id++)
+    {
+        uint32_t begin = arc->type_ofs[id], end = arc->type_ofs[id + 1];
+
+        if((arc->type_tnf[id] == tnf) && (begin <= end) && (end <= arc->type_data_size) &&
+           (end - begin == type_len) && ((type_len == 0) || !memcmp(arc->type_data + begin, type, type_len)))
+        {
+            *p_id = (uint16_t)id;
+            return NFC_ARCHIVE_OK;
+        }
+    }
+
+    return NFC_ARCHIVE_E_NOT_FOUND;
+}
+
+/*
+ * @brief This API collects the records of one type, scanning only the type column.
+ */
+size_t nfc_archive_scan_type(const nfc_archive_t *arc, uint16_t type_id, uint32_t *p_pos,
+                             uint32_t *recs, size_t max)
+{
+    const uint16_t *col = arc->rec_type;
+    uint32_t       i    = *p_pos;
+    size_t         cnt  = 0;
+
+    /* Vector blocks only run while every match of the block fits in 'recs'.
+     * Each 16-bit match sets two mask bits; only the low one is kept. */
+#if defined(__AVX2__)
+    const __m256i key32 = _mm256_set1_epi16((short)type_id);
+    for(; (arc->rec_cnt - i >= 16) && (max - cnt >= 16); i += 16)
+    {
+        __m256i  v    = _mm256_loadu_si256((const __m256i *)(col + i));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(v, key32)) & 0x55555555U;
+        for(; mask != 0; mask &= mask - 1)
+            recs[cnt++] = i + nfc_archive_ctz32(mask) / 2;
+    }
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+    const __m128i key16 = _mm_set1_epi16((short)type_id);
+    for(; (arc->rec_cnt - i >= 8) && (max - cnt >= 8); i += 8)
+    {
+        __m128i  v    = _mm_loadu_si128((const __m128i *)(col + i));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(v, key16)) & 0x5555U;
+        for(; mask != 0; mask &= mask - 1)
+            recs[cnt++] = i + nfc_archive_ctz32(mask) / 2;
+    }
+#endif
+
+    for(; (i < arc->rec_cnt) && (cnt < max); i++)
+    {
+        if(col[i] == type_id)
+            recs[cnt++] = i;
+    }
+
+    *p_pos = i;
+    return cnt;
+}
+
+/*
+ * @brief This API describes a record as an ndef_record_t.
+ */
+nfc_archive_status_t nfc_archive_get_record(const nfc_archive_t *arc, uint32_t n, ndef_record_t *rec)
+{
+    if((arc == NULL) || (rec == NULL) || (n >= arc->rec_cnt))
+        return NFC_ARCHIVE_E_INVALID_ARGS;
+
+    uint64_t begin = arc->payload_ofs[n], end = arc->payload_ofs[n + 1];
+    uint16_t id    = arc->rec_type[n];
+
+    if((begin > end) || (end > arc->payload_size) || (id >= arc->type_cnt))
+        return NFC_ARCHIVE_E_INVALID_DATA;
+
+    uint32_t type_begin = arc->type_ofs[id], type_end = arc->type_ofs[id + 1];
+    uint8_t  header     = arc->rec_header[n] & (uint8_t)~NDEF_RECORD_FLAG_IL;
+
+    if((type_begin > type_end) || (type_end > arc->type_data_size) || (type_end - type_begin > UINT8_MAX) ||
+       (NDEF_RECORD_GET_FLAG(header, NDEF_RECORD_FLAG_SR) && (end - begin > UINT8_MAX)) ||
+       (end - begin > UINT32_MAX))
+        return NFC_ARCHIVE_E_INVALID_DATA;
+
+    rec->header       = header;
+    rec->type_len     = (uint8_t)(type_end - type_begin);
+    rec->payload_len  = (size_t)(end - begin);
+    rec->id_len       = 0;
+    rec->type         = (rec->type_len == 0) ? NULL : (uint8_t *)(arc->type_data + type_begin);
+    rec->id           = NULL;
+    rec->payload      = (rec->payload_len == 0) ? NULL : (uint8_t *)(arc->payload + begin);
+    rec->total_length = ndef_header_table[header].fixed_len + rec->type_len + rec->payload_len;
+
+    return NFC_ARCHIVE_OK;
+}
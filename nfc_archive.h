@@ -0,0 +1,333 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_archive.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_archive.h
+ * @brief Columnar archive of parsed tags.
+ */
+
+/*!
+ * @defgroup ARCHIVE API
+ */
+#ifndef _NFC_ARCHIVE_H_
+#define _NFC_ARCHIVE_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "nfc_ndef.h"
+
+#define NFC_ARCHIVE_MAGIC       0x4143464EU /* "NFCA" as a little-endian word.          */
+#define NFC_ARCHIVE_VERSION     1           /* Format version written by this library.  */
+#define NFC_ARCHIVE_ALIGN       64          /* Alignment of every column in the file.   */
+#define NFC_ARCHIVE_UID_SIZE    10          /* Largest UID (ISO/IEC 14443 triple size). */
+#define NFC_ARCHIVE_MAX_TYPES   0xFFFF      /* Largest number of distinct record types. */
+
+/*!
+ * @brief Archive API status codes.
+ */
+typedef enum
+{
+    NFC_ARCHIVE_OK,                 /* Success                                         */
+    NFC_ARCHIVE_E_INVALID_ARGS,     /* Invalid function arguments                      */
+    NFC_ARCHIVE_E_NO_MEM,           /* Allocation failed, or a count limit was reached */
+    NFC_ARCHIVE_E_INVALID_DATA,     /* Archive or record data is invalid               */
+    NFC_ARCHIVE_E_NOT_SUPPORTED,    /* Unknown version or codec, or big-endian host    */
+    NFC_ARCHIVE_E_NOT_FOUND,        /* No such record type in the dictionary           */
+    NFC_ARCHIVE_E_IO                /* The write callback failed                       */
+} nfc_archive_status_t;
+
+/*!
+ * @brief Columns of an archive, in file order.
+ *
+ * Tag columns have one row per tag, record columns one row per NDEF record
+ * (record chunks count individually) and type columns one row per distinct
+ * (TNF, type) pair. Offset columns have one extra row holding the end offset.
+ */
+typedef enum
+{
+    NFC_ARCHIVE_COL_UID,            /* Tag: NFC_ARCHIVE_UID_SIZE bytes, zero padded  */
+    NFC_ARCHIVE_COL_UID_LEN,        /* Tag: uint8_t UID length                       */
+    NFC_ARCHIVE_COL_CC_VERSION,     /* Tag: uint8_t CC version (major << 4 | minor)  */
+    NFC_ARCHIVE_COL_CC_ACCESS,      /* Tag: uint8_t CC access (read << 4 | write)    */
+    NFC_ARCHIVE_COL_CC_SIZE,        /* Tag: uint32_t data area size in bytes         */
+    NFC_ARCHIVE_COL_TAG_REC,        /* Tag: uint32_t first record (+1 row)           */
+    NFC_ARCHIVE_COL_REC_HEADER,     /* Record: uint8_t NDEF header byte              */
+    NFC_ARCHIVE_COL_REC_TYPE,       /* Record: uint16_t type dictionary id           */
+    NFC_ARCHIVE_COL_PAYLOAD_OFS,    /* Record: uint64_t payload offset (+1 row)      */
+    NFC_ARCHIVE_COL_PAYLOAD,        /* Payload bytes of every record, back to back   */
+    NFC_ARCHIVE_COL_TYPE_TNF,       /* Type: uint8_t TNF                             */
+    NFC_ARCHIVE_COL_TYPE_OFS,       /* Type: uint32_t type name offset (+1 row)      */
+    NFC_ARCHIVE_COL_TYPE_DATA,      /* Type name bytes, back to back                 */
+    NFC_ARCHIVE_COL_CNT
+} nfc_archive_col_t;
+
+/*!
+ * @brief Column codecs.
+ *
+ * Only uncompressed columns are written and read for now; the codec and
+ * raw_size fields of the directory leave room for block-compressed columns
+ * without a format version change.
+ */
+typedef enum
+{
+    NFC_ARCHIVE_CODEC_NONE          /* Column stored as is */
+} nfc_archive_codec_t;
+
+/*!
+ * @brief File header, at offset 0. All fields are little endian.
+ */
+typedef struct
+{
+    uint32_t magic;         /* NFC_ARCHIVE_MAGIC                  */
+    uint16_t version;       /* NFC_ARCHIVE_VERSION                */
+    uint16_t col_cnt;       /* Entries in the column directory    */
+    uint32_t tag_cnt;       /* Number of tags                     */
+    uint32_t rec_cnt;       /* Number of records                  */
+    uint32_t type_cnt;      /* Number of dictionary entries       */
+    uint32_t flags;         /* Reserved, 0                        */
+    uint64_t file_size;     /* Size of the whole archive in bytes */
+} nfc_archive_header_t;
+
+/*!
+ * @brief Column directory entry; the directory follows the header.
+ */
+typedef struct
+{
+    uint32_t codec;         /* nfc_archive_codec_t                        */
+    uint32_t reserved;      /* 0                                          */
+    uint64_t offset;        /* Offset of the column, NFC_ARCHIVE_ALIGN aligned */
+    uint64_t size;          /* Stored size of the column in bytes         */
+    uint64_t raw_size;      /* Size of the column once decoded            */
+} nfc_archive_column_t;
+
+/*!
+ * @brief Tag-level fields kept in the archive.
+ */
+typedef struct
+{
+    uint8_t  uid[NFC_ARCHIVE_UID_SIZE]; /* UID, first byte is the manufacturer ID */
+    uint8_t  uid_len;                   /* UID length in bytes                    */
+    uint8_t  cc_version;                /* Mapping version (major << 4 | minor)   */
+    uint8_t  cc_access;                 /* Read access << 4 | write access        */
+    uint32_t cc_size;                   /* Data area size in bytes                */
+} nfc_archive_tag_t;
+
+/*!
+ * @brief Archive writer (opaque).
+ *
+ * Tags are appended to growing in-memory columns; record types are
+ * dictionary-encoded as they are added. The archive is produced in one go
+ * by nfc_archive_write.
+ */
+typedef struct nfc_archive_writer nfc_archive_writer_t;
+
+/*!
+ * @brief Sink for the archive bytes, e.g. a wrapper around fwrite.
+ *
+ * @return 0 on success, non-zero to abort the write.
+ */
+typedef int (*nfc_archive_write_fn_t)(void *ctx, const void *data, size_t len);
+
+/*!
+ * @brief Archive opened for reading.
+ *
+ * The columns point into the caller's buffer (typically a read-only mapping
+ * of the file), so opening an archive copies nothing and a query only touches
+ * the pages of the columns it reads. Record IDs are not archived.
+ */
+typedef struct
+{
+    const uint8_t  *base;           /* Start of the archive                       */
+    size_t         len;             /* Length of the archive                      */
+    uint32_t       tag_cnt;         /* Number of tags                             */
+    uint32_t       rec_cnt;         /* Number of records                          */
+    uint32_t       type_cnt;        /* Number of dictionary entries               */
+    uint64_t       payload_size;    /* Size of the payload column                 */
+    uint32_t       type_data_size;  /* Size of the type name column               */
+    const uint8_t  *uid;            /* tag_cnt * NFC_ARCHIVE_UID_SIZE bytes       */
+    const uint8_t  *uid_len;        /* tag_cnt entries                            */
+    const uint8_t  *cc_version;     /* tag_cnt entries                            */
+    const uint8_t  *cc_access;      /* tag_cnt entries                            */
+    const uint32_t *cc_size;        /* tag_cnt entries                            */
+    const uint32_t *tag_rec;        /* tag_cnt + 1 entries                        */
+    const uint8_t  *rec_header;     /* rec_cnt entries                            */
+    const uint16_t *rec_type;       /* rec_cnt entries                            */
+    const uint64_t *payload_ofs;    /* rec_cnt + 1 entries                        */
+    const uint8_t  *payload;        /* payload_size bytes                         */
+    const uint8_t  *type_tnf;       /* type_cnt entries                           */
+    const uint32_t *type_ofs;       /* type_cnt + 1 entries                       */
+    const uint8_t  *type_data;      /* type_data_size bytes                       */
+} nfc_archive_t;
+
+/*
+ * @brief This API fills the tag fields from a raw Type 2 Tag image.
+ *
+ * @param[out] tag      : Tag fields.
+ * @param[in]  raw_data : Image, starting at block 0 (at least 16 bytes).
+ */
+void nfc_archive_tag_from_t2t(nfc_archive_tag_t *tag, const uint8_t *raw_data);
+
+/*
+ * @brief This API allocates an empty archive writer.
+ *
+ * @param[out] p_writer : Writer; free with nfc_archive_writer_destroy().
+ *
+ * @return API status code.
+ */
+nfc_archive_status_t nfc_archive_writer_create(nfc_archive_writer_t **p_writer);
+
+/*
+ * @brief This API frees an archive writer.
+ *
+ * @param[in] writer : Writer, or NULL.
+ */
+void nfc_archive_writer_destroy(nfc_archive_writer_t *writer);
+
+/*
+ * @brief This API appends a tag and the records of its NDEF message.
+ *
+ * The payloads are copied, so the image may be reused once this returns.
+ * On failure the writer is left as before the call.
+ *
+ * @param[in,out] writer : Writer.
+ * @param[in]     tag    : Tag fields.
+ * @param[in]     ndef   : Index of the tag's NDEF message, or NULL for none.
+ *
+ * @return API status code.
+ */
+nfc_archive_status_t nfc_archive_add(nfc_archive_writer_t *writer, const nfc_archive_tag_t *tag,
+                                     const ndef_index_t *ndef);
+
+/*
+ * @brief This API writes the archive of every tag added so far.
+ *
+ * The writer keeps its contents, so more tags can be added and the archive
+ * written again.
+ *
+ * @param[in] writer : Writer.
+ * @param[in] fn     : Sink the archive is written to, in order.
+ * @param[in] ctx    : Context passed to fn.
+ *
+ * @return API status code.
+ */
+nfc_archive_status_t nfc_archive_write(const nfc_archive_writer_t *writer, nfc_archive_write_fn_t fn, void *ctx);
+
+/*
+ * @brief This API opens an archive held in memory.
+ *
+ * The header, the column directory and the end offsets of the offset columns
+ * are checked here; per-row checks are left to the accessors so opening does
+ * not read whole columns. The buffer must stay valid and 8-byte aligned (a
+ * mapping is page aligned) while the archive is used.
+ *
+ * @param[out] arc : Archive.
+ * @param[in]  buf : Archive bytes.
+ * @param[in]  len : Length of buf.
+ *
+ * @return API status code.
+ */
+nfc_archive_status_t nfc_archive_open(nfc_archive_t *arc, const void *buf, size_t len);
+
+/*
+ * @brief This API copies the fields of a tag.
+ *
+ * @param[in]  arc : Archive.
+ * @param[in]  n   : Tag number.
+ * @param[out] tag : Tag fields.
+ *
+ * @return API status code.
+ */
+nfc_archive_status_t nfc_archive_get_tag(const nfc_archive_t *arc, uint32_t n, nfc_archive_tag_t *tag);
+
+/*
+ * @brief This API returns the tag a record belongs to.
+ *
+ * @param[in] arc : Archive.
+ * @param[in] rec : Record number, below arc->rec_cnt.
+ *
+ * @return Tag number.
+ */
+uint32_t nfc_archive_rec_tag(const nfc_archive_t *arc, uint32_t rec);
+
+/*
+ * @brief This API looks up the dictionary id of a record type.
+ *
+ * @param[in]  arc      : Archive.
+ * @param[in]  tnf      : Type name format.
+ * @param[in]  type     : Type name.
+ * @param[in]  type_len : Length of the type name.
+ * @param[out] p_id     : Dictionary id.
+ *
+ * @return API status code.
+ */
+nfc_archive_status_t nfc_archive_find_type(const nfc_archive_t *arc, uint8_t tnf, const uint8_t *type,
+                                           uint8_t type_len, uint16_t *p_id);
+
+/*
+ * @brief This API collects the records of one type, scanning only the type column.
+ *
+ * Scanning starts at *p_pos and stops after max matches or at the end of the
+ * archive; *p_pos is updated so the next call continues where this one
+ * stopped.
+ *
+ * @param[in]     arc     : Archive.
+ * @param[in]     type_id : Dictionary id from nfc_archive_find_type().
+ * @param[in,out] p_pos   : Record to scan from.
+ * @param[out]    recs    : Record numbers of the matches.
+ * @param[in]     max     : Capacity of recs.
+ *
+ * @return Number of matches stored.
+ */
+size_t nfc_archive_scan_type(const nfc_archive_t *arc, uint16_t type_id, uint32_t *p_pos,
+                             uint32_t *recs, size_t max);
+
+/*
+ * @brief This API describes a record as an ndef_record_t.
+ *
+ * The type and payload point into the archive and must not be written
+ * through. Record IDs are not archived, so the ID is empty and IL is clear.
+ *
+ * @param[in]  arc : Archive.
+ * @param[in]  n   : Record number.
+ * @param[out] rec : Record.
+ *
+ * @return API status code.
+ */
+nfc_archive_status_t nfc_archive_get_record(const nfc_archive_t *arc, uint32_t n, ndef_record_t *rec);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* _NFC_ARCHIVE_H_ */
+/** @}*/
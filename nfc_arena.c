@@ -0,0 +1,103 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_arena.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_arena.c
+ * @brief Bump allocator for per-tag parse storage.
+ */
+#include "nfc_arena.h"
+
+#define NFC_ARENA_ROUND_UP(__N__)   (((__N__) + NFC_ARENA_ALIGN - 1) & ~(size_t)(NFC_ARENA_ALIGN - 1))
+
+/*
+ * @brief This API initializes an arena over a caller-provided region.
+ */
+nfc_arena_status_t nfc_arena_init(nfc_arena_t *arena, void *buf, size_t size)
+{
+    if((arena == NULL) || (buf == NULL))
+        return NFC_ARENA_E_INVALID_ARGS;
+
+    size_t skip = NFC_ARENA_ROUND_UP((uintptr_t)buf) - (uintptr_t)buf;
+
+    arena->base = (uint8_t *)buf + skip;
+    arena->size = (size > skip) ? size - skip : 0;
+    arena->used = 0;
+    arena->peak = 0;
+
+    return NFC_ARENA_OK;
+}
+
+/*
+ * @brief This API allocates a block from an arena.
+ */
+void *nfc_arena_alloc(nfc_arena_t *arena, size_t size)
+{
+    size_t avail = arena->size - arena->used;
+
+    if(size > avail)
+        return NULL;
+
+    /* Rounding keeps 'used' aligned, except at the very end of the region. */
+    void   *ptr    = arena->base + arena->used;
+    size_t rounded = NFC_ARENA_ROUND_UP(size);
+
+    arena->used += (rounded < avail) ? rounded : avail;
+    if(arena->used > arena->peak)
+        arena->peak = arena->used;
+
+    return ptr;
+}
+
+/*
+ * @brief This API reserves the rest of an arena as an array of unknown final length.
+ */
+void *nfc_arena_reserve(const nfc_arena_t *arena, size_t elem_size, size_t *p_cnt)
+{
+    *p_cnt = (elem_size != 0) ? (arena->size - arena->used) / elem_size : 0;
+    return arena->base + arena->used;
+}
+
+/*
+ * @brief This API allocates the leading part of the last reservation.
+ */
+void nfc_arena_commit(nfc_arena_t *arena, void *ptr, size_t size)
+{
+    size_t end = (size_t)((uint8_t *)ptr - arena->base) + NFC_ARENA_ROUND_UP(size);
+
+    arena->used = (end < arena->size) ? end : arena->size;
+    if(arena->used > arena->peak)
+        arena->peak = arena->used;
+}
+
+/*
+ * @brief This API releases every allocation of an arena.
+ */
+void nfc_arena_reset(nfc_arena_t *arena)
+{
+    arena->used = 0;
+}
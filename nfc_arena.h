@@ -0,0 +1,131 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_arena.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_arena.h
+ * @brief Bump allocator for per-tag parse storage.
+ */
+
+/*!
+ * @defgroup ARENA API
+ */
+#ifndef _NFC_ARENA_H_
+#define _NFC_ARENA_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define NFC_ARENA_ALIGN     8   /* Alignment of every allocation; enough for tlv_t and the index words. */
+
+/*!
+ * @brief Arena API status codes.
+ */
+typedef enum
+{
+    NFC_ARENA_OK,               /* Success                      */
+    NFC_ARENA_E_INVALID_ARGS    /* Invalid function arguments   */
+} nfc_arena_status_t;
+
+/*!
+ * @brief Bump allocator over a caller-provided region.
+ *
+ * Allocations are carved from the region in order and are never freed one
+ * by one; nfc_arena_reset() releases all of them at once in O(1). One arena
+ * per thread, reset after each tag, gives a parse loop with no malloc and a
+ * footprint fixed by the region size.
+ */
+typedef struct
+{
+    uint8_t *base;  /* Start of the region, NFC_ARENA_ALIGN aligned  */
+    size_t  size;   /* Usable size of the region                     */
+    size_t  used;   /* Bytes handed out since the last reset         */
+    size_t  peak;   /* Largest 'used' seen, to size the region       */
+} nfc_arena_t;
+
+/*
+ * @brief This API initializes an arena over a caller-provided region.
+ *
+ * @param[out] arena : Arena.
+ * @param[in]  buf   : Region; bytes before the first aligned address are skipped.
+ * @param[in]  size  : Size of the region in bytes.
+ *
+ * @return API status code.
+ */
+nfc_arena_status_t nfc_arena_init(nfc_arena_t *arena, void *buf, size_t size);
+
+/*
+ * @brief This API allocates a block from an arena.
+ *
+ * @param[in,out] arena : Arena.
+ * @param[in]     size  : Size of the block in bytes.
+ *
+ * @return Pointer to the block, or NULL if the arena is exhausted.
+ */
+void *nfc_arena_alloc(nfc_arena_t *arena, size_t size);
+
+/*
+ * @brief This API reserves the rest of an arena as an array of unknown final length.
+ *
+ * Nothing is allocated until nfc_arena_commit(), and no other allocation may
+ * be made in between. This lets a parser fill as many entries as the arena
+ * holds and then keep only the ones it used.
+ *
+ * @param[in]  arena     : Arena.
+ * @param[in]  elem_size : Size of an array element.
+ * @param[out] p_cnt     : Number of elements that fit.
+ *
+ * @return Pointer to the array (valid even if *p_cnt is 0).
+ */
+void *nfc_arena_reserve(const nfc_arena_t *arena, size_t elem_size, size_t *p_cnt);
+
+/*
+ * @brief This API allocates the leading part of the last reservation.
+ *
+ * @param[in,out] arena : Arena.
+ * @param[in]     ptr   : Pointer returned by nfc_arena_reserve().
+ * @param[in]     size  : Number of bytes used, at most the size reserved.
+ */
+void nfc_arena_commit(nfc_arena_t *arena, void *ptr, size_t size);
+
+/*
+ * @brief This API releases every allocation of an arena.
+ *
+ * @param[in,out] arena : Arena.
+ */
+void nfc_arena_reset(nfc_arena_t *arena);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* _NFC_ARENA_H_ */
+/** @}*/
@@ -0,0 +1,449 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_async.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_async.c
+ * @brief Asynchronous Type 2 Tag read and parse pipeline.
+ */
+#include "nfc_async.h"
+#include "nfc_stats.h"
+
+#include <string.h>
+
+static void nfc_async_on_read(void *ctx, nfc_async_status_t status);
+
+/*
+ * @brief Record the result of an operation; the first result wins.
+ */
+static void nfc_async_finish(nfc_async_read_t *op, nfc_async_status_t status)
+{
+    if(op->finished)
+        return;
+
+    op->finished = 1;
+    op->status   = status;
+}
+
+/*
+ * @brief Submit a READ command into the raw buffer.
+ */
+static nfc_async_status_t nfc_async_submit(nfc_async_read_t *op, uint8_t block)
+{
+    return op->transport->read(op->transport->impl, block, op->raw + (size_t)block * T2T_BLOCK_SIZE,
+                               nfc_async_on_read, op);
+}
+
+/*
+ * @brief Index the NDEF records received so far.
+ */
+static void nfc_async_decode(nfc_async_read_t *op)
+{
+    const type_2_tag_read_plan_t *plan = &op->plan;
+
+    /* The planner publishes the NDEF value location once its TLV header has been read. */
+    if(plan->ndef_offset == 0)
+        return;
+
+    size_t end   = plan->valid_end;
+    size_t limit = (size_t)plan->ndef_offset + plan->ndef_length;
+
+    if(end > limit)
+        end = limit;
+
+    size_t avail = (end > plan->ndef_offset) ? end - plan->ndef_offset : 0;
+
+    ndef_status_t rslt = ndef_index_update(&op->ndef, op->raw + plan->ndef_offset, plan->ndef_length, avail);
+
+    if((rslt == NDEF_E_INCOMPLETE) && !plan->done)
+        return;
+
+    op->ndef_status = rslt;
+
+    if(rslt == NDEF_OK)
+        nfc_async_finish(op, NFC_ASYNC_OK);
+    else if(rslt == NDEF_E_NOT_FOUND)
+        nfc_async_finish(op, NFC_ASYNC_E_NOT_FOUND);
+    else
+        nfc_async_finish(op, NFC_ASYNC_E_NDEF);
+}
+
+/*
+ * @brief Completion handler of every READ command.
+ * The next READ is submitted before the received page is decoded, so the
+ * transport is busy while this thread decodes. The handler of that READ may
+ * run concurrently (or nested, for a synchronous transport); the lock and the
+ * 'active' and 'inflight' counts ensure only the last handler out reports.
+ */
+static void nfc_async_on_read(void *ctx, nfc_async_status_t status)
+{
+    nfc_async_read_t *op    = ctx;
+    uint8_t          block  = 0;
+    uint8_t          submit = 0;
+
+    pthread_mutex_lock(&op->lock);
+    op->inflight--;
+    op->active++;
+
+    if(!op->finished)
+    {
+        if(status != NFC_ASYNC_OK)
+        {
+            nfc_async_finish(op, NFC_ASYNC_E_TRANSPORT);
+        }
+        else
+        {
+            type_2_tag_status_t rslt = type_2_tag_read_plan_next(&op->plan, op->raw, &block);
+
+            op->tag_status = rslt;
+
+            if(rslt == T2T_E_NOT_FOUND)
+                nfc_async_finish(op, NFC_ASYNC_E_NOT_FOUND);
+            else if(rslt != T2T_OK)
+                nfc_async_finish(op, NFC_ASYNC_E_TAG);
+            else if(!op->plan.done)
+                submit = 1;
+        }
+    }
+
+    if(submit)
+        op->inflight++;
+    pthread_mutex_unlock(&op->lock);
+
+    /* Put the next READ on the air before decoding. */
+    if(submit && (nfc_async_submit(op, block) != NFC_ASYNC_OK))
+    {
+        pthread_mutex_lock(&op->lock);
+        op->inflight--;
+        nfc_async_finish(op, NFC_ASYNC_E_TRANSPORT);
+        pthread_mutex_unlock(&op->lock);
+    }
+
+    pthread_mutex_lock(&op->lock);
+    if(!op->finished)
+        nfc_async_decode(op);
+
+    op->active--;
+
+    uint8_t               report = op->finished && op->running && (op->active == 0) && (op->inflight == 0);
+    nfc_async_read_done_t done   = op->done;
+    nfc_async_status_t    rslt   = op->status;
+
+    if(report)
+        op->running = 0;
+    pthread_mutex_unlock(&op->lock);
+
+    if(report)
+        done(op, rslt);
+}
+
+/*
+ * @brief This API initialises a read operation.
+ */
+nfc_async_status_t nfc_async_read_init(nfc_async_read_t *op, const nfc_async_transport_t *transport,
+                                       uint8_t *raw, size_t raw_size, uint32_t *storage, uint32_t max_records,
+                                       nfc_async_read_done_t done, void *user_ctx)
+{
+    if((op == NULL) || (transport == NULL) || (transport->read == NULL) || (raw == NULL) || (done == NULL))
+        return NFC_ASYNC_E_INVALID_ARGS;
+
+    memset(op, 0, sizeof(*op));
+
+    if(ndef_index_init(&op->ndef, storage, max_records) != NDEF_OK)
+        return NFC_ASYNC_E_INVALID_ARGS;
+
+    if(pthread_mutex_init(&op->lock, NULL) != 0)
+        return NFC_ASYNC_E_INVALID_ARGS;
+
+    op->transport = transport;
+    op->raw       = raw;
+    op->raw_size  = raw_size;
+    op->done      = done;
+    op->user_ctx  = user_ctx;
+
+    return NFC_ASYNC_OK;
+}
+
+/*
+ * @brief This API starts reading a tag.
+ */
+nfc_async_status_t nfc_async_read_start(nfc_async_read_t *op)
+{
+    if(op == NULL)
+        return NFC_ASYNC_E_INVALID_ARGS;
+
+    pthread_mutex_lock(&op->lock);
+    if(op->running)
+    {
+        pthread_mutex_unlock(&op->lock);
+        return NFC_ASYNC_E_BUSY;
+    }
+
+    type_2_tag_read_plan_init(&op->plan, op->raw_size);
+
+    uint8_t             block;
+    type_2_tag_status_t rslt = type_2_tag_read_plan_next(&op->plan, op->raw, &block);
+
+    if(rslt != T2T_OK)
+    {
+        pthread_mutex_unlock(&op->lock);
+        return NFC_ASYNC_E_INVALID_ARGS;
+    }
+
+    /* Forget the previous message, which may have lived at the same offset. */
+    op->ndef.msg     = NULL;
+    op->ndef.msg_len = 0;
+    op->ndef.rec_cnt = 0;
+
+    op->tag_status  = T2T_OK;
+    op->ndef_status = NDEF_E_INCOMPLETE;
+    op->status      = NFC_ASYNC_OK;
+    op->finished    = 0;
+    op->running     = 1;
+    op->inflight    = 1;
+    pthread_mutex_unlock(&op->lock);
+
+    nfc_async_status_t err = nfc_async_submit(op, block);
+
+    if(err != NFC_ASYNC_OK)
+    {
+        pthread_mutex_lock(&op->lock);
+        op->inflight = 0;
+        op->running  = 0;
+        pthread_mutex_unlock(&op->lock);
+    }
+
+    return err;
+}
+
+/*
+ * @brief This API releases the resources of a read operation that is not running.
+ */
+void nfc_async_read_deinit(nfc_async_read_t *op)
+{
+    if(op == NULL)
+        return;
+
+    pthread_mutex_destroy(&op->lock);
+}
+
+/*
+ * @brief Queue a READ command on the simulated transport.
+ */
+static nfc_async_status_t nfc_async_sim_read(void *impl, uint8_t block, uint8_t *data, nfc_async_io_done_t done, void *ctx)
+{
+    nfc_async_sim_t *sim = impl;
+
+    if((data == NULL) || (done == NULL))
+        return NFC_ASYNC_E_INVALID_ARGS;
+
+    pthread_mutex_lock(&sim->lock);
+    if(sim->stop || (sim->count == NFC_ASYNC_SIM_QUEUE_LEN))
+    {
+        pthread_mutex_unlock(&sim->lock);
+        return NFC_ASYNC_E_BUSY;
+    }
+
+    uint8_t slot = (uint8_t)((sim->head + sim->count) % NFC_ASYNC_SIM_QUEUE_LEN);
+
+    sim->queue[slot].block = block;
+    sim->queue[slot].data  = data;
+    sim->queue[slot].done  = done;
+    sim->queue[slot].ctx   = ctx;
+    sim->count++;
+    pthread_cond_signal(&sim->cond);
+    pthread_mutex_unlock(&sim->lock);
+
+    return NFC_ASYNC_OK;
+}
+
+/*
+ * @brief Worker thread of the simulated transport.
+ */
+static void *nfc_async_sim_worker(void *arg)
+{
+    nfc_async_sim_t *sim = arg;
+
+    pthread_mutex_lock(&sim->lock);
+    for(;;)
+    {
+        /* Wait for a command and for room to queue its completion. */
+        while(((sim->count == 0) && !sim->stop) || (sim->done_count == NFC_ASYNC_SIM_QUEUE_LEN))
+            pthread_cond_wait(&sim->cond, &sim->lock);
+
+        if(sim->count == 0)
+            break;
+
+        uint8_t             block = sim->queue[sim->head].block;
+        uint8_t             *data = sim->queue[sim->head].data;
+        nfc_async_io_done_t done  = sim->queue[sim->head].done;
+        void                *ctx  = sim->queue[sim->head].ctx;
+
+        sim->head = (uint8_t)((sim->head + 1) % NFC_ASYNC_SIM_QUEUE_LEN);
+        sim->count--;
+        pthread_mutex_unlock(&sim->lock);
+
+        /* The emulator sleeps for the configured READ latency. */
+        nfc_t2t_emu_status_t rslt = nfc_t2t_emu_read(sim->emu, block, data);
+
+        pthread_mutex_lock(&sim->lock);
+
+        uint8_t slot = (uint8_t)((sim->done_head + sim->done_count) % NFC_ASYNC_SIM_QUEUE_LEN);
+
+        sim->done_queue[slot].status = (rslt == NFC_T2T_EMU_OK) ? NFC_ASYNC_OK : NFC_ASYNC_E_TRANSPORT;
+        sim->done_queue[slot].done   = done;
+        sim->done_queue[slot].ctx    = ctx;
+        sim->done_count++;
+        pthread_cond_signal(&sim->done_cond);
+    }
+
+    sim->drained = 1;
+    pthread_cond_signal(&sim->done_cond);
+    pthread_mutex_unlock(&sim->lock);
+
+#ifdef NFC_STATS
+    /* Counters of the transport threads would be lost when they exit. */
+    nfc_stats_flush();
+#endif
+
+    return NULL;
+}
+
+/*
+ * @brief Completion thread of the simulated transport.
+ */
+static void *nfc_async_sim_completer(void *arg)
+{
+    nfc_async_sim_t *sim = arg;
+
+    pthread_mutex_lock(&sim->lock);
+    for(;;)
+    {
+        while((sim->done_count == 0) && !sim->drained)
+            pthread_cond_wait(&sim->done_cond, &sim->lock);
+
+        if(sim->done_count == 0)
+            break;
+
+        nfc_async_status_t  status = sim->done_queue[sim->done_head].status;
+        nfc_async_io_done_t done   = sim->done_queue[sim->done_head].done;
+        void                *ctx   = sim->done_queue[sim->done_head].ctx;
+
+        sim->done_head = (uint8_t)((sim->done_head + 1) % NFC_ASYNC_SIM_QUEUE_LEN);
+        sim->done_count--;
+        pthread_cond_signal(&sim->cond);
+        pthread_mutex_unlock(&sim->lock);
+
+        done(ctx, status);
+
+        pthread_mutex_lock(&sim->lock);
+    }
+    pthread_mutex_unlock(&sim->lock);
+
+#ifdef NFC_STATS
+    /* The completions decode the TLV blocks and NDEF records on this thread. */
+    nfc_stats_flush();
+#endif
+
+    return NULL;
+}
+
+/*
+ * @brief This API starts a simulated transport over an emulated tag.
+ */
+nfc_async_status_t nfc_async_sim_init(nfc_async_sim_t *sim, nfc_t2t_emu_t *emu, nfc_async_transport_t *transport)
+{
+    if((sim == NULL) || (emu == NULL) || (transport == NULL))
+        return NFC_ASYNC_E_INVALID_ARGS;
+
+    memset(sim, 0, sizeof(*sim));
+    sim->emu = emu;
+
+    if(pthread_mutex_init(&sim->lock, NULL) != 0)
+        return NFC_ASYNC_E_INVALID_ARGS;
+
+    if(pthread_cond_init(&sim->cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&sim->lock);
+        return NFC_ASYNC_E_INVALID_ARGS;
+    }
+
+    if(pthread_cond_init(&sim->done_cond, NULL) != 0)
+    {
+        pthread_cond_destroy(&sim->cond);
+        pthread_mutex_destroy(&sim->lock);
+        return NFC_ASYNC_E_INVALID_ARGS;
+    }
+
+    if(pthread_create(&sim->completer, NULL, nfc_async_sim_completer, sim) != 0)
+    {
+        pthread_cond_destroy(&sim->done_cond);
+        pthread_cond_destroy(&sim->cond);
+        pthread_mutex_destroy(&sim->lock);
+        return NFC_ASYNC_E_INVALID_ARGS;
+    }
+
+    if(pthread_create(&sim->thread, NULL, nfc_async_sim_worker, sim) != 0)
+    {
+        /* Let the completion thread see an empty, drained transport. */
+        pthread_mutex_lock(&sim->lock);
+        sim->drained = 1;
+        pthread_cond_signal(&sim->done_cond);
+        pthread_mutex_unlock(&sim->lock);
+
+        pthread_join(sim->completer, NULL);
+        pthread_cond_destroy(&sim->done_cond);
+        pthread_cond_destroy(&sim->cond);
+        pthread_mutex_destroy(&sim->lock);
+        return NFC_ASYNC_E_INVALID_ARGS;
+    }
+
+    transport->impl = sim;
+    transport->read = nfc_async_sim_read;
+
+    return NFC_ASYNC_OK;
+}
+
+/*
+ * @brief This API stops a simulated transport once the queued commands have been served and completed.
+ */
+void nfc_async_sim_deinit(nfc_async_sim_t *sim)
+{
+    if(sim == NULL)
+        return;
+
+    pthread_mutex_lock(&sim->lock);
+    sim->stop = 1;
+    pthread_cond_signal(&sim->cond);
+    pthread_mutex_unlock(&sim->lock);
+
+    pthread_join(sim->thread, NULL);
+    pthread_join(sim->completer, NULL);
+    pthread_cond_destroy(&sim->done_cond);
+    pthread_cond_destroy(&sim->cond);
+    pthread_mutex_destroy(&sim->lock);
+}
@@ -0,0 +1,218 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_async.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_async.h
+ * @brief Asynchronous Type 2 Tag read and parse pipeline.
+ */
+
+/*!
+ * @defgroup NFC_ASYNC API
+ */
+#ifndef _NFC_ASYNC_H_
+#define _NFC_ASYNC_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "type_2_tag.h"
+#include "nfc_ndef.h"
+#include "nfc_t2t_emu.h"
+
+#define NFC_ASYNC_SIM_QUEUE_LEN     16      /* READ commands the simulated transport can queue */
+
+/*!
+ * @brief Asynchronous API status codes.
+ */
+typedef enum
+{
+    NFC_ASYNC_OK,             /* API execution success                          */
+    NFC_ASYNC_E_INVALID_ARGS, /* Invalid function arguments                     */
+    NFC_ASYNC_E_BUSY,         /* Operation already running or transport full    */
+    NFC_ASYNC_E_TRANSPORT,    /* A READ command failed                          */
+    NFC_ASYNC_E_TAG,          /* Header or TLV data invalid, see 'tag_status'   */
+    NFC_ASYNC_E_NOT_FOUND,    /* Tag holds no NDEF message                      */
+    NFC_ASYNC_E_NDEF          /* NDEF message invalid, see 'ndef_status'        */
+} nfc_async_status_t;
+
+/*!
+ * @brief Completion callback of a single READ command.
+ * @param[in] ctx    : Context given when the command was submitted.
+ * @param[in] status : NFC_ASYNC_OK once the 16 bytes have been stored, NFC_ASYNC_E_TRANSPORT otherwise.
+ */
+typedef void (*nfc_async_io_done_t)(void *ctx, nfc_async_status_t status);
+
+/*!
+ * @brief Transport interface.
+ * 'read' submits a READ command and returns without waiting for the answer.
+ * When it returns NFC_ASYNC_OK the transport must later store T2T_READ_SIZE
+ * bytes at 'data' and call 'done' exactly once, from any thread (including
+ * from within 'read'). When it returns an error 'done' is never called.
+ */
+typedef struct
+{
+    void               *impl;   /* Transport instance passed to 'read' */
+    nfc_async_status_t (*read)(void *impl, uint8_t block, uint8_t *data, nfc_async_io_done_t done, void *ctx);
+} nfc_async_transport_t;
+
+typedef struct nfc_async_read nfc_async_read_t;
+
+/*!
+ * @brief Completion callback of a read operation.
+ * Called exactly once per started operation, after the last READ has
+ * completed; the operation can be restarted or released from the callback.
+ * @param[in] op     : Finished operation.
+ * @param[in] status : Result of the operation.
+ */
+typedef void (*nfc_async_read_done_t)(nfc_async_read_t *op, nfc_async_status_t status);
+
+/*!
+ * @brief Read operation.
+ * Fetches the NDEF message of one tag with the minimal-read planner. As soon
+ * as a READ answer arrives the next READ is submitted, and the pages received
+ * so far are TLV and NDEF decoded while it is on the air, so decoding adds no
+ * time after the last page arrives beyond indexing its records.
+ */
+struct nfc_async_read
+{
+    const nfc_async_transport_t *transport;  /* Transport serving the READ commands      */
+    uint8_t                     *raw;        /* Raw tag memory, filled from block 0       */
+    size_t                      raw_size;    /* Size of the raw buffer                    */
+    nfc_async_read_done_t       done;        /* Completion callback                       */
+    void                        *user_ctx;   /* Free for the caller                       */
+    type_2_tag_read_plan_t      plan;        /* Read planner state                        */
+    ndef_index_t                ndef;        /* Records of the message, valid once done   */
+    type_2_tag_status_t         tag_status;  /* Planner result                            */
+    ndef_status_t               ndef_status; /* Indexing result                           */
+    nfc_async_status_t          status;      /* Result, valid once done                   */
+    uint8_t                     inflight;    /* READ commands submitted, not yet answered */
+    uint8_t                     active;      /* Completion handlers currently running     */
+    uint8_t                     finished;    /* Result is known                           */
+    uint8_t                     running;     /* Started and not yet reported              */
+    pthread_mutex_t             lock;        /* Serialises the completion handlers        */
+};
+
+/*!
+ * @brief Simulated transport.
+ * Serves READ commands from an emulated tag on a worker thread, so each
+ * command takes the latency configured on the emulator while the caller
+ * keeps running. Completions are delivered from a second thread, so a READ
+ * submitted from a completion callback is on the air while that callback
+ * carries on decoding, as with an interrupt-driven reader.
+ */
+typedef struct
+{
+    nfc_t2t_emu_t   *emu;       /* Emulated tag                         */
+    pthread_t       thread;     /* Worker thread serving the commands   */
+    pthread_t       completer;  /* Thread calling the completions       */
+    pthread_mutex_t lock;       /* Protects both queues                 */
+    pthread_cond_t  cond;       /* Signals queued work, room or stop    */
+    pthread_cond_t  done_cond;  /* Signals queued completions or drain  */
+    uint8_t         stop;       /* Worker exit request                  */
+    uint8_t         drained;    /* Worker has served its last command   */
+    uint8_t         head;       /* First queued command                 */
+    uint8_t         count;      /* Number of queued commands            */
+    uint8_t         done_head;  /* First queued completion              */
+    uint8_t         done_count; /* Number of queued completions         */
+    struct
+    {
+        uint8_t             block;
+        uint8_t             *data;
+        nfc_async_io_done_t done;
+        void                *ctx;
+    } queue[NFC_ASYNC_SIM_QUEUE_LEN];
+    struct
+    {
+        nfc_async_status_t  status;
+        nfc_async_io_done_t done;
+        void                *ctx;
+    } done_queue[NFC_ASYNC_SIM_QUEUE_LEN];
+} nfc_async_sim_t;
+
+/*
+ * @brief This API initialises a read operation.
+ * @param[out] op          : Operation.
+ * @param[in]  transport   : Transport serving the READ commands.
+ * @param[in]  raw         : Buffer for the raw tag memory.
+ * @param[in]  raw_size    : Size of the buffer, at least T2T_RAW_DATA_SIZE() of the tag.
+ * @param[in]  storage     : NDEF_INDEX_STORAGE_WORDS(max_records) words for the record index.
+ * @param[in]  max_records : Maximum number of records per message.
+ * @param[in]  done        : Completion callback.
+ * @param[in]  user_ctx    : Free for the caller.
+ * @return API status code.
+ */
+nfc_async_status_t nfc_async_read_init(nfc_async_read_t *op, const nfc_async_transport_t *transport,
+                                       uint8_t *raw, size_t raw_size, uint32_t *storage, uint32_t max_records,
+                                       nfc_async_read_done_t done, void *user_ctx);
+
+/*
+ * @brief This API starts reading a tag.
+ * The first READ is submitted before returning; 'done' is called when the
+ * message has been read and indexed, or on the first error. The NDEF message
+ * then lies at raw + plan.ndef_offset and is described by 'ndef'.
+ * @param[in,out] op : Initialised operation that is not running.
+ * @return API status code.
+ * @retval NFC_ASYNC_E_BUSY if the operation is still running.
+ * @retval Other            if the first READ could not be submitted; 'done' is not called.
+ */
+nfc_async_status_t nfc_async_read_start(nfc_async_read_t *op);
+
+/*
+ * @brief This API releases the resources of a read operation that is not running.
+ * @param[in,out] op : Operation.
+ */
+void nfc_async_read_deinit(nfc_async_read_t *op);
+
+/*
+ * @brief This API starts a simulated transport over an emulated tag.
+ * @param[out] sim       : Simulated transport.
+ * @param[in]  emu       : Initialised emulated tag; its latency applies to every READ.
+ * @param[out] transport : Transport interface to pass to nfc_async_read_init().
+ * @return API status code.
+ */
+nfc_async_status_t nfc_async_sim_init(nfc_async_sim_t *sim, nfc_t2t_emu_t *emu, nfc_async_transport_t *transport);
+
+/*
+ * @brief This API stops a simulated transport once the queued commands have been served and completed.
+ * Completions run on a transport thread, so with NFC_STATS the parser counters
+ * of the reads reach nfc_stats_global() once this returns.
+ * @param[in,out] sim : Simulated transport.
+ */
+void nfc_async_sim_deinit(nfc_async_sim_t *sim);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* _NFC_ASYNC_H_ */
+/** @}*/
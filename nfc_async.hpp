@@ -0,0 +1,119 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_async.hpp
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_async.hpp
+ * @brief Header-only C++20 coroutine wrapper over the asynchronous read pipeline.
+ */
+
+/*!
+ * @defgroup NFC_ASYNC_CPP API
+ */
+#ifndef _NFC_ASYNC_HPP_
+#define _NFC_ASYNC_HPP_
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+
+#include "nfc_async.h"
+
+/*
+ * Available when the compiler and library support coroutines (C++20):
+ *
+ *   nfc_async_status_t status = co_await nfc::async_read(op);
+ *
+ * starts the operation and resumes the coroutine from the completion
+ * callback, i.e. on the transport thread that delivered the last READ. The
+ * awaiter takes over the operation's 'done' and 'user_ctx' fields.
+ */
+#if defined(__cpp_impl_coroutine) && defined(__cpp_lib_coroutine)
+
+#include <coroutine>
+
+namespace nfc
+{
+
+/*!
+ * @brief Awaitable read operation.
+ */
+class read_awaiter
+{
+public:
+    explicit read_awaiter(nfc_async_read_t &op) noexcept : op_(op) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+        handle_       = handle;
+        op_.done      = &read_awaiter::on_done;
+        op_.user_ctx  = this;
+
+        /* The callback may resume the coroutine before start returns, so
+         * nothing of *this is touched once the read has been started. */
+        nfc_async_status_t status = nfc_async_read_start(&op_);
+
+        if(status == NFC_ASYNC_OK)
+            return true;
+
+        status_ = status;
+        return false;
+    }
+
+    nfc_async_status_t await_resume() const noexcept { return status_; }
+
+private:
+    static void on_done(nfc_async_read_t *op, nfc_async_status_t status) noexcept
+    {
+        read_awaiter *self = static_cast<read_awaiter *>(op->user_ctx);
+
+        self->status_ = status;
+        self->handle_.resume();
+    }
+
+    nfc_async_read_t        &op_;
+    std::coroutine_handle<> handle_;
+    nfc_async_status_t      status_ = NFC_ASYNC_OK;
+};
+
+/*!
+ * @brief Read a tag from a coroutine.
+ * @param[in,out] op : Initialised operation that is not running.
+ * @return Awaitable yielding the result of the operation.
+ */
+inline read_awaiter async_read(nfc_async_read_t &op) noexcept { return read_awaiter(op); }
+
+} // namespace nfc
+
+#endif /* __cpp_impl_coroutine */
+
+#endif /* _NFC_ASYNC_HPP_ */
+/** @}*/
@@ -0,0 +1,308 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_batch.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_batch.c
+ * @brief Batch and multi-threaded parsing of tag images.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "nfc_batch.h"
+#include "nfc_stats.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NFC_BATCH_CACHE_LINE    64
+#define NFC_BATCH_MAX_THREADS   256
+
+/*
+ * @brief Range of images owned by one worker, padded to its own cache line.
+ */
+typedef struct
+{
+    _Alignas(NFC_BATCH_CACHE_LINE) atomic_size_t next; /* Next unclaimed image */
+    size_t end;                                          /* End of the range     */
+} nfc_batch_range_t;
+
+/*
+ * @brief State shared (read-only apart from the range counters) by the workers.
+ */
+typedef struct
+{
+    const nfc_image_t         *images;
+    nfc_batch_result_t        *results;
+    const nfc_batch_storage_t *storage;
+    nfc_batch_range_t         *ranges;
+    unsigned                  range_cnt;
+} nfc_batch_job_t;
+
+typedef struct
+{
+    nfc_batch_job_t *job;
+    unsigned        id;
+} nfc_batch_worker_t;
+
+/*
+ * @brief Parse the tag header and TLV blocks of an image into a TLV array.
+ *
+ * @return NDEF message TLV, or NULL if there is none.
+ */
+static const tlv_t *nfc_batch_parse_tag(const nfc_image_t *image, nfc_batch_result_t *result,
+                                        tlv_t *tlvs, uint16_t max_tlvs)
+{
+    result->tlvs    = tlvs;
+    result->tlv_cnt = 0;
+
+    /* The CC data area size must fit inside the image span. */
+    if((image->data == NULL) || (image->len < T2T_FIRST_DATA_BLOCK_OFFSET) ||
+       (image->len < T2T_FIRST_DATA_BLOCK_OFFSET +
+                     (size_t)image->data[T2T_CC_BLOCK_OFFSET + 2] * T2T_DATA_AREA_SIZE_UNIT))
+    {
+        result->tag_status = T2T_E_INVALID_DATA;
+        return NULL;
+    }
+
+    type_2_tag_t tag =
+    {
+        .max_tlv_blocks    = max_tlvs,
+        .p_tlv_block_array = tlvs,
+        .tlv_count         = 0
+    };
+
+    result->tag_status = type_2_tag_parse(&tag, image->data);
+    result->tlv_cnt    = tag.tlv_count;
+
+    for(uint16_t i = 0; i < tag.tlv_count; i++)
+    {
+        if(tlvs[i].type == TLV_NDEF_MESSAGE)
+            return &tlvs[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * @brief Parse a single image into its result and storage slice.
+ */
+static void nfc_batch_parse_one(const nfc_image_t *image, nfc_batch_result_t *result,
+                                const nfc_batch_storage_t *storage, size_t n)
+{
+    tlv_t    *tlvs    = storage->tlv_storage + n * storage->max_tlvs;
+    uint32_t *idx_mem = storage->index_storage + n * NDEF_INDEX_STORAGE_WORDS((size_t)storage->max_records);
+
+    result->ndef_status = NDEF_E_NOT_FOUND;
+    ndef_index_init(&result->ndef, idx_mem, storage->max_records);
+
+    const tlv_t *ndef = nfc_batch_parse_tag(image, result, tlvs, storage->max_tlvs);
+    if(ndef != NULL)
+        result->ndef_status = ndef_index_build(&result->ndef, ndef->value, ndef->length);
+}
+
+/*
+ * @brief Claim the next grain of images from a range.
+ *
+ * @return Number of images claimed, starting at *p_begin.
+ */
+static size_t nfc_batch_claim(nfc_batch_range_t *range, size_t *p_begin)
+{
+    if(atomic_load_explicit(&range->next, memory_order_relaxed) >= range->end)
+        return 0;
+
+    size_t begin = atomic_fetch_add_explicit(&range->next, NFC_BATCH_GRAIN, memory_order_relaxed);
+    if(begin >= range->end)
+        return 0;
+
+    *p_begin = begin;
+    return (range->end - begin < NFC_BATCH_GRAIN) ? range->end - begin : NFC_BATCH_GRAIN;
+}
+
+static void *nfc_batch_worker(void *arg)
+{
+    nfc_batch_worker_t *worker = arg;
+    nfc_batch_job_t    *job    = worker->job;
+
+    /* Own range first, then steal from the others in turn. */
+    for(unsigned k = 0; k < job->range_cnt; k++)
+    {
+        nfc_batch_range_t *range = &job->ranges[(worker->id + k) % job->range_cnt];
+        size_t begin, cnt;
+
+        while((cnt = nfc_batch_claim(range, &begin)) != 0)
+        {
+            for(size_t n = begin; n < begin + cnt; n++)
+                nfc_batch_parse_one(&job->images[n], &job->results[n], job->storage, n);
+        }
+    }
+
+#ifdef NFC_STATS
+    /* Counters of the pool threads would be lost when they exit. */
+    if(worker->id != 0)
+        nfc_stats_flush();
+#endif
+
+    return NULL;
+}
+
+/*
+ * @brief This API parses a batch of tag images on the calling thread.
+ */
+nfc_batch_status_t nfc_batch_parse(const nfc_image_t *images, size_t image_cnt,
+                                   nfc_batch_result_t *results, const nfc_batch_storage_t *storage)
+{
+    if((images == NULL) || (results == NULL) || (storage == NULL) ||
+       (storage->tlv_storage == NULL) || (storage->index_storage == NULL))
+        return NFC_BATCH_E_INVALID_ARGS;
+
+    for(size_t n = 0; n < image_cnt; n++)
+        nfc_batch_parse_one(&images[n], &results[n], storage, n);
+
+    return NFC_BATCH_OK;
+}
+
+/*
+ * @brief This API parses one tag image with its storage taken from an arena.
+ */
+nfc_batch_status_t nfc_batch_parse_arena(const nfc_image_t *image, nfc_batch_result_t *result,
+                                         nfc_arena_t *arena)
+{
+    if((image == NULL) || (result == NULL) || (arena == NULL))
+        return NFC_BATCH_E_INVALID_ARGS;
+
+    /* Offer the whole free arena to the TLV array, then keep what was used.
+     * Every stored TLV block takes at least 2 bytes of the data area. */
+    size_t max_tlvs;
+    tlv_t  *tlvs = nfc_arena_reserve(arena, sizeof(tlv_t), &max_tlvs);
+
+    if((image->data != NULL) && (image->len > T2T_CC_BLOCK_OFFSET + 2))
+    {
+        size_t data_area = (size_t)image->data[T2T_CC_BLOCK_OFFSET + 2] * T2T_DATA_AREA_SIZE_UNIT;
+        if(max_tlvs > data_area / 2)
+            max_tlvs = data_area / 2;
+    }
+    if(max_tlvs > UINT16_MAX)
+        max_tlvs = UINT16_MAX;
+
+    const tlv_t *ndef = nfc_batch_parse_tag(image, result, tlvs, (uint16_t)max_tlvs);
+    nfc_arena_commit(arena, tlvs, result->tlv_cnt * sizeof(tlv_t));
+
+    /* Same for the index: every record takes at least 3 bytes of the message. */
+    size_t   max_words;
+    uint32_t *idx_mem = nfc_arena_reserve(arena, sizeof(uint32_t), &max_words);
+    size_t   max_recs = max_words / NDEF_INDEX_STORAGE_WORDS(1);
+
+    if((ndef != NULL) && (max_recs > ndef->length / 3))
+        max_recs = ndef->length / 3;
+    if(max_recs > UINT32_MAX)
+        max_recs = UINT32_MAX;
+
+    ndef_index_init(&result->ndef, idx_mem, (uint32_t)max_recs);
+    result->ndef_status = NDEF_E_NOT_FOUND;
+
+    if(ndef != NULL)
+        result->ndef_status = ndef_index_build(&result->ndef, ndef->value, ndef->length);
+
+    nfc_arena_commit(arena, idx_mem, ndef_index_shrink(&result->ndef) * sizeof(uint32_t));
+
+    return NFC_BATCH_OK;
+}
+
+/*
+ * @brief This API parses a batch of tag images on a pool of worker threads.
+ */
+nfc_batch_status_t nfc_batch_parse_parallel(const nfc_image_t *images, size_t image_cnt,
+                                            nfc_batch_result_t *results, const nfc_batch_storage_t *storage,
+                                            unsigned thread_cnt)
+{
+    if((images == NULL) || (results == NULL) || (storage == NULL) ||
+       (storage->tlv_storage == NULL) || (storage->index_storage == NULL))
+        return NFC_BATCH_E_INVALID_ARGS;
+
+    if(thread_cnt == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_cnt = (cpus > 0) ? (unsigned)cpus : 1;
+    }
+    if(thread_cnt > NFC_BATCH_MAX_THREADS)
+        thread_cnt = NFC_BATCH_MAX_THREADS;
+    if(thread_cnt == 1 || image_cnt <= NFC_BATCH_GRAIN)
+        return nfc_batch_parse(images, image_cnt, results, storage);
+
+    nfc_batch_range_t  *ranges  = aligned_alloc(NFC_BATCH_CACHE_LINE, thread_cnt * sizeof(nfc_batch_range_t));
+    nfc_batch_worker_t *workers = malloc(thread_cnt * sizeof(nfc_batch_worker_t));
+    pthread_t          *threads = malloc(thread_cnt * sizeof(pthread_t));
+
+    if((ranges == NULL) || (workers == NULL) || (threads == NULL))
+    {
+        free(ranges);
+        free(workers);
+        free(threads);
+        return NFC_BATCH_E_NO_MEM;
+    }
+
+    nfc_batch_job_t job = { images, results, storage, ranges, thread_cnt };
+
+    for(unsigned t = 0; t < thread_cnt; t++)
+    {
+        atomic_init(&ranges[t].next, image_cnt * t / thread_cnt);
+        ranges[t].end = image_cnt * (t + 1) / thread_cnt;
+        workers[t].job = &job;
+        workers[t].id  = t;
+    }
+
+    /* The calling thread acts as worker 0. */
+    unsigned started = 1;
+    for(; started < thread_cnt; started++)
+    {
+        if(pthread_create(&threads[started], NULL, nfc_batch_worker, &workers[started]) != 0)
+            break;
+    }
+
+    /* Workers that did start steal the ranges of those that did not. */
+    if(started == 1)
+    {
+        free(ranges);
+        free(workers);
+        free(threads);
+        return NFC_BATCH_E_THREAD;
+    }
+
+    nfc_batch_worker(&workers[0]);
+
+    for(unsigned t = 1; t < started; t++)
+        pthread_join(threads[t], NULL);
+
+    free(ranges);
+    free(workers);
+    free(threads);
+
+    return NFC_BATCH_OK;
+}
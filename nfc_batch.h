@@ -0,0 +1,170 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_batch.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_batch.h
+ * @brief Batch parsing of tag images.
+ */
+
+/*!
+ * @defgroup BATCH API
+ */
+#ifndef _NFC_BATCH_H_
+#define _NFC_BATCH_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "nfc_arena.h"
+#include "nfc_ndef.h"
+#include "nfc_tlv_block.h"
+#include "type_2_tag.h"
+
+#define NFC_BATCH_GRAIN     32      /* Images claimed by a worker at a time. */
+
+/* Arena size that can hold the parse of any image with the given data area
+ * size: one TLV per 2 bytes and one NDEF record per 3 bytes, plus alignment. */
+#define NFC_BATCH_ARENA_SIZE(__DATA_AREA_SIZE__)                                    \
+    (((__DATA_AREA_SIZE__) / 2) * sizeof(tlv_t) +                                   \
+     NDEF_INDEX_STORAGE_WORDS((__DATA_AREA_SIZE__) / 3 + 1) * sizeof(uint32_t) +    \
+     3 * NFC_ARENA_ALIGN)
+
+/*!
+ * @brief Batch API status codes.
+ */
+typedef enum
+{
+    NFC_BATCH_OK,               /* Success                              */
+    NFC_BATCH_E_INVALID_ARGS,   /* Invalid function arguments           */
+    NFC_BATCH_E_THREAD,         /* Worker threads could not be started  */
+    NFC_BATCH_E_NO_MEM          /* Worker state could not be allocated  */
+} nfc_batch_status_t;
+
+/*!
+ * @brief Span of a raw Type 2 Tag image (starting at block 0).
+ */
+typedef struct
+{
+    uint8_t *data;  /* Pointer to the first byte of the image */
+    size_t  len;    /* Length of the image in bytes            */
+} nfc_image_t;
+
+/*!
+ * @brief Per-image parse result.
+ *
+ * 'tlvs' and the 'ndef' index arrays point into the batch storage slice
+ * reserved for the image; the TLV values and NDEF offsets point into the image.
+ * An NDEF message split by a reserved area (see type_2_tag_parse()) has a NULL
+ * TLV value and is reported as NDEF_E_INVALID_ARGS; no storage is set aside to
+ * gather it, so read it with type_2_tag_ndef_copy().
+ */
+typedef struct
+{
+    type_2_tag_status_t tag_status;  /* Result of parsing the tag header and TLV blocks  */
+    ndef_status_t       ndef_status; /* Result of indexing the first NDEF message TLV    */
+    tlv_t               *tlvs;       /* TLV blocks found in the data area (NULL excluded) */
+    uint16_t            tlv_cnt;     /* Number of TLV blocks                             */
+    ndef_index_t        ndef;        /* Index of the first NDEF message                  */
+} nfc_batch_result_t;
+
+/*!
+ * @brief Caller storage for a batch, sliced per image.
+ */
+typedef struct
+{
+    uint16_t max_tlvs;        /* TLV blocks reserved per image                                */
+    uint32_t max_records;     /* NDEF records reserved per image                              */
+    tlv_t    *tlv_storage;    /* image_cnt * max_tlvs entries                                 */
+    uint32_t *index_storage;  /* image_cnt * NDEF_INDEX_STORAGE_WORDS(max_records) words      */
+} nfc_batch_storage_t;
+
+/*
+ * @brief This API parses a batch of tag images on the calling thread.
+ *
+ * Every image gets a result; a failing image does not stop the batch.
+ *
+ * @param[in]  images    : Array of image spans.
+ * @param[in]  image_cnt : Number of images.
+ * @param[out] results   : Array of image_cnt results.
+ * @param[in]  storage   : Storage sliced per image for the TLV and index arrays.
+ *
+ * @return API status code.
+ */
+nfc_batch_status_t nfc_batch_parse(const nfc_image_t *images, size_t image_cnt,
+                                   nfc_batch_result_t *results, const nfc_batch_storage_t *storage);
+
+/*
+ * @brief This API parses one tag image with its storage taken from an arena.
+ *
+ * The TLV array and the NDEF index are sized to what the image holds rather
+ * than to fixed maxima, so a tag with many TLV blocks only fails if the arena
+ * itself is full. The result stays valid until the arena is reset; a parse
+ * loop resets it after each tag.
+ *
+ * @param[in]     image  : Image span.
+ * @param[out]    result : Parse result.
+ * @param[in,out] arena  : Arena the TLV and index arrays are allocated from.
+ *
+ * @return API status code.
+ */
+nfc_batch_status_t nfc_batch_parse_arena(const nfc_image_t *image, nfc_batch_result_t *result,
+                                         nfc_arena_t *arena);
+
+/*
+ * @brief This API parses a batch of tag images on a pool of worker threads.
+ *
+ * The batch is split into one contiguous range per worker. Workers claim
+ * NFC_BATCH_GRAIN images at a time from their own range and steal from the
+ * other ranges once it is exhausted. Each image is parsed by exactly one
+ * worker into its own result and storage slice, so no locks are taken.
+ * If only some worker threads can be started, they and the calling thread
+ * parse the whole batch; if none can, nothing is parsed.
+ *
+ * @param[in]  images      : Array of image spans.
+ * @param[in]  image_cnt   : Number of images.
+ * @param[out] results     : Array of image_cnt results.
+ * @param[in]  storage     : Storage sliced per image for the TLV and index arrays.
+ * @param[in]  thread_cnt  : Number of worker threads (0 for one per online CPU).
+ *
+ * @return API status code.
+ * @retval NFC_BATCH_E_THREAD if no worker thread could be started.
+ */
+nfc_batch_status_t nfc_batch_parse_parallel(const nfc_image_t *images, size_t image_cnt,
+                                            nfc_batch_result_t *results, const nfc_batch_storage_t *storage,
+                                            unsigned thread_cnt);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* _NFC_BATCH_H_ */
+/** @}*/
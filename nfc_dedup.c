@@ -0,0 +1,376 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_dedup.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_dedup.c
+ * @brief NDEF message fingerprints and time-windowed de-duplication of tap events.
+ */
+#include "nfc_dedup.h"
+#include "nfc_stats.h"
+#include "nfc_tlv_block.h"
+
+#include <string.h>
+
+/* XXH64 primes. */
+#define NFC_DEDUP_P1    0x9E3779B185EBCA87ULL
+#define NFC_DEDUP_P2    0xC2B2AE3D27D4EB4FULL
+#define NFC_DEDUP_P3    0x165667B19E3779F9ULL
+#define NFC_DEDUP_P4    0x85EBCA77C2B2AE63ULL
+#define NFC_DEDUP_P5    0x27D4EB2F165667C5ULL
+
+#define NFC_DEDUP_REC_PREFIX_LEN    7   /* Flags, type length, ID length, 32-bit payload length. */
+
+static inline uint64_t nfc_dedup_rotl(uint64_t x, unsigned r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+/*
+ * @brief Little-endian loads; compilers turn them into single loads.
+ */
+static inline uint64_t nfc_dedup_le64(const uint8_t *p)
+{
+    return  (uint64_t)p[0]        | ((uint64_t)p[1] << 8)  | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+           ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline uint32_t nfc_dedup_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t nfc_dedup_round(uint64_t acc, uint64_t input)
+{
+    acc += input * NFC_DEDUP_P2;
+    acc  = nfc_dedup_rotl(acc, 31);
+    return acc * NFC_DEDUP_P1;
+}
+
+static inline uint64_t nfc_dedup_merge(uint64_t h, uint64_t acc)
+{
+    h ^= nfc_dedup_round(0, acc);
+    return h * NFC_DEDUP_P1 + NFC_DEDUP_P4;
+}
+
+/*
+ * @brief Consume whole stripes, one 64-bit word per lane.
+ */
+static const uint8_t *nfc_dedup_stripes(uint64_t acc[4], const uint8_t *p, size_t stripes)
+{
+    uint64_t a0 = acc[0], a1 = acc[1], a2 = acc[2], a3 = acc[3];
+
+    while(stripes--)
+    {
+        a0 = nfc_dedup_round(a0, nfc_dedup_le64(p));
+        a1 = nfc_dedup_round(a1, nfc_dedup_le64(p + 8));
+        a2 = nfc_dedup_round(a2, nfc_dedup_le64(p + 16));
+        a3 = nfc_dedup_round(a3, nfc_dedup_le64(p + 24));
+        p += NFC_DEDUP_STRIPE_SIZE;
+    }
+
+    acc[0] = a0;
+    acc[1] = a1;
+    acc[2] = a2;
+    acc[3] = a3;
+
+    return p;
+}
+
+/*
+ * @brief This API starts a fingerprint.
+ */
+void nfc_dedup_fp_init(nfc_dedup_fp_t *fp)
+{
+    if(fp == NULL)
+        return;
+
+    fp->acc[0]    = NFC_DEDUP_P1 + NFC_DEDUP_P2;
+    fp->acc[1]    = NFC_DEDUP_P2;
+    fp->acc[2]    = 0;
+    fp->acc[3]    = 0 - NFC_DEDUP_P1;
+    fp->total_len = 0;
+    fp->buf_len   = 0;
+}
+
+/*
+ * @brief This API feeds bytes to a fingerprint.
+ */
+void nfc_dedup_fp_update(nfc_dedup_fp_t *fp, const uint8_t *data, size_t len)
+{
+    if((fp == NULL) || (data == NULL) || (len == 0))
+        return;
+
+    fp->total_len += len;
+
+    if(fp->buf_len != 0)
+    {
+        size_t fill = NFC_DEDUP_STRIPE_SIZE - fp->buf_len;
+
+        if(len < fill)
+        {
+            memcpy(fp->buf + fp->buf_len, data, len);
+            fp->buf_len = (uint8_t)(fp->buf_len + len);
+            return;
+        }
+
+        memcpy(fp->buf + fp->buf_len, data, fill);
+        nfc_dedup_stripes(fp->acc, fp->buf, 1);
+        data       += fill;
+        len        -= fill;
+        fp->buf_len = 0;
+    }
+
+    data = nfc_dedup_stripes(fp->acc, data, len / NFC_DEDUP_STRIPE_SIZE);
+    len %= NFC_DEDUP_STRIPE_SIZE;
+
+    memcpy(fp->buf, data, len);
+    fp->buf_len = (uint8_t)len;
+}
+
+/*
+ * @brief This API feeds the canonical form of a record to a fingerprint.
+ */
+void nfc_dedup_fp_record(nfc_dedup_fp_t *fp, const ndef_record_t *rec)
+{
+    if((fp == NULL) || (rec == NULL))
+        return;
+
+    uint32_t payload_len = (uint32_t)rec->payload_len;
+    uint8_t  prefix[NFC_DEDUP_REC_PREFIX_LEN] =
+    {
+        (uint8_t)(rec->header & (NDEF_RECORD_FLAG_CF | NDEF_RECORD_FLAG_TNF_Msk)),
+        rec->type_len,
+        rec->id_len,
+        (uint8_t)(payload_len >> 24),
+        (uint8_t)(payload_len >> 16),
+        (uint8_t)(payload_len >> 8),
+        (uint8_t)payload_len
+    };
+
+    nfc_dedup_fp_update(fp, prefix, sizeof(prefix));
+    nfc_dedup_fp_update(fp, rec->type, rec->type_len);
+    nfc_dedup_fp_update(fp, rec->id, rec->id_len);
+    nfc_dedup_fp_update(fp, rec->payload, rec->payload_len);
+}
+
+/*
+ * @brief This API returns the fingerprint of the bytes fed so far.
+ */
+uint64_t nfc_dedup_fp_final(const nfc_dedup_fp_t *fp)
+{
+    if(fp == NULL)
+        return 0;
+
+    uint64_t h;
+
+    if(fp->total_len >= NFC_DEDUP_STRIPE_SIZE)
+    {
+        h = nfc_dedup_rotl(fp->acc[0], 1) + nfc_dedup_rotl(fp->acc[1], 7) +
+            nfc_dedup_rotl(fp->acc[2], 12) + nfc_dedup_rotl(fp->acc[3], 18);
+        h = nfc_dedup_merge(h, fp->acc[0]);
+        h = nfc_dedup_merge(h, fp->acc[1]);
+        h = nfc_dedup_merge(h, fp->acc[2]);
+        h = nfc_dedup_merge(h, fp->acc[3]);
+    }
+    else
+    {
+        h = fp->acc[2] + NFC_DEDUP_P5;
+    }
+
+    h += fp->total_len;
+
+    const uint8_t *p   = fp->buf;
+    size_t        len  = fp->buf_len;
+
+    for(; len >= 8; p += 8, len -= 8)
+    {
+        h ^= nfc_dedup_round(0, nfc_dedup_le64(p));
+        h  = nfc_dedup_rotl(h, 27) * NFC_DEDUP_P1 + NFC_DEDUP_P4;
+    }
+    if(len >= 4)
+    {
+        h ^= (uint64_t)nfc_dedup_le32(p) * NFC_DEDUP_P1;
+        h  = nfc_dedup_rotl(h, 23) * NFC_DEDUP_P2 + NFC_DEDUP_P3;
+        p   += 4;
+        len -= 4;
+    }
+    for(; len > 0; p++, len--)
+    {
+        h ^= *p * NFC_DEDUP_P5;
+        h  = nfc_dedup_rotl(h, 11) * NFC_DEDUP_P1;
+    }
+
+    h ^= h >> 33;
+    h *= NFC_DEDUP_P2;
+    h ^= h >> 29;
+    h *= NFC_DEDUP_P3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+/*
+ * @brief This API fingerprints the records of an NDEF message.
+ */
+nfc_dedup_status_t nfc_dedup_fingerprint_msg(uint8_t *msg, size_t len, uint64_t *fp)
+{
+    if((msg == NULL) || (fp == NULL))
+        return NFC_DEDUP_E_INVALID_ARGS;
+
+    nfc_dedup_fp_t state;
+    size_t         offset = 0;
+
+    nfc_dedup_fp_init(&state);
+
+    while(offset < len)
+    {
+        ndef_record_t rec;
+        size_t        br;
+
+        ndef_status_t rslt = ndef_parse_next_rec(msg + offset, len - offset, &rec, &br);
+        if(rslt != NDEF_OK)
+        {
+            if(rslt == NDEF_E_INCOMPLETE)
+                NFC_STATS_ERROR(NFC_STATS_ERR_NDEF_INCOMPLETE);
+            return NFC_DEDUP_E_INVALID_DATA;
+        }
+
+        nfc_dedup_fp_record(&state, &rec);
+        offset += br;
+    }
+
+    *fp = nfc_dedup_fp_final(&state);
+
+    return NFC_DEDUP_OK;
+}
+
+/*
+ * @brief This API fingerprints the first NDEF message of a TLV data area.
+ */
+nfc_dedup_status_t nfc_dedup_fingerprint_tlv(uint8_t *buf, size_t len, uint64_t *fp)
+{
+    if((buf == NULL) || (fp == NULL))
+        return NFC_DEDUP_E_INVALID_ARGS;
+
+    size_t offset = 0;
+
+    while(offset < len)
+    {
+        offset += tlv_skip_null(buf + offset, len - offset);
+        if(offset == len)
+            break;
+
+        tlv_t        tlv;
+        size_t       br = 0;
+        tlv_status_t rslt = t2t_parse_next_tlv(buf + offset, len - offset, &tlv, &br);
+
+        if(rslt == TLV_E_NOT_FOUND)
+        {
+            offset += br;
+            continue;
+        }
+        if(rslt != TLV_OK)
+        {
+            if(rslt == TLV_E_INCOMPLETE)
+                NFC_STATS_ERROR(NFC_STATS_ERR_TLV_INCOMPLETE);
+            return NFC_DEDUP_E_INVALID_DATA;
+        }
+
+        if(tlv.type == TLV_NDEF_MESSAGE)
+            return nfc_dedup_fingerprint_msg(tlv.value, tlv.length, fp);
+        if(tlv.type == TLV_TERMINATOR)
+            break;
+
+        offset += br;
+    }
+
+    return NFC_DEDUP_E_NOT_FOUND;
+}
+
+/*
+ * @brief This API initialises a table over caller storage and empties it.
+ */
+nfc_dedup_status_t nfc_dedup_init(nfc_dedup_table_t *table)
+{
+    if((table == NULL) || (table->set_cnt == 0) || ((table->set_cnt & (table->set_cnt - 1)) != 0) ||
+       (table->entries == NULL))
+        return NFC_DEDUP_E_INVALID_ARGS;
+
+    memset(table->entries, 0, (size_t)table->set_cnt * NFC_DEDUP_WAYS * sizeof(*table->entries));
+    table->passed  = 0;
+    table->dropped = 0;
+
+    return NFC_DEDUP_OK;
+}
+
+/*
+ * @brief This API checks a tap event against the table and records it.
+ */
+nfc_dedup_status_t nfc_dedup_check(nfc_dedup_table_t *table, uint64_t fingerprint, uint64_t now)
+{
+    if(table == NULL)
+        return NFC_DEDUP_E_INVALID_ARGS;
+
+    /* 0 marks empty entries. */
+    if(fingerprint == 0)
+        fingerprint = 1;
+
+    /* Fingerprints are well mixed: the high bits pick the set. */
+    nfc_dedup_entry_t *set    = table->entries + (size_t)((fingerprint >> 32) & (table->set_cnt - 1)) * NFC_DEDUP_WAYS;
+    nfc_dedup_entry_t *victim = &set[0];
+
+    for(size_t way = 0; way < NFC_DEDUP_WAYS; way++)
+    {
+        if(set[way].fingerprint == fingerprint)
+        {
+            uint64_t last = set[way].stamp;
+
+            set[way].stamp = now;
+
+            if(now - last <= table->window)
+            {
+                table->dropped++;
+                return NFC_DEDUP_E_DUPLICATE;
+            }
+
+            table->passed++;
+            return NFC_DEDUP_OK;
+        }
+
+        /* Prefer an empty entry, then the least recently seen one. */
+        if((victim->fingerprint != 0) &&
+           ((set[way].fingerprint == 0) || (set[way].stamp < victim->stamp)))
+            victim = &set[way];
+    }
+
+    victim->fingerprint = fingerprint;
+    victim->stamp       = now;
+    table->passed++;
+
+    return NFC_DEDUP_OK;
+}
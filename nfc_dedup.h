@@ -0,0 +1,204 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_dedup.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_dedup.h
+ * @brief NDEF message fingerprints and time-windowed de-duplication of tap events.
+ */
+
+/*!
+ * @defgroup DEDUP API
+ */
+#ifndef _NFC_DEDUP_H_
+#define _NFC_DEDUP_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "nfc_ndef.h"
+
+#define NFC_DEDUP_WAYS          4   /* Entries per set; one set fills a 64-byte cache line. */
+#define NFC_DEDUP_STRIPE_SIZE   32  /* Bytes consumed per round of the fingerprint hash.    */
+
+/*!
+ * @brief De-duplication API status codes.
+ */
+typedef enum
+{
+    NFC_DEDUP_OK,               /* Success (new event on check)                   */
+    NFC_DEDUP_E_INVALID_ARGS,   /* Invalid function arguments                     */
+    NFC_DEDUP_E_DUPLICATE,      /* Fingerprint seen within the window, drop event */
+    NFC_DEDUP_E_NOT_FOUND,      /* No NDEF message TLV in the data area           */
+    NFC_DEDUP_E_INVALID_DATA    /* TLV or NDEF data is invalid                    */
+} nfc_dedup_status_t;
+
+/*!
+ * @brief Streaming fingerprint state.
+ *
+ * The fingerprint is XXH64 (seed 0) of the bytes fed to it, so it can be
+ * reproduced by any XXH64 implementation.
+ */
+typedef struct
+{
+    uint64_t acc[4];                        /* Lane accumulators                  */
+    uint64_t total_len;                     /* Bytes fed so far                   */
+    uint8_t  buf[NFC_DEDUP_STRIPE_SIZE];    /* Bytes not yet forming a full stripe */
+    uint8_t  buf_len;                       /* Bytes held in 'buf'                */
+} nfc_dedup_fp_t;
+
+/*!
+ * @brief Table entry.
+ */
+typedef struct
+{
+    uint64_t fingerprint;   /* Message fingerprint, 0 if the entry is empty */
+    uint64_t stamp;         /* Time the fingerprint was last seen           */
+} nfc_dedup_entry_t;
+
+/*!
+ * @brief Fixed-memory de-duplication table over caller storage.
+ *
+ * Each fingerprint maps to one set of NFC_DEDUP_WAYS entries sharing a cache
+ * line, so a check touches a single line whatever the table size. Times are
+ * in any caller-chosen unit; 'window' uses the same unit.
+ */
+typedef struct
+{
+    uint32_t          set_cnt;  /* Number of sets, a power of two                  */
+    uint64_t          window;   /* Events closer than this to the last are dropped */
+    nfc_dedup_entry_t *entries; /* set_cnt * NFC_DEDUP_WAYS entries, ideally 64-byte aligned */
+    uint64_t          passed;   /* Events reported as new                         */
+    uint64_t          dropped;  /* Events reported as duplicates                  */
+} nfc_dedup_table_t;
+
+/*
+ * @brief This API starts a fingerprint.
+ *
+ * @param[out] fp : Fingerprint state.
+ */
+void nfc_dedup_fp_init(nfc_dedup_fp_t *fp);
+
+/*
+ * @brief This API feeds bytes to a fingerprint.
+ *
+ * Can be used to mix the tag UID in first, so identical content on different
+ * tags is reported separately.
+ *
+ * @param[in,out] fp   : Fingerprint state.
+ * @param[in]     data : Bytes to hash.
+ * @param[in]     len  : Number of bytes.
+ */
+void nfc_dedup_fp_update(nfc_dedup_fp_t *fp, const uint8_t *data, size_t len);
+
+/*
+ * @brief This API feeds the canonical form of a record to a fingerprint.
+ *
+ * The canonical form is the TNF and CF bits, the type, ID and payload lengths
+ * as fixed-size fields and the type, ID and payload bytes. It does not depend
+ * on the MB/ME flags or on the short or long length encoding, so the same
+ * records always give the same fingerprint.
+ *
+ * @param[in,out] fp  : Fingerprint state.
+ * @param[in]     rec : Record from ndef_parse_next_rec().
+ */
+void nfc_dedup_fp_record(nfc_dedup_fp_t *fp, const ndef_record_t *rec);
+
+/*
+ * @brief This API returns the fingerprint of the bytes fed so far.
+ *
+ * The state is left unchanged, so more bytes can still be fed.
+ *
+ * @param[in] fp : Fingerprint state.
+ *
+ * @return Fingerprint.
+ */
+uint64_t nfc_dedup_fp_final(const nfc_dedup_fp_t *fp);
+
+/*
+ * @brief This API fingerprints the records of an NDEF message.
+ *
+ * @param[in]  msg : Pointer to the NDEF message.
+ * @param[in]  len : Length of the message.
+ * @param[out] fp  : Fingerprint.
+ *
+ * @return API status code.
+ */
+nfc_dedup_status_t nfc_dedup_fingerprint_msg(uint8_t *msg, size_t len, uint64_t *fp);
+
+/*
+ * @brief This API fingerprints the first NDEF message of a TLV data area.
+ *
+ * NULL padding and the TLV framing are skipped: only the records are hashed,
+ * so the result equals nfc_dedup_fingerprint_msg() on the message alone.
+ *
+ * @param[in]  buf : Pointer to the data area.
+ * @param[in]  len : Length of the data area.
+ * @param[out] fp  : Fingerprint.
+ *
+ * @return API status code.
+ */
+nfc_dedup_status_t nfc_dedup_fingerprint_tlv(uint8_t *buf, size_t len, uint64_t *fp);
+
+/*
+ * @brief This API initialises a table over caller storage and empties it.
+ *
+ * @param[in,out] table : Table with 'set_cnt', 'window' and 'entries' set.
+ *
+ * @return API status code.
+ */
+nfc_dedup_status_t nfc_dedup_init(nfc_dedup_table_t *table);
+
+/*
+ * @brief This API checks a tap event against the table and records it.
+ *
+ * An event whose fingerprint was last seen at most 'window' ago is a
+ * duplicate. Every event refreshes the time of its fingerprint, so a tag
+ * held in the field keeps being dropped and is reported again only after it
+ * has been away for a whole window. When a set is full the expired or least
+ * recently seen entry is replaced.
+ *
+ * @param[in,out] table       : Table.
+ * @param[in]     fingerprint : Fingerprint of the event.
+ * @param[in]     now         : Time of the event, never decreasing.
+ *
+ * @return API status code.
+ * @retval NFC_DEDUP_OK          if the event is new.
+ * @retval NFC_DEDUP_E_DUPLICATE if the event should be dropped.
+ */
+nfc_dedup_status_t nfc_dedup_check(nfc_dedup_table_t *table, uint64_t fingerprint, uint64_t now);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* _NFC_DEDUP_H_ */
+/** @}*/
@@ -0,0 +1,283 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_filter.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_filter.c
+ * @brief Compiled (TNF, type) record filter over NDEF messages.
+ */
+#include "nfc_filter.h"
+#include "nfc_stats.h"
+
+#include <string.h>
+
+#define NFC_FILTER_FNV_OFFSET   0x811C9DC5u     /* FNV-1a 32-bit offset basis */
+#define NFC_FILTER_FNV_PRIME    0x01000193u     /* FNV-1a 32-bit prime        */
+
+/*
+ * @brief Media and external types are case-insensitive.
+ */
+static inline uint8_t nfc_filter_fold_case(uint8_t tnf)
+{
+    return (tnf == TNF_MEDIA_TYPE) || (tnf == TNF_EXTERNAL_TYPE);
+}
+
+static inline uint8_t nfc_filter_lower(uint8_t c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? (uint8_t)(c + ('a' - 'A')) : c;
+}
+
+/*
+ * @brief Hash of a TNF and type, folding case where the TNF requires it.
+ */
+static uint32_t nfc_filter_hash(uint8_t tnf, const uint8_t *type, uint8_t type_len)
+{
+    uint32_t h = (NFC_FILTER_FNV_OFFSET ^ tnf) * NFC_FILTER_FNV_PRIME;
+
+    h = (h ^ type_len) * NFC_FILTER_FNV_PRIME;
+
+    if(nfc_filter_fold_case(tnf))
+    {
+        for(uint8_t i = 0; i < type_len; i++)
+            h = (h ^ nfc_filter_lower(type[i])) * NFC_FILTER_FNV_PRIME;
+    }
+    else
+    {
+        for(uint8_t i = 0; i < type_len; i++)
+            h = (h ^ type[i]) * NFC_FILTER_FNV_PRIME;
+    }
+
+    return h;
+}
+
+/*
+ * @brief Compare two types of the same TNF and length.
+ */
+static uint8_t nfc_filter_type_eq(uint8_t tnf, const uint8_t *a, const uint8_t *b, uint8_t len)
+{
+    if(!nfc_filter_fold_case(tnf))
+        return memcmp(a, b, len) == 0;
+
+    for(uint8_t i = 0; i < len; i++)
+    {
+        if(nfc_filter_lower(a[i]) != nfc_filter_lower(b[i]))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * @brief Find the slot of a TNF and type: the matching slot, or the empty slot ending its probe sequence.
+ */
+static const nfc_filter_slot_t *nfc_filter_find(const nfc_filter_t *filter, uint8_t tnf,
+                                                const uint8_t *type, uint8_t type_len, uint32_t hash)
+{
+    uint32_t mask = filter->slot_cnt - 1;
+
+    for(uint32_t i = hash & mask; ; i = (i + 1) & mask)
+    {
+        const nfc_filter_slot_t *slot = &filter->slots[i];
+
+        if(slot->mask == 0)
+            return slot;
+
+        if((slot->hash == hash) && (slot->tnf == tnf) && (slot->type_len == type_len) &&
+           nfc_filter_type_eq(tnf, slot->type, type, type_len))
+            return slot;
+    }
+}
+
+/*
+ * @brief Scan one message, appending its matches.
+ */
+static nfc_filter_status_t nfc_filter_scan_msg(const nfc_filter_t *filter, uint32_t msg_no, uint8_t *msg, size_t len,
+                                               nfc_filter_match_t *matches, size_t max, size_t *cnt)
+{
+    size_t   offset = 0;
+    uint32_t rec_no = 0;
+    uint64_t carry  = 0;
+
+    while(offset < len)
+    {
+        ndef_record_t rec;
+        size_t        br;
+
+        ndef_status_t rslt = ndef_parse_next_rec(msg + offset, len - offset, &rec, &br);
+        if(rslt != NDEF_OK)
+        {
+            if(rslt == NDEF_E_INCOMPLETE)
+                NFC_STATS_ERROR(NFC_STATS_ERR_NDEF_INCOMPLETE);
+            return NFC_FILTER_E_INVALID_DATA;
+        }
+
+        /* Continuation chunks inherit the result of the initial chunk. */
+        uint64_t mask = ((rec.header & NDEF_RECORD_FLAG_TNF_Msk) == TNF_UNCHANGED) ?
+                        carry : nfc_filter_match(filter, &rec);
+
+        carry = NDEF_RECORD_GET_FLAG(rec.header, NDEF_RECORD_FLAG_CF) ? mask : 0;
+
+        if(mask != 0)
+        {
+            if(*cnt >= max)
+                return NFC_FILTER_E_NO_MEM;
+
+            nfc_filter_match_t *m = &matches[(*cnt)++];
+
+            m->msg_no      = msg_no;
+            m->rec_no      = rec_no;
+            m->mask        = mask;
+            m->payload     = rec.payload;
+            m->payload_len = rec.payload_len;
+        }
+
+        offset += br;
+        rec_no++;
+    }
+
+    return NFC_FILTER_OK;
+}
+
+/*
+ * @brief This API compiles a set of patterns into a filter.
+ */
+nfc_filter_status_t nfc_filter_compile(nfc_filter_t *filter, const nfc_filter_pattern_t *patterns, size_t cnt)
+{
+    if((filter == NULL) || (filter->slots == NULL) || ((patterns == NULL) && (cnt != 0)) ||
+       (cnt > NFC_FILTER_MAX_PATTERNS))
+        return NFC_FILTER_E_INVALID_ARGS;
+
+    /* At least one empty slot ends every probe sequence. */
+    if((filter->slot_cnt <= cnt) || ((filter->slot_cnt & (filter->slot_cnt - 1)) != 0))
+        return NFC_FILTER_E_NO_MEM;
+
+    memset(filter->slots, 0, filter->slot_cnt * sizeof(*filter->slots));
+    memset(filter->any_mask, 0, sizeof(filter->any_mask));
+    filter->tnf_used = 0;
+
+    for(size_t n = 0; n < cnt; n++)
+    {
+        const nfc_filter_pattern_t *p   = &patterns[n];
+        uint64_t                   bit  = 1ULL << n;
+
+        if((p->tnf >= TNF_UNCHANGED) || ((p->type == NULL) && (p->type_len != 0)))
+            return NFC_FILTER_E_INVALID_ARGS;
+
+        filter->tnf_used |= (uint8_t)(1u << p->tnf);
+
+        if(p->type == NULL)
+        {
+            filter->any_mask[p->tnf] |= bit;
+            continue;
+        }
+
+        uint32_t          hash = nfc_filter_hash(p->tnf, p->type, p->type_len);
+        nfc_filter_slot_t *slot = (nfc_filter_slot_t *)nfc_filter_find(filter, p->tnf, p->type, p->type_len, hash);
+
+        if(slot->mask == 0)
+        {
+            slot->type     = p->type;
+            slot->hash     = hash;
+            slot->tnf      = p->tnf;
+            slot->type_len = p->type_len;
+        }
+        slot->mask |= bit;
+    }
+
+    return NFC_FILTER_OK;
+}
+
+/*
+ * @brief This API returns the patterns matching a record.
+ */
+uint64_t nfc_filter_match(const nfc_filter_t *filter, const ndef_record_t *rec)
+{
+    if((filter == NULL) || (rec == NULL))
+        return 0;
+
+    uint8_t tnf = rec->header & NDEF_RECORD_FLAG_TNF_Msk;
+
+    /* Most records of an unwanted TNF are rejected on the header byte alone. */
+    if(!(filter->tnf_used & (1u << tnf)))
+        return 0;
+
+    uint64_t mask = filter->any_mask[tnf];
+
+    if((rec->type_len != 0) || (rec->type != NULL))
+    {
+        uint32_t                hash = nfc_filter_hash(tnf, rec->type, rec->type_len);
+        const nfc_filter_slot_t *slot = nfc_filter_find(filter, tnf, rec->type, rec->type_len, hash);
+
+        mask |= slot->mask;
+    }
+
+    return mask;
+}
+
+/*
+ * @brief This API scans an NDEF message and returns the payloads of the matching records.
+ */
+nfc_filter_status_t nfc_filter_scan(const nfc_filter_t *filter, uint8_t *msg, size_t len,
+                                    nfc_filter_match_t *matches, size_t max, size_t *cnt)
+{
+    if((filter == NULL) || (msg == NULL) || ((matches == NULL) && (max != 0)) || (cnt == NULL))
+        return NFC_FILTER_E_INVALID_ARGS;
+
+    *cnt = 0;
+
+    return nfc_filter_scan_msg(filter, 0, msg, len, matches, max, cnt);
+}
+
+/*
+ * @brief This API scans a batch of NDEF messages.
+ */
+nfc_filter_status_t nfc_filter_scan_batch(const nfc_filter_t *filter, uint8_t *const *msgs, const size_t *lens,
+                                          size_t msg_cnt, nfc_filter_match_t *matches, size_t max, size_t *cnt)
+{
+    if((filter == NULL) || ((msg_cnt != 0) && ((msgs == NULL) || (lens == NULL))) ||
+       ((matches == NULL) && (max != 0)) || (cnt == NULL) || (msg_cnt > UINT32_MAX))
+        return NFC_FILTER_E_INVALID_ARGS;
+
+    nfc_filter_status_t status = NFC_FILTER_OK;
+
+    *cnt = 0;
+
+    for(size_t n = 0; n < msg_cnt; n++)
+    {
+        if(msgs[n] == NULL)
+            return NFC_FILTER_E_INVALID_ARGS;
+
+        nfc_filter_status_t rslt = nfc_filter_scan_msg(filter, (uint32_t)n, msgs[n], lens[n], matches, max, cnt);
+
+        if(rslt == NFC_FILTER_E_NO_MEM)
+            return rslt;
+        if(rslt != NFC_FILTER_OK)
+            status = rslt;
+    }
+
+    return status;
+}
@@ -0,0 +1,180 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_filter.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_filter.h
+ * @brief Compiled (TNF, type) record filter over NDEF messages.
+ */
+
+/*!
+ * @defgroup FILTER API
+ */
+#ifndef _NFC_FILTER_H_
+#define _NFC_FILTER_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "nfc_ndef.h"
+
+#define NFC_FILTER_MAX_PATTERNS     64  /* Patterns per filter, one bit each in a match mask. */
+
+/*!
+ * @brief Filter API status codes.
+ */
+typedef enum
+{
+    NFC_FILTER_OK,              /* Success                                    */
+    NFC_FILTER_E_INVALID_ARGS,  /* Invalid function arguments                 */
+    NFC_FILTER_E_NO_MEM,        /* Not enough slots or match storage          */
+    NFC_FILTER_E_INVALID_DATA   /* Message is malformed                       */
+} nfc_filter_status_t;
+
+/*!
+ * @brief Record pattern.
+ *
+ * Matches records with the given TNF and type. A NULL type matches every
+ * record of the TNF. Media types and external types are compared without
+ * regard to ASCII case, as their specifications require; other types are
+ * compared exactly. The type bytes are not copied and must outlive the filter.
+ */
+typedef struct
+{
+    uint8_t       tnf;      /* TNF_* value                        */
+    const uint8_t *type;    /* Type bytes, or NULL for any type   */
+    uint8_t       type_len; /* Length of the type                 */
+} nfc_filter_pattern_t;
+
+/*!
+ * @brief Hash table slot of a compiled filter.
+ */
+typedef struct
+{
+    uint64_t      mask;     /* Patterns matching this (TNF, type), 0 if the slot is empty */
+    const uint8_t *type;    /* Type bytes                                                 */
+    uint32_t      hash;     /* Hash of the TNF and type                                   */
+    uint8_t       tnf;      /* TNF                                                        */
+    uint8_t       type_len; /* Length of the type                                         */
+} nfc_filter_slot_t;
+
+/*!
+ * @brief Compiled filter over caller storage.
+ */
+typedef struct
+{
+    nfc_filter_slot_t *slots;       /* Caller storage, a power of two above the pattern count */
+    uint32_t          slot_cnt;     /* Number of slots                                        */
+    uint64_t          any_mask[8];  /* Per TNF: patterns matching any type                    */
+    uint8_t           tnf_used;     /* Bit per TNF with at least one pattern                  */
+} nfc_filter_t;
+
+/*!
+ * @brief Matching record.
+ */
+typedef struct
+{
+    uint32_t msg_no;        /* Message index within the scanned batch             */
+    uint32_t rec_no;        /* Record index within the message                    */
+    uint64_t mask;          /* Matching patterns, bit n for pattern n             */
+    uint8_t  *payload;      /* Payload of the record (one chunk for chunked ones) */
+    size_t   payload_len;   /* Length of the payload                              */
+} nfc_filter_match_t;
+
+/*
+ * @brief This API compiles a set of patterns into a filter.
+ *
+ * @param[in,out] filter   : Filter with 'slots' and 'slot_cnt' set.
+ * @param[in]     patterns : Patterns; pattern n sets bit n of the match masks.
+ * @param[in]     cnt      : Number of patterns, at most NFC_FILTER_MAX_PATTERNS.
+ *
+ * @return API status code.
+ * @retval NFC_FILTER_E_NO_MEM if 'slot_cnt' is not a power of two above 'cnt'.
+ */
+nfc_filter_status_t nfc_filter_compile(nfc_filter_t *filter, const nfc_filter_pattern_t *patterns, size_t cnt);
+
+/*
+ * @brief This API returns the patterns matching a record.
+ *
+ * Only the header and type bytes of the record are read.
+ *
+ * @param[in] filter : Compiled filter.
+ * @param[in] rec    : Record from ndef_parse_next_rec().
+ *
+ * @return Mask of the matching patterns, 0 if none.
+ */
+uint64_t nfc_filter_match(const nfc_filter_t *filter, const ndef_record_t *rec);
+
+/*
+ * @brief This API scans an NDEF message and returns the payloads of the matching records.
+ *
+ * Records are walked with ndef_parse_next_rec(), so payload bytes are never
+ * read. The continuation chunks of a matching chunked record match as well.
+ *
+ * @param[in]  filter  : Compiled filter.
+ * @param[in]  msg     : Pointer to the NDEF message.
+ * @param[in]  len     : Length of the message.
+ * @param[out] matches : Match storage.
+ * @param[in]  max     : Capacity of 'matches'.
+ * @param[out] cnt     : Number of matches stored.
+ *
+ * @return API status code.
+ * @retval NFC_FILTER_E_NO_MEM if more records match than 'max'; the first 'max' are stored.
+ */
+nfc_filter_status_t nfc_filter_scan(const nfc_filter_t *filter, uint8_t *msg, size_t len,
+                                    nfc_filter_match_t *matches, size_t max, size_t *cnt);
+
+/*
+ * @brief This API scans a batch of NDEF messages.
+ *
+ * A malformed message stops its own scan only; its earlier matches are kept.
+ *
+ * @param[in]  filter  : Compiled filter.
+ * @param[in]  msgs    : Pointers to the messages.
+ * @param[in]  lens    : Lengths of the messages.
+ * @param[in]  msg_cnt : Number of messages.
+ * @param[out] matches : Match storage, shared by all messages in order.
+ * @param[in]  max     : Capacity of 'matches'.
+ * @param[out] cnt     : Number of matches stored.
+ *
+ * @return API status code.
+ * @retval NFC_FILTER_E_INVALID_DATA if at least one message is malformed.
+ * @retval NFC_FILTER_E_NO_MEM       if more records match than 'max'.
+ */
+nfc_filter_status_t nfc_filter_scan_batch(const nfc_filter_t *filter, uint8_t *const *msgs, const size_t *lens,
+                                          size_t msg_cnt, nfc_filter_match_t *matches, size_t max, size_t *cnt);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* _NFC_FILTER_H_ */
+/** @}*/
@@ -31,128 +31,525 @@
  * @brief Utility tools for NDEF format.
  */
 #include "nfc_ndef.h"
+#include "nfc_stats.h"
+#include "nfc_tlv_block.h"
+
+#include <string.h>
+
+#define NDEF_HEADER_MIN_LENGTH      2   /* Header byte + type length byte. */
+#define NDEF_SR_PAYLOAD_LEN_LENGTH  1   /* Payload length field of a short record. */
+#define NDEF_PAYLOAD_LEN_LENGTH     4   /* Payload length field of a normal record. */
+
+/*
+ * @brief Header byte decode table, expanded at compile time.
+ */
+const ndef_header_info_t ndef_header_table[256] = { NDEF_HEADER_INFO_TABLE };
 
 /*
  * @brief This API parses the next NDEF record found in the buffer.
  */
-ndef_status_t ndef_parse_next_rec(uint8_t *buf, ndef_record_t *rec, size_t *br)
+ndef_status_t ndef_parse_next_rec(uint8_t *buf, size_t len, ndef_record_t *rec, size_t *br)
 {
     /* Check parameters are valid */
-    if((buf == NULL) || (rec == NULL) || (br == 0))
+    if((buf == NULL) || (rec == NULL) || (br == NULL))
+        return NDEF_E_INVALID_ARGS;
+
+    if(len < NDEF_HEADER_MIN_LENGTH)
+        return NDEF_E_INCOMPLETE;
+
+    const ndef_header_info_t *info = &ndef_header_table[buf[0]];
+
+    if(len < info->fixed_len)
+        return NDEF_E_INCOMPLETE;
+
+    if(!info->tnf_valid)
+    {
+        NFC_STATS_ERROR(NFC_STATS_ERR_NDEF_RESERVED_TNF);
+        return NDEF_E_INVALID_FORMAT;
+    }
+
+    /*
+     * Payload length without branching on SR: the 4-byte form is loaded
+     * whenever the buffer is long enough, independently of the header byte,
+     * and the table selects between it and the 1-byte form.
+     */
+    uint32_t sr_len   = buf[2];
+    uint32_t long_len = sr_len;
+    if(len >= NDEF_HEADER_MIN_LENGTH + NDEF_PAYLOAD_LEN_LENGTH)
+        long_len = ((uint32_t)buf[2] << 24) | ((uint32_t)buf[3] << 16) |
+                   ((uint32_t)buf[4] << 8)  |  (uint32_t)buf[5];
+    uint32_t payload_len = info->long_len ? long_len : sr_len;
+
+    /*
+     * ID length byte follows the payload length field. Its position is
+     * computed from the SR and IL bits directly so it does not wait on the
+     * table load. Without IL the index falls on the last payload length
+     * byte instead and the value is masked.
+     */
+    uint32_t il     = (buf[0] >> 3) & 1;
+    uint32_t sr     = (buf[0] >> 4) & 1;
+    uint32_t id_pos = NDEF_HEADER_MIN_LENGTH - 1 + NDEF_PAYLOAD_LEN_LENGTH - 3 * sr + il;
+    uint8_t  id_len = buf[id_pos] & (uint8_t)(0u - il);
+
+    rec->header      = buf[0];
+    rec->type_len    = buf[1];
+    rec->payload_len = payload_len;
+    rec->id_len      = id_len;
+
+    /* Type, ID and payload must lie entirely within the buffer. */
+    size_t total = (size_t)info->fixed_len + rec->type_len + rec->id_len + (size_t)payload_len;
+    if((payload_len > len) || (total > len))
+        return NDEF_E_INCOMPLETE;
+
+    uint8_t *type = buf + info->fixed_len;
+
+    rec->type    = (rec->type_len == 0) ? NULL : type;
+    rec->id      = (rec->id_len == 0) ? NULL : type + rec->type_len;
+    rec->payload = (rec->payload_len == 0) ? NULL : type + rec->type_len + rec->id_len;
+
+    rec->total_length = total;
+
+    *br = rec->total_length;
+
+    NFC_STATS_INC(NFC_STATS_NDEF_RECORDS);
+    NFC_STATS_INC(info->long_len ? NFC_STATS_NDEF_LONG_RECORDS : NFC_STATS_NDEF_SHORT_RECORDS);
+    NFC_STATS_HIST(NFC_STATS_HIST_PAYLOAD_LENGTH, payload_len);
+
+    return NDEF_OK;
+}
+
+/*
+ * @brief This API initialises an NDEF message index over caller storage.
+ */
+ndef_status_t ndef_index_init(ndef_index_t *idx, uint32_t *storage, uint32_t max_records)
+{
+    if((idx == NULL) || (storage == NULL))
         return NDEF_E_INVALID_ARGS;
 
-    /* Check the NDEF record has at least the MB or ME set for validity */
-    if (NDEF_RECORD_GET_FLAG(*buf, NDEF_RECORD_FLAG_MB) == 0 &&
-        NDEF_RECORD_GET_FLAG(*buf, NDEF_RECORD_FLAG_ME) == 0)
+    idx->msg            = NULL;
+    idx->msg_len        = 0;
+    idx->rec_offset     = storage;
+    idx->payload_offset = storage + max_records;
+    idx->payload_len    = storage + 2 * (size_t)max_records;
+    idx->max_records    = max_records;
+    idx->rec_cnt        = 0;
+
+    return NDEF_OK;
+}
+
+/*
+ * @brief Indexes the records that end within the first 'avail' bytes of the
+ * message, resuming after the last record already in the index.
+ */
+static ndef_status_t ndef_index_scan(ndef_index_t *idx, size_t avail)
+{
+    uint8_t *msg    = idx->msg;
+    size_t   len    = idx->msg_len;
+    size_t   offset = 0;
+
+    if(idx->rec_cnt != 0)
+    {
+        uint32_t last = idx->rec_cnt - 1;
+
+        /* A previous call already saw the record carrying ME. */
+        if(NDEF_RECORD_GET_FLAG(msg[idx->rec_offset[last]], NDEF_RECORD_FLAG_ME))
+            return NDEF_OK;
+
+        offset = (size_t)idx->payload_offset[last] + idx->payload_len[last];
+    }
+
+    while(offset < avail)
+    {
+        ndef_record_t rec;
+        size_t        br;
+        ndef_status_t rslt = ndef_parse_next_rec(msg + offset, avail - offset, &rec, &br);
+
+        if(rslt == NDEF_E_INCOMPLETE)
+        {
+            if(avail < len)
+                return NDEF_E_INCOMPLETE;
+
+            NFC_STATS_ERROR(NFC_STATS_ERR_NDEF_TRUNCATED_MSG);
+            return NDEF_E_INVALID_FORMAT;
+        }
+        if(rslt != NDEF_OK)
+            return rslt;
+
+        /* MB must be set on the first record only. */
+        if(NDEF_RECORD_GET_FLAG(rec.header, NDEF_RECORD_FLAG_MB) != (idx->rec_cnt == 0))
+        {
+            NFC_STATS_ERROR(NFC_STATS_ERR_NDEF_MB);
+            return NDEF_E_INVALID_FORMAT;
+        }
+
+        if(idx->rec_cnt >= idx->max_records)
+        {
+            NFC_STATS_ERROR(NFC_STATS_ERR_NDEF_INDEX_FULL);
+            return NDEF_E_NO_MEM;
+        }
+
+        idx->rec_offset[idx->rec_cnt]     = (uint32_t)offset;
+        idx->payload_offset[idx->rec_cnt] = (uint32_t)(offset + br - rec.payload_len);
+        idx->payload_len[idx->rec_cnt]    = (uint32_t)rec.payload_len;
+        idx->rec_cnt++;
+
+        offset += br;
+
+        /* ME must be set on the last record only, which must end the message. */
+        if(NDEF_RECORD_GET_FLAG(rec.header, NDEF_RECORD_FLAG_ME))
+        {
+            if(offset != len)
+            {
+                NFC_STATS_ERROR(NFC_STATS_ERR_NDEF_ME);
+                return NDEF_E_INVALID_FORMAT;
+            }
+
+            NFC_STATS_INC(NFC_STATS_NDEF_MESSAGES);
+            NFC_STATS_HIST(NFC_STATS_HIST_RECORDS_PER_MSG, idx->rec_cnt);
+            return NDEF_OK;
+        }
+    }
+
+    if(avail < len)
+        return NDEF_E_INCOMPLETE;
+
+    /* Message ended without a record carrying ME (or was empty). */
+    if(idx->rec_cnt == 0)
         return NDEF_E_NOT_FOUND;
 
-    uint8_t *buf_start = buf;
+    NFC_STATS_ERROR(NFC_STATS_ERR_NDEF_ME);
+    return NDEF_E_INVALID_FORMAT;
+}
 
-    rec->header  = *buf++;
-    rec->type_len = *buf++;
-    
-    if (NDEF_RECORD_GET_FLAG(rec->header, NDEF_RECORD_FLAG_SR))
+/*
+ * @brief This API indexes every record of an NDEF message in a single pass.
+ */
+ndef_status_t ndef_index_build(ndef_index_t *idx, uint8_t *msg, size_t len)
+{
+    if((idx == NULL) || (msg == NULL) || (len > UINT32_MAX))
+        return NDEF_E_INVALID_ARGS;
+
+    idx->msg     = msg;
+    idx->msg_len = (uint32_t)len;
+    idx->rec_cnt = 0;
+
+    return ndef_index_scan(idx, len);
+}
+
+/*
+ * @brief This API extends the index of a partially received NDEF message.
+ */
+ndef_status_t ndef_index_update(ndef_index_t *idx, uint8_t *msg, size_t len, size_t avail)
+{
+    if((idx == NULL) || (msg == NULL) || (len > UINT32_MAX) || (avail > len))
+        return NDEF_E_INVALID_ARGS;
+
+    if((idx->msg != msg) || (idx->msg_len != len))
     {
-        /* NDEF record is a 'short' sized record, copy the 1-byte 'Paylod Length' field */
-        rec->payload_len = *buf++;
+        idx->msg     = msg;
+        idx->msg_len = (uint32_t)len;
+        idx->rec_cnt = 0;
     }
-    else
+
+    return ndef_index_scan(idx, avail);
+}
+
+/*
+ * @brief This API compacts the index arrays down to the records indexed.
+ */
+size_t ndef_index_shrink(ndef_index_t *idx)
+{
+    uint32_t cnt = idx->rec_cnt;
+
+    /* Each array only moves down, and the payload offsets move before the
+     * payload lengths they could otherwise overwrite. */
+    memmove(idx->rec_offset + cnt, idx->payload_offset, cnt * sizeof(uint32_t));
+    memmove(idx->rec_offset + 2 * (size_t)cnt, idx->payload_len, cnt * sizeof(uint32_t));
+
+    idx->payload_offset = idx->rec_offset + cnt;
+    idx->payload_len    = idx->rec_offset + 2 * (size_t)cnt;
+    idx->max_records    = cnt;
+
+    return NDEF_INDEX_STORAGE_WORDS((size_t)cnt);
+}
+
+/*
+ * @brief This API fills a record structure for an indexed record.
+ */
+ndef_status_t ndef_index_get(const ndef_index_t *idx, uint32_t n, ndef_record_t *rec)
+{
+    if((idx == NULL) || (rec == NULL))
+        return NDEF_E_INVALID_ARGS;
+
+    if(n >= idx->rec_cnt)
+        return NDEF_E_NOT_FOUND;
+
+    uint8_t *hdr     = idx->msg + idx->rec_offset[n];
+    uint8_t *payload = idx->msg + idx->payload_offset[n];
+
+    rec->header      = hdr[0];
+    rec->type_len    = hdr[1];
+    rec->payload_len = idx->payload_len[n];
+
+    /* The ID length byte, when present, is the last byte of the fixed header. */
+    const ndef_header_info_t *info = &ndef_header_table[rec->header];
+    rec->id_len = info->il ? hdr[info->fixed_len - 1] : 0;
+
+    uint8_t *type = payload - rec->id_len - rec->type_len;
+
+    rec->type         = (rec->type_len == 0) ? NULL : type;
+    rec->id           = (rec->id_len == 0) ? NULL : type + rec->type_len;
+    rec->payload      = (rec->payload_len == 0) ? NULL : payload;
+    rec->total_length = (size_t)(payload + rec->payload_len - hdr);
+
+    return NDEF_OK;
+}
+
+
+/*
+ * @brief This API parses the next logical NDEF record, joining chunked records.
+ */
+ndef_status_t ndef_parse_next_chunked_rec(uint8_t *buf, size_t len, ndef_chunked_record_t *crec, size_t *br)
+{
+    if((buf == NULL) || (crec == NULL) || (crec->segs == NULL) || (br == NULL))
+        return NDEF_E_INVALID_ARGS;
+
+    ndef_record_t chunk;
+    size_t        chunk_len;
+    ndef_status_t rslt = ndef_parse_next_rec(buf, len, &chunk, &chunk_len);
+    if(rslt != NDEF_OK)
+        return rslt;
+
+    if(crec->max_segs == 0)
+        return NDEF_E_NO_MEM;
+
+    /* An initial chunk carries the type, so it can never be TNF_UNCHANGED. */
+    if((chunk.header & NDEF_RECORD_FLAG_TNF_Msk) == TNF_UNCHANGED)
+        return NDEF_E_INVALID_FORMAT;
+
+    crec->rec              = chunk;
+    crec->segs[0].data     = chunk.payload;
+    crec->segs[0].len      = chunk.payload_len;
+    crec->seg_cnt          = 1;
+
+    size_t offset      = chunk_len;
+    size_t payload_len = chunk.payload_len;
+    uint8_t last_header = chunk.header;
+
+    while(NDEF_RECORD_GET_FLAG(last_header, NDEF_RECORD_FLAG_CF))
     {
-        /* NDEF record is a 'normal' sized record, copy the 4-byte 'Payload Length' field */
-        rec->payload_len = ntohl(buf);
-        buf += sizeof(uint32_t);
+        /* ME on a chunk other than the terminating one ends the message early. */
+        if(NDEF_RECORD_GET_FLAG(last_header, NDEF_RECORD_FLAG_ME))
+            return NDEF_E_INVALID_FORMAT;
+
+        rslt = ndef_parse_next_rec(buf + offset, len - offset, &chunk, &chunk_len);
+        if(rslt != NDEF_OK)
+            return rslt;
+
+        /* Middle and terminating chunks: TNF_UNCHANGED, no type, no ID, no MB. */
+        if(((chunk.header & NDEF_RECORD_FLAG_TNF_Msk) != TNF_UNCHANGED) ||
+           (chunk.type_len != 0) || (chunk.id_len != 0) ||
+           NDEF_RECORD_GET_FLAG(chunk.header, NDEF_RECORD_FLAG_MB))
+            return NDEF_E_INVALID_FORMAT;
+
+        if(crec->seg_cnt >= crec->max_segs)
+            return NDEF_E_NO_MEM;
+
+        crec->segs[crec->seg_cnt].data = chunk.payload;
+        crec->segs[crec->seg_cnt].len  = chunk.payload_len;
+        crec->seg_cnt++;
+
+        payload_len += chunk.payload_len;
+        offset      += chunk_len;
+        last_header  = chunk.header;
     }
 
-    if(NDEF_RECORD_GET_FLAG(rec->header, NDEF_RECORD_FLAG_IL))
-        rec->id_len = *buf++;
-    else
-        rec->id_len = 0;
+    crec->rec.header = (uint8_t)((crec->rec.header & ~(NDEF_RECORD_FLAG_CF | NDEF_RECORD_FLAG_ME | NDEF_RECORD_FLAG_SR)) |
+                                 (last_header & NDEF_RECORD_FLAG_ME));
+    if(payload_len <= UINT8_MAX)
+        crec->rec.header |= NDEF_RECORD_FLAG_SR;
 
-    rec->type = (rec->type_len == 0) ? NULL : buf;
-    buf += rec->type_len;
+    crec->rec.payload_len  = payload_len;
+    crec->rec.payload      = (crec->seg_cnt == 1) ? crec->segs[0].data : NULL;
+    crec->rec.total_length = offset;
 
-    rec->id = (rec->id_len == 0) ? NULL : buf;
-    buf += rec->id_len;
+    *br = offset;
 
-    rec->payload = (rec->payload_len == 0) ? NULL : buf;
-    buf += rec->payload_len;
+    return NDEF_OK;
+}
 
-    rec->total_length = buf - buf_start;
+/*
+ * @brief This API copies the payload of a chunked record into a contiguous buffer.
+ */
+ndef_status_t ndef_chunked_copy(const ndef_chunked_record_t *crec, uint8_t *buf, size_t len, size_t *bw)
+{
+    if((crec == NULL) || (bw == NULL) || ((buf == NULL) && (crec->rec.payload_len != 0)))
+        return NDEF_E_INVALID_ARGS;
 
-    *br = rec->total_length;
+    if(crec->rec.payload_len > len)
+        return NDEF_E_NO_MEM;
+
+    size_t pos = 0;
+
+    for(size_t i = 0; i < crec->seg_cnt; i++)
+    {
+        if(crec->segs[i].len != 0)
+            memcpy(buf + pos, crec->segs[i].data, crec->segs[i].len);
+        pos += crec->segs[i].len;
+    }
+
+    *bw = pos;
 
     return NDEF_OK;
 }
 
+/*
+ * @brief Size of a single encoded record, or 0 if the record is invalid.
+ */
+static size_t ndef_rec_size(const ndef_record_t *rec)
+{
+    if(((rec->header & NDEF_RECORD_FLAG_TNF_Msk) == TNF_RESERVED) ||
+       (rec->payload_len > UINT32_MAX) ||
+       ((rec->type_len != 0) && (rec->type == NULL)) ||
+       ((rec->id_len != 0) && (rec->id == NULL)) ||
+       ((rec->payload_len != 0) && (rec->payload == NULL)))
+        return 0;
+
+    size_t size = NDEF_HEADER_MIN_LENGTH;
+    size += (rec->payload_len <= UINT8_MAX) ? NDEF_SR_PAYLOAD_LEN_LENGTH : NDEF_PAYLOAD_LEN_LENGTH;
+    size += (rec->id_len != 0) ? 1 : 0;
+    size += rec->type_len + rec->id_len + rec->payload_len;
+
+    return size;
+}
 
-// uint8_t* NDEF_BuildRecord(uint8_t flags, uint8_t *type, uint8_t typeLength, uint8_t *id, uint8_t idLength, uint8_t *payload, uint32_t payloadLength)
-// {
-//     size_t totalLength;
-//     uint8_t shortRecord; /* bool */
-//     uint8_t header;
-//     uint8_t *pos;
-
-//     shortRecord = payloadLength < 256 ? 1 : 0;
-
-//     /* ==== Calculate total length of record */
-//     totalLength = 2; /* Flag + type length */
-//     totalLength += shortRecord ? sizeof(uint8_t) : sizeof(uint32_t); /* Payload length */
-//     if(idLength > 0)
-//         totalLength += 1;
-//     totalLength += typeLength + idLength + payloadLength;
-//     /* ===================================== */
-
-//     //NDEF_RecordType *rec = malloc(sizeof(NDEF_RecordType));
-//     uint8_t *buf = malloc(totalLength);
-//     if(buf == NULL)
-//     {
-//         Log_info("NDEF: Failed to allocate record for build");
-//         return NULL;
-//     }
-//     pos = buf; /* Set pointer to beginning of NDEF Record */
+/*
+ * @brief This API computes the encoded size of an NDEF message.
+ */
+ndef_status_t ndef_msg_size(const ndef_record_t *recs, size_t rec_cnt, size_t *size)
+{
+    if((recs == NULL) || (rec_cnt == 0) || (size == NULL))
+        return NDEF_E_INVALID_ARGS;
 
-//     /* ==== Ensure correct flags are set in record */
-//     header = flags;
+    size_t total = 0;
 
-//     if(idLength > 0)
-//         header |= NDEF_RECORD_FLAG_IL;
-//     if(shortRecord)
-//         header |= NDEF_RECORD_FLAG_SR;
-    
-//     *pos++ = header;
-//     *pos++ = typeLength;
+    for(size_t i = 0; i < rec_cnt; i++)
+    {
+        size_t rec_size = ndef_rec_size(&recs[i]);
+        if((rec_size == 0) || (rec_size > SIZE_MAX - total))
+            return NDEF_E_INVALID_ARGS;
+        total += rec_size;
+    }
 
-//     if(shortRecord)
-//     {
-//         *pos++ = (uint8_t) payloadLength;
-//     }
-//     else
-//     {
-//         memcpy(pos, (uint8_t*) &payloadLength, sizeof(payloadLength));
-//         pos += sizeof(payloadLength);
-//     }
-    
-//     if(idLength > 0)
-//         *pos++ = idLength;
+    *size = total;
 
-//     if((type != NULL) && (typeLength > 0))
-//     {
-//         memcpy(pos, type, typeLength);
-//         pos += sizeof(typeLength);
-//     }
-//     if(id != NULL && (idLength > 0))
-//     {
-//         memcpy(pos, id, idLength);
-//         pos += sizeof(idLength);
-//     }
-//     if(payload != NULL && (payloadLength > 0))
-//     {
-//         memcpy(pos, payload, payloadLength);
-//         pos += sizeof(payloadLength);
-//     }
-    
-//     return buf;
-// }
+    return NDEF_OK;
+}
+
+/*
+ * @brief Write validated records into a buffer already known to be large enough.
+ */
+static size_t ndef_msg_write(const ndef_record_t *recs, size_t rec_cnt, uint8_t *buf)
+{
+    uint8_t *pos = buf;
+
+    for(size_t i = 0; i < rec_cnt; i++)
+    {
+        const ndef_record_t *rec = &recs[i];
+        uint8_t header = rec->header & (NDEF_RECORD_FLAG_CF | NDEF_RECORD_FLAG_TNF_Msk);
+
+        if(i == 0)
+            header |= NDEF_RECORD_FLAG_MB;
+        if(i == rec_cnt - 1)
+            header |= NDEF_RECORD_FLAG_ME;
+        if(rec->payload_len <= UINT8_MAX)
+            header |= NDEF_RECORD_FLAG_SR;
+        if(rec->id_len != 0)
+            header |= NDEF_RECORD_FLAG_IL;
+
+        *pos++ = header;
+        *pos++ = rec->type_len;
+
+        if(header & NDEF_RECORD_FLAG_SR)
+        {
+            *pos++ = (uint8_t)rec->payload_len;
+        }
+        else
+        {
+            /* Payload length is transmitted in network byte order. */
+            *pos++ = (uint8_t)(rec->payload_len >> 24);
+            *pos++ = (uint8_t)(rec->payload_len >> 16);
+            *pos++ = (uint8_t)(rec->payload_len >> 8);
+            *pos++ = (uint8_t)rec->payload_len;
+        }
+
+        if(rec->id_len != 0)
+            *pos++ = rec->id_len;
+
+        if(rec->type_len != 0)
+            memcpy(pos, rec->type, rec->type_len);
+        pos += rec->type_len;
+
+        if(rec->id_len != 0)
+            memcpy(pos, rec->id, rec->id_len);
+        pos += rec->id_len;
+
+        if(rec->payload_len != 0)
+            memcpy(pos, rec->payload, rec->payload_len);
+        pos += rec->payload_len;
+    }
+
+    return (size_t)(pos - buf);
+}
+
+/*
+ * @brief This API serialises an NDEF message into a caller buffer.
+ */
+ndef_status_t ndef_msg_encode(const ndef_record_t *recs, size_t rec_cnt, uint8_t *buf, size_t len, size_t *bw)
+{
+    if((buf == NULL) || (bw == NULL))
+        return NDEF_E_INVALID_ARGS;
+
+    size_t        size;
+    ndef_status_t rslt = ndef_msg_size(recs, rec_cnt, &size);
+    if(rslt != NDEF_OK)
+        return rslt;
+
+    if(size > len)
+        return NDEF_E_NO_MEM;
+
+    *bw = ndef_msg_write(recs, rec_cnt, buf);
+
+    return NDEF_OK;
+}
+
+/*
+ * @brief This API serialises an NDEF message wrapped in a TLV_NDEF_MESSAGE block.
+ */
+ndef_status_t ndef_msg_encode_tlv(const ndef_record_t *recs, size_t rec_cnt, uint8_t *buf, size_t len, size_t *bw)
+{
+    if((buf == NULL) || (bw == NULL))
+        return NDEF_E_INVALID_ARGS;
+
+    size_t        size;
+    ndef_status_t rslt = ndef_msg_size(recs, rec_cnt, &size);
+    if(rslt != NDEF_OK)
+        return rslt;
+
+    size_t       header_len;
+    tlv_status_t tlv_rslt = tlv_encode_header(TLV_NDEF_MESSAGE, size, buf, len, &header_len);
+    if(tlv_rslt == TLV_E_NO_MEM)
+        return NDEF_E_NO_MEM;
+    if(tlv_rslt != TLV_OK)
+        return NDEF_E_INVALID_ARGS;
+
+    if(size > len - header_len)
+        return NDEF_E_NO_MEM;
+
+    *bw = header_len + ndef_msg_write(recs, rec_cnt, buf + header_len);
+
+    return NDEF_OK;
+}
 
 
 // /* Print our NDEF Record in similar styling to http://www.ndefparser.net */
@@ -68,6 +68,44 @@ extern "C" {
  */
 #define NDEF_RECORD_GET_FLAG(__BYTE__, __FLAG__)     ((((__BYTE__) & (__FLAG__)) == (__FLAG__)) ? 1 : 0)
 
+/*!
+ * @brief Decoded properties of an NDEF record header byte.
+ */
+typedef struct
+{
+    uint8_t fixed_len;  /* Header, type length, payload length and ID length fields */
+    uint8_t long_len;   /* 1 if the payload length field is 4 bytes (SR clear)     */
+    uint8_t il;         /* 1 if the ID length field is present                     */
+    uint8_t tnf_valid;  /* 0 for the reserved TNF                                  */
+} ndef_header_info_t;
+
+/*!
+ * @brief Header byte decode as a constant expression, used to build ndef_header_table.
+ *
+ * The row macros expand to initialisers for consecutive header values so the
+ * 256-entry table is produced by the compiler (and can be evaluated in C++
+ * constant expressions) rather than decoded flag by flag at run time.
+ */
+#define NDEF_HEADER_INFO(__B__)                                                     \
+    { (uint8_t)(2 + (((__B__) & NDEF_RECORD_FLAG_SR) ? 1 : 4) +                     \
+                (((__B__) & NDEF_RECORD_FLAG_IL) ? 1 : 0)),                         \
+      (uint8_t)(((__B__) & NDEF_RECORD_FLAG_SR) ? 0 : 1),                           \
+      (uint8_t)(((__B__) & NDEF_RECORD_FLAG_IL) ? 1 : 0),                           \
+      (uint8_t)((((__B__) & NDEF_RECORD_FLAG_TNF_Msk) == TNF_RESERVED) ? 0 : 1) }
+#define NDEF_HEADER_INFO_ROW4(__B__)    NDEF_HEADER_INFO(__B__),          NDEF_HEADER_INFO((__B__) + 1),      \
+                                        NDEF_HEADER_INFO((__B__) + 2),    NDEF_HEADER_INFO((__B__) + 3)
+#define NDEF_HEADER_INFO_ROW16(__B__)   NDEF_HEADER_INFO_ROW4(__B__),     NDEF_HEADER_INFO_ROW4((__B__) + 4), \
+                                        NDEF_HEADER_INFO_ROW4((__B__) + 8), NDEF_HEADER_INFO_ROW4((__B__) + 12)
+#define NDEF_HEADER_INFO_ROW64(__B__)   NDEF_HEADER_INFO_ROW16(__B__),    NDEF_HEADER_INFO_ROW16((__B__) + 16), \
+                                        NDEF_HEADER_INFO_ROW16((__B__) + 32), NDEF_HEADER_INFO_ROW16((__B__) + 48)
+#define NDEF_HEADER_INFO_TABLE          NDEF_HEADER_INFO_ROW64(0),        NDEF_HEADER_INFO_ROW64(64),         \
+                                        NDEF_HEADER_INFO_ROW64(128),      NDEF_HEADER_INFO_ROW64(192)
+
+/*!
+ * @brief Header byte decode table, indexed by the record header byte.
+ */
+extern const ndef_header_info_t ndef_header_table[256];
+
 /*!
  * @brief NDEF API status code.
  */
@@ -75,7 +113,10 @@ typedef enum
 {
     NDEF_OK,             /* API execution succes            */
     NDEF_E_NOT_FOUND,     /* Parser did not find NDEF record */
-    NDEF_E_INVALID_ARGS /* Invalid fucntion parameters     */
+    NDEF_E_INVALID_ARGS, /* Invalid fucntion parameters     */
+    NDEF_E_INCOMPLETE,   /* Record continues past buffer    */
+    NDEF_E_INVALID_FORMAT, /* MB/ME flags or lengths invalid  */
+    NDEF_E_NO_MEM        /* Caller storage too small        */
 } ndef_status_t;
 
 typedef enum
@@ -106,16 +147,218 @@ typedef struct
     size_t   total_length;
 } ndef_record_t;
 
+/*!
+ * @brief Contiguous part of a chunked payload, pointing into the message buffer.
+ */
+typedef struct
+{
+    uint8_t *data;  /* Start of the segment */
+    size_t  len;    /* Length of the segment in bytes */
+} ndef_segment_t;
+
+/*!
+ * @brief Logical NDEF record reassembled from one or more record chunks.
+ *
+ * 'rec' describes the logical record: header flags of the initial chunk with
+ * CF cleared (ME taken from the terminating chunk), its type and ID, and the
+ * total payload length. The payload is the concatenation of 'segs', which
+ * point into the original buffer; rec.payload is only set when the payload
+ * is a single segment.
+ */
+typedef struct
+{
+    ndef_record_t  rec;      /* Logical record                          */
+    ndef_segment_t *segs;    /* Caller storage for the payload segments */
+    size_t         max_segs; /* Capacity of 'segs'                      */
+    size_t         seg_cnt;  /* Number of payload segments              */
+} ndef_chunked_record_t;
+
+/*!
+ * @brief NDEF message index.
+ *
+ * Structure-of-arrays table built by a single pass over an NDEF message. Each
+ * record is described by 32-bit offsets into the message, so random access
+ * to record N needs no re-parsing. The arrays live in caller storage.
+ */
+typedef struct
+{
+    uint8_t  *msg;            /* Start of the indexed message                  */
+    uint32_t msg_len;         /* Length of the indexed message                 */
+    uint32_t *rec_offset;     /* Offset of each record header                  */
+    uint32_t *payload_offset; /* Offset of each record payload                 */
+    uint32_t *payload_len;    /* Length of each record payload                 */
+    uint32_t max_records;     /* Capacity of the offset arrays                 */
+    uint32_t rec_cnt;         /* Number of records in the message              */
+} ndef_index_t;
+
+/*!
+ * @brief Number of 32-bit words of storage needed to index the given number of records.
+ */
+#define NDEF_INDEX_STORAGE_WORDS(__MAX_RECORDS__)   (3 * (__MAX_RECORDS__))
+
 /*
  * @brief This API parses the next NDEF record found in the buffer.
  * 
- * @param[in]     buf : Pointer to byte buffer containing ndef message(s).
- * @param[out]    rec : Pointer to NDEF record(s) buffer in which to save parsed NDEF record.
- * @param[in] rec_cnt : Number of bytes read from bufer.
+ * @param[in]  buf : Pointer to byte buffer containing ndef message(s).
+ * @param[in]  len : Number of valid bytes in the buffer.
+ * @param[out] rec : Pointer to NDEF record(s) buffer in which to save parsed NDEF record.
+ * @param[out] br  : Number of bytes read from bufer.
+ *
+ * @return API status code.
+ * @retval NDEF_E_INCOMPLETE     if the buffer ends inside the record.
+ * @retval NDEF_E_INVALID_FORMAT if the record uses the reserved TNF.
+ */
+ndef_status_t ndef_parse_next_rec(uint8_t *buf, size_t len, ndef_record_t *rec, size_t *br);
+
+/*
+ * @brief This API parses the next logical NDEF record, joining chunked records.
+ *
+ * An initial chunk (CF set) is followed by TNF_UNCHANGED chunks with no type
+ * or ID, up to the terminating chunk with CF cleared. Each chunk payload
+ * becomes one segment; no payload bytes are copied. An unchunked record
+ * yields a single segment.
+ *
+ * @param[in]     buf  : Pointer to byte buffer containing ndef message(s).
+ * @param[in]     len  : Number of valid bytes in the buffer.
+ * @param[in,out] crec : Pointer to the chunked record, with 'segs' and 'max_segs' set.
+ * @param[out]    br   : Number of bytes read from bufer (all chunks).
+ *
+ * @return API status code.
+ * @retval NDEF_E_NO_MEM         if the record has more chunks than 'max_segs'.
+ * @retval NDEF_E_INVALID_FORMAT if a continuation chunk is malformed.
+ */
+ndef_status_t ndef_parse_next_chunked_rec(uint8_t *buf, size_t len, ndef_chunked_record_t *crec, size_t *br);
+
+/*
+ * @brief This API copies the payload of a chunked record into a contiguous buffer.
+ *
+ * @param[in]  crec : Pointer to a parsed chunked record.
+ * @param[out] buf  : Pointer to the output buffer.
+ * @param[in]  len  : Size of the output buffer.
+ * @param[out] bw   : Pointer to value which will store number of bytes written.
+ *
+ * @return API status code.
+ */
+ndef_status_t ndef_chunked_copy(const ndef_chunked_record_t *crec, uint8_t *buf, size_t len, size_t *bw);
+
+/*
+ * @brief This API computes the encoded size of an NDEF message.
+ *
+ * @param[in]  recs    : Records of the message (see ndef_msg_encode()).
+ * @param[in]  rec_cnt : Number of records.
+ * @param[out] size    : Pointer to value which will store the message size in bytes.
+ *
+ * @return API status code.
+ */
+ndef_status_t ndef_msg_size(const ndef_record_t *recs, size_t rec_cnt, size_t *size);
+
+/*
+ * @brief This API serialises an NDEF message into a caller buffer.
+ *
+ * For each record the caller fills in the TNF (and CF for chunks) in
+ * 'header', the type, ID and payload pointers and their lengths. MB, ME, SR
+ * and IL are derived by the encoder. No heap memory is used.
+ *
+ * @param[in]  recs    : Records of the message.
+ * @param[in]  rec_cnt : Number of records.
+ * @param[out] buf     : Pointer to the output buffer.
+ * @param[in]  len     : Size of the output buffer.
+ * @param[out] bw      : Pointer to value which will store number of bytes written.
+ *
+ * @return API status code.
+ * @retval NDEF_E_NO_MEM if the buffer is too small for the message.
+ */
+ndef_status_t ndef_msg_encode(const ndef_record_t *recs, size_t rec_cnt, uint8_t *buf, size_t len, size_t *bw);
+
+/*
+ * @brief This API serialises an NDEF message wrapped in a TLV_NDEF_MESSAGE block.
+ *
+ * The TLV uses the short length format when the message is shorter than 255
+ * bytes and the 3-byte format otherwise. The message is written in place
+ * after the TLV header.
+ *
+ * @param[in]  recs    : Records of the message (see ndef_msg_encode()).
+ * @param[in]  rec_cnt : Number of records.
+ * @param[out] buf     : Pointer to the output buffer.
+ * @param[in]  len     : Size of the output buffer.
+ * @param[out] bw      : Pointer to value which will store number of bytes written.
+ *
+ * @return API status code.
+ */
+ndef_status_t ndef_msg_encode_tlv(const ndef_record_t *recs, size_t rec_cnt, uint8_t *buf, size_t len, size_t *bw);
+
+/*
+ * @brief This API initialises an NDEF message index over caller storage.
+ *
+ * @param[out] idx         : Pointer to the index.
+ * @param[in]  storage     : Pointer to NDEF_INDEX_STORAGE_WORDS(max_records) words of storage.
+ * @param[in]  max_records : Maximum number of records the index can hold.
+ *
+ * @return API status code.
+ */
+ndef_status_t ndef_index_init(ndef_index_t *idx, uint32_t *storage, uint32_t max_records);
+
+/*
+ * @brief This API indexes every record of an NDEF message in a single pass.
+ *
+ * The message must start with a record with MB set, end exactly after the
+ * record with ME set and contain no other MB or ME flags.
+ *
+ * @param[in,out] idx : Pointer to an initialised index.
+ * @param[in]     msg : Pointer to the NDEF message.
+ * @param[in]     len : Length of the NDEF message in bytes.
+ *
+ * @return API status code.
+ * @retval NDEF_E_NO_MEM         if the message holds more records than the index can.
+ * @retval NDEF_E_INVALID_FORMAT if the MB/ME flags or the total length are invalid.
+ */
+ndef_status_t ndef_index_build(ndef_index_t *idx, uint8_t *msg, size_t len);
+
+/*
+ * @brief This API extends the index of an NDEF message that is still being received.
+ *
+ * Records lying entirely within the first 'avail' bytes are appended to the
+ * index, resuming after the last record already indexed, so a message read
+ * page by page is indexed exactly once overall. A call with a different
+ * message pointer or length starts a new index; to index a new message placed
+ * in the same buffer, call ndef_index_init() first. Once 'avail' equals 'len'
+ * the result is the same as ndef_index_build().
+ *
+ * @param[in,out] idx   : Pointer to an initialised index.
+ * @param[in]     msg   : Pointer to the NDEF message.
+ * @param[in]     len   : Final length of the NDEF message in bytes.
+ * @param[in]     avail : Number of leading message bytes received so far.
+ *
+ * @return API status code.
+ * @retval NDEF_E_INCOMPLETE     if more bytes are needed to finish the index.
+ * @retval NDEF_E_NO_MEM         if the message holds more records than the index can.
+ * @retval NDEF_E_INVALID_FORMAT if the MB/ME flags or the total length are invalid.
+ */
+ndef_status_t ndef_index_update(ndef_index_t *idx, uint8_t *msg, size_t len, size_t avail);
+
+/*
+ * @brief This API compacts the index arrays down to the records indexed.
+ *
+ * Afterwards the index uses only the first NDEF_INDEX_STORAGE_WORDS(rec_cnt)
+ * words of its storage, so the rest can be handed out again, and it can no
+ * longer be extended with ndef_index_update().
+ *
+ * @param[in,out] idx : Pointer to a built index.
+ *
+ * @return Number of storage words still in use.
+ */
+size_t ndef_index_shrink(ndef_index_t *idx);
+
+/*
+ * @brief This API fills a record structure for an indexed record.
+ *
+ * @param[in]  idx : Pointer to a built index.
+ * @param[in]  n   : Index of the record in the message.
+ * @param[out] rec : Pointer to the record structure to fill.
  *
  * @return API status code.
  */
-ndef_status_t ndef_parse_next_rec(uint8_t *buf, ndef_record_t *rec, size_t *br);
+ndef_status_t ndef_index_get(const ndef_index_t *idx, uint32_t n, ndef_record_t *rec);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,673 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_ndef.hpp
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_ndef.hpp
+ * @brief Header-only C++17 layer over the NDEF and TLV parsers.
+ */
+
+/*!
+ * @defgroup NDEF_CPP API
+ */
+#ifndef _NFC_NDEF_HPP_
+#define _NFC_NDEF_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+
+#if defined(__cpp_lib_span)
+#include <span>
+#endif
+
+#include "nfc_ndef.h"
+#include "nfc_tlv_block.h"
+
+/*
+ * Messages for static content are built as constant expressions:
+ *
+ *   constexpr auto tlv = nfc::tlv_message(nfc::uri_record(0x04, "example.com"));
+ *
+ * produces a std::array holding the TLV_NDEF_MESSAGE block, ready to be
+ * written to the data area. Parsing works on spans of existing buffers; the
+ * decoders follow ndef_parse_next_rec() and t2t_parse_next_tlv() but are
+ * constexpr, so they also run in constant expressions. Nothing allocates.
+ */
+namespace nfc
+{
+
+#if defined(__cpp_lib_span)
+template <class T>
+using span = std::span<T>;
+#else
+/*!
+ * @brief Minimal stand-in for std::span before C++20.
+ */
+template <class T>
+class span
+{
+public:
+    using element_type = T;
+    using iterator     = T *;
+
+    constexpr span() noexcept : ptr_(nullptr), len_(0) {}
+    constexpr span(T *ptr, std::size_t len) noexcept : ptr_(ptr), len_(len) {}
+    template <std::size_t N>
+    constexpr span(T (&arr)[N]) noexcept : ptr_(arr), len_(N) {}
+    template <class U, std::size_t N>
+    constexpr span(std::array<U, N> &arr) noexcept : ptr_(arr.data()), len_(N) {}
+    template <class U, std::size_t N>
+    constexpr span(const std::array<U, N> &arr) noexcept : ptr_(arr.data()), len_(N) {}
+
+    constexpr T           *data() const noexcept { return ptr_; }
+    constexpr std::size_t size() const noexcept { return len_; }
+    constexpr bool        empty() const noexcept { return len_ == 0; }
+    constexpr T           &operator[](std::size_t i) const noexcept { return ptr_[i]; }
+    constexpr iterator    begin() const noexcept { return ptr_; }
+    constexpr iterator    end() const noexcept { return ptr_ + len_; }
+
+    constexpr span first(std::size_t n) const noexcept { return span(ptr_, n); }
+    constexpr span subspan(std::size_t off) const noexcept { return span(ptr_ + off, len_ - off); }
+    constexpr span subspan(std::size_t off, std::size_t n) const noexcept { return span(ptr_ + off, n); }
+
+private:
+    T           *ptr_;
+    std::size_t len_;
+};
+#endif
+
+using bytes_view = span<const std::uint8_t>;
+
+/*!
+ * @brief Header byte decode table usable in constant expressions.
+ */
+inline constexpr ndef_header_info_t header_table[256] = { NDEF_HEADER_INFO_TABLE };
+
+/* ------------------------------------------------------------------------ */
+/* Builder                                                                  */
+/* ------------------------------------------------------------------------ */
+
+/*!
+ * @brief NDEF record with compile-time field sizes.
+ */
+template <std::size_t TypeLen, std::size_t IdLen, std::size_t PayloadLen>
+struct record
+{
+    static_assert(TypeLen <= UINT8_MAX, "type field longer than 255 bytes");
+    static_assert(IdLen <= UINT8_MAX, "ID field longer than 255 bytes");
+
+    static constexpr std::size_t encoded_size =
+        2 + ((PayloadLen <= UINT8_MAX) ? 1 : 4) + ((IdLen != 0) ? 1 : 0) + TypeLen + IdLen + PayloadLen;
+
+    std::uint8_t                          tnf;
+    std::array<std::uint8_t, TypeLen>     type;
+    std::array<std::uint8_t, IdLen>       id;
+    std::array<std::uint8_t, PayloadLen>  payload;
+};
+
+/*!
+ * @brief Bytes of a string literal, without the terminating NUL.
+ */
+template <std::size_t N>
+constexpr std::array<std::uint8_t, N - 1> bytes(const char (&str)[N])
+{
+    std::array<std::uint8_t, N - 1> out{};
+    for(std::size_t i = 0; i < N - 1; i++)
+        out[i] = static_cast<std::uint8_t>(str[i]);
+    return out;
+}
+
+/*!
+ * @brief Record with the given TNF, type and payload.
+ */
+template <std::size_t T, std::size_t P>
+constexpr record<T - 1, 0, P> make_record(std::uint8_t tnf, const char (&type)[T],
+                                          const std::array<std::uint8_t, P> &payload)
+{
+    return { tnf, bytes(type), {}, payload };
+}
+
+/*!
+ * @brief Record with the given TNF, type, ID and payload.
+ */
+template <std::size_t T, std::size_t I, std::size_t P>
+constexpr record<T - 1, I - 1, P> make_record(std::uint8_t tnf, const char (&type)[T], const char (&id)[I],
+                                              const std::array<std::uint8_t, P> &payload)
+{
+    return { tnf, bytes(type), bytes(id), payload };
+}
+
+/*!
+ * @brief Well-known URI record ("U") with an abbreviation code and the rest of the URI.
+ */
+template <std::size_t N>
+constexpr record<1, 0, N> uri_record(std::uint8_t prefix_code, const char (&rest)[N])
+{
+    record<1, 0, N> rec{ TNF_WELL_KNOWN, { 'U' }, {}, {} };
+    rec.payload[0] = prefix_code;
+    for(std::size_t i = 0; i < N - 1; i++)
+        rec.payload[i + 1] = static_cast<std::uint8_t>(rest[i]);
+    return rec;
+}
+
+/*!
+ * @brief Well-known Text record ("T") with UTF-8 text.
+ */
+template <std::size_t L, std::size_t N>
+constexpr record<1, 0, L + N - 1> text_record(const char (&lang)[L], const char (&text)[N])
+{
+    static_assert(L - 1 <= 0x3F, "language code longer than 63 bytes");
+
+    record<1, 0, L + N - 1> rec{ TNF_WELL_KNOWN, { 'T' }, {}, {} };
+    rec.payload[0] = static_cast<std::uint8_t>(L - 1);
+    for(std::size_t i = 0; i < L - 1; i++)
+        rec.payload[1 + i] = static_cast<std::uint8_t>(lang[i]);
+    for(std::size_t i = 0; i < N - 1; i++)
+        rec.payload[L + i] = static_cast<std::uint8_t>(text[i]);
+    return rec;
+}
+
+/*!
+ * @brief Media-type record (RFC 2046 type such as "application/json").
+ */
+template <std::size_t T, std::size_t P>
+constexpr record<T - 1, 0, P> mime_record(const char (&type)[T], const std::array<std::uint8_t, P> &payload)
+{
+    return make_record(TNF_MEDIA_TYPE, type, payload);
+}
+
+/*!
+ * @brief External type record ("domain:type").
+ */
+template <std::size_t T, std::size_t P>
+constexpr record<T - 1, 0, P> external_record(const char (&type)[T], const std::array<std::uint8_t, P> &payload)
+{
+    return make_record(TNF_EXTERNAL_TYPE, type, payload);
+}
+
+namespace detail
+{
+
+template <std::size_t N, std::size_t T, std::size_t I, std::size_t P>
+constexpr void put_record(std::array<std::uint8_t, N> &out, std::size_t &pos, const record<T, I, P> &rec,
+                          std::size_t n, std::size_t cnt)
+{
+    std::uint8_t header = rec.tnf & NDEF_RECORD_FLAG_TNF_Msk;
+
+    if(n == 0)
+        header |= NDEF_RECORD_FLAG_MB;
+    if(n == cnt - 1)
+        header |= NDEF_RECORD_FLAG_ME;
+    if(P <= UINT8_MAX)
+        header |= NDEF_RECORD_FLAG_SR;
+    if(I != 0)
+        header |= NDEF_RECORD_FLAG_IL;
+
+    out[pos++] = header;
+    out[pos++] = static_cast<std::uint8_t>(T);
+
+    if(P <= UINT8_MAX)
+    {
+        out[pos++] = static_cast<std::uint8_t>(P);
+    }
+    else
+    {
+        /* Payload length is transmitted in network byte order. */
+        out[pos++] = static_cast<std::uint8_t>(P >> 24);
+        out[pos++] = static_cast<std::uint8_t>(P >> 16);
+        out[pos++] = static_cast<std::uint8_t>(P >> 8);
+        out[pos++] = static_cast<std::uint8_t>(P);
+    }
+
+    if(I != 0)
+        out[pos++] = static_cast<std::uint8_t>(I);
+
+    for(std::size_t i = 0; i < T; i++)
+        out[pos++] = rec.type[i];
+    for(std::size_t i = 0; i < I; i++)
+        out[pos++] = rec.id[i];
+    for(std::size_t i = 0; i < P; i++)
+        out[pos++] = rec.payload[i];
+}
+
+} // namespace detail
+
+/*!
+ * @brief NDEF message made of the given records, with MB, ME, SR and IL set as in ndef_msg_encode().
+ */
+template <class... Records>
+constexpr auto message(const Records &...recs)
+{
+    static_assert(sizeof...(Records) > 0, "a message holds at least one record");
+
+    std::array<std::uint8_t, (Records::encoded_size + ...)> out{};
+    std::size_t pos = 0;
+    std::size_t n   = 0;
+
+    (detail::put_record(out, pos, recs, n++, sizeof...(Records)), ...);
+
+    return out;
+}
+
+/*!
+ * @brief TLV_NDEF_MESSAGE block holding the message, as in ndef_msg_encode_tlv().
+ */
+template <class... Records>
+constexpr auto tlv_message(const Records &...recs)
+{
+    constexpr std::size_t msg_len    = (Records::encoded_size + ...);
+    constexpr std::size_t header_len = TLV_T_LENGTH + ((msg_len < TLV_L_FORMAT_FLAG) ? TLV_L_SHORT_LENGTH
+                                                                                   : TLV_L_LONG_LENGTH);
+    static_assert(msg_len < 0xFFFF, "message does not fit a TLV block");
+
+    const auto msg = message(recs...);
+    std::array<std::uint8_t, header_len + msg_len> out{};
+
+    out[0] = TLV_NDEF_MESSAGE;
+    if(msg_len < TLV_L_FORMAT_FLAG)
+    {
+        out[1] = static_cast<std::uint8_t>(msg_len);
+    }
+    else
+    {
+        out[1] = TLV_L_FORMAT_FLAG;
+        out[2] = static_cast<std::uint8_t>(msg_len >> 8);
+        out[3] = static_cast<std::uint8_t>(msg_len);
+    }
+
+    for(std::size_t i = 0; i < msg_len; i++)
+        out[header_len + i] = msg[i];
+
+    return out;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Parsing                                                                  */
+/* ------------------------------------------------------------------------ */
+
+/*!
+ * @brief NDEF record decoded in place.
+ */
+struct record_view
+{
+    std::uint8_t header       = 0;
+    bytes_view   type;
+    bytes_view   id;
+    bytes_view   payload;
+    std::size_t  total_length = 0;
+
+    constexpr std::uint8_t tnf() const noexcept { return header & NDEF_RECORD_FLAG_TNF_Msk; }
+    constexpr bool         mb() const noexcept { return (header & NDEF_RECORD_FLAG_MB) != 0; }
+    constexpr bool         me() const noexcept { return (header & NDEF_RECORD_FLAG_ME) != 0; }
+    constexpr bool         cf() const noexcept { return (header & NDEF_RECORD_FLAG_CF) != 0; }
+
+    /*!
+     * @brief The record as the C structure. The C API never writes through its pointers.
+     */
+    ndef_record_t to_c() const noexcept
+    {
+        ndef_record_t rec{};
+        rec.header       = header;
+        rec.type_len     = static_cast<std::uint8_t>(type.size());
+        rec.payload_len  = payload.size();
+        rec.id_len       = static_cast<std::uint8_t>(id.size());
+        rec.type         = type.empty() ? nullptr : const_cast<std::uint8_t *>(type.data());
+        rec.id           = id.empty() ? nullptr : const_cast<std::uint8_t *>(id.data());
+        rec.payload      = payload.empty() ? nullptr : const_cast<std::uint8_t *>(payload.data());
+        rec.total_length = total_length;
+        return rec;
+    }
+};
+
+/*!
+ * @brief TLV block decoded in place.
+ */
+struct tlv_view
+{
+    std::uint8_t type = 0;
+    bytes_view   value;
+
+    /*!
+     * @brief The block as the C structure. The C API never writes through its pointers.
+     */
+    tlv_t to_c() const noexcept
+    {
+        tlv_t tlv{};
+        tlv.type   = type;
+        tlv.length = value.size();
+        tlv.value  = value.empty() ? nullptr : const_cast<std::uint8_t *>(value.data());
+        return tlv;
+    }
+};
+
+/*!
+ * @brief Decode the NDEF record at the start of the buffer, as ndef_parse_next_rec().
+ */
+constexpr ndef_status_t parse_record(bytes_view buf, record_view &rec, std::size_t &br) noexcept
+{
+    if(buf.size() < 2)
+        return NDEF_E_INCOMPLETE;
+
+    const ndef_header_info_t &info = header_table[buf[0]];
+
+    if(buf.size() < info.fixed_len)
+        return NDEF_E_INCOMPLETE;
+    if(!info.tnf_valid)
+        return NDEF_E_INVALID_FORMAT;
+
+    std::size_t payload_len = buf[2];
+    if(info.long_len)
+        payload_len = (static_cast<std::size_t>(buf[2]) << 24) | (static_cast<std::size_t>(buf[3]) << 16) |
+                      (static_cast<std::size_t>(buf[4]) << 8) | buf[5];
+
+    std::size_t type_len = buf[1];
+    std::size_t id_len   = info.il ? buf[info.fixed_len - 1] : 0;
+    std::size_t total    = info.fixed_len + type_len + id_len + payload_len;
+
+    if((payload_len > buf.size()) || (total > buf.size()))
+        return NDEF_E_INCOMPLETE;
+
+    rec.header       = buf[0];
+    rec.type         = buf.subspan(info.fixed_len, type_len);
+    rec.id           = buf.subspan(info.fixed_len + type_len, id_len);
+    rec.payload      = buf.subspan(info.fixed_len + type_len + id_len, payload_len);
+    rec.total_length = total;
+    br               = total;
+
+    return NDEF_OK;
+}
+
+/*!
+ * @brief Decode the TLV block at the start of the buffer, as t2t_parse_next_tlv().
+ */
+constexpr tlv_status_t parse_tlv(bytes_view buf, tlv_view &tlv, std::size_t &br) noexcept
+{
+    if(buf.size() < TLV_T_LENGTH)
+        return TLV_E_INCOMPLETE;
+
+    std::uint8_t type = buf[0];
+
+    if((type == TLV_NULL) || (type == TLV_TERMINATOR))
+    {
+        tlv.type  = type;
+        tlv.value = bytes_view();
+        br        = TLV_T_LENGTH;
+        return TLV_OK;
+    }
+
+    if((type != TLV_LOCK_CONTROL) && (type != TLV_MEMORY_CONTROL) &&
+       (type != TLV_NDEF_MESSAGE) && (type != TLV_PROPRIETARY))
+    {
+        br = 1;
+        return TLV_E_NOT_FOUND;
+    }
+
+    if(buf.size() < TLV_T_LENGTH + TLV_L_SHORT_LENGTH)
+        return TLV_E_INCOMPLETE;
+
+    std::size_t header_len = TLV_T_LENGTH + TLV_L_SHORT_LENGTH;
+    std::size_t length     = buf[1];
+
+    if((type == TLV_LOCK_CONTROL) || (type == TLV_MEMORY_CONTROL))
+    {
+        /* Length field should equal 3 for LOCK CONTROL and MEMORY CONTROL blocks. */
+        if(length != TLV_LOCK_MEMORY_CTRL_LEN)
+        {
+            br = 1;
+            return TLV_E_NOT_FOUND;
+        }
+    }
+    else if(length == TLV_L_FORMAT_FLAG)
+    {
+        if(buf.size() < TLV_T_LENGTH + TLV_L_LONG_LENGTH)
+            return TLV_E_INCOMPLETE;
+
+        header_len = TLV_T_LENGTH + TLV_L_LONG_LENGTH;
+        length     = (static_cast<std::size_t>(buf[2]) << 8) | buf[3];
+    }
+
+    /* Value field must lie entirely within the buffer. */
+    if(length > buf.size() - header_len)
+        return TLV_E_INCOMPLETE;
+
+    tlv.type  = type;
+    tlv.value = buf.subspan(header_len, length);
+    br        = header_len + length;
+
+    return TLV_OK;
+}
+
+/*!
+ * @brief Sentinel ending the record and TLV ranges.
+ */
+struct end_sentinel {};
+
+/*!
+ * @brief Records of an NDEF message. Iteration stops at the end of the
+ * message or at the first record that cannot be decoded.
+ */
+class record_range
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = record_view;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const record_view *;
+        using reference         = const record_view &;
+
+        constexpr iterator() noexcept = default;
+        constexpr explicit iterator(bytes_view rest) noexcept : rest_(rest) { decode(); }
+
+        constexpr reference operator*() const noexcept { return rec_; }
+        constexpr pointer   operator->() const noexcept { return &rec_; }
+
+        constexpr iterator &operator++() noexcept
+        {
+            rest_ = rest_.subspan(rec_.total_length);
+            decode();
+            return *this;
+        }
+
+        constexpr iterator operator++(int) noexcept
+        {
+            iterator prev = *this;
+            ++*this;
+            return prev;
+        }
+
+        constexpr bool operator==(const iterator &o) const noexcept
+        {
+            return (valid_ == o.valid_) && (!valid_ || (rest_.data() == o.rest_.data()));
+        }
+        constexpr bool operator!=(const iterator &o) const noexcept { return !(*this == o); }
+        constexpr bool operator==(end_sentinel) const noexcept { return !valid_; }
+        constexpr bool operator!=(end_sentinel) const noexcept { return valid_; }
+
+    private:
+        constexpr void decode() noexcept
+        {
+            std::size_t br = 0;
+            valid_ = !rest_.empty() && (parse_record(rest_, rec_, br) == NDEF_OK);
+        }
+
+        bytes_view  rest_;
+        record_view rec_;
+        bool        valid_ = false;
+    };
+
+    constexpr explicit record_range(bytes_view msg) noexcept : msg_(msg) {}
+
+    constexpr iterator     begin() const noexcept { return iterator(msg_); }
+    constexpr end_sentinel end() const noexcept { return {}; }
+
+    /*!
+     * @brief Validate the whole message with the rules of ndef_index_build().
+     */
+    constexpr ndef_status_t status() const noexcept
+    {
+        std::size_t offset = 0;
+        std::size_t cnt    = 0;
+
+        while(offset < msg_.size())
+        {
+            record_view   rec;
+            std::size_t   br   = 0;
+            ndef_status_t rslt = parse_record(msg_.subspan(offset), rec, br);
+
+            if(rslt == NDEF_E_INCOMPLETE)
+                return NDEF_E_INVALID_FORMAT;
+            if(rslt != NDEF_OK)
+                return rslt;
+            if(rec.mb() != (cnt == 0))
+                return NDEF_E_INVALID_FORMAT;
+
+            cnt++;
+            offset += br;
+
+            if(rec.me())
+                return (offset == msg_.size()) ? NDEF_OK : NDEF_E_INVALID_FORMAT;
+        }
+
+        return (cnt == 0) ? NDEF_E_NOT_FOUND : NDEF_E_INVALID_FORMAT;
+    }
+
+private:
+    bytes_view msg_;
+};
+
+/*!
+ * @brief TLV blocks of a data area, as collected by type_2_tag_parse(): NULL
+ * blocks and unknown bytes are skipped, iteration stops at the TERMINATOR
+ * block, the end of the buffer or a block running past it.
+ */
+class tlv_range
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = tlv_view;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const tlv_view *;
+        using reference         = const tlv_view &;
+
+        constexpr iterator() noexcept = default;
+        constexpr explicit iterator(bytes_view rest) noexcept : rest_(rest) { decode(); }
+
+        constexpr reference operator*() const noexcept { return tlv_; }
+        constexpr pointer   operator->() const noexcept { return &tlv_; }
+
+        constexpr iterator &operator++() noexcept
+        {
+            rest_ = rest_.subspan(br_);
+            decode();
+            return *this;
+        }
+
+        constexpr iterator operator++(int) noexcept
+        {
+            iterator prev = *this;
+            ++*this;
+            return prev;
+        }
+
+        constexpr bool operator==(const iterator &o) const noexcept
+        {
+            return (valid_ == o.valid_) && (!valid_ || (rest_.data() == o.rest_.data()));
+        }
+        constexpr bool operator!=(const iterator &o) const noexcept { return !(*this == o); }
+        constexpr bool operator==(end_sentinel) const noexcept { return !valid_; }
+        constexpr bool operator!=(end_sentinel) const noexcept { return valid_; }
+
+    private:
+        constexpr void decode() noexcept
+        {
+            valid_ = false;
+
+            while(!rest_.empty())
+            {
+                tlv_status_t rslt = parse_tlv(rest_, tlv_, br_);
+
+                if(rslt == TLV_E_NOT_FOUND)
+                {
+                    rest_ = rest_.subspan(br_);
+                    continue;
+                }
+                if((rslt != TLV_OK) || (tlv_.type == TLV_TERMINATOR))
+                    return;
+                if(tlv_.type == TLV_NULL)
+                {
+                    rest_ = rest_.subspan(br_);
+                    continue;
+                }
+
+                valid_ = true;
+                return;
+            }
+        }
+
+        bytes_view  rest_;
+        tlv_view    tlv_;
+        std::size_t br_    = 0;
+        bool        valid_ = false;
+    };
+
+    constexpr explicit tlv_range(bytes_view data_area) noexcept : data_(data_area) {}
+
+    constexpr iterator     begin() const noexcept { return iterator(data_); }
+    constexpr end_sentinel end() const noexcept { return {}; }
+
+private:
+    bytes_view data_;
+};
+
+/*!
+ * @brief Records of an NDEF message.
+ */
+constexpr record_range records(bytes_view msg) noexcept { return record_range(msg); }
+
+/*!
+ * @brief TLV blocks of a data area.
+ */
+constexpr tlv_range tlvs(bytes_view data_area) noexcept { return tlv_range(data_area); }
+
+} // namespace nfc
+
+#endif /* _NFC_NDEF_HPP_ */
+/** @}*/
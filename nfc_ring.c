@@ -0,0 +1,328 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_ring.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_ring.c
+ * @brief Lock-free ring of pre-allocated tag image slots.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "nfc_ring.h"
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define NFC_RING_CACHE_LINE     64
+#define NFC_RING_MAX_SLOTS      (1u << 24)
+
+/*
+ * @brief Queue cell: a slot number and the sequence number guarding it.
+ */
+typedef struct
+{
+    atomic_size_t seq;  /* Position the cell is ready for */
+    uint32_t      slot; /* Slot number held by the cell    */
+} nfc_ring_cell_t;
+
+/*
+ * @brief Bounded MPMC queue of slot numbers.
+ *
+ * The enqueue and dequeue positions live on their own cache lines so that
+ * producers and consumers do not invalidate each other's line on every
+ * operation. A cell can be written at position p once its sequence number
+ * equals p, and read once it equals p + 1, so a single CAS on the position
+ * claims a cell.
+ */
+typedef struct
+{
+    _Alignas(NFC_RING_CACHE_LINE) atomic_size_t tail;   /* Next enqueue position */
+    _Alignas(NFC_RING_CACHE_LINE) atomic_size_t head;   /* Next dequeue position */
+    _Alignas(NFC_RING_CACHE_LINE) nfc_ring_cell_t *cells;
+    size_t mask;
+} nfc_ring_queue_t;
+
+struct nfc_ring
+{
+    nfc_ring_queue_t free_q;    /* Slots producers may fill      */
+    nfc_ring_queue_t full_q;    /* Slots published to consumers  */
+    uint8_t          *data;     /* slot_cnt * slot_stride bytes  */
+    size_t           *lens;     /* Image length of each slot     */
+    size_t           slot_size;
+    size_t           slot_stride;
+    uint32_t         slot_cnt;
+};
+
+static void nfc_ring_queue_init(nfc_ring_queue_t *q, nfc_ring_cell_t *cells, uint32_t cnt)
+{
+    q->cells = cells;
+    q->mask  = cnt - 1;
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->head, 0);
+
+    for(uint32_t i = 0; i < cnt; i++)
+        atomic_init(&cells[i].seq, i);
+}
+
+/*
+ * @brief Enqueue a slot number.
+ *
+ * A queue holds every slot, so it is never full. A cell whose sequence number
+ * lags the position is still being read by a consumer of the previous lap,
+ * which has already claimed it; the push waits for that read to finish.
+ */
+static void nfc_ring_push(nfc_ring_queue_t *q, uint32_t slot)
+{
+    size_t          pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    nfc_ring_cell_t *cell;
+
+    for(;;)
+    {
+        cell = &q->cells[pos & q->mask];
+
+        size_t    seq  = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t)(seq - pos);
+
+        if(diff == 0)
+        {
+            if(atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                     memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else
+        {
+            if(diff < 0)
+                sched_yield();
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+
+    cell->slot = slot;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+}
+
+/*
+ * @brief Dequeue a slot number; fails if the queue is empty.
+ */
+static int nfc_ring_pop(nfc_ring_queue_t *q, uint32_t *p_slot)
+{
+    size_t          pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    nfc_ring_cell_t *cell;
+
+    for(;;)
+    {
+        cell = &q->cells[pos & q->mask];
+
+        size_t    seq  = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t)(seq - (pos + 1));
+
+        if(diff == 0)
+        {
+            if(atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                     memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if(diff < 0)
+        {
+            return -1;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+
+    *p_slot = cell->slot;
+    atomic_store_explicit(&cell->seq, pos + q->mask + 1, memory_order_release);
+    return 0;
+}
+
+/*
+ * @brief This API allocates a ring and its image slots.
+ */
+nfc_ring_status_t nfc_ring_create(nfc_ring_t **p_ring, uint32_t slot_cnt, size_t slot_size)
+{
+    if((p_ring == NULL) || (slot_cnt == 0) || (slot_cnt > NFC_RING_MAX_SLOTS) ||
+       ((slot_cnt & (slot_cnt - 1)) != 0) || (slot_size == 0))
+        return NFC_RING_E_INVALID_ARGS;
+
+    /* Slots start on a cache line so neighbouring images are not falsely shared. */
+    size_t stride = (slot_size + NFC_RING_CACHE_LINE - 1) & ~(size_t)(NFC_RING_CACHE_LINE - 1);
+    if(stride / NFC_RING_CACHE_LINE > SIZE_MAX / NFC_RING_CACHE_LINE / slot_cnt)
+        return NFC_RING_E_INVALID_ARGS;
+
+    nfc_ring_t      *ring  = aligned_alloc(NFC_RING_CACHE_LINE, sizeof(nfc_ring_t));
+    nfc_ring_cell_t *cells = malloc(2 * (size_t)slot_cnt * sizeof(nfc_ring_cell_t));
+    size_t          *lens  = malloc(slot_cnt * sizeof(size_t));
+    uint8_t         *data  = aligned_alloc(NFC_RING_CACHE_LINE, slot_cnt * stride);
+
+    if((ring == NULL) || (cells == NULL) || (lens == NULL) || (data == NULL))
+    {
+        free(ring);
+        free(cells);
+        free(lens);
+        free(data);
+        return NFC_RING_E_NO_MEM;
+    }
+
+    ring->data        = data;
+    ring->lens        = lens;
+    ring->slot_size   = slot_size;
+    ring->slot_stride = stride;
+    ring->slot_cnt    = slot_cnt;
+
+    /* Each queue can hold every slot. */
+    nfc_ring_queue_init(&ring->free_q, cells, slot_cnt);
+    nfc_ring_queue_init(&ring->full_q, cells + slot_cnt, slot_cnt);
+
+    for(uint32_t i = 0; i < slot_cnt; i++)
+    {
+        lens[i] = 0;
+        nfc_ring_push(&ring->free_q, i);
+    }
+
+    *p_ring = ring;
+    return NFC_RING_OK;
+}
+
+/*
+ * @brief This API frees a ring and its image slots.
+ */
+void nfc_ring_destroy(nfc_ring_t *ring)
+{
+    if(ring == NULL)
+        return;
+
+    free(ring->free_q.cells);
+    free(ring->lens);
+    free(ring->data);
+    free(ring);
+}
+
+/*
+ * @brief This API takes a free slot for a producer to fill.
+ */
+nfc_ring_status_t nfc_ring_acquire(nfc_ring_t *ring, uint32_t *p_slot, nfc_image_t *image)
+{
+    uint32_t slot;
+
+    if((ring == NULL) || (p_slot == NULL) || (image == NULL))
+        return NFC_RING_E_INVALID_ARGS;
+
+    if(nfc_ring_pop(&ring->free_q, &slot) != 0)
+        return NFC_RING_E_EMPTY;
+
+    *p_slot     = slot;
+    image->data = ring->data + (size_t)slot * ring->slot_stride;
+    image->len  = ring->slot_size;
+
+    return NFC_RING_OK;
+}
+
+/*
+ * @brief This API publishes a filled slot to the consumers.
+ */
+nfc_ring_status_t nfc_ring_publish(nfc_ring_t *ring, uint32_t slot, size_t len)
+{
+    if((ring == NULL) || (slot >= ring->slot_cnt) || (len > ring->slot_size))
+        return NFC_RING_E_INVALID_ARGS;
+
+    /* The release store of the push orders the image and length before it. */
+    ring->lens[slot] = len;
+    nfc_ring_push(&ring->full_q, slot);
+
+    return NFC_RING_OK;
+}
+
+/*
+ * @brief This API takes the oldest published image.
+ */
+nfc_ring_status_t nfc_ring_consume(nfc_ring_t *ring, uint32_t *p_slot, nfc_image_t *image)
+{
+    uint32_t slot;
+
+    if((ring == NULL) || (p_slot == NULL) || (image == NULL))
+        return NFC_RING_E_INVALID_ARGS;
+
+    if(nfc_ring_pop(&ring->full_q, &slot) != 0)
+        return NFC_RING_E_EMPTY;
+
+    *p_slot     = slot;
+    image->data = ring->data + (size_t)slot * ring->slot_stride;
+    image->len  = ring->lens[slot];
+
+    return NFC_RING_OK;
+}
+
+/*
+ * @brief This API takes up to max_cnt published images for nfc_batch_parse.
+ */
+nfc_ring_status_t nfc_ring_consume_batch(nfc_ring_t *ring, uint32_t *slots, nfc_image_t *images,
+                                         size_t max_cnt, size_t *p_cnt)
+{
+    size_t cnt = 0;
+
+    if((ring == NULL) || (slots == NULL) || (images == NULL) || (p_cnt == NULL))
+        return NFC_RING_E_INVALID_ARGS;
+
+    while((cnt < max_cnt) && (nfc_ring_consume(ring, &slots[cnt], &images[cnt]) == NFC_RING_OK))
+        cnt++;
+
+    *p_cnt = cnt;
+    return (cnt == 0) ? NFC_RING_E_EMPTY : NFC_RING_OK;
+}
+
+/*
+ * @brief This API returns a consumed slot to the producers.
+ */
+nfc_ring_status_t nfc_ring_release(nfc_ring_t *ring, uint32_t slot)
+{
+    if((ring == NULL) || (slot >= ring->slot_cnt))
+        return NFC_RING_E_INVALID_ARGS;
+
+    nfc_ring_push(&ring->free_q, slot);
+    return NFC_RING_OK;
+}
+
+/*
+ * @brief This API returns a batch of consumed slots to the producers.
+ */
+nfc_ring_status_t nfc_ring_release_batch(nfc_ring_t *ring, const uint32_t *slots, size_t cnt)
+{
+    if((ring == NULL) || ((slots == NULL) && (cnt != 0)))
+        return NFC_RING_E_INVALID_ARGS;
+
+    for(size_t i = 0; i < cnt; i++)
+    {
+        nfc_ring_status_t status = nfc_ring_release(ring, slots[i]);
+        if(status != NFC_RING_OK)
+            return status;
+    }
+
+    return NFC_RING_OK;
+}
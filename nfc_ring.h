@@ -0,0 +1,176 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_ring.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_ring.h
+ * @brief Lock-free ring of pre-allocated tag image slots.
+ */
+
+/*!
+ * @defgroup RING API
+ */
+#ifndef _NFC_RING_H_
+#define _NFC_RING_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "nfc_batch.h"
+#include "type_2_tag.h"
+
+/*! Slot size for images of a Type 2 Tag with the given data area size. */
+#define NFC_RING_SLOT_SIZE(__DATA_AREA_SIZE__)  T2T_RAW_DATA_SIZE(__DATA_AREA_SIZE__)
+
+/*!
+ * @brief Ring API status codes.
+ */
+typedef enum
+{
+    NFC_RING_OK,                /* Success                                  */
+    NFC_RING_E_INVALID_ARGS,    /* Invalid function arguments               */
+    NFC_RING_E_NO_MEM,          /* Ring could not be allocated              */
+    NFC_RING_E_EMPTY            /* No free slot, or no published image      */
+} nfc_ring_status_t;
+
+/*!
+ * @brief Ring of tag image slots (opaque).
+ *
+ * The ring owns slot_cnt image buffers of slot_size bytes and moves slot
+ * numbers between two bounded lock-free MPMC queues: one of free slots and
+ * one of published images. Producers (reader threads) take a free slot, read
+ * the tag straight into it and publish it; consumers (parser workers) take a
+ * published slot, parse the image in place and release the slot. No image is
+ * copied and no lock is taken, so any number of producers and consumers can
+ * share a ring.
+ */
+typedef struct nfc_ring nfc_ring_t;
+
+/*
+ * @brief This API allocates a ring and its image slots.
+ *
+ * @param[out] p_ring    : Receives the ring.
+ * @param[in]  slot_cnt  : Number of image slots, a power of two.
+ * @param[in]  slot_size : Size of each slot, e.g. NFC_RING_SLOT_SIZE(data area size).
+ *
+ * @return API status code.
+ */
+nfc_ring_status_t nfc_ring_create(nfc_ring_t **p_ring, uint32_t slot_cnt, size_t slot_size);
+
+/*
+ * @brief This API frees a ring and its image slots.
+ *
+ * No producer or consumer may use the ring any more.
+ *
+ * @param[in] ring : Ring, or NULL.
+ */
+void nfc_ring_destroy(nfc_ring_t *ring);
+
+/*
+ * @brief This API takes a free slot for a producer to fill.
+ *
+ * @param[in]  ring   : Ring.
+ * @param[out] p_slot : Receives the slot number.
+ * @param[out] image  : Receives the slot buffer and its size.
+ *
+ * @return API status code, NFC_RING_E_EMPTY if every slot is in use.
+ */
+nfc_ring_status_t nfc_ring_acquire(nfc_ring_t *ring, uint32_t *p_slot, nfc_image_t *image);
+
+/*
+ * @brief This API publishes a filled slot to the consumers.
+ *
+ * @param[in] ring : Ring.
+ * @param[in] slot : Slot taken with nfc_ring_acquire.
+ * @param[in] len  : Length of the image written to the slot.
+ *
+ * @return API status code.
+ */
+nfc_ring_status_t nfc_ring_publish(nfc_ring_t *ring, uint32_t slot, size_t len);
+
+/*
+ * @brief This API takes the oldest published image.
+ *
+ * The image stays valid, and may be parsed in place, until the slot is released.
+ *
+ * @param[in]  ring   : Ring.
+ * @param[out] p_slot : Receives the slot number.
+ * @param[out] image  : Receives the image span.
+ *
+ * @return API status code, NFC_RING_E_EMPTY if no image is published.
+ */
+nfc_ring_status_t nfc_ring_consume(nfc_ring_t *ring, uint32_t *p_slot, nfc_image_t *image);
+
+/*
+ * @brief This API takes up to max_cnt published images for nfc_batch_parse.
+ *
+ * The images array can be passed as is to nfc_batch_parse or
+ * nfc_batch_parse_parallel; the slots are released with nfc_ring_release_batch
+ * once the results are no longer needed.
+ *
+ * @param[in]  ring    : Ring.
+ * @param[out] slots   : Receives the slot numbers.
+ * @param[out] images  : Receives the image spans.
+ * @param[in]  max_cnt : Size of the slots and images arrays.
+ * @param[out] p_cnt   : Number of images taken.
+ *
+ * @return API status code, NFC_RING_E_EMPTY if no image is published.
+ */
+nfc_ring_status_t nfc_ring_consume_batch(nfc_ring_t *ring, uint32_t *slots, nfc_image_t *images,
+                                         size_t max_cnt, size_t *p_cnt);
+
+/*
+ * @brief This API returns a consumed slot to the producers.
+ *
+ * @param[in] ring : Ring.
+ * @param[in] slot : Slot taken with nfc_ring_consume or nfc_ring_consume_batch.
+ *
+ * @return API status code.
+ */
+nfc_ring_status_t nfc_ring_release(nfc_ring_t *ring, uint32_t slot);
+
+/*
+ * @brief This API returns a batch of consumed slots to the producers.
+ *
+ * @param[in] ring  : Ring.
+ * @param[in] slots : Slot numbers returned by nfc_ring_consume_batch.
+ * @param[in] cnt   : Number of slots.
+ *
+ * @return API status code.
+ */
+nfc_ring_status_t nfc_ring_release_batch(nfc_ring_t *ring, const uint32_t *slots, size_t cnt);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* _NFC_RING_H_ */
+/** @}*/
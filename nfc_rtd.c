@@ -0,0 +1,917 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_rtd.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_rtd.c
+ * @brief Decoders for the NFC Forum well-known record types (URI, Text, Smart Poster).
+ */
+#include "nfc_rtd.h"
+#include "nfc_stats.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#define RTD_HAVE_SSSE3  1   /* Byte shuffles: table lookups for UTF-8, 3-byte UTF-16 blocks */
+#else
+#define RTD_HAVE_SSSE3  0
+#endif
+
+#if RTD_HAVE_SSSE3 || defined(__SSE2__) || defined(_M_X64)
+#define RTD_HAVE_SSE2   1
+#else
+#define RTD_HAVE_SSE2   0
+#endif
+
+/* UTF-16 bytes converted one unit at a time after a block fails the vector
+ * path. Without byte shuffles only uniform 1 or 2-byte blocks vectorise, so
+ * the next block of mixed text would most likely fail as well. */
+#if RTD_HAVE_SSSE3
+#define RTD_UTF16_FALLBACK_SIZE 16
+#else
+#define RTD_UTF16_FALLBACK_SIZE 32
+#endif
+
+#define RTD_STR(__S__)  { (__S__), sizeof(__S__) - 1 }
+
+/*
+ * @brief URI identifier code expansions (NFC Forum URI RTD, table 3).
+ */
+static const rtd_str_t rtd_uri_prefixes[RTD_URI_PREFIX_MAX + 1] =
+{
+    RTD_STR(""),
+    RTD_STR("http://www."),
+    RTD_STR("https://www."),
+    RTD_STR("http://"),
+    RTD_STR("https://"),
+    RTD_STR("tel:"),
+    RTD_STR("mailto:"),
+    RTD_STR("ftp://anonymous:anonymous@"),
+    RTD_STR("ftp://ftp."),
+    RTD_STR("ftps://"),
+    RTD_STR("sftp://"),
+    RTD_STR("smb://"),
+    RTD_STR("nfs://"),
+    RTD_STR("ftp://"),
+    RTD_STR("dav://"),
+    RTD_STR("news:"),
+    RTD_STR("telnet://"),
+    RTD_STR("imap:"),
+    RTD_STR("rtsp://"),
+    RTD_STR("urn:"),
+    RTD_STR("pop:"),
+    RTD_STR("sip:"),
+    RTD_STR("sips:"),
+    RTD_STR("tftp:"),
+    RTD_STR("btspp://"),
+    RTD_STR("btl2cap://"),
+    RTD_STR("btgoep://"),
+    RTD_STR("tcpobex://"),
+    RTD_STR("irdaobex://"),
+    RTD_STR("file://"),
+    RTD_STR("urn:epc:id:"),
+    RTD_STR("urn:epc:tag:"),
+    RTD_STR("urn:epc:pat:"),
+    RTD_STR("urn:epc:raw:"),
+    RTD_STR("urn:epc:"),
+    RTD_STR("urn:nfc:"),
+};
+
+/*
+ * @brief Check a record type against a type name without building a string.
+ */
+static int rtd_type_equals(const ndef_record_t *rec, const char *type)
+{
+    size_t len = strlen(type);
+
+    return (rec->type_len == len) && ((len == 0) || (memcmp(rec->type, type, len) == 0));
+}
+
+/*
+ * @brief This API checks whether a record is a well-known record of the given type.
+ */
+int rtd_is_well_known(const ndef_record_t *rec, const char *type)
+{
+    if((rec == NULL) || (type == NULL))
+        return 0;
+
+    return ((rec->header & NDEF_RECORD_FLAG_TNF_Msk) == TNF_WELL_KNOWN) && rtd_type_equals(rec, type);
+}
+
+/*
+ * @brief This API returns the expansion of a URI identifier code.
+ */
+rtd_str_t rtd_uri_prefix(uint8_t code)
+{
+    return rtd_uri_prefixes[(code <= RTD_URI_PREFIX_MAX) ? code : 0];
+}
+
+/*
+ * @brief This API decodes a well-known URI ("U") record.
+ */
+rtd_status_t rtd_uri_decode(const ndef_record_t *rec, rtd_uri_t *uri)
+{
+    if((rec == NULL) || (uri == NULL))
+        return RTD_E_INVALID_ARGS;
+
+    if(!rtd_is_well_known(rec, "U"))
+        return RTD_E_WRONG_TYPE;
+
+    if(rec->payload_len < 1)
+        return RTD_E_INVALID_FORMAT;
+
+    uri->prefix_code = rec->payload[0];
+    uri->prefix      = rtd_uri_prefix(uri->prefix_code);
+    uri->rest.data   = (const char *)rec->payload + 1;
+    uri->rest.len    = rec->payload_len - 1;
+
+    return RTD_OK;
+}
+
+/*
+ * @brief This API writes the full URI into a buffer, for callers that need one string.
+ */
+rtd_status_t rtd_uri_copy(const rtd_uri_t *uri, char *buf, size_t len, size_t *bw)
+{
+    if((uri == NULL) || (buf == NULL) || (bw == NULL))
+        return RTD_E_INVALID_ARGS;
+
+    if(uri->prefix.len + uri->rest.len > len)
+        return RTD_E_INVALID_ARGS;
+
+    memcpy(buf, uri->prefix.data, uri->prefix.len);
+    if(uri->rest.len != 0)
+        memcpy(buf + uri->prefix.len, uri->rest.data, uri->rest.len);
+
+    *bw = uri->prefix.len + uri->rest.len;
+
+    return RTD_OK;
+}
+
+/*
+ * @brief This API decodes a well-known Text ("T") record.
+ */
+rtd_status_t rtd_text_decode(const ndef_record_t *rec, rtd_text_t *text)
+{
+    if((rec == NULL) || (text == NULL))
+        return RTD_E_INVALID_ARGS;
+
+    if(!rtd_is_well_known(rec, "T"))
+        return RTD_E_WRONG_TYPE;
+
+    if(rec->payload_len < 1)
+        return RTD_E_INVALID_FORMAT;
+
+    uint8_t status   = rec->payload[0];
+    size_t  lang_len = status & RTD_TEXT_STATUS_LANG_Msk;
+
+    if(lang_len > rec->payload_len - 1)
+        return RTD_E_INVALID_FORMAT;
+
+    text->utf16     = NDEF_RECORD_GET_FLAG(status, RTD_TEXT_STATUS_UTF16);
+    text->lang.data = (const char *)rec->payload + 1;
+    text->lang.len  = lang_len;
+    text->text.data = (const char *)rec->payload + 1 + lang_len;
+    text->text.len  = rec->payload_len - 1 - lang_len;
+
+    return RTD_OK;
+}
+
+/* ---- UTF-8 validation ------------------------------------------------------------------ */
+
+/*
+ * @brief Scalar UTF-8 check (Unicode table 3-7), starting at a character boundary.
+ *
+ * @return Offset of the first invalid sequence, or len if the text is valid.
+ */
+static size_t rtd_utf8_scan(const uint8_t *s, size_t i, size_t len)
+{
+    while(i < len)
+    {
+        /* Skip ASCII a vector or a word at a time. */
+#if RTD_HAVE_SSE2
+        if((len - i >= 16) && (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i))) == 0))
+        {
+            i += 16;
+            continue;
+        }
+#endif
+        if(len - i >= sizeof(uint64_t))
+        {
+            uint64_t w;
+            memcpy(&w, s + i, sizeof(w));
+            if((w & 0x8080808080808080ULL) == 0)
+            {
+                i += sizeof(w);
+                continue;
+            }
+        }
+
+        uint8_t c = s[i];
+        if(c < 0x80)
+        {
+            i++;
+            continue;
+        }
+
+        size_t  n;
+        uint8_t lo = 0x80, hi = 0xBF;
+
+        if((c >= 0xC2) && (c <= 0xDF))
+        {
+            n = 1;
+        }
+        else if((c >= 0xE0) && (c <= 0xEF))
+        {
+            n  = 2;
+            lo = (c == 0xE0) ? 0xA0 : 0x80;   /* Overlong */
+            hi = (c == 0xED) ? 0x9F : 0xBF;   /* Surrogates */
+        }
+        else if((c >= 0xF0) && (c <= 0xF4))
+        {
+            n  = 3;
+            lo = (c == 0xF0) ? 0x90 : 0x80;   /* Overlong */
+            hi = (c == 0xF4) ? 0x8F : 0xBF;   /* Above U+10FFFF */
+        }
+        else
+        {
+            return i;
+        }
+
+        if((len - i - 1 < n) || (s[i + 1] < lo) || (s[i + 1] > hi))
+            return i;
+        for(size_t k = 2; k <= n; k++)
+        {
+            if((s[i + k] & 0xC0) != 0x80)
+                return i;
+        }
+
+        i += n + 1;
+    }
+
+    return len;
+}
+
+#if RTD_HAVE_SSSE3
+
+/*
+ * @brief Locate the error in a block the vector check rejected.
+ *
+ * Every sequence starting more than 3 bytes before the block was valid, so
+ * the scalar check restarts at the first character boundary of those bytes.
+ */
+static size_t rtd_utf8_locate(const uint8_t *s, size_t block, size_t len)
+{
+    size_t i = (block > 3) ? block - 3 : 0;
+
+    while((i < block) && ((s[i] & 0xC0) == 0x80))
+        i++;
+
+    return rtd_utf8_scan(s, i, len);
+}
+
+/* Error classes of the byte pair lookup (Keiser and Lemire, "Validating UTF-8
+ * in less than one instruction per byte"). A pair is invalid when the classes
+ * of its first byte's high and low nibble and its second byte's high nibble
+ * share a bit; TWO_CONTS is expected, and checked against, in the bytes
+ * that must continue a 3 or 4-byte sequence. */
+#define RTD_U8_TOO_SHORT        (1 << 0)
+#define RTD_U8_TOO_LONG         (1 << 1)
+#define RTD_U8_OVERLONG_3       (1 << 2)
+#define RTD_U8_TOO_LARGE        (1 << 3)
+#define RTD_U8_SURROGATE        (1 << 4)
+#define RTD_U8_OVERLONG_2       (1 << 5)
+#define RTD_U8_TOO_LARGE_1000   (1 << 6)
+#define RTD_U8_OVERLONG_4       (1 << 6)
+#define RTD_U8_TWO_CONTS        (-128)      /* Bit 7, written so it fits the char arguments of _mm_setr_epi8 */
+#define RTD_U8_CARRY            (RTD_U8_TOO_SHORT | RTD_U8_TOO_LONG | RTD_U8_TWO_CONTS)
+
+#define RTD_U8_BYTE_1_HIGH                                                                  \
+    RTD_U8_TOO_LONG, RTD_U8_TOO_LONG, RTD_U8_TOO_LONG, RTD_U8_TOO_LONG,                     \
+    RTD_U8_TOO_LONG, RTD_U8_TOO_LONG, RTD_U8_TOO_LONG, RTD_U8_TOO_LONG,                     \
+    RTD_U8_TWO_CONTS, RTD_U8_TWO_CONTS, RTD_U8_TWO_CONTS, RTD_U8_TWO_CONTS,                 \
+    RTD_U8_TOO_SHORT | RTD_U8_OVERLONG_2,                                                   \
+    RTD_U8_TOO_SHORT,                                                                       \
+    RTD_U8_TOO_SHORT | RTD_U8_OVERLONG_3 | RTD_U8_SURROGATE,                                \
+    RTD_U8_TOO_SHORT | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000 | RTD_U8_OVERLONG_4
+
+#define RTD_U8_BYTE_1_LOW                                                                   \
+    RTD_U8_CARRY | RTD_U8_OVERLONG_3 | RTD_U8_OVERLONG_2 | RTD_U8_OVERLONG_4,               \
+    RTD_U8_CARRY | RTD_U8_OVERLONG_2,                                                       \
+    RTD_U8_CARRY,                                                                           \
+    RTD_U8_CARRY,                                                                           \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE,                                                        \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000,                                \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000,                                \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000,                                \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000,                                \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000,                                \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000,                                \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000,                                \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000,                                \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000 | RTD_U8_SURROGATE,             \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000,                                \
+    RTD_U8_CARRY | RTD_U8_TOO_LARGE | RTD_U8_TOO_LARGE_1000
+
+#define RTD_U8_BYTE_2_HIGH                                                                  \
+    RTD_U8_TOO_SHORT, RTD_U8_TOO_SHORT, RTD_U8_TOO_SHORT, RTD_U8_TOO_SHORT,                 \
+    RTD_U8_TOO_SHORT, RTD_U8_TOO_SHORT, RTD_U8_TOO_SHORT, RTD_U8_TOO_SHORT,                 \
+    RTD_U8_TOO_LONG | RTD_U8_OVERLONG_2 | RTD_U8_TWO_CONTS | RTD_U8_OVERLONG_3 |            \
+        RTD_U8_TOO_LARGE_1000 | RTD_U8_OVERLONG_4,                                          \
+    RTD_U8_TOO_LONG | RTD_U8_OVERLONG_2 | RTD_U8_TWO_CONTS | RTD_U8_OVERLONG_3 |            \
+        RTD_U8_TOO_LARGE,                                                                   \
+    RTD_U8_TOO_LONG | RTD_U8_OVERLONG_2 | RTD_U8_TWO_CONTS | RTD_U8_SURROGATE |             \
+        RTD_U8_TOO_LARGE,                                                                   \
+    RTD_U8_TOO_LONG | RTD_U8_OVERLONG_2 | RTD_U8_TWO_CONTS | RTD_U8_SURROGATE |             \
+        RTD_U8_TOO_LARGE,                                                                   \
+    RTD_U8_TOO_SHORT, RTD_U8_TOO_SHORT, RTD_U8_TOO_SHORT, RTD_U8_TOO_SHORT
+
+#endif /* RTD_HAVE_SSSE3 */
+
+#if defined(__AVX2__)
+
+#define RTD_U8_BLOCK    32
+typedef __m256i rtd_u8_vec_t;
+
+#define RTD_U8_PREV(__IN__, __PREV__, __N__) \
+    _mm256_alignr_epi8((__IN__), _mm256_permute2x128_si256((__PREV__), (__IN__), 0x21), 16 - (__N__))
+
+static inline rtd_u8_vec_t rtd_u8_high_nibble(rtd_u8_vec_t v)
+{
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+}
+
+/*
+ * @brief Error bits of a 32-byte block given the block before it.
+ */
+static inline rtd_u8_vec_t rtd_u8_check(rtd_u8_vec_t in, rtd_u8_vec_t prev_in)
+{
+    const rtd_u8_vec_t byte_1_high = _mm256_setr_epi8(RTD_U8_BYTE_1_HIGH, RTD_U8_BYTE_1_HIGH);
+    const rtd_u8_vec_t byte_1_low  = _mm256_setr_epi8(RTD_U8_BYTE_1_LOW, RTD_U8_BYTE_1_LOW);
+    const rtd_u8_vec_t byte_2_high = _mm256_setr_epi8(RTD_U8_BYTE_2_HIGH, RTD_U8_BYTE_2_HIGH);
+
+    rtd_u8_vec_t prev1 = RTD_U8_PREV(in, prev_in, 1);
+    rtd_u8_vec_t sc    = _mm256_and_si256(
+                             _mm256_and_si256(_mm256_shuffle_epi8(byte_1_high, rtd_u8_high_nibble(prev1)),
+                                              _mm256_shuffle_epi8(byte_1_low,
+                                                                  _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+                             _mm256_shuffle_epi8(byte_2_high, rtd_u8_high_nibble(in)));
+
+    /* Third and fourth bytes of 3 and 4-byte sequences must be continuations. */
+    rtd_u8_vec_t third  = _mm256_subs_epu8(RTD_U8_PREV(in, prev_in, 2), _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    rtd_u8_vec_t fourth = _mm256_subs_epu8(RTD_U8_PREV(in, prev_in, 3), _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    rtd_u8_vec_t must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+
+    return _mm256_xor_si256(must23, sc);
+}
+
+/*
+ * @brief Non-zero where the block ends inside a multi-byte sequence.
+ */
+static inline rtd_u8_vec_t rtd_u8_incomplete(rtd_u8_vec_t in)
+{
+    const rtd_u8_vec_t max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                              -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                              (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    return _mm256_subs_epu8(in, max);
+}
+
+#define RTD_U8_LOAD(__P__)      _mm256_loadu_si256((const __m256i *)(__P__))
+#define RTD_U8_ZERO()           _mm256_setzero_si256()
+#define RTD_U8_OR(__A__, __B__) _mm256_or_si256((__A__), (__B__))
+#define RTD_U8_ASCII(__V__)     (_mm256_movemask_epi8(__V__) == 0)
+#define RTD_U8_ANY(__V__)       (!_mm256_testz_si256((__V__), (__V__)))
+
+#elif RTD_HAVE_SSSE3
+
+#define RTD_U8_BLOCK    16
+typedef __m128i rtd_u8_vec_t;
+
+#define RTD_U8_PREV(__IN__, __PREV__, __N__)    _mm_alignr_epi8((__IN__), (__PREV__), 16 - (__N__))
+
+static inline rtd_u8_vec_t rtd_u8_high_nibble(rtd_u8_vec_t v)
+{
+    return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+}
+
+/*
+ * @brief Error bits of a 16-byte block given the block before it.
+ */
+static inline rtd_u8_vec_t rtd_u8_check(rtd_u8_vec_t in, rtd_u8_vec_t prev_in)
+{
+    const rtd_u8_vec_t byte_1_high = _mm_setr_epi8(RTD_U8_BYTE_1_HIGH);
+    const rtd_u8_vec_t byte_1_low  = _mm_setr_epi8(RTD_U8_BYTE_1_LOW);
+    const rtd_u8_vec_t byte_2_high = _mm_setr_epi8(RTD_U8_BYTE_2_HIGH);
+
+    rtd_u8_vec_t prev1 = RTD_U8_PREV(in, prev_in, 1);
+    rtd_u8_vec_t sc    = _mm_and_si128(
+                             _mm_and_si128(_mm_shuffle_epi8(byte_1_high, rtd_u8_high_nibble(prev1)),
+                                           _mm_shuffle_epi8(byte_1_low, _mm_and_si128(prev1, _mm_set1_epi8(0x0F)))),
+                             _mm_shuffle_epi8(byte_2_high, rtd_u8_high_nibble(in)));
+
+    /* Third and fourth bytes of 3 and 4-byte sequences must be continuations. */
+    rtd_u8_vec_t third  = _mm_subs_epu8(RTD_U8_PREV(in, prev_in, 2), _mm_set1_epi8((char)(0xE0 - 0x80)));
+    rtd_u8_vec_t fourth = _mm_subs_epu8(RTD_U8_PREV(in, prev_in, 3), _mm_set1_epi8((char)(0xF0 - 0x80)));
+    rtd_u8_vec_t must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+
+    return _mm_xor_si128(must23, sc);
+}
+
+/*
+ * @brief Non-zero where the block ends inside a multi-byte sequence.
+ */
+static inline rtd_u8_vec_t rtd_u8_incomplete(rtd_u8_vec_t in)
+{
+    const rtd_u8_vec_t max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                           (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    return _mm_subs_epu8(in, max);
+}
+
+#define RTD_U8_LOAD(__P__)      _mm_loadu_si128((const __m128i *)(__P__))
+#define RTD_U8_ZERO()           _mm_setzero_si128()
+#define RTD_U8_OR(__A__, __B__) _mm_or_si128((__A__), (__B__))
+#define RTD_U8_ASCII(__V__)     (_mm_movemask_epi8(__V__) == 0)
+#define RTD_U8_ANY(__V__)       (_mm_movemask_epi8(_mm_cmpeq_epi8((__V__), _mm_setzero_si128())) != 0xFFFF)
+
+#endif
+
+/*
+ * @brief UTF-8 check of a whole buffer.
+ *
+ * @return Offset of the first invalid sequence, or len if the text is valid.
+ */
+static size_t rtd_utf8_check(const uint8_t *s, size_t len)
+{
+    size_t i = 0;
+
+#if defined(RTD_U8_BLOCK)
+    rtd_u8_vec_t prev_in         = RTD_U8_ZERO();
+    rtd_u8_vec_t prev_incomplete = RTD_U8_ZERO();
+
+    for(; i + RTD_U8_BLOCK <= len; i += RTD_U8_BLOCK)
+    {
+        rtd_u8_vec_t in = RTD_U8_LOAD(s + i);
+        rtd_u8_vec_t error;
+
+        if(RTD_U8_ASCII(in))
+        {
+            /* Only a sequence left open by the previous block can fail. */
+            error           = prev_incomplete;
+            prev_incomplete = RTD_U8_ZERO();
+        }
+        else
+        {
+            error           = rtd_u8_check(in, prev_in);
+            prev_incomplete = rtd_u8_incomplete(in);
+        }
+
+        if(RTD_U8_ANY(error))
+            return rtd_utf8_locate(s, i, len);
+
+        prev_in = in;
+    }
+
+    if(i < len)
+    {
+        /* Zero padding reads as ASCII, so a truncated sequence is caught. */
+        uint8_t tail[RTD_U8_BLOCK] = { 0 };
+        memcpy(tail, s + i, len - i);
+
+        if(RTD_U8_ANY(rtd_u8_check(RTD_U8_LOAD(tail), prev_in)))
+            return rtd_utf8_locate(s, i, len);
+    }
+    else if(RTD_U8_ANY(prev_incomplete))
+    {
+        return rtd_utf8_locate(s, i, len);
+    }
+
+    return len;
+#else
+    return rtd_utf8_scan(s, i, len);
+#endif
+}
+
+/*
+ * @brief This API validates UTF-8 text.
+ */
+rtd_status_t rtd_utf8_validate(const uint8_t *buf, size_t len, size_t *p_valid)
+{
+    if((buf == NULL) && (len != 0))
+        return RTD_E_INVALID_ARGS;
+
+    size_t valid = (len != 0) ? rtd_utf8_check(buf, len) : 0;
+
+    if(p_valid != NULL)
+        *p_valid = valid;
+
+    return (valid == len) ? RTD_OK : RTD_E_INVALID_TEXT;
+}
+
+/* ---- UTF-16 to UTF-8 ------------------------------------------------------------------- */
+
+static inline uint32_t rtd_utf16_unit(const uint8_t *p, uint8_t little_endian)
+{
+    return little_endian ? (uint32_t)(p[0] | (p[1] << 8)) : (uint32_t)((p[0] << 8) | p[1]);
+}
+
+#if RTD_HAVE_SSE2
+
+#if RTD_HAVE_SSSE3
+
+/*
+ * @brief Shuffles that keep both bytes of 2-byte units and the first byte of
+ *        ASCII units, indexed by the ASCII mask of 4 units.
+ */
+static const uint8_t rtd_utf16_compact[16][8] =
+{
+    { 0, 1, 2, 3, 4, 5, 6, 7 },             { 0, 2, 3, 4, 5, 6, 7, 0x80 },
+    { 0, 1, 2, 4, 5, 6, 7, 0x80 },          { 0, 2, 4, 5, 6, 7, 0x80, 0x80 },
+    { 0, 1, 2, 3, 4, 6, 7, 0x80 },          { 0, 2, 3, 4, 6, 7, 0x80, 0x80 },
+    { 0, 1, 2, 4, 6, 7, 0x80, 0x80 },       { 0, 2, 4, 6, 7, 0x80, 0x80, 0x80 },
+    { 0, 1, 2, 3, 4, 5, 6, 0x80 },          { 0, 2, 3, 4, 5, 6, 0x80, 0x80 },
+    { 0, 1, 2, 4, 5, 6, 0x80, 0x80 },       { 0, 2, 4, 5, 6, 0x80, 0x80, 0x80 },
+    { 0, 1, 2, 3, 4, 6, 0x80, 0x80 },       { 0, 2, 3, 4, 6, 0x80, 0x80, 0x80 },
+    { 0, 1, 2, 4, 6, 0x80, 0x80, 0x80 },    { 0, 2, 4, 6, 0x80, 0x80, 0x80, 0x80 },
+};
+
+static inline size_t rtd_popcount4(unsigned v)
+{
+    return (v & 1) + ((v >> 1) & 1) + ((v >> 2) & 1) + ((v >> 3) & 1);
+}
+
+#endif /* RTD_HAVE_SSSE3 */
+
+/*
+ * @brief Convert 8 code units with vectors when they share one UTF-8 length.
+ *
+ * @return Number of bytes written to out (at most 24), or 0 if the units
+ *         must be converted one at a time.
+ */
+static size_t rtd_utf16_block(const uint8_t *s, uint8_t little_endian, uint8_t *out)
+{
+    __m128i v = _mm_loadu_si128((const __m128i *)s);
+
+    if(!little_endian)
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+    const __m128i zero = _mm_setzero_si128();
+    __m128i       hi7  = _mm_and_si128(v, _mm_set1_epi16((short)0xFF80));  /* Zero below U+0080 */
+    __m128i       hi11 = _mm_and_si128(v, _mm_set1_epi16((short)0xF800));  /* Zero below U+0800 */
+
+    if(_mm_movemask_epi8(_mm_cmpeq_epi16(hi7, zero)) == 0xFFFF)
+    {
+        _mm_storel_epi64((__m128i *)out, _mm_packus_epi16(v, v));
+        return 8;
+    }
+
+#if RTD_HAVE_SSSE3
+    if(_mm_movemask_epi8(_mm_cmpeq_epi16(hi11, zero)) == 0xFFFF)
+    {
+        /* Mix of 1 and 2-byte units: build both bytes of every unit, then
+         * drop the second byte of the ASCII ones, 4 units at a time. */
+        __m128i ascii = _mm_cmpeq_epi16(hi7, zero);
+        __m128i two   = _mm_or_si128(_mm_or_si128(_mm_srli_epi16(v, 6), _mm_set1_epi16(0xC0)),
+                                     _mm_slli_epi16(_mm_or_si128(_mm_and_si128(v, _mm_set1_epi16(0x3F)),
+                                                                 _mm_set1_epi16(0x80)), 8));
+        __m128i pair  = _mm_or_si128(_mm_and_si128(ascii, v), _mm_andnot_si128(ascii, two));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_packs_epi16(ascii, zero));
+        unsigned lo   = mask & 0x0F, hi = mask >> 4;
+
+        __m128i lo_idx = _mm_loadl_epi64((const __m128i *)rtd_utf16_compact[lo]);
+        __m128i hi_idx = _mm_add_epi8(_mm_loadl_epi64((const __m128i *)rtd_utf16_compact[hi]), _mm_set1_epi8(8));
+        size_t  lo_len = 8 - rtd_popcount4(lo);
+
+        _mm_storel_epi64((__m128i *)out, _mm_shuffle_epi8(pair, lo_idx));
+        _mm_storel_epi64((__m128i *)(out + lo_len), _mm_shuffle_epi8(pair, hi_idx));
+        return lo_len + 8 - rtd_popcount4(hi);
+    }
+
+    if((_mm_movemask_epi8(_mm_cmpeq_epi16(hi11, zero)) == 0) &&
+       (_mm_movemask_epi8(_mm_cmpeq_epi16(hi11, _mm_set1_epi16((short)0xD800))) == 0))
+    {
+        /* 1110xxxx 10xxxxxx 10xxxxxx, interleaved from three planes. */
+        __m128i b0 = _mm_or_si128(_mm_srli_epi16(v, 12), _mm_set1_epi16(0xE0));
+        __m128i b1 = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 6), _mm_set1_epi16(0x3F)), _mm_set1_epi16(0x80));
+        __m128i b2 = _mm_or_si128(_mm_and_si128(v, _mm_set1_epi16(0x3F)), _mm_set1_epi16(0x80));
+        __m128i x  = _mm_packus_epi16(b0, b1);
+        __m128i y  = _mm_packus_epi16(b2, b2);
+
+        __m128i lo = _mm_or_si128(
+            _mm_shuffle_epi8(x, _mm_setr_epi8(0, 8, -1, 1, 9, -1, 2, 10, -1, 3, 11, -1, 4, 12, -1, 5)),
+            _mm_shuffle_epi8(y, _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1)));
+        __m128i hi = _mm_or_si128(
+            _mm_shuffle_epi8(x, _mm_setr_epi8(13, -1, 6, 14, -1, 7, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(y, _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1)));
+
+        _mm_storeu_si128((__m128i *)out, lo);
+        _mm_storel_epi64((__m128i *)(out + 16), hi);
+        return 24;
+    }
+#else
+    if((_mm_movemask_epi8(_mm_cmpeq_epi16(hi11, zero)) == 0xFFFF) &&
+       (_mm_movemask_epi8(_mm_cmpeq_epi16(hi7, zero)) == 0))
+    {
+        /* 110xxxxx 10xxxxxx */
+        __m128i b0 = _mm_or_si128(_mm_srli_epi16(v, 6), _mm_set1_epi16(0xC0));
+        __m128i b1 = _mm_or_si128(_mm_and_si128(v, _mm_set1_epi16(0x3F)), _mm_set1_epi16(0x80));
+
+        _mm_storeu_si128((__m128i *)out, _mm_or_si128(b0, _mm_slli_epi16(b1, 8)));
+        return 16;
+    }
+#endif
+
+    return 0;
+}
+
+#endif /* RTD_HAVE_SSE2 */
+
+/*
+ * @brief This API converts UTF-16 text to UTF-8.
+ */
+rtd_status_t rtd_utf16_to_utf8(const uint8_t *buf, size_t len, uint8_t little_endian,
+                               char *out, size_t out_len, size_t *bw)
+{
+    if(((buf == NULL) && (len != 0)) || (out == NULL) || (bw == NULL))
+        return RTD_E_INVALID_ARGS;
+
+    if(len % 2 != 0)
+        return RTD_E_INVALID_TEXT;
+
+    uint8_t *dst = (uint8_t *)out;
+    size_t  i    = 0;
+    size_t  o    = 0;
+
+    while(i < len)
+    {
+        size_t end = len;
+
+#if RTD_HAVE_SSE2
+        if((len - i >= 16) && (out_len - o >= 24))
+        {
+            size_t n = rtd_utf16_block(buf + i, little_endian, dst + o);
+            if(n != 0)
+            {
+                i += 16;
+                o += n;
+                continue;
+            }
+
+            /* Mixed lengths: convert these units one at a time. */
+            end = (len - i >= RTD_UTF16_FALLBACK_SIZE) ? i + RTD_UTF16_FALLBACK_SIZE : len;
+        }
+#endif
+
+        while(i < end)
+        {
+            uint32_t cp = rtd_utf16_unit(buf + i, little_endian);
+            size_t   in = 2;
+
+            if((cp >= 0xD800) && (cp <= 0xDFFF))
+            {
+                if((cp >= 0xDC00) || (len - i < 4))
+                    return RTD_E_INVALID_TEXT;
+
+                uint32_t low = rtd_utf16_unit(buf + i + 2, little_endian);
+                if((low < 0xDC00) || (low > 0xDFFF))
+                    return RTD_E_INVALID_TEXT;
+
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                in = 4;
+            }
+
+            size_t n = (cp < 0x80) ? 1 : (cp < 0x800) ? 2 : (cp < 0x10000) ? 3 : 4;
+            if(out_len - o < n)
+                return RTD_E_INVALID_ARGS;
+
+            switch(n)
+            {
+                case 1:
+                    dst[o] = (uint8_t)cp;
+                    break;
+                case 2:
+                    dst[o]     = (uint8_t)(0xC0 | (cp >> 6));
+                    dst[o + 1] = (uint8_t)(0x80 | (cp & 0x3F));
+                    break;
+                case 3:
+                    dst[o]     = (uint8_t)(0xE0 | (cp >> 12));
+                    dst[o + 1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+                    dst[o + 2] = (uint8_t)(0x80 | (cp & 0x3F));
+                    break;
+                default:
+                    dst[o]     = (uint8_t)(0xF0 | (cp >> 18));
+                    dst[o + 1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+                    dst[o + 2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+                    dst[o + 3] = (uint8_t)(0x80 | (cp & 0x3F));
+                    break;
+            }
+
+            i += in;
+            o += n;
+        }
+    }
+
+    *bw = o;
+
+    return RTD_OK;
+}
+
+/*
+ * @brief This API writes the text of a decoded Text record as validated UTF-8.
+ */
+rtd_status_t rtd_text_to_utf8(const rtd_text_t *text, char *buf, size_t len, size_t *bw)
+{
+    if((text == NULL) || (buf == NULL) || (bw == NULL))
+        return RTD_E_INVALID_ARGS;
+
+    for(size_t i = 0; i < text->lang.len; i++)
+    {
+        if((text->lang.data[i] < 0x21) || (text->lang.data[i] > 0x7E))
+            return RTD_E_INVALID_FORMAT;
+    }
+
+    const uint8_t *s = (const uint8_t *)text->text.data;
+    size_t        n  = text->text.len;
+
+    if(text->utf16)
+    {
+        uint8_t little_endian = 0;
+
+        /* Big-endian unless a byte order mark says otherwise; the mark is not copied. */
+        if((n >= 2) && (((s[0] == 0xFE) && (s[1] == 0xFF)) || ((s[0] == 0xFF) && (s[1] == 0xFE))))
+        {
+            little_endian = (s[0] == 0xFF);
+            s += 2;
+            n -= 2;
+        }
+
+        return rtd_utf16_to_utf8(s, n, little_endian, buf, len, bw);
+    }
+
+    if(n > len)
+        return RTD_E_INVALID_ARGS;
+
+    rtd_status_t rslt = rtd_utf8_validate(s, n, NULL);
+    if(rslt != RTD_OK)
+        return rslt;
+
+    if(n != 0)
+        memcpy(buf, s, n);
+    *bw = n;
+
+    return RTD_OK;
+}
+
+/*
+ * @brief Merge one Smart Poster field record, keeping any value already set.
+ */
+static void rtd_sp_merge_field(const ndef_record_t *rec, rtd_smart_poster_t *sp)
+{
+    if(rtd_type_equals(rec, "U"))
+    {
+        if(!sp->has_uri && (rtd_uri_decode(rec, &sp->uri) == RTD_OK))
+            sp->has_uri = 1;
+    }
+    else if(rtd_type_equals(rec, "T"))
+    {
+        if((sp->title_cnt < sp->max_titles) && (rtd_text_decode(rec, &sp->titles[sp->title_cnt]) == RTD_OK))
+            sp->title_cnt++;
+    }
+    else if(rtd_type_equals(rec, "act"))
+    {
+        if(!sp->has_action && (rec->payload_len == 1))
+        {
+            sp->action     = rec->payload[0];
+            sp->has_action = 1;
+        }
+    }
+    else if(rtd_type_equals(rec, "s"))
+    {
+        if(!sp->has_size && (rec->payload_len == 4))
+        {
+            sp->size     = ((uint32_t)rec->payload[0] << 24) | ((uint32_t)rec->payload[1] << 16) |
+                           ((uint32_t)rec->payload[2] << 8)  |  (uint32_t)rec->payload[3];
+            sp->has_size = 1;
+        }
+    }
+    else if(rtd_type_equals(rec, "t"))
+    {
+        if(sp->mime_type.data == NULL)
+        {
+            sp->mime_type.data = (const char *)rec->payload;
+            sp->mime_type.len  = rec->payload_len;
+        }
+    }
+}
+
+/*
+ * @brief Decode the records of a Smart Poster payload, following nested Smart Posters.
+ *
+ * The fields of this level are merged before any nested Smart Poster is
+ * entered, so a value set here is never replaced by a deeper one.
+ */
+static rtd_status_t rtd_sp_decode_msg(uint8_t *msg, size_t len, rtd_smart_poster_t *sp, unsigned depth)
+{
+    ndef_record_t rec;
+    size_t        br;
+    size_t        offset = 0;
+    uint8_t       nested = 0;
+
+    while(offset < len)
+    {
+        ndef_status_t rslt = ndef_parse_next_rec(msg + offset, len - offset, &rec, &br);
+        if(rslt != NDEF_OK)
+        {
+            if(rslt == NDEF_E_INCOMPLETE)
+                NFC_STATS_ERROR(NFC_STATS_ERR_NDEF_INCOMPLETE);
+            return RTD_E_INVALID_FORMAT;
+        }
+
+        offset += br;
+
+        if((rec.header & NDEF_RECORD_FLAG_TNF_Msk) != TNF_WELL_KNOWN)
+            continue;
+
+        if(rtd_type_equals(&rec, "Sp"))
+            nested = 1;
+        else
+            rtd_sp_merge_field(&rec, sp);
+    }
+
+    if(!nested)
+        return RTD_OK;
+
+    if(depth == 0)
+        return RTD_E_DEPTH;
+
+    /* The first pass has validated every record, so this walk cannot fail. */
+    for(offset = 0; offset < len; offset += br)
+    {
+        (void)ndef_parse_next_rec(msg + offset, len - offset, &rec, &br);
+
+        if(((rec.header & NDEF_RECORD_FLAG_TNF_Msk) == TNF_WELL_KNOWN) && rtd_type_equals(&rec, "Sp"))
+        {
+            rtd_status_t rslt = rtd_sp_decode_msg(rec.payload, rec.payload_len, sp, depth - 1);
+            if(rslt != RTD_OK)
+                return rslt;
+        }
+    }
+
+    return RTD_OK;
+}
+
+/*
+ * @brief This API decodes a well-known Smart Poster ("Sp") record.
+ */
+rtd_status_t rtd_sp_decode(const ndef_record_t *rec, rtd_smart_poster_t *sp, unsigned max_depth)
+{
+    if((rec == NULL) || (sp == NULL) || ((sp->titles == NULL) && (sp->max_titles != 0)))
+        return RTD_E_INVALID_ARGS;
+
+    if(!rtd_is_well_known(rec, "Sp"))
+        return RTD_E_WRONG_TYPE;
+
+    sp->has_uri        = 0;
+    sp->title_cnt      = 0;
+    sp->has_action     = 0;
+    sp->has_size       = 0;
+    sp->mime_type.data = NULL;
+    sp->mime_type.len  = 0;
+
+    rtd_status_t rslt = rtd_sp_decode_msg(rec->payload, rec->payload_len, sp, max_depth);
+    if(rslt != RTD_OK)
+        return rslt;
+
+    return sp->has_uri ? RTD_OK : RTD_E_INVALID_FORMAT;
+}
@@ -0,0 +1,253 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_rtd.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_rtd.h
+ * @brief Decoders for the NFC Forum well-known record types (URI, Text, Smart Poster).
+ */
+
+/*!
+ * @defgroup RTD API
+ */
+#ifndef _NFC_RTD_H_
+#define _NFC_RTD_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "nfc_ndef.h"
+
+#define RTD_URI_PREFIX_MAX          0x23    /* Highest defined URI identifier code.           */
+#define RTD_TEXT_STATUS_UTF16       (1 << 7)/* Text status byte: UTF-16 encoding.             */
+#define RTD_TEXT_STATUS_LANG_Msk    0x3F    /* Text status byte: language code length mask.   */
+#define RTD_SP_DEFAULT_DEPTH        2       /* Nested Smart Poster levels followed by default. */
+
+/* UTF-8 buffer size that holds any Text record text of the given encoded length:
+ * a UTF-16 code unit becomes at most 3 bytes, a surrogate pair 4. */
+#define RTD_TEXT_UTF8_MAX_SIZE(__TEXT_LEN__)    ((__TEXT_LEN__) + (__TEXT_LEN__) / 2)
+
+/*!
+ * @brief RTD API status codes.
+ */
+typedef enum
+{
+    RTD_OK,                 /* Success                                     */
+    RTD_E_INVALID_ARGS,     /* Invalid function arguments                  */
+    RTD_E_WRONG_TYPE,       /* Record is not of the requested type         */
+    RTD_E_INVALID_FORMAT,   /* Payload does not follow the RTD             */
+    RTD_E_DEPTH,            /* Smart Poster nesting exceeds the depth limit */
+    RTD_E_INVALID_TEXT      /* Text is not valid UTF-8 or UTF-16           */
+} rtd_status_t;
+
+/*!
+ * @brief Non-owning view of a string; not NUL terminated.
+ */
+typedef struct
+{
+    const char *data;
+    size_t     len;
+} rtd_str_t;
+
+/*!
+ * @brief Decoded URI record.
+ *
+ * The full URI is 'prefix' followed by 'rest'. 'prefix' points into a static
+ * table and 'rest' into the record payload; no string is built.
+ */
+typedef struct
+{
+    uint8_t   prefix_code;  /* URI identifier code (payload byte 0) */
+    rtd_str_t prefix;       /* Expansion of the identifier code     */
+    rtd_str_t rest;         /* Remainder of the URI                 */
+} rtd_uri_t;
+
+/*!
+ * @brief Decoded Text record.
+ */
+typedef struct
+{
+    uint8_t   utf16;    /* 1 if the text is UTF-16 encoded, 0 for UTF-8 */
+    rtd_str_t lang;     /* IANA language code                           */
+    rtd_str_t text;     /* Encoded text (raw UTF-8 or UTF-16 bytes)     */
+} rtd_text_t;
+
+/*!
+ * @brief Decoded Smart Poster record.
+ *
+ * Titles are stored in caller storage. Fields of nested Smart Posters are
+ * merged in, the outermost value winning: each level's own records are
+ * applied before its nested Smart Posters are entered, and outer titles are
+ * stored ahead of nested ones.
+ */
+typedef struct
+{
+    uint8_t    has_uri;
+    rtd_uri_t  uri;         /* URI record (mandatory in a valid Smart Poster) */
+    rtd_text_t *titles;     /* Caller storage for the title records           */
+    size_t     max_titles;  /* Capacity of 'titles'                           */
+    size_t     title_cnt;   /* Number of titles stored                        */
+    uint8_t    has_action;
+    uint8_t    action;      /* Recommended action ("act" record)              */
+    uint8_t    has_size;
+    uint32_t   size;        /* Size of the referenced object ("s" record)     */
+    rtd_str_t  mime_type;   /* Type of the referenced object ("t" record)     */
+} rtd_smart_poster_t;
+
+/*
+ * @brief This API checks whether a record is a well-known record of the given type.
+ *
+ * @param[in] rec  : Pointer to the record.
+ * @param[in] type : Well-known type name, e.g. "U".
+ *
+ * @return 1 if the record matches, 0 otherwise.
+ */
+int rtd_is_well_known(const ndef_record_t *rec, const char *type);
+
+/*
+ * @brief This API decodes a well-known URI ("U") record.
+ *
+ * Identifier codes above RTD_URI_PREFIX_MAX are reserved and expand to an
+ * empty prefix.
+ *
+ * @param[in]  rec : Pointer to the record.
+ * @param[out] uri : Pointer to the decoded URI.
+ *
+ * @return API status code.
+ */
+rtd_status_t rtd_uri_decode(const ndef_record_t *rec, rtd_uri_t *uri);
+
+/*
+ * @brief This API returns the expansion of a URI identifier code.
+ *
+ * @param[in] code : URI identifier code.
+ *
+ * @return View of the prefix (empty for reserved codes).
+ */
+rtd_str_t rtd_uri_prefix(uint8_t code);
+
+/*
+ * @brief This API writes the full URI into a buffer, for callers that need one string.
+ *
+ * @param[in]  uri : Pointer to the decoded URI.
+ * @param[out] buf : Pointer to the output buffer.
+ * @param[in]  len : Size of the output buffer.
+ * @param[out] bw  : Pointer to value which will store number of bytes written.
+ *
+ * @return API status code.
+ */
+rtd_status_t rtd_uri_copy(const rtd_uri_t *uri, char *buf, size_t len, size_t *bw);
+
+/*
+ * @brief This API decodes a well-known Text ("T") record.
+ *
+ * @param[in]  rec  : Pointer to the record.
+ * @param[out] text : Pointer to the decoded text.
+ *
+ * @return API status code.
+ */
+rtd_status_t rtd_text_decode(const ndef_record_t *rec, rtd_text_t *text);
+
+/*
+ * @brief This API validates UTF-8 text.
+ *
+ * Overlong forms, surrogates, code points above U+10FFFF and truncated
+ * sequences are rejected. With AVX2 or SSSE3 blocks of 32 or 16 bytes are
+ * checked with table lookups; SSE2 and other targets skip ASCII runs a
+ * vector or word at a time and check the rest byte by byte. The scan stops
+ * at the first block holding an error.
+ *
+ * @param[in]  buf     : Pointer to the text.
+ * @param[in]  len     : Length of the text in bytes.
+ * @param[out] p_valid : Length of the longest valid prefix, i.e. the offset of the
+ *                       first invalid sequence on error (may be NULL).
+ *
+ * @return API status code.
+ * @retval RTD_E_INVALID_TEXT if the text is not valid UTF-8.
+ */
+rtd_status_t rtd_utf8_validate(const uint8_t *buf, size_t len, size_t *p_valid);
+
+/*
+ * @brief This API converts UTF-16 text to UTF-8.
+ *
+ * Runs of 8 code units that are all ASCII, all 2-byte or (with SSSE3) all
+ * 3-byte in UTF-8 are converted with SSE2 vectors; other runs, including
+ * surrogate pairs, one code unit at a time. Unpaired surrogates are rejected.
+ *
+ * @param[in]  buf           : Pointer to the UTF-16 text, without byte order mark.
+ * @param[in]  len           : Length of the text in bytes.
+ * @param[in]  little_endian : 1 for UTF-16LE, 0 for UTF-16BE.
+ * @param[out] out           : Pointer to the output buffer.
+ * @param[in]  out_len       : Size of the output buffer; RTD_TEXT_UTF8_MAX_SIZE(len) is enough.
+ * @param[out] bw            : Pointer to value which will store number of bytes written.
+ *
+ * @return API status code.
+ * @retval RTD_E_INVALID_TEXT if the text is not valid UTF-16.
+ */
+rtd_status_t rtd_utf16_to_utf8(const uint8_t *buf, size_t len, uint8_t little_endian,
+                               char *out, size_t out_len, size_t *bw);
+
+/*
+ * @brief This API writes the text of a decoded Text record as validated UTF-8.
+ *
+ * UTF-8 text is validated and copied; UTF-16 text is converted, using its
+ * byte order mark if present and big-endian otherwise. The language code must
+ * be printable ASCII. Works straight on the record payload.
+ *
+ * @param[in]  text : Pointer to the decoded text.
+ * @param[out] buf  : Pointer to the output buffer.
+ * @param[in]  len  : Size of the output buffer; RTD_TEXT_UTF8_MAX_SIZE(text->text.len) is enough.
+ * @param[out] bw   : Pointer to value which will store number of bytes written.
+ *
+ * @return API status code.
+ * @retval RTD_E_INVALID_FORMAT if the language code is not printable ASCII.
+ * @retval RTD_E_INVALID_TEXT   if the text is not valid in its encoding.
+ */
+rtd_status_t rtd_text_to_utf8(const rtd_text_t *text, char *buf, size_t len, size_t *bw);
+
+/*
+ * @brief This API decodes a well-known Smart Poster ("Sp") record.
+ *
+ * @param[in]     rec       : Pointer to the record.
+ * @param[in,out] sp        : Pointer to the Smart Poster, with 'titles' and 'max_titles' set.
+ * @param[in]     max_depth : Number of nested Smart Poster levels to follow.
+ *
+ * @return API status code.
+ * @retval RTD_E_DEPTH if nested Smart Posters go deeper than max_depth.
+ */
+rtd_status_t rtd_sp_decode(const ndef_record_t *rec, rtd_smart_poster_t *sp, unsigned max_depth);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* _NFC_RTD_H_ */
+/** @}*/
@@ -0,0 +1,200 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_stats.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_stats.c
+ * @brief Compile-time parser instrumentation.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "nfc_stats.h"
+
+#include <string.h>
+
+#ifdef NFC_STATS
+#include <pthread.h>
+#include <time.h>
+
+NFC_STATS_TLS nfc_stats_t nfc_stats_tls;
+
+static nfc_stats_t     nfc_stats_total;
+static pthread_mutex_t nfc_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * @brief Monotonic time in nanoseconds.
+ */
+uint64_t nfc_stats_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+static const char *const nfc_stats_counter_names[NFC_STATS_COUNTER_CNT] =
+{
+    "tlv_blocks", "tlv_padding_bytes", "tlv_skipped_bytes", "ndef_records",
+    "ndef_short_records", "ndef_long_records", "ndef_messages", "tags"
+};
+
+static const char *const nfc_stats_hist_names[NFC_STATS_HIST_CNT] =
+{
+    "records_per_msg", "tlv_length", "payload_length", "tag_parse_ns"
+};
+
+static const char *const nfc_stats_error_names[NFC_STATS_ERR_CNT] =
+{
+    "tlv_incomplete", "tlv_unknown_type", "tlv_ctrl_length", "ndef_incomplete",
+    "ndef_reserved_tnf", "ndef_truncated_msg", "ndef_mb", "ndef_me", "ndef_index_full",
+    "t2t_bcc", "t2t_cc_magic", "t2t_version", "t2t_tlv_overrun", "t2t_tlv_array_full"
+};
+
+/*
+ * @brief This API copies the counters of the calling thread.
+ */
+void nfc_stats_thread(nfc_stats_t *stats)
+{
+    if(stats == NULL)
+        return;
+
+#ifdef NFC_STATS
+    *stats = nfc_stats_tls;
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+/*
+ * @brief This API adds the counters of the calling thread to the process totals.
+ */
+void nfc_stats_flush(void)
+{
+#ifdef NFC_STATS
+    pthread_mutex_lock(&nfc_stats_lock);
+    nfc_stats_merge(&nfc_stats_total, &nfc_stats_tls);
+    pthread_mutex_unlock(&nfc_stats_lock);
+
+    memset(&nfc_stats_tls, 0, sizeof(nfc_stats_tls));
+#endif
+}
+
+/*
+ * @brief This API flushes the calling thread and copies the process totals.
+ */
+void nfc_stats_global(nfc_stats_t *stats)
+{
+    if(stats == NULL)
+        return;
+
+#ifdef NFC_STATS
+    nfc_stats_flush();
+
+    pthread_mutex_lock(&nfc_stats_lock);
+    *stats = nfc_stats_total;
+    pthread_mutex_unlock(&nfc_stats_lock);
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+/*
+ * @brief This API clears the counters of the calling thread and the process totals.
+ */
+void nfc_stats_reset(void)
+{
+#ifdef NFC_STATS
+    memset(&nfc_stats_tls, 0, sizeof(nfc_stats_tls));
+
+    pthread_mutex_lock(&nfc_stats_lock);
+    memset(&nfc_stats_total, 0, sizeof(nfc_stats_total));
+    pthread_mutex_unlock(&nfc_stats_lock);
+#endif
+}
+
+/*
+ * @brief This API adds one set of counters to another.
+ */
+void nfc_stats_merge(nfc_stats_t *dst, const nfc_stats_t *src)
+{
+    if((dst == NULL) || (src == NULL))
+        return;
+
+    /* The structure is nothing but 64-bit counters. */
+    uint64_t       *d = (uint64_t *)dst;
+    const uint64_t *s = (const uint64_t *)src;
+
+    for(size_t i = 0; i < sizeof(nfc_stats_t) / sizeof(uint64_t); i++)
+        d[i] += s[i];
+}
+
+/*
+ * @brief This API returns the name of an error reason.
+ */
+const char *nfc_stats_error_name(nfc_stats_error_t err)
+{
+    return ((unsigned)err < NFC_STATS_ERR_CNT) ? nfc_stats_error_names[err] : "unknown";
+}
+
+/*
+ * @brief This API writes counters and histograms as a single JSON object.
+ */
+void nfc_stats_print_json(FILE *stream, const nfc_stats_t *stats)
+{
+    if((stream == NULL) || (stats == NULL))
+        return;
+
+    fprintf(stream, "{\"counters\":{");
+    for(size_t i = 0; i < NFC_STATS_COUNTER_CNT; i++)
+        fprintf(stream, "%s\"%s\":%llu", (i != 0) ? "," : "", nfc_stats_counter_names[i],
+                (unsigned long long)stats->counters[i]);
+
+    /* TLV types are sparse: only the ones seen are listed. */
+    fprintf(stream, "},\"tlv_types\":{");
+    for(size_t i = 0, n = 0; i < 256; i++)
+    {
+        if(stats->tlv_types[i] != 0)
+            fprintf(stream, "%s\"0x%02zX\":%llu", (n++ != 0) ? "," : "", i,
+                    (unsigned long long)stats->tlv_types[i]);
+    }
+
+    fprintf(stream, "},\"histograms\":{");
+    for(size_t h = 0; h < NFC_STATS_HIST_CNT; h++)
+    {
+        fprintf(stream, "%s\"%s\":[", (h != 0) ? "," : "", nfc_stats_hist_names[h]);
+        for(size_t b = 0; b < NFC_STATS_HIST_BUCKETS; b++)
+            fprintf(stream, "%s%llu", (b != 0) ? "," : "", (unsigned long long)stats->hists[h][b]);
+        fprintf(stream, "]");
+    }
+
+    fprintf(stream, "},\"errors\":{");
+    for(size_t i = 0; i < NFC_STATS_ERR_CNT; i++)
+        fprintf(stream, "%s\"%s\":%llu", (i != 0) ? "," : "", nfc_stats_error_names[i],
+                (unsigned long long)stats->errors[i]);
+
+    fprintf(stream, "}}\n");
+}
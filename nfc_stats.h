@@ -0,0 +1,227 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_stats.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_stats.h
+ * @brief Compile-time parser instrumentation.
+ */
+
+/*!
+ * @defgroup STATS API
+ */
+#ifndef _NFC_STATS_H_
+#define _NFC_STATS_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Instrumentation is compiled in with -DNFC_STATS, in which case nfc_stats.c
+ * must be linked as well. Without it the hooks below expand to nothing and
+ * the parsers are unchanged; the API functions still link and report zeros.
+ *
+ * Counters are thread-local, so the hooks take no locks and share no cache
+ * lines between threads.
+ */
+
+#define NFC_STATS_HIST_BUCKETS  16  /* Bucket 0 holds 0, bucket n holds [2^(n-1), 2^n), the last is open. */
+
+/*!
+ * @brief Event counters.
+ */
+typedef enum
+{
+    NFC_STATS_TLV_BLOCKS,           /* TLV blocks parsed                      */
+    NFC_STATS_TLV_PADDING_BYTES,    /* NULL TLV bytes skipped                 */
+    NFC_STATS_TLV_SKIPPED_BYTES,    /* Unknown or malformed bytes skipped     */
+    NFC_STATS_NDEF_RECORDS,         /* NDEF records parsed                    */
+    NFC_STATS_NDEF_SHORT_RECORDS,   /* Records with a 1-byte payload length   */
+    NFC_STATS_NDEF_LONG_RECORDS,    /* Records with a 4-byte payload length   */
+    NFC_STATS_NDEF_MESSAGES,        /* NDEF messages indexed                  */
+    NFC_STATS_TAGS,                 /* Type 2 Tag images parsed               */
+    NFC_STATS_COUNTER_CNT
+} nfc_stats_counter_t;
+
+/*!
+ * @brief Log2 histograms.
+ */
+typedef enum
+{
+    NFC_STATS_HIST_RECORDS_PER_MSG, /* Records in each indexed message        */
+    NFC_STATS_HIST_TLV_LENGTH,      /* Length of each TLV value               */
+    NFC_STATS_HIST_PAYLOAD_LENGTH,  /* Length of each NDEF payload            */
+    NFC_STATS_HIST_TAG_PARSE_NS,    /* Latency of type_2_tag_parse()          */
+    NFC_STATS_HIST_CNT
+} nfc_stats_hist_t;
+
+/*!
+ * @brief Reasons behind the status codes returned by the parsers.
+ *
+ * TLV_E_INCOMPLETE and NDEF_E_INCOMPLETE often just mean "read more", so the
+ * INCOMPLETE reasons are counted by the callers for which the truncation is
+ * final, never by the block and record parsers themselves.
+ */
+typedef enum
+{
+    NFC_STATS_ERR_TLV_INCOMPLETE,       /* TLV block cut off by the end of the data       */
+    NFC_STATS_ERR_TLV_UNKNOWN_TYPE,     /* Unknown TLV type byte                          */
+    NFC_STATS_ERR_TLV_CTRL_LENGTH,      /* Control TLV length other than 3                */
+    NFC_STATS_ERR_NDEF_INCOMPLETE,      /* Record cut off by the end of the data          */
+    NFC_STATS_ERR_NDEF_RESERVED_TNF,    /* Record uses the reserved TNF                   */
+    NFC_STATS_ERR_NDEF_TRUNCATED_MSG,   /* Message ends inside a record                   */
+    NFC_STATS_ERR_NDEF_MB,              /* MB flag missing or repeated                    */
+    NFC_STATS_ERR_NDEF_ME,              /* ME flag missing or not on the last record      */
+    NFC_STATS_ERR_NDEF_INDEX_FULL,      /* More records than the index can hold           */
+    NFC_STATS_ERR_T2T_BCC,              /* UID check byte mismatch                        */
+    NFC_STATS_ERR_T2T_CC_MAGIC,         /* CC does not start with 0xE1                    */
+    NFC_STATS_ERR_T2T_VERSION,          /* Unsupported CC major version                   */
+    NFC_STATS_ERR_T2T_TLV_OVERRUN,      /* TLV block runs past the CC data area           */
+    NFC_STATS_ERR_T2T_TLV_ARRAY_FULL,   /* More TLV blocks than the tag descriptor holds  */
+    NFC_STATS_ERR_CNT
+} nfc_stats_error_t;
+
+/*!
+ * @brief Counters and histograms of one thread, or a merge of several.
+ */
+typedef struct
+{
+    uint64_t counters[NFC_STATS_COUNTER_CNT];
+    uint64_t tlv_types[256];
+    uint64_t hists[NFC_STATS_HIST_CNT][NFC_STATS_HIST_BUCKETS];
+    uint64_t errors[NFC_STATS_ERR_CNT];
+} nfc_stats_t;
+
+#ifdef NFC_STATS
+
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define NFC_STATS_TLS   _Thread_local
+#else
+#define NFC_STATS_TLS   __thread
+#endif
+
+extern NFC_STATS_TLS nfc_stats_t nfc_stats_tls;
+
+uint64_t nfc_stats_now_ns(void);
+
+/*
+ * @brief Histogram bucket of a value.
+ */
+static inline unsigned nfc_stats_bucket(uint64_t v)
+{
+    unsigned n = 0;
+
+    while((v != 0) && (n < NFC_STATS_HIST_BUCKETS - 1))
+    {
+        v >>= 1;
+        n++;
+    }
+
+    return n;
+}
+
+#define NFC_STATS_INC(__C__)                (nfc_stats_tls.counters[__C__]++)
+#define NFC_STATS_ADD(__C__, __N__)         (nfc_stats_tls.counters[__C__] += (__N__))
+#define NFC_STATS_TLV_TYPE(__T__)           (nfc_stats_tls.tlv_types[(uint8_t)(__T__)]++)
+#define NFC_STATS_HIST(__H__, __V__)        (nfc_stats_tls.hists[__H__][nfc_stats_bucket(__V__)]++)
+#define NFC_STATS_ERROR(__E__)              (nfc_stats_tls.errors[__E__]++)
+#define NFC_STATS_TIMER_START(__T__)        uint64_t __T__ = nfc_stats_now_ns()
+#define NFC_STATS_TIMER_STOP(__H__, __T__)  NFC_STATS_HIST(__H__, nfc_stats_now_ns() - (__T__))
+
+#else
+
+#define NFC_STATS_INC(__C__)                ((void)0)
+#define NFC_STATS_ADD(__C__, __N__)         ((void)0)
+#define NFC_STATS_TLV_TYPE(__T__)           ((void)0)
+#define NFC_STATS_HIST(__H__, __V__)        ((void)0)
+#define NFC_STATS_ERROR(__E__)              ((void)0)
+#define NFC_STATS_TIMER_START(__T__)
+#define NFC_STATS_TIMER_STOP(__H__, __T__)  ((void)0)
+
+#endif /* NFC_STATS */
+
+/*
+ * @brief This API copies the counters of the calling thread.
+ *
+ * @param[out] stats : Counters not yet flushed by this thread.
+ */
+void nfc_stats_thread(nfc_stats_t *stats);
+
+/*
+ * @brief This API adds the counters of the calling thread to the process
+ * totals and clears them. Worker threads call it before exiting.
+ */
+void nfc_stats_flush(void);
+
+/*
+ * @brief This API flushes the calling thread and copies the process totals.
+ *
+ * @param[out] stats : Totals of every flushed thread.
+ */
+void nfc_stats_global(nfc_stats_t *stats);
+
+/*
+ * @brief This API clears the counters of the calling thread and the process totals.
+ */
+void nfc_stats_reset(void);
+
+/*
+ * @brief This API adds one set of counters to another.
+ *
+ * @param[in,out] dst : Destination.
+ * @param[in]     src : Counters to add.
+ */
+void nfc_stats_merge(nfc_stats_t *dst, const nfc_stats_t *src);
+
+/*
+ * @brief This API returns the name of an error reason.
+ *
+ * @param[in] err : Error reason.
+ *
+ * @return Name, or "unknown".
+ */
+const char *nfc_stats_error_name(nfc_stats_error_t err);
+
+/*
+ * @brief This API writes counters and histograms as a single JSON object.
+ *
+ * @param[in] stream : Output stream.
+ * @param[in] stats  : Counters to export.
+ */
+void nfc_stats_print_json(FILE *stream, const nfc_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* _NFC_STATS_H_ */
+/** @}*/
@@ -0,0 +1,415 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_t2t_emu.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_t2t_emu.c
+ * @brief In-process Type 2 Tag emulator.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "nfc_t2t_emu.h"
+
+#include <string.h>
+#include <time.h>
+
+#define EMU_LOCK_BYTE_0             10      /* Static lock byte 0 (block 2, byte 2)        */
+#define EMU_LOCK_BYTE_1             11      /* Static lock byte 1 (block 2, byte 3)        */
+#define EMU_UID_BLOCKS              2       /* Blocks 0-1 hold the UID                     */
+#define EMU_LOCK_BLOCK              2
+#define EMU_CC_BLOCK                3
+#define EMU_STATIC_BLOCKS           16      /* Blocks covered by the static lock bits      */
+#define EMU_DYN_LOCK_START          (EMU_STATIC_BLOCKS * T2T_BLOCK_SIZE)
+#define EMU_MAX_AREAS               8
+#define EMU_DEFAULT_BYTES_PER_BIT   8       /* Dynamic lock granularity without a Lock Control TLV */
+
+/* Lock byte 0: block-locking bits 0-2, lock bit for the CC (3) and for blocks 4-7 (4-7). */
+#define EMU_BL_CC                   (1 << 0)
+#define EMU_BL_4_9                  (1 << 1)
+#define EMU_BL_10_15                (1 << 2)
+#define EMU_L_CC                    (1 << 3)
+
+/*
+ * @brief Simulate the time on air of a command.
+ */
+static void emu_delay(uint32_t us)
+{
+    if(us == 0)
+        return;
+
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (long)(us % 1000000) * 1000 };
+
+    while(nanosleep(&ts, &ts) != 0)
+        ;
+}
+
+/*
+ * @brief Number of blocks of the current sector.
+ */
+static size_t emu_sector_blocks(const nfc_t2t_emu_t *emu)
+{
+    size_t first = (size_t)emu->sector * NFC_T2T_EMU_SECTOR_BLOCKS;
+    size_t total = emu->size / T2T_BLOCK_SIZE;
+
+    if(first >= total)
+        return 0;
+
+    return (total - first < NFC_T2T_EMU_SECTOR_BLOCKS) ? total - first : NFC_T2T_EMU_SECTOR_BLOCKS;
+}
+
+/*
+ * @brief Check whether a block is write-protected by the static or dynamic lock bits.
+ */
+static int emu_block_locked(const nfc_t2t_emu_t *emu, size_t block)
+{
+    uint8_t lock0 = emu->image[EMU_LOCK_BYTE_0];
+    uint8_t lock1 = emu->image[EMU_LOCK_BYTE_1];
+
+    if(block < EMU_UID_BLOCKS)
+        return 1;
+    if(block == EMU_LOCK_BLOCK)
+        return 0;
+    if(block == EMU_CC_BLOCK)
+        return (lock0 & EMU_L_CC) != 0;
+    if(block < 8)
+        return (lock0 >> block) & 1;
+    if(block < EMU_STATIC_BLOCKS)
+        return (lock1 >> (block - 8)) & 1;
+
+    if((emu->dyn_lock_bits == 0) || (emu->bytes_per_bit == 0))
+        return 0;
+
+    size_t bit = (block * T2T_BLOCK_SIZE - EMU_DYN_LOCK_START) / emu->bytes_per_bit;
+    if(bit >= emu->dyn_lock_bits)
+        return 0;
+
+    return (emu->image[emu->dyn_lock_offset + bit / 8] >> (bit % 8)) & 1;
+}
+
+/*
+ * @brief Apply a WRITE to the static lock bytes. Bits frozen by the block-locking bits are kept.
+ */
+static void emu_write_lock_bytes(nfc_t2t_emu_t *emu, const uint8_t *data)
+{
+    uint8_t lock0   = emu->image[EMU_LOCK_BYTE_0];
+    uint8_t lock1   = emu->image[EMU_LOCK_BYTE_1];
+    uint8_t frozen0 = 0, frozen1 = 0;
+
+    if(lock0 & EMU_BL_CC)
+        frozen0 |= EMU_L_CC;
+    if(lock0 & EMU_BL_4_9)
+    {
+        frozen0 |= 0xF0;
+        frozen1 |= 0x03;
+    }
+    if(lock0 & EMU_BL_10_15)
+        frozen1 |= 0xFC;
+
+    /* Bytes 0-1 of the block (BCC1 and the internal byte) are not writable. */
+    emu->image[EMU_LOCK_BYTE_0] = lock0 | (data[2] & (uint8_t)~frozen0);
+    emu->image[EMU_LOCK_BYTE_1] = lock1 | (data[3] & (uint8_t)~frozen1);
+}
+
+/*
+ * @brief Execute a WRITE with the tag lock held.
+ */
+static nfc_t2t_emu_status_t emu_write_locked(nfc_t2t_emu_t *emu, uint8_t block, const uint8_t *data)
+{
+    if(block >= emu_sector_blocks(emu))
+        return NFC_T2T_EMU_E_NAK;
+
+    size_t abs_block = (size_t)emu->sector * NFC_T2T_EMU_SECTOR_BLOCKS + block;
+
+    if(emu_block_locked(emu, abs_block))
+        return NFC_T2T_EMU_E_NAK;
+
+    uint8_t *dst = emu->image + abs_block * T2T_BLOCK_SIZE;
+
+    if(abs_block == EMU_LOCK_BLOCK)
+    {
+        emu_write_lock_bytes(emu, data);
+    }
+    else if(abs_block == EMU_CC_BLOCK)
+    {
+        /* The CC is one-time programmable. */
+        for(size_t i = 0; i < T2T_BLOCK_SIZE; i++)
+            dst[i] |= data[i];
+    }
+    else
+    {
+        size_t dyn_end = (size_t)emu->dyn_lock_offset + (emu->dyn_lock_bits + 7) / 8;
+
+        for(size_t i = 0; i < T2T_BLOCK_SIZE; i++)
+        {
+            size_t addr = abs_block * T2T_BLOCK_SIZE + i;
+
+            /* Dynamic lock bytes are one-time programmable as well. */
+            if((emu->dyn_lock_bits != 0) && (addr >= emu->dyn_lock_offset) && (addr < dyn_end))
+                dst[i] |= data[i];
+            else
+                dst[i] = data[i];
+        }
+    }
+
+    emu->writes++;
+
+    return NFC_T2T_EMU_OK;
+}
+
+/*
+ * @brief Execute a READ with the tag lock held.
+ */
+static nfc_t2t_emu_status_t emu_read_locked(nfc_t2t_emu_t *emu, uint8_t block, uint8_t *data)
+{
+    size_t blocks = emu_sector_blocks(emu);
+
+    if(block >= blocks)
+        return NFC_T2T_EMU_E_NAK;
+
+    const uint8_t *sector = emu->image + (size_t)emu->sector * NFC_T2T_EMU_SECTOR_BLOCKS * T2T_BLOCK_SIZE;
+
+    /* Reads past the last block roll over to block 0 of the sector. */
+    for(size_t i = 0; i < T2T_READ_SIZE / T2T_BLOCK_SIZE; i++)
+        memcpy(data + i * T2T_BLOCK_SIZE, sector + ((block + i) % blocks) * T2T_BLOCK_SIZE, T2T_BLOCK_SIZE);
+
+    emu->reads++;
+
+    return NFC_T2T_EMU_OK;
+}
+
+/*
+ * @brief Execute SECTOR SELECT packet 2 with the tag lock held.
+ */
+static nfc_t2t_emu_status_t emu_sector_locked(nfc_t2t_emu_t *emu, uint8_t sector)
+{
+    if((size_t)sector * NFC_T2T_EMU_SECTOR_BLOCKS * T2T_BLOCK_SIZE >= emu->size)
+        return NFC_T2T_EMU_E_NAK;
+
+    emu->sector = sector;
+
+    return NFC_T2T_EMU_OK;
+}
+
+/*
+ * @brief This API initialises an emulated tag over a memory image.
+ */
+nfc_t2t_emu_status_t nfc_t2t_emu_init(nfc_t2t_emu_t *emu, uint8_t *image, size_t size,
+                                      type_2_tag_t *tag, const nfc_t2t_emu_latency_t *latency)
+{
+    if((emu == NULL) || (image == NULL) || (tag == NULL) || (size % T2T_BLOCK_SIZE != 0) ||
+       (size < T2T_FIRST_DATA_BLOCK_OFFSET))
+        return NFC_T2T_EMU_E_INVALID_ARGS;
+
+    memset(emu, 0, offsetof(nfc_t2t_emu_t, lock));
+    emu->image = image;
+    emu->size  = size;
+    emu->tag   = tag;
+
+    if(latency != NULL)
+        emu->latency = *latency;
+
+    /* The CC data area must lie inside the memory. */
+    if(size < T2T_FIRST_DATA_BLOCK_OFFSET + (size_t)image[T2T_CC_BLOCK_OFFSET + 2] * T2T_DATA_AREA_SIZE_UNIT)
+        return NFC_T2T_EMU_E_INVALID_DATA;
+
+    if(type_2_tag_parse(tag, image) != T2T_OK)
+        return NFC_T2T_EMU_E_INVALID_DATA;
+
+    type_2_tag_reserved_t areas[EMU_MAX_AREAS];
+    uint8_t               area_cnt = 0;
+
+    type_2_tag_reserved_map(tag, areas, EMU_MAX_AREAS, &area_cnt);
+
+    for(uint8_t i = 0; i < area_cnt; i++)
+    {
+        if((areas[i].type == TLV_LOCK_CONTROL) && (areas[i].offset >= T2T_FIRST_DATA_BLOCK_OFFSET) &&
+           ((size_t)areas[i].offset + areas[i].size <= size))
+        {
+            emu->dyn_lock_offset = areas[i].offset;
+            emu->dyn_lock_bits   = (uint16_t)(areas[i].size * 8);
+            emu->bytes_per_bit   = areas[i].bytes_per_bit;
+            break;
+        }
+    }
+
+    /* Without a Lock Control TLV the dynamic lock bits follow the data area, one per 8 bytes. */
+    uint16_t data_size = tag->cc.data_area_size;
+
+    if((emu->dyn_lock_bits == 0) && (data_size > EMU_DYN_LOCK_START - T2T_FIRST_DATA_BLOCK_OFFSET))
+    {
+        uint16_t bits   = (uint16_t)((data_size - (EMU_DYN_LOCK_START - T2T_FIRST_DATA_BLOCK_OFFSET) + 7) / 8);
+        size_t   offset = T2T_FIRST_DATA_BLOCK_OFFSET + (size_t)data_size;
+
+        if(offset + (bits + 7) / 8 <= size)
+        {
+            emu->dyn_lock_offset = (uint16_t)offset;
+            emu->dyn_lock_bits   = bits;
+            emu->bytes_per_bit   = EMU_DEFAULT_BYTES_PER_BIT;
+        }
+    }
+
+    if(pthread_mutex_init(&emu->lock, NULL) != 0)
+        return NFC_T2T_EMU_E_INVALID_ARGS;
+
+    return NFC_T2T_EMU_OK;
+}
+
+/*
+ * @brief This API releases the resources of an emulated tag.
+ */
+void nfc_t2t_emu_deinit(nfc_t2t_emu_t *emu)
+{
+    if(emu != NULL)
+        pthread_mutex_destroy(&emu->lock);
+}
+
+/*
+ * @brief This API executes a READ command.
+ */
+nfc_t2t_emu_status_t nfc_t2t_emu_read(nfc_t2t_emu_t *emu, uint8_t block, uint8_t *data)
+{
+    if((emu == NULL) || (data == NULL))
+        return NFC_T2T_EMU_E_INVALID_ARGS;
+
+    emu_delay(emu->latency.read_us);
+
+    pthread_mutex_lock(&emu->lock);
+    emu->sector_pending = 0;
+    nfc_t2t_emu_status_t rslt = emu_read_locked(emu, block, data);
+    if(rslt == NFC_T2T_EMU_E_NAK)
+        emu->naks++;
+    pthread_mutex_unlock(&emu->lock);
+
+    return rslt;
+}
+
+/*
+ * @brief This API executes a WRITE command.
+ */
+nfc_t2t_emu_status_t nfc_t2t_emu_write(nfc_t2t_emu_t *emu, uint8_t block, const uint8_t *data)
+{
+    if((emu == NULL) || (data == NULL))
+        return NFC_T2T_EMU_E_INVALID_ARGS;
+
+    emu_delay(emu->latency.write_us);
+
+    pthread_mutex_lock(&emu->lock);
+    emu->sector_pending = 0;
+    nfc_t2t_emu_status_t rslt = emu_write_locked(emu, block, data);
+    if(rslt == NFC_T2T_EMU_E_NAK)
+        emu->naks++;
+    pthread_mutex_unlock(&emu->lock);
+
+    return rslt;
+}
+
+/*
+ * @brief This API executes both packets of a SECTOR SELECT command.
+ */
+nfc_t2t_emu_status_t nfc_t2t_emu_sector_select(nfc_t2t_emu_t *emu, uint8_t sector)
+{
+    if(emu == NULL)
+        return NFC_T2T_EMU_E_INVALID_ARGS;
+
+    emu_delay(emu->latency.sector_us);
+
+    pthread_mutex_lock(&emu->lock);
+    emu->sector_pending = 0;
+    nfc_t2t_emu_status_t rslt = emu_sector_locked(emu, sector);
+    if(rslt == NFC_T2T_EMU_E_NAK)
+        emu->naks++;
+    pthread_mutex_unlock(&emu->lock);
+
+    return rslt;
+}
+
+/*
+ * @brief This API executes a raw command frame (without CRC).
+ */
+nfc_t2t_emu_status_t nfc_t2t_emu_transceive(nfc_t2t_emu_t *emu, const uint8_t *cmd, size_t cmd_len,
+                                            uint8_t *rsp, size_t *rsp_len)
+{
+    if((emu == NULL) || (cmd == NULL) || (rsp == NULL) || (rsp_len == NULL) || (cmd_len == 0))
+        return NFC_T2T_EMU_E_INVALID_ARGS;
+
+    nfc_t2t_emu_status_t rslt = NFC_T2T_EMU_E_NAK;
+    uint8_t              ack  = 0;
+    uint32_t             delay;
+
+    switch(cmd[0])
+    {
+        case NFC_T2T_EMU_CMD_READ:          delay = emu->latency.read_us;   break;
+        case NFC_T2T_EMU_CMD_WRITE:         delay = emu->latency.write_us;  break;
+        default:                            delay = emu->latency.sector_us; break;
+    }
+    emu_delay(delay);
+
+    pthread_mutex_lock(&emu->lock);
+
+    *rsp_len = 0;
+
+    if(emu->sector_pending)
+    {
+        /* Packet 2 of SECTOR SELECT: sector number and 3 bytes RFU, passive ACK. */
+        emu->sector_pending = 0;
+        if(cmd_len == 4)
+            rslt = emu_sector_locked(emu, cmd[0]);
+    }
+    else if((cmd[0] == NFC_T2T_EMU_CMD_READ) && (cmd_len == 2))
+    {
+        rslt = emu_read_locked(emu, cmd[1], rsp);
+        if(rslt == NFC_T2T_EMU_OK)
+            *rsp_len = T2T_READ_SIZE;
+    }
+    else if((cmd[0] == NFC_T2T_EMU_CMD_WRITE) && (cmd_len == 2 + T2T_BLOCK_SIZE))
+    {
+        rslt = emu_write_locked(emu, cmd[1], cmd + 2);
+        ack  = 1;
+    }
+    else if((cmd[0] == NFC_T2T_EMU_CMD_SECTOR_SELECT) && (cmd_len == 2) && (cmd[1] == 0xFF))
+    {
+        emu->sector_pending = 1;
+        rslt = NFC_T2T_EMU_OK;
+        ack  = 1;
+    }
+
+    if(rslt == NFC_T2T_EMU_E_NAK)
+    {
+        emu->naks++;
+        rsp[0]   = NFC_T2T_EMU_NAK;
+        *rsp_len = 1;
+    }
+    else if(ack)
+    {
+        rsp[0]   = NFC_T2T_EMU_ACK;
+        *rsp_len = 1;
+    }
+
+    pthread_mutex_unlock(&emu->lock);
+
+    return rslt;
+}
@@ -0,0 +1,187 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_t2t_emu.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_t2t_emu.h
+ * @brief In-process Type 2 Tag emulator.
+ */
+
+/*!
+ * @defgroup T2T_EMU API
+ */
+#ifndef _NFC_T2T_EMU_H_
+#define _NFC_T2T_EMU_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "type_2_tag.h"
+
+#define NFC_T2T_EMU_CMD_READ            0x30    /* READ: 4 blocks from the given block          */
+#define NFC_T2T_EMU_CMD_WRITE           0xA2    /* WRITE: 1 block                               */
+#define NFC_T2T_EMU_CMD_SECTOR_SELECT   0xC2    /* SECTOR SELECT packet 1 (followed by packet 2) */
+#define NFC_T2T_EMU_ACK                 0x0A    /* 4-bit ACK                                    */
+#define NFC_T2T_EMU_NAK                 0x00    /* 4-bit NAK (invalid argument)                 */
+#define NFC_T2T_EMU_SECTOR_BLOCKS       256     /* Blocks addressable in one sector             */
+
+/*!
+ * @brief Emulator API status codes.
+ */
+typedef enum
+{
+    NFC_T2T_EMU_OK,             /* Command executed                          */
+    NFC_T2T_EMU_E_INVALID_ARGS, /* Invalid function arguments                */
+    NFC_T2T_EMU_E_NAK,          /* Tag answered NAK                          */
+    NFC_T2T_EMU_E_INVALID_DATA  /* Image does not hold a valid Type 2 Tag    */
+} nfc_t2t_emu_status_t;
+
+/*!
+ * @brief Simulated time on air of each command, in microseconds.
+ */
+typedef struct
+{
+    uint32_t read_us;   /* READ          */
+    uint32_t write_us;  /* WRITE         */
+    uint32_t sector_us; /* SECTOR SELECT */
+} nfc_t2t_emu_latency_t;
+
+/*!
+ * @brief Emulated tag.
+ *
+ * The tag serves commands from a caller-owned memory image and applies
+ * WRITE commands to it in place. Every tag has its own mutex, so any number
+ * of tags can be driven from any number of threads.
+ */
+typedef struct
+{
+    uint8_t               *image;           /* Tag memory, from block 0                  */
+    size_t                size;             /* Size of the memory in bytes               */
+    type_2_tag_t          *tag;             /* Descriptor parsed from the image at init  */
+    nfc_t2t_emu_latency_t latency;          /* Simulated command latency                 */
+    uint16_t              dyn_lock_offset;  /* Dynamic lock bytes (0 if none)            */
+    uint16_t              dyn_lock_bits;    /* Number of dynamic lock bits               */
+    uint16_t              bytes_per_bit;    /* Bytes locked by each dynamic lock bit     */
+    uint8_t               sector;           /* Current sector                            */
+    uint8_t               sector_pending;   /* Set between the two SECTOR SELECT packets */
+    uint32_t              reads;            /* READ commands served                      */
+    uint32_t              writes;           /* WRITE commands applied                    */
+    uint32_t              naks;             /* Commands answered with NAK                */
+    pthread_mutex_t       lock;             /* Serialises commands to this tag           */
+} nfc_t2t_emu_t;
+
+/*
+ * @brief This API initialises an emulated tag over a memory image.
+ *
+ * The image is parsed into 'tag' (see type_2_tag_parse()) and a Lock Control
+ * TLV, if any, sets up the dynamic lock bits.
+ *
+ * @param[out] emu     : Emulated tag.
+ * @param[in]  image   : Tag memory from block 0, a whole number of blocks; modified by WRITE.
+ * @param[in]  size    : Size of the memory in bytes.
+ * @param[out] tag     : Descriptor receiving the parsed image.
+ * @param[in]  latency : Simulated latency, or NULL for none.
+ *
+ * @return API status code.
+ */
+nfc_t2t_emu_status_t nfc_t2t_emu_init(nfc_t2t_emu_t *emu, uint8_t *image, size_t size,
+                                      type_2_tag_t *tag, const nfc_t2t_emu_latency_t *latency);
+
+/*
+ * @brief This API releases the resources of an emulated tag.
+ *
+ * @param[in,out] emu : Emulated tag.
+ */
+void nfc_t2t_emu_deinit(nfc_t2t_emu_t *emu);
+
+/*
+ * @brief This API executes a READ command.
+ *
+ * Reads past the last block of the sector roll over to block 0, as on NTAG.
+ *
+ * @param[in,out] emu   : Emulated tag.
+ * @param[in]     block : Block number in the current sector.
+ * @param[out]    data  : T2T_READ_SIZE bytes.
+ *
+ * @return API status code.
+ */
+nfc_t2t_emu_status_t nfc_t2t_emu_read(nfc_t2t_emu_t *emu, uint8_t block, uint8_t *data);
+
+/*
+ * @brief This API executes a WRITE command.
+ *
+ * Blocks 0-1 are read-only. Lock bytes and the CC are one-time programmable:
+ * written bits are ORed in. Blocks locked by the static or dynamic lock bits
+ * answer NAK.
+ *
+ * @param[in,out] emu   : Emulated tag.
+ * @param[in]     block : Block number in the current sector.
+ * @param[in]     data  : T2T_BLOCK_SIZE bytes.
+ *
+ * @return API status code.
+ */
+nfc_t2t_emu_status_t nfc_t2t_emu_write(nfc_t2t_emu_t *emu, uint8_t block, const uint8_t *data);
+
+/*
+ * @brief This API executes both packets of a SECTOR SELECT command.
+ *
+ * @param[in,out] emu    : Emulated tag.
+ * @param[in]     sector : Sector to select.
+ *
+ * @return API status code.
+ */
+nfc_t2t_emu_status_t nfc_t2t_emu_sector_select(nfc_t2t_emu_t *emu, uint8_t sector);
+
+/*
+ * @brief This API executes a raw command frame (without CRC).
+ *
+ * READ answers 16 bytes, WRITE and both SECTOR SELECT packets answer an ACK,
+ * except packet 2 which is passively acknowledged (no answer). Invalid
+ * commands answer a NAK.
+ *
+ * @param[in,out] emu      : Emulated tag.
+ * @param[in]     cmd      : Command frame.
+ * @param[in]     cmd_len  : Length of the command frame.
+ * @param[out]    rsp      : Response buffer of at least T2T_READ_SIZE bytes.
+ * @param[out]    rsp_len  : Length of the response.
+ *
+ * @return API status code.
+ */
+nfc_t2t_emu_status_t nfc_t2t_emu_transceive(nfc_t2t_emu_t *emu, const uint8_t *cmd, size_t cmd_len,
+                                            uint8_t *rsp, size_t *rsp_len);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* _NFC_T2T_EMU_H_ */
+/** @}*/
@@ -0,0 +1,239 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_tag_cache.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_tag_cache.c
+ * @brief UID-keyed cache of parsed tag images.
+ */
+#include "nfc_tag_cache.h"
+
+#include <string.h>
+
+#define NFC_TAG_CACHE_KEY_VALID     (1ULL << 56)            /* Keeps packed keys non-zero. */
+#define NFC_TAG_CACHE_MIX           0x9E3779B97F4A7C15ULL   /* 64-bit golden ratio.        */
+#define NFC_TAG_CACHE_FP_OFFSET     8                       /* First fingerprinted byte.   */
+
+/*
+ * @brief Pack the UID bytes of a raw image the same way as nfc_tag_cache_key().
+ */
+static uint64_t nfc_tag_cache_raw_key(const uint8_t *raw)
+{
+    return NFC_TAG_CACHE_KEY_VALID |
+           ((uint64_t)raw[0] << 48) | ((uint64_t)raw[1] << 40) | ((uint64_t)raw[2] << 32) |
+           ((uint64_t)raw[4] << 24) | ((uint64_t)raw[5] << 16) | ((uint64_t)raw[6] << 8) | raw[7];
+}
+
+/*
+ * @brief Index of the first entry of the set holding a key.
+ */
+static size_t nfc_tag_cache_set(const nfc_tag_cache_t *cache, uint64_t key)
+{
+    /* Fold the UID halves together, then take the well-mixed high bits of the product. */
+    uint64_t h = (key ^ (key >> 32)) * NFC_TAG_CACHE_MIX;
+
+    return (size_t)((h >> 32) & (cache->set_cnt - 1)) * NFC_TAG_CACHE_WAYS;
+}
+
+/*
+ * @brief Fill a view from a slot.
+ */
+static void nfc_tag_cache_view(const nfc_tag_cache_t *cache, size_t n, nfc_tag_cache_view_t *view)
+{
+    nfc_tag_cache_slot_t *slot = &cache->slots[n];
+
+    view->image       = cache->image_storage + n * cache->max_image_size;
+    view->image_len   = slot->image_len;
+    view->tlvs        = cache->tlv_storage + n * cache->max_tlvs;
+    view->tlv_cnt     = slot->tlv_cnt;
+    view->ndef_status = slot->ndef_status;
+    view->ndef        = &slot->ndef;
+}
+
+nfc_tag_cache_status_t nfc_tag_cache_init(nfc_tag_cache_t *cache)
+{
+    if((cache == NULL) || (cache->set_cnt == 0) || ((cache->set_cnt & (cache->set_cnt - 1)) != 0) ||
+       (cache->entries == NULL) || (cache->stamps == NULL) || (cache->slots == NULL) ||
+       (cache->image_storage == NULL) || (cache->max_image_size < NFC_TAG_CACHE_PROBE_SIZE) ||
+       ((cache->tlv_storage == NULL) && (cache->max_tlvs != 0)) ||
+       ((cache->index_storage == NULL) && (cache->max_records != 0)))
+        return NFC_TAG_CACHE_E_INVALID_ARGS;
+
+    size_t slot_cnt = (size_t)cache->set_cnt * NFC_TAG_CACHE_WAYS;
+
+    memset(cache->entries, 0, slot_cnt * sizeof(*cache->entries));
+    memset(cache->stamps, 0, slot_cnt * sizeof(*cache->stamps));
+    cache->clock = 0;
+
+    return NFC_TAG_CACHE_OK;
+}
+
+uint64_t nfc_tag_cache_key(const type_2_tag_serial_number_t *sn)
+{
+    return NFC_TAG_CACHE_KEY_VALID |
+           ((uint64_t)sn->manufacturer_id << 48) |
+           ((uint64_t)sn->serial_number_part_1 << 32) |
+           sn->serial_number_part_2;
+}
+
+uint64_t nfc_tag_cache_fingerprint(const uint8_t *probe)
+{
+    uint64_t h = 0;
+
+    /* Internal byte, lock bytes, CC and blocks 4-7 as three 64-bit words. */
+    for(size_t i = NFC_TAG_CACHE_FP_OFFSET; i < NFC_TAG_CACHE_PROBE_SIZE; i += sizeof(uint64_t))
+    {
+        uint64_t w;
+        memcpy(&w, probe + i, sizeof(w));
+        h = (h ^ w) * NFC_TAG_CACHE_MIX;
+        h ^= h >> 29;
+    }
+
+    h ^= h >> 32;
+    h *= NFC_TAG_CACHE_MIX;
+    h ^= h >> 29;
+
+    return h;
+}
+
+nfc_tag_cache_status_t nfc_tag_cache_lookup(nfc_tag_cache_t *cache, const uint8_t *probe,
+                                            nfc_tag_cache_view_t *view)
+{
+    if((cache == NULL) || (probe == NULL) || (view == NULL))
+        return NFC_TAG_CACHE_E_INVALID_ARGS;
+
+    uint64_t              key      = nfc_tag_cache_raw_key(probe);
+    size_t                set      = nfc_tag_cache_set(cache, key);
+    nfc_tag_cache_entry_t *entries = cache->entries + set;
+
+    for(size_t way = 0; way < NFC_TAG_CACHE_WAYS; way++)
+    {
+        if(entries[way].key != key)
+            continue;
+
+        if(entries[way].fingerprint != nfc_tag_cache_fingerprint(probe))
+        {
+            entries[way].key = 0;
+            return NFC_TAG_CACHE_E_STALE;
+        }
+
+        cache->stamps[set + way] = ++cache->clock;
+        nfc_tag_cache_view(cache, set + way, view);
+        return NFC_TAG_CACHE_OK;
+    }
+
+    return NFC_TAG_CACHE_E_MISS;
+}
+
+nfc_tag_cache_status_t nfc_tag_cache_insert(nfc_tag_cache_t *cache, const uint8_t *image, size_t len,
+                                            nfc_tag_cache_view_t *view)
+{
+    if((cache == NULL) || (image == NULL) || (view == NULL) || (len < NFC_TAG_CACHE_PROBE_SIZE))
+        return NFC_TAG_CACHE_E_INVALID_ARGS;
+
+    /* The CC data area size must fit inside the image span. */
+    if(len < T2T_FIRST_DATA_BLOCK_OFFSET + (size_t)image[T2T_CC_BLOCK_OFFSET + 2] * T2T_DATA_AREA_SIZE_UNIT)
+        return NFC_TAG_CACHE_E_INVALID_DATA;
+
+    if(len > cache->max_image_size)
+        return NFC_TAG_CACHE_E_NO_MEM;
+
+    uint64_t              key      = nfc_tag_cache_raw_key(image);
+    size_t                set      = nfc_tag_cache_set(cache, key);
+    nfc_tag_cache_entry_t *entries = cache->entries + set;
+    size_t                victim   = 0;
+
+    /* Reuse the entry of the same tag, else an empty one, else the least recently used. */
+    for(size_t way = 0; way < NFC_TAG_CACHE_WAYS; way++)
+    {
+        if(entries[way].key == key)
+        {
+            victim = way;
+            break;
+        }
+
+        if((entries[victim].key != 0) &&
+           ((entries[way].key == 0) || (cache->stamps[set + way] < cache->stamps[set + victim])))
+            victim = way;
+    }
+
+    size_t               n        = set + victim;
+    nfc_tag_cache_slot_t *slot    = &cache->slots[n];
+    uint8_t              *copy    = cache->image_storage + n * cache->max_image_size;
+    tlv_t                *tlvs    = cache->tlv_storage + n * cache->max_tlvs;
+    uint32_t             *idx_mem = cache->index_storage + n * NDEF_INDEX_STORAGE_WORDS((size_t)cache->max_records);
+
+    entries[victim].key = 0;
+    memcpy(copy, image, len);
+
+    type_2_tag_t tag =
+    {
+        .max_tlv_blocks    = cache->max_tlvs,
+        .p_tlv_block_array = tlvs,
+        .tlv_count         = 0
+    };
+
+    type_2_tag_status_t rslt = type_2_tag_parse(&tag, copy);
+    if(rslt != T2T_OK)
+        return (rslt == T2T_E_NO_MEM) ? NFC_TAG_CACHE_E_NO_MEM : NFC_TAG_CACHE_E_INVALID_DATA;
+
+    slot->image_len   = (uint16_t)len;
+    slot->tlv_cnt     = tag.tlv_count;
+    slot->ndef_status = NDEF_E_NOT_FOUND;
+    ndef_index_init(&slot->ndef, idx_mem, cache->max_records);
+
+    for(uint16_t i = 0; i < tag.tlv_count; i++)
+    {
+        if(tlvs[i].type == TLV_NDEF_MESSAGE)
+        {
+            slot->ndef_status = ndef_index_build(&slot->ndef, tlvs[i].value, tlvs[i].length);
+            break;
+        }
+    }
+
+    entries[victim].key         = key;
+    entries[victim].fingerprint = nfc_tag_cache_fingerprint(copy);
+    cache->stamps[n]            = ++cache->clock;
+
+    nfc_tag_cache_view(cache, n, view);
+
+    return NFC_TAG_CACHE_OK;
+}
+
+void nfc_tag_cache_remove(nfc_tag_cache_t *cache, uint64_t key)
+{
+    if(cache == NULL)
+        return;
+
+    nfc_tag_cache_entry_t *entries = cache->entries + nfc_tag_cache_set(cache, key);
+
+    for(size_t way = 0; way < NFC_TAG_CACHE_WAYS; way++)
+    {
+        if(entries[way].key == key)
+            entries[way].key = 0;
+    }
+}
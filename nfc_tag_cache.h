@@ -0,0 +1,198 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_tag_cache.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_tag_cache.h
+ * @brief UID-keyed cache of parsed tag images.
+ */
+
+/*!
+ * @defgroup TAG_CACHE API
+ */
+#ifndef _NFC_TAG_CACHE_H_
+#define _NFC_TAG_CACHE_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "nfc_ndef.h"
+#include "nfc_tlv_block.h"
+#include "type_2_tag.h"
+
+#define NFC_TAG_CACHE_WAYS          4   /* Entries per set; one set fills a 64-byte cache line. */
+
+/* Bytes read on re-tap: blocks 0-3 (UID, lock bytes, CC) and the first data area READ. */
+#define NFC_TAG_CACHE_PROBE_SIZE    (T2T_FIRST_DATA_BLOCK_OFFSET + T2T_READ_SIZE)
+
+/*!
+ * @brief Tag cache API status codes.
+ */
+typedef enum
+{
+    NFC_TAG_CACHE_OK,               /* Success (cache hit on lookup)                     */
+    NFC_TAG_CACHE_E_INVALID_ARGS,   /* Invalid function arguments                        */
+    NFC_TAG_CACHE_E_MISS,           /* No entry for the UID                              */
+    NFC_TAG_CACHE_E_STALE,          /* Entry found but the fingerprint changed (dropped) */
+    NFC_TAG_CACHE_E_NO_MEM,         /* Image or parse result does not fit a slot         */
+    NFC_TAG_CACHE_E_INVALID_DATA    /* Image could not be parsed                         */
+} nfc_tag_cache_status_t;
+
+/*!
+ * @brief Hot part of a cache entry, compared on every lookup.
+ */
+typedef struct
+{
+    uint64_t key;           /* Packed 7-byte UID, 0 if the entry is empty  */
+    uint64_t fingerprint;   /* Fingerprint of the probe bytes              */
+} nfc_tag_cache_entry_t;
+
+/*!
+ * @brief Cold part of a cache entry: the image copy and its parse result.
+ */
+typedef struct
+{
+    uint16_t      image_len;    /* Length of the cached image          */
+    uint16_t      tlv_cnt;      /* Number of TLV blocks                */
+    ndef_status_t ndef_status;  /* Result of indexing the first NDEF   */
+    ndef_index_t  ndef;         /* Index of the first NDEF message     */
+} nfc_tag_cache_slot_t;
+
+/*!
+ * @brief Parse result returned on a hit or after an insert.
+ *
+ * The pointers refer to the cache storage and stay valid until the entry is
+ * evicted or dropped. An NDEF message split by a reserved area is not indexed
+ * (NDEF_E_INVALID_ARGS); read it from 'image' with type_2_tag_ndef_copy().
+ */
+typedef struct
+{
+    uint8_t            *image;       /* Cached image, from block 0       */
+    size_t             image_len;    /* Length of the image              */
+    const tlv_t        *tlvs;        /* TLV blocks (NULL excluded)       */
+    uint16_t           tlv_cnt;      /* Number of TLV blocks             */
+    ndef_status_t      ndef_status;  /* Result of indexing the first NDEF */
+    const ndef_index_t *ndef;        /* Index of the first NDEF message  */
+} nfc_tag_cache_view_t;
+
+/*!
+ * @brief Caller storage for the cache, sliced per slot.
+ *
+ * The number of slots is set_cnt * NFC_TAG_CACHE_WAYS.
+ */
+typedef struct
+{
+    uint32_t              set_cnt;        /* Number of sets, a power of two                      */
+    uint16_t              max_image_size; /* Bytes reserved per slot for the image               */
+    uint16_t              max_tlvs;       /* TLV blocks reserved per slot                        */
+    uint32_t              max_records;    /* NDEF records reserved per slot                      */
+    nfc_tag_cache_entry_t *entries;       /* One per slot, ideally 64-byte aligned               */
+    uint32_t              *stamps;        /* One LRU stamp per slot                              */
+    nfc_tag_cache_slot_t  *slots;         /* One per slot                                        */
+    uint8_t               *image_storage; /* slot count * max_image_size bytes                   */
+    tlv_t                 *tlv_storage;   /* slot count * max_tlvs entries                       */
+    uint32_t              *index_storage; /* slot count * NDEF_INDEX_STORAGE_WORDS(max_records)  */
+    uint32_t              clock;          /* LRU clock, set by nfc_tag_cache_init()              */
+} nfc_tag_cache_t;
+
+/*
+ * @brief This API initializes a cache over caller storage and empties it.
+ *
+ * @param[in,out] cache : Cache with its storage fields set.
+ *
+ * @return API status code.
+ */
+nfc_tag_cache_status_t nfc_tag_cache_init(nfc_tag_cache_t *cache);
+
+/*
+ * @brief This API packs the 7-byte UID of a tag into a cache key.
+ *
+ * @param[in] sn : Serial number decoded from the tag.
+ *
+ * @return Cache key (never 0).
+ */
+uint64_t nfc_tag_cache_key(const type_2_tag_serial_number_t *sn);
+
+/*
+ * @brief This API computes the fingerprint of the probe bytes of a tag.
+ *
+ * The fingerprint covers the lock bytes, the CC and the first 16 bytes of the
+ * data area, which hold the TLV lengths and the start of the NDEF message.
+ * A rewrite that keeps all of those bytes goes unnoticed.
+ *
+ * @param[in] probe : NFC_TAG_CACHE_PROBE_SIZE bytes from block 0.
+ *
+ * @return Fingerprint.
+ */
+uint64_t nfc_tag_cache_fingerprint(const uint8_t *probe);
+
+/*
+ * @brief This API looks up a tag from its probe bytes.
+ *
+ * A stale entry is dropped, so the caller reads and inserts the full image.
+ *
+ * @param[in,out] cache : Cache.
+ * @param[in]     probe : NFC_TAG_CACHE_PROBE_SIZE bytes from block 0.
+ * @param[out]    view  : Cached parse result on a hit.
+ *
+ * @return API status code.
+ */
+nfc_tag_cache_status_t nfc_tag_cache_lookup(nfc_tag_cache_t *cache, const uint8_t *probe,
+                                            nfc_tag_cache_view_t *view);
+
+/*
+ * @brief This API parses a full tag image and stores it, evicting the least
+ * recently used entry of its set if needed.
+ *
+ * @param[in,out] cache : Cache.
+ * @param[in]     image : Raw image from block 0.
+ * @param[in]     len   : Length of the image.
+ * @param[out]    view  : Parse result stored in the cache.
+ *
+ * @return API status code.
+ */
+nfc_tag_cache_status_t nfc_tag_cache_insert(nfc_tag_cache_t *cache, const uint8_t *image, size_t len,
+                                            nfc_tag_cache_view_t *view);
+
+/*
+ * @brief This API drops the entry of a tag, if any.
+ *
+ * @param[in,out] cache : Cache.
+ * @param[in]     key   : Cache key from nfc_tag_cache_key().
+ */
+void nfc_tag_cache_remove(nfc_tag_cache_t *cache, uint64_t key);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* _NFC_TAG_CACHE_H_ */
+/** @}*/
@@ -31,16 +31,44 @@
  * @brief Utility tools for TLV format.
  */
 #include "nfc_tlv_block.h"
+#include "nfc_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+/*
+ * @brief Count trailing zero bits of a non-zero value.
+ */
+static inline unsigned tlv_ctz32(uint32_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(v);
+#else
+    unsigned n = 0;
+    while((v & 1) == 0) { v >>= 1; n++; }
+    return n;
+#endif
+}
 
 /*
  * @brief This API parses the next TLV block found in the byte-buffer.
  */
-tlv_status_t t2t_parse_next_tlv(uint8_t *buf, tlv_t *tlv, size_t *br)
+tlv_status_t t2t_parse_next_tlv(uint8_t *buf, size_t len, tlv_t *tlv, size_t *br)
 {
     if((buf == NULL) || (tlv == NULL) || (br == NULL))
         return TLV_E_INVALID_ARGS;
 
+    if(len < TLV_T_LENGTH)
+        return TLV_E_INCOMPLETE;
+
     uint8_t *buf_start = buf;
+    uint8_t *buf_end   = buf + len;
 
     if((*buf == TLV_NULL) || (*buf == TLV_TERMINATOR))
     {
@@ -50,9 +78,17 @@ tlv_status_t t2t_parse_next_tlv(uint8_t *buf, tlv_t *tlv, size_t *br)
     }
     else if((*buf == TLV_LOCK_CONTROL) || (*buf == TLV_MEMORY_CONTROL))
     {
+        if(len < TLV_T_LENGTH + TLV_L_SHORT_LENGTH)
+            return TLV_E_INCOMPLETE;
+
         /* Length field should equal 3 for LOCK CONTROL and MEMORY CONTROL blocks. */
         if(buf[1] != TLV_LOCK_MEMORY_CTRL_LEN)
+        {
+            NFC_STATS_ERROR(NFC_STATS_ERR_TLV_CTRL_LENGTH);
+            NFC_STATS_ADD(NFC_STATS_TLV_SKIPPED_BYTES, 1);
+            *br = 1;
             return TLV_E_NOT_FOUND;
+        }
 
         tlv->type   = *buf++;
         tlv->length = *buf++;
@@ -60,13 +96,19 @@ tlv_status_t t2t_parse_next_tlv(uint8_t *buf, tlv_t *tlv, size_t *br)
     }
     else if((*buf == TLV_NDEF_MESSAGE) || (*buf == TLV_PROPRIETARY))
     {
+        if(len < TLV_T_LENGTH + TLV_L_SHORT_LENGTH)
+            return TLV_E_INCOMPLETE;
+
         tlv->type = *buf++;
 
-        if (*buf == 0xFF)
+        if (*buf == TLV_L_FORMAT_FLAG)
         {
+            if(len < TLV_T_LENGTH + TLV_L_LONG_LENGTH)
+                return TLV_E_INCOMPLETE;
+
             /* Long record? */
             tlv->length = ((*(buf + 1) << 8) & 0xFF00) | *(buf + 2);
-            buf += 3;
+            buf += TLV_L_LONG_LENGTH;
         }
         else
         {
@@ -78,12 +120,212 @@ tlv_status_t t2t_parse_next_tlv(uint8_t *buf, tlv_t *tlv, size_t *br)
     }
     else
     {
+        NFC_STATS_ERROR(NFC_STATS_ERR_TLV_UNKNOWN_TYPE);
+        NFC_STATS_ADD(NFC_STATS_TLV_SKIPPED_BYTES, 1);
         *br = 1;
         return TLV_E_NOT_FOUND;
     }
+
+    /* Value field must lie entirely within the buffer. */
+    if(tlv->length > (size_t)(buf_end - buf))
+        return TLV_E_INCOMPLETE;
     
     buf += tlv->length;
-    *br = buf_start - buf;
+    *br = buf - buf_start;
+
+    NFC_STATS_INC(NFC_STATS_TLV_BLOCKS);
+    NFC_STATS_TLV_TYPE(tlv->type);
+    NFC_STATS_HIST(NFC_STATS_HIST_TLV_LENGTH, tlv->length);
     
     return TLV_OK;
-}
\ No newline at end of file
+}
+
+/*
+ * @brief This API writes the type and length fields of a TLV block.
+ */
+tlv_status_t tlv_encode_header(uint8_t type, size_t length, uint8_t *buf, size_t len, size_t *bw)
+{
+    if((buf == NULL) || (bw == NULL) || (length >= 0xFFFF))
+        return TLV_E_INVALID_ARGS;
+
+    size_t header_len = TLV_T_LENGTH + ((length < TLV_L_FORMAT_FLAG) ? TLV_L_SHORT_LENGTH : TLV_L_LONG_LENGTH);
+
+    if(len < header_len)
+        return TLV_E_NO_MEM;
+
+    buf[0] = type;
+
+    if(length < TLV_L_FORMAT_FLAG)
+    {
+        buf[1] = (uint8_t)length;
+    }
+    else
+    {
+        buf[1] = TLV_L_FORMAT_FLAG;
+        buf[2] = (uint8_t)(length >> 8);
+        buf[3] = (uint8_t)length;
+    }
+
+    *bw = header_len;
+
+    return TLV_OK;
+}
+
+/*
+ * @brief Length of the run of NULL bytes at the start of the buffer.
+ */
+static inline size_t tlv_null_run(const uint8_t *buf, size_t len)
+{
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i zero32 = _mm256_setzero_si256();
+    for(; i + 32 <= len; i += 32)
+    {
+        __m256i  v    = _mm256_loadu_si256((const __m256i *)(buf + i));
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero32));
+        if(mask != 0)
+            return i + tlv_ctz32(mask);
+    }
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero16 = _mm_setzero_si128();
+    for(; i + 16 <= len; i += 16)
+    {
+        __m128i  v    = _mm_loadu_si128((const __m128i *)(buf + i));
+        uint32_t mask = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero16)) & 0xFFFF;
+        if(mask != 0)
+            return i + tlv_ctz32(mask);
+    }
+#endif
+
+    /* Portable path: compare a word at a time, then finish byte by byte. */
+    for(; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t))
+    {
+        uint64_t w;
+        memcpy(&w, buf + i, sizeof(w));
+        if(w != 0)
+            break;
+    }
+
+    while((i < len) && (buf[i] == TLV_NULL))
+        i++;
+
+    return i;
+}
+
+/*
+ * @brief This API returns the length of the run of NULL TLV blocks at the start of the buffer.
+ */
+size_t tlv_skip_null(const uint8_t *buf, size_t len)
+{
+    if(buf == NULL)
+        return 0;
+
+    size_t run = tlv_null_run(buf, len);
+
+    NFC_STATS_ADD(NFC_STATS_TLV_PADDING_BYTES, run);
+
+    return run;
+}
+
+/*
+ * @brief This API initialises a streaming TLV decoder.
+ */
+tlv_status_t tlv_stream_init(tlv_stream_t *ctx, uint8_t *buf, size_t size)
+{
+    if((ctx == NULL) || (buf == NULL))
+        return TLV_E_INVALID_ARGS;
+
+    ctx->buf  = buf;
+    ctx->size = size;
+    ctx->fill = 0;
+    ctx->pos  = 0;
+    ctx->done = 0;
+
+    return TLV_OK;
+}
+
+/*
+ * @brief This API appends a chunk of tag memory to the decoder.
+ */
+tlv_status_t tlv_stream_feed(tlv_stream_t *ctx, const uint8_t *chunk, size_t len)
+{
+    if((ctx == NULL) || (chunk == NULL))
+        return TLV_E_INVALID_ARGS;
+
+    if(len > ctx->size - ctx->fill)
+        return TLV_E_NO_MEM;
+
+    /* Reader may have written the chunk straight into the storage. */
+    if(chunk != ctx->buf + ctx->fill)
+        memmove(ctx->buf + ctx->fill, chunk, len);
+
+    ctx->fill += len;
+
+    return TLV_OK;
+}
+
+/*
+ * @brief This API returns the next complete TLV block from the decoder.
+ */
+tlv_status_t tlv_stream_next(tlv_stream_t *ctx, tlv_t *tlv)
+{
+    if((ctx == NULL) || (tlv == NULL))
+        return TLV_E_INVALID_ARGS;
+
+    if(ctx->done)
+        return TLV_E_END;
+
+    ctx->pos += tlv_skip_null(ctx->buf + ctx->pos, ctx->fill - ctx->pos);
+
+    size_t br = 0;
+    tlv_status_t rslt = t2t_parse_next_tlv(ctx->buf + ctx->pos, ctx->fill - ctx->pos, tlv, &br);
+
+    if(rslt == TLV_OK)
+    {
+        if(tlv->type == TLV_TERMINATOR)
+            ctx->done = 1;
+    }
+    else if(rslt != TLV_E_NOT_FOUND)
+    {
+        /* Incomplete block: keep position and wait for more data. */
+        return rslt;
+    }
+
+    /* Invalid bytes are skipped so the caller may carry on decoding. */
+    ctx->pos += br;
+
+    return rslt;
+}
+
+/*
+ * @brief This API prints the type, length and value of a TLV block.
+ */
+void t2t_print_tlv(tlv_t *tlv)
+{
+    if(tlv == NULL)
+        return;
+
+    const char *name;
+
+    switch(tlv->type)
+    {
+        case TLV_NULL:           name = "NULL";           break;
+        case TLV_LOCK_CONTROL:   name = "LOCK CONTROL";   break;
+        case TLV_MEMORY_CONTROL: name = "MEMORY CONTROL"; break;
+        case TLV_NDEF_MESSAGE:   name = "NDEF MESSAGE";   break;
+        case TLV_PROPRIETARY:    name = "PROPRIETARY";    break;
+        case TLV_TERMINATOR:     name = "TERMINATOR";     break;
+        default:                 name = "UNKNOWN";        break;
+    }
+
+    printf("TLV: TYPE 0x%02X (%s), LENGTH %lu\n", tlv->type, name, (unsigned long)tlv->length);
+
+    if(tlv->value == NULL)
+        return;
+
+    for(size_t i = 0; i < tlv->length; i++)
+        printf((((i + 1) % 16) == 0 || (i + 1 == tlv->length)) ? "%02X\n" : "%02X ", tlv->value[i]);
+}
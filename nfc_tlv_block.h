@@ -57,9 +57,12 @@ extern "C" {
  */
 typedef enum 
 {
-    TLV_OK,             /* Success                    */
-    TLV_E_NOT_FOUND,     /* No TLV found by parser     */
-    TLV_E_INVALID_ARGS, /* Invalid function arguments */
+    TLV_OK,             /* Success                         */
+    TLV_E_NOT_FOUND,     /* No TLV found by parser          */
+    TLV_E_INVALID_ARGS, /* Invalid function arguments      */
+    TLV_E_INCOMPLETE,   /* TLV block continues past buffer */
+    TLV_E_NO_MEM,       /* Stream storage is full          */
+    TLV_E_END,          /* Stream finished at TERMINATOR   */
 } tlv_status_t;
 
 /*!
@@ -85,16 +88,110 @@ typedef struct
     uint8_t *value; /* Pointer to the value field (NULL if no value field is present) */
 } tlv_t;
 
+/*!
+ * @brief Streaming TLV decoder context.
+ *
+ * Tag memory is fed in arbitrary sized chunks (e.g. the 16 bytes returned by a
+ * Type 2 Tag READ command) and TLV blocks are emitted as soon as their header
+ * and value field are complete. The fed bytes are kept in caller-owned storage
+ * so the emitted TLV value pointers stay valid for the lifetime of the storage.
+ */
+typedef struct
+{
+    uint8_t *buf;   /* Storage holding the bytes fed so far          */
+    size_t  size;   /* Capacity of the storage                       */
+    size_t  fill;   /* Number of valid bytes in the storage          */
+    size_t  pos;    /* Offset of the next TLV block to decode        */
+    uint8_t done;   /* Set once the TERMINATOR block has been decoded */
+} tlv_stream_t;
+
 /*
  * @brief This API parses the next TLV block found in the byte-buffer.
  * 
  * @param[in]  buf : Pointer to byte buffer containing TLV data.
+ * @param[in]  len : Number of valid bytes in the buffer.
  * @param[out] tlv : Pointer to structure that will be filled with parsed data.
  * @param[out] br  : Pointer to value which will store number of bytes read.
  *
  * @return API status code.
+ * @retval TLV_E_INCOMPLETE if the buffer ends inside the TLV block.
+ */
+tlv_status_t t2t_parse_next_tlv(uint8_t *buf, size_t len, tlv_t *tlv, size_t *br);
+
+/*
+ * @brief This API writes the type and length fields of a TLV block.
+ *
+ * The 1-byte length format is used for lengths below 0xFF and the 3-byte
+ * format otherwise. The value field is left for the caller to write directly
+ * after the returned header.
+ *
+ * @param[in]  type   : Type of the TLV block.
+ * @param[in]  length : Length of the value field (at most 0xFFFE).
+ * @param[out] buf    : Pointer to the output buffer.
+ * @param[in]  len    : Size of the output buffer.
+ * @param[out] bw     : Pointer to value which will store number of bytes written.
+ *
+ * @return API status code.
+ */
+tlv_status_t tlv_encode_header(uint8_t type, size_t length, uint8_t *buf, size_t len, size_t *bw);
+
+/*
+ * @brief This API returns the length of the run of NULL TLV blocks at the start of the buffer.
+ *
+ * Padding is scanned 32 (AVX2) or 16 (SSE2) bytes at a time where available,
+ * falling back to 8 bytes at a time otherwise.
+ *
+ * @param[in] buf : Pointer to byte buffer containing TLV data.
+ * @param[in] len : Number of valid bytes in the buffer.
+ *
+ * @return Offset of the first byte that is not a NULL TLV block (len if there is none).
+ */
+size_t tlv_skip_null(const uint8_t *buf, size_t len);
+
+/*
+ * @brief This API initialises a streaming TLV decoder.
+ *
+ * @param[out] ctx  : Pointer to the decoder context.
+ * @param[in]  buf  : Pointer to storage that receives the fed bytes.
+ * @param[in]  size : Size of the storage in bytes.
+ *
+ * @return API status code.
+ */
+tlv_status_t tlv_stream_init(tlv_stream_t *ctx, uint8_t *buf, size_t size);
+
+/*
+ * @brief This API appends a chunk of tag memory to the decoder.
+ *
+ * If the chunk already lies at the end of the decoder storage (the reader
+ * wrote it in place) no copy is made.
+ *
+ * @param[in,out] ctx   : Pointer to the decoder context.
+ * @param[in]     chunk : Pointer to the chunk of tag memory.
+ * @param[in]     len   : Length of the chunk in bytes.
+ *
+ * @return API status code.
+ */
+tlv_status_t tlv_stream_feed(tlv_stream_t *ctx, const uint8_t *chunk, size_t len);
+
+/*
+ * @brief This API returns the next complete TLV block from the decoder.
+ *
+ * @param[in,out] ctx : Pointer to the decoder context.
+ * @param[out]    tlv : Pointer to structure that will be filled with parsed data.
+ *
+ * NULL blocks are padding and are skipped rather than returned. The
+ * TERMINATOR block is returned once; later calls return TLV_E_END. A decode
+ * loop runs until TLV_E_INCOMPLETE (feed more data) or TLV_E_END:
+ *
+ *   while(((rslt = tlv_stream_next(ctx, &tlv)) != TLV_E_INCOMPLETE) && (rslt != TLV_E_END))
+ *       if(rslt == TLV_OK) ...
+ *
+ * @return API status code.
+ * @retval TLV_E_INCOMPLETE if more data must be fed before the next block is complete.
+ * @retval TLV_E_NOT_FOUND  if an invalid byte was skipped; decoding may carry on.
+ * @retval TLV_E_END        if the TERMINATOR block has already been returned.
  */
-tlv_status_t t2t_parse_next_tlv(uint8_t *buf, tlv_t *tlv, size_t *br);
+tlv_status_t tlv_stream_next(tlv_stream_t *ctx, tlv_t *tlv);
 
 
 void t2t_print_tlv(tlv_t *tlv);
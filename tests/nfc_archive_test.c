@@ -0,0 +1,370 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_archive_test.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_archive_test.c
+ * @brief Archive round trip, queries, corrupted input and writer limits.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nfc_archive.h"
+#include "nfc_batch.h"
+#include "nfc_corpus.h"
+#include "nfc_test.h"
+
+#define TEST_PER_KIND   100
+#define TEST_FUZZ       1000
+
+/*
+ * @brief Growing in-memory sink that can be told to fail.
+ */
+typedef struct
+{
+    uint8_t *data;
+    size_t  len;
+    size_t  cap;
+    int     fail_at;    /* Call to fail at, or -1 */
+} test_sink_t;
+
+static uint8_t     test_arena_buf[1 << 16];
+static nfc_arena_t test_arena;
+static uint32_t    test_seed = 7;
+
+static uint32_t test_rand(void)
+{
+    test_seed ^= test_seed << 13;
+    test_seed ^= test_seed >> 17;
+    test_seed ^= test_seed << 5;
+    return test_seed;
+}
+
+static int test_sink(void *ctx, const void *data, size_t len)
+{
+    test_sink_t *sink = ctx;
+
+    if(sink->fail_at-- == 0)
+        return -1;
+    if(sink->len + len > sink->cap)
+    {
+        sink->cap  = (sink->len + len) * 2;
+        sink->data = realloc(sink->data, sink->cap);
+    }
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    return 0;
+}
+
+/*
+ * @brief Copy the archive to an aligned buffer, as a mapping would be.
+ */
+static uint8_t *test_aligned_copy(const test_sink_t *sink)
+{
+    uint8_t *buf = aligned_alloc(NFC_ARCHIVE_ALIGN, (sink->len + NFC_ARCHIVE_ALIGN - 1) & ~(size_t)(NFC_ARCHIVE_ALIGN - 1));
+
+    memcpy(buf, sink->data, sink->len);
+    return buf;
+}
+
+/*
+ * @brief Parse tag 'n' of the interleaved corpora; every 7th tag is archived without records.
+ */
+static uint32_t test_parse(nfc_corpus_t *corpora, size_t tag, nfc_archive_tag_t *t, nfc_batch_result_t *r)
+{
+    nfc_corpus_t *corpus = &corpora[tag % NFC_CORPUS_KIND_CNT];
+    size_t       n       = tag / NFC_CORPUS_KIND_CNT;
+    nfc_image_t  image   = { nfc_corpus_image(corpus, n), corpus->image_size };
+
+    nfc_arena_reset(&test_arena);
+    nfc_batch_parse_arena(&image, r, &test_arena);
+    TEST_CHECK(r->ndef_status == NDEF_OK);
+    nfc_archive_tag_from_t2t(t, image.data);
+
+    return (n % 7 == 3) ? 0 : r->ndef.rec_cnt;
+}
+
+/*
+ * @brief Every tag and record reads back as added.
+ */
+static void test_verify(const nfc_archive_t *arc, nfc_corpus_t *corpora, size_t tag_cnt)
+{
+    uint32_t rec = 0;
+
+    for(uint32_t tag = 0; tag < tag_cnt; tag++)
+    {
+        nfc_batch_result_t r;
+        nfc_archive_tag_t  t, u;
+        uint32_t           cnt = test_parse(corpora, tag, &t, &r);
+
+        TEST_CHECK(nfc_archive_get_tag(arc, tag, &u) == NFC_ARCHIVE_OK);
+        TEST_CHECK((u.uid_len == t.uid_len) && (memcmp(u.uid, t.uid, sizeof(t.uid)) == 0));
+        TEST_CHECK((u.cc_version == t.cc_version) && (u.cc_access == t.cc_access) && (u.cc_size == t.cc_size));
+        TEST_CHECK(arc->tag_rec[tag + 1] - arc->tag_rec[tag] == cnt);
+
+        for(uint32_t i = 0; i < cnt; i++, rec++)
+        {
+            ndef_record_t x, y;
+
+            ndef_index_get(&r.ndef, i, &x);
+            TEST_CHECK(nfc_archive_get_record(arc, rec, &y) == NFC_ARCHIVE_OK);
+            TEST_CHECK(nfc_archive_rec_tag(arc, rec) == tag);
+
+            /* IDs are not archived. */
+            TEST_CHECK(y.header == (x.header & ~NDEF_RECORD_FLAG_IL));
+            TEST_CHECK((y.type_len == x.type_len) && ((x.type_len == 0) || (memcmp(y.type, x.type, x.type_len) == 0)));
+            TEST_CHECK((y.payload_len == x.payload_len) &&
+                       ((x.payload_len == 0) || (memcmp(y.payload, x.payload, x.payload_len) == 0)));
+            TEST_CHECK(y.total_length == x.total_length - (x.id_len ? x.id_len + 1 : 0));
+        }
+    }
+
+    TEST_CHECK(rec == arc->rec_cnt);
+}
+
+/*
+ * @brief Scanning by type finds the records a plain loop over the type column does.
+ */
+static void test_scan(const nfc_archive_t *arc)
+{
+    for(uint16_t id = 0; id < arc->type_cnt; id++)
+    {
+        for(size_t max = 1; max < 40; max += 13)
+        {
+            uint32_t pos = 0;
+            uint32_t ref = 0;
+            uint32_t recs[64];
+
+            while(pos < arc->rec_cnt)
+            {
+                size_t cnt = nfc_archive_scan_type(arc, id, &pos, recs, max);
+
+                TEST_CHECK(cnt <= max);
+                for(size_t j = 0; j < cnt; j++)
+                {
+                    while((ref < arc->rec_cnt) && (arc->rec_type[ref] != id))
+                        ref++;
+                    TEST_CHECK(recs[j] == ref);
+                    ref++;
+                }
+            }
+
+            while((ref < arc->rec_cnt) && (arc->rec_type[ref] != id))
+                ref++;
+            TEST_CHECK(ref == arc->rec_cnt);
+        }
+    }
+
+    uint16_t id;
+
+    TEST_CHECK(nfc_archive_find_type(arc, TNF_WELL_KNOWN, (const uint8_t *)"U", 1, &id) == NFC_ARCHIVE_OK);
+    TEST_CHECK((arc->type_tnf[id] == TNF_WELL_KNOWN) && (arc->type_data[arc->type_ofs[id]] == 'U'));
+    TEST_CHECK(nfc_archive_find_type(arc, TNF_WELL_KNOWN, (const uint8_t *)"X", 1, &id) == NFC_ARCHIVE_E_NOT_FOUND);
+}
+
+/*
+ * @brief Flipped bits and truncation are rejected or read safely (run under a sanitizer).
+ */
+static void test_fuzz(const test_sink_t *sink)
+{
+    uint8_t *buf = test_aligned_copy(sink);
+
+    for(int round = 0; round < TEST_FUZZ; round++)
+    {
+        nfc_archive_t arc;
+
+        /* Mostly in the header and column directory. */
+        memcpy(buf, sink->data, sink->len);
+        for(unsigned m = 1 + test_rand() % 4; m > 0; m--)
+        {
+            size_t p = (test_rand() & 1) ? test_rand() % 1024 : test_rand() % sink->len;
+            buf[p] ^= (uint8_t)(1u << (test_rand() % 8));
+        }
+
+        size_t len = (test_rand() % 10 == 0) ? test_rand() % sink->len : sink->len;
+
+        if(nfc_archive_open(&arc, buf, len) != NFC_ARCHIVE_OK)
+            continue;
+
+        for(uint32_t i = 0; i < arc.tag_cnt; i += 1 + test_rand() % 50)
+        {
+            nfc_archive_tag_t t;
+            nfc_archive_get_tag(&arc, i, &t);
+        }
+
+        for(uint32_t i = 0; i < arc.rec_cnt; i++)
+        {
+            ndef_record_t     rec;
+            volatile uint8_t  sum = 0;
+
+            if(nfc_archive_get_record(&arc, i, &rec) == NFC_ARCHIVE_OK)
+            {
+                for(size_t q = 0; q < rec.type_len; q++)
+                    sum ^= rec.type[q];
+                for(size_t q = 0; q < rec.payload_len; q++)
+                    sum ^= rec.payload[q];
+            }
+            nfc_archive_rec_tag(&arc, i);
+        }
+
+        uint16_t id;
+        uint32_t pos = 0;
+        uint32_t recs[16];
+
+        nfc_archive_find_type(&arc, TNF_WELL_KNOWN, (const uint8_t *)"T", 1, &id);
+        while(pos < arc.rec_cnt)
+            nfc_archive_scan_type(&arc, 1, &pos, recs, 16);
+    }
+
+    free(buf);
+}
+
+/*
+ * @brief Add a tag holding one external record whose type is 'name'.
+ */
+static nfc_archive_status_t test_add_type(nfc_archive_writer_t *writer, const char *name)
+{
+    static const nfc_archive_tag_t tag = { { 1, 2, 3 }, 3, 0x10, 0, 48 };
+    uint8_t                        msg[64];
+    uint32_t                       storage[NDEF_INDEX_STORAGE_WORDS(1)];
+    ndef_record_t                  rec = { 0 };
+    ndef_index_t                   index;
+    size_t                         bw;
+
+    rec.header      = NDEF_RECORD_FLAG_MB | NDEF_RECORD_FLAG_ME | NDEF_RECORD_FLAG_SR | TNF_EXTERNAL_TYPE;
+    rec.type        = (uint8_t *)name;
+    rec.type_len    = (uint8_t)strlen(name);
+    rec.payload     = (uint8_t *)"p";
+    rec.payload_len = 1;
+
+    TEST_CHECK(ndef_msg_encode(&rec, 1, msg, sizeof(msg), &bw) == NDEF_OK);
+    ndef_index_init(&index, storage, 1);
+    TEST_CHECK(ndef_index_build(&index, msg, bw) == NDEF_OK);
+
+    return nfc_archive_add(writer, &tag, &index);
+}
+
+/*
+ * @brief A full type dictionary fails the add and leaves the writer usable.
+ */
+static void test_type_limit(void)
+{
+    nfc_archive_writer_t *writer;
+    char                 name[8];
+
+    TEST_CHECK(nfc_archive_writer_create(&writer) == NFC_ARCHIVE_OK);
+
+    for(unsigned i = 0; i < NFC_ARCHIVE_MAX_TYPES; i++)
+    {
+        snprintf(name, sizeof(name), "%u", i);
+        TEST_CHECK(test_add_type(writer, name) == NFC_ARCHIVE_OK);
+    }
+    TEST_CHECK(test_add_type(writer, "full") == NFC_ARCHIVE_E_NO_MEM);
+    TEST_CHECK(test_add_type(writer, "17") == NFC_ARCHIVE_OK);
+
+    test_sink_t   sink = { .fail_at = -1 };
+    nfc_archive_t arc;
+    uint16_t      id;
+
+    TEST_CHECK(nfc_archive_write(writer, test_sink, &sink) == NFC_ARCHIVE_OK);
+
+    uint8_t *buf = test_aligned_copy(&sink);
+
+    TEST_CHECK(nfc_archive_open(&arc, buf, sink.len) == NFC_ARCHIVE_OK);
+    TEST_CHECK((arc.tag_cnt == NFC_ARCHIVE_MAX_TYPES + 1) && (arc.type_cnt == NFC_ARCHIVE_MAX_TYPES));
+    TEST_CHECK(nfc_archive_find_type(&arc, TNF_EXTERNAL_TYPE, (const uint8_t *)"17", 2, &id) == NFC_ARCHIVE_OK);
+    TEST_CHECK((id == 17) && (arc.rec_type[arc.rec_cnt - 1] == 17));
+    TEST_CHECK(nfc_archive_find_type(&arc, TNF_EXTERNAL_TYPE, (const uint8_t *)"full", 4, &id) ==
+               NFC_ARCHIVE_E_NOT_FOUND);
+
+    free(buf);
+    free(sink.data);
+    nfc_archive_writer_destroy(writer);
+}
+
+int main(void)
+{
+    nfc_corpus_t         corpora[NFC_CORPUS_KIND_CNT];
+    nfc_archive_writer_t *writer;
+    const size_t         tag_cnt = (size_t)TEST_PER_KIND * NFC_CORPUS_KIND_CNT;
+    uint32_t             rec_cnt = 0;
+
+    nfc_arena_init(&test_arena, test_arena_buf, sizeof(test_arena_buf));
+    for(int k = 0; k < NFC_CORPUS_KIND_CNT; k++)
+        TEST_CHECK(nfc_corpus_generate(&corpora[k], (nfc_corpus_kind_t)k, TEST_PER_KIND, k + 1) == 0);
+
+    /* Interleave the corpus kinds so the record types mix. */
+    TEST_CHECK(nfc_archive_writer_create(&writer) == NFC_ARCHIVE_OK);
+    for(size_t tag = 0; tag < tag_cnt; tag++)
+    {
+        nfc_batch_result_t r;
+        nfc_archive_tag_t  t;
+        uint32_t           cnt = test_parse(corpora, tag, &t, &r);
+
+        TEST_CHECK(nfc_archive_add(writer, &t, (cnt != 0) ? &r.ndef : NULL) == NFC_ARCHIVE_OK);
+        rec_cnt += cnt;
+    }
+
+    test_sink_t sink = { .fail_at = -1 };
+
+    TEST_CHECK(nfc_archive_write(writer, test_sink, &sink) == NFC_ARCHIVE_OK);
+
+    /* A failing sink aborts the write, whichever call fails. */
+    for(int f = 0; f < 1000; f++)
+    {
+        test_sink_t          failing = { .fail_at = f };
+        nfc_archive_status_t rslt    = nfc_archive_write(writer, test_sink, &failing);
+
+        free(failing.data);
+        if(failing.len == sink.len)
+        {
+            TEST_CHECK(rslt == NFC_ARCHIVE_OK);
+            break;
+        }
+        TEST_CHECK(rslt == NFC_ARCHIVE_E_IO);
+    }
+
+    uint8_t       *buf = test_aligned_copy(&sink);
+    nfc_archive_t arc;
+
+    TEST_CHECK(nfc_archive_open(&arc, buf, sink.len) == NFC_ARCHIVE_OK);
+    TEST_CHECK((arc.tag_cnt == tag_cnt) && (arc.rec_cnt == rec_cnt));
+
+    test_verify(&arc, corpora, tag_cnt);
+    test_scan(&arc);
+    test_fuzz(&sink);
+    test_type_limit();
+
+    free(buf);
+    free(sink.data);
+    nfc_archive_writer_destroy(writer);
+    for(int k = 0; k < NFC_CORPUS_KIND_CNT; k++)
+        nfc_corpus_free(&corpora[k]);
+
+    return test_report("nfc_archive_test");
+}
@@ -0,0 +1,165 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_arena_test.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_arena_test.c
+ * @brief Arena-backed parsing against the fixed batch storage.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "nfc_batch.h"
+#include "nfc_corpus.h"
+#include "nfc_test.h"
+
+#define TEST_IMAGES     300
+#define TEST_MAX_TLVS   16
+#define TEST_MAX_RECS   256
+
+static tlv_t    test_tlvs[TEST_MAX_TLVS];
+static uint32_t test_index[NDEF_INDEX_STORAGE_WORDS(TEST_MAX_RECS)];
+
+/*
+ * @brief Both parses of an image give the same result.
+ */
+static void test_same(const nfc_batch_result_t *r1, const nfc_batch_result_t *r2)
+{
+    TEST_CHECK(r1->tag_status == r2->tag_status);
+    TEST_CHECK(r1->ndef_status == r2->ndef_status);
+    TEST_CHECK(r1->tlv_cnt == r2->tlv_cnt);
+    TEST_CHECK(r1->ndef.rec_cnt == r2->ndef.rec_cnt);
+    if((r1->tlv_cnt != r2->tlv_cnt) || (r1->ndef.rec_cnt != r2->ndef.rec_cnt))
+        return;
+
+    for(uint16_t i = 0; i < r1->tlv_cnt; i++)
+        TEST_CHECK(r1->tlvs[i].value == r2->tlvs[i].value);
+    for(uint32_t i = 0; i < r1->ndef.rec_cnt; i++)
+    {
+        TEST_CHECK(r1->ndef.rec_offset[i] == r2->ndef.rec_offset[i]);
+        TEST_CHECK(r1->ndef.payload_offset[i] == r2->ndef.payload_offset[i]);
+        TEST_CHECK(r1->ndef.payload_len[i] == r2->ndef.payload_len[i]);
+    }
+}
+
+/*
+ * @brief Every corpus kind parses the same with either kind of storage.
+ */
+static void test_corpus(void)
+{
+    const nfc_batch_storage_t storage = { TEST_MAX_TLVS, TEST_MAX_RECS, test_tlvs, test_index };
+
+    for(int k = 0; k < NFC_CORPUS_KIND_CNT; k++)
+    {
+        nfc_corpus_t corpus;
+
+        TEST_CHECK(nfc_corpus_generate(&corpus, (nfc_corpus_kind_t)k, TEST_IMAGES, 9) == 0);
+
+        /* Misalign the region to check that the arena aligns it. */
+        size_t      size = NFC_BATCH_ARENA_SIZE(corpus.image_size);
+        uint8_t     *buf = malloc(size + 3);
+        nfc_arena_t arena;
+
+        TEST_CHECK(nfc_arena_init(&arena, buf + 3, size) == NFC_ARENA_OK);
+
+        for(size_t n = 0; n < corpus.image_cnt; n++)
+        {
+            nfc_image_t        image = { nfc_corpus_image(&corpus, n), corpus.image_size };
+            nfc_batch_result_t r1, r2;
+
+            nfc_arena_reset(&arena);
+            TEST_CHECK(nfc_batch_parse(&image, 1, &r1, &storage) == NFC_BATCH_OK);
+            TEST_CHECK(nfc_batch_parse_arena(&image, &r2, &arena) == NFC_BATCH_OK);
+            TEST_CHECK(r1.tag_status == T2T_OK);
+            test_same(&r1, &r2);
+        }
+
+        free(buf);
+        nfc_corpus_free(&corpus);
+    }
+}
+
+/*
+ * @brief A tag with more TLV blocks than fixed storage would reserve.
+ */
+static void test_many_tlvs(void)
+{
+    static uint8_t     big[4096];
+    uint8_t            image[16 + 120 + 16] = { 0 };
+    const uint8_t      rec[]                = { 0xD1, 1, 1, 'T', 0 };
+    nfc_image_t        span                 = { image, sizeof(image) };
+    nfc_arena_t        arena;
+    nfc_batch_result_t r, r2;
+    size_t             o = 16;
+
+    /* CC of a 120-byte data area, then 50 empty proprietary TLVs and the NDEF message. */
+    image[3]  = 0x88;
+    image[12] = 0xE1;
+    image[13] = 0x10;
+    image[14] = 120 / 8;
+    for(int i = 0; i < 50; i++)
+    {
+        image[o++] = TLV_PROPRIETARY;
+        image[o++] = 0;
+    }
+    image[o++] = TLV_NDEF_MESSAGE;
+    image[o++] = sizeof(rec);
+    memcpy(image + o, rec, sizeof(rec));
+    o         += sizeof(rec);
+    image[o]   = TLV_TERMINATOR;
+
+    nfc_arena_init(&arena, big, sizeof(big));
+    TEST_CHECK(nfc_batch_parse_arena(&span, &r, &arena) == NFC_BATCH_OK);
+    TEST_CHECK((r.tag_status == T2T_OK) && (r.tlv_cnt == 51));
+    TEST_CHECK((r.ndef_status == NDEF_OK) && (r.ndef.rec_cnt == 1));
+
+    /* Without a reset the first result stays valid. */
+    size_t used = arena.used;
+    TEST_CHECK(nfc_batch_parse_arena(&span, &r2, &arena) == NFC_BATCH_OK);
+    TEST_CHECK(arena.used == 2 * used);
+    TEST_CHECK(r.tlvs != r2.tlvs);
+    test_same(&r, &r2);
+
+    /* Too small for the TLV blocks. */
+    nfc_arena_init(&arena, big, 200);
+    TEST_CHECK(nfc_batch_parse_arena(&span, &r, &arena) == NFC_BATCH_OK);
+    TEST_CHECK(r.tag_status == T2T_E_NO_MEM);
+
+    /* Room for the TLV blocks but not for the NDEF index. */
+    nfc_arena_init(&arena, big, 51 * sizeof(tlv_t) + 8);
+    TEST_CHECK(nfc_batch_parse_arena(&span, &r, &arena) == NFC_BATCH_OK);
+    TEST_CHECK((r.tag_status == T2T_OK) && (r.tlv_cnt == 51));
+    TEST_CHECK(r.ndef_status == NDEF_E_NO_MEM);
+}
+
+int main(void)
+{
+    test_corpus();
+    test_many_tlvs();
+
+    return test_report("nfc_arena_test");
+}
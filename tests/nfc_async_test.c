@@ -0,0 +1,328 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_async_test.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_async_test.c
+ * @brief Asynchronous reads over the simulated and synchronous transports.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "nfc_async.h"
+#include "nfc_corpus.h"
+#include "nfc_stats.h"
+#include "nfc_test.h"
+#include "nfc_tlv_block.h"
+
+#define TEST_PER_KIND   20
+#define TEST_MAX_TLVS   16
+#define TEST_MAX_RECS   256
+#define TEST_RESTARTS   10
+
+/*
+ * @brief Completions of an operation, signalled to the waiting test.
+ */
+typedef struct
+{
+    pthread_mutex_t    lock;
+    pthread_cond_t     cond;
+    unsigned           reports;     /* Calls of the done callback            */
+    nfc_async_status_t status;      /* Status of the last call               */
+    unsigned           restarts;    /* Restarts left to make from the callback */
+    unsigned           restart_err; /* Restarts that failed                  */
+} test_wait_t;
+
+/*
+ * @brief Transport completing every READ inside 'read', on the caller's thread.
+ */
+typedef struct
+{
+    nfc_t2t_emu_t *emu;
+    unsigned      reads;        /* READ commands submitted                     */
+    unsigned      fail_done;    /* READ completed with an error, or ~0u        */
+    unsigned      fail_submit;  /* READ refused at submission, or ~0u          */
+} test_sync_t;
+
+static uint32_t test_idx_mem[NDEF_INDEX_STORAGE_WORDS(TEST_MAX_RECS)];
+
+static nfc_async_status_t test_sync_read(void *impl, uint8_t block, uint8_t *data, nfc_async_io_done_t done, void *ctx)
+{
+    test_sync_t *sync = impl;
+    unsigned    n     = sync->reads++;
+
+    if(n == sync->fail_submit)
+        return NFC_ASYNC_E_BUSY;
+
+    nfc_async_status_t status = (nfc_t2t_emu_read(sync->emu, block, data) == NFC_T2T_EMU_OK) ?
+                                NFC_ASYNC_OK : NFC_ASYNC_E_TRANSPORT;
+
+    done(ctx, (n == sync->fail_done) ? NFC_ASYNC_E_TRANSPORT : status);
+    return NFC_ASYNC_OK;
+}
+
+static void test_done(nfc_async_read_t *op, nfc_async_status_t status)
+{
+    test_wait_t *wait = op->user_ctx;
+
+    pthread_mutex_lock(&wait->lock);
+    wait->status = status;
+    wait->reports++;
+
+    /* Start the next read of the same tag from the callback. */
+    if(wait->restarts != 0)
+    {
+        wait->restarts--;
+        pthread_mutex_unlock(&wait->lock);
+        if(nfc_async_read_start(op) != NFC_ASYNC_OK)
+        {
+            pthread_mutex_lock(&wait->lock);
+            wait->restart_err++;
+            wait->restarts = 0;
+            pthread_cond_signal(&wait->cond);
+            pthread_mutex_unlock(&wait->lock);
+        }
+        return;
+    }
+
+    pthread_cond_signal(&wait->cond);
+    pthread_mutex_unlock(&wait->lock);
+}
+
+/*
+ * @brief Start an operation and wait until it has reported 'reports' times in all.
+ */
+static nfc_async_status_t test_run(nfc_async_read_t *op, test_wait_t *wait, unsigned reports)
+{
+    nfc_async_status_t rslt = nfc_async_read_start(op);
+
+    if(rslt != NFC_ASYNC_OK)
+        return rslt;
+
+    pthread_mutex_lock(&wait->lock);
+    while((wait->reports < reports) && (wait->restart_err == 0))
+        pthread_cond_wait(&wait->cond, &wait->lock);
+    rslt = wait->status;
+    pthread_mutex_unlock(&wait->lock);
+
+    return rslt;
+}
+
+/*
+ * @brief The indexed message matches a synchronous parse of the image.
+ */
+static void test_compare(const nfc_async_read_t *op, uint8_t *image)
+{
+    tlv_t        tlvs[TEST_MAX_TLVS];
+    type_2_tag_t tag = { .max_tlv_blocks = TEST_MAX_TLVS, .p_tlv_block_array = tlvs };
+    uint32_t     ref_mem[NDEF_INDEX_STORAGE_WORDS(TEST_MAX_RECS)];
+    ndef_index_t ref;
+    const tlv_t  *ndef = NULL;
+
+    TEST_CHECK(type_2_tag_parse(&tag, image) == T2T_OK);
+    for(uint16_t i = 0; i < tag.tlv_count; i++)
+    {
+        if(tlvs[i].type == TLV_NDEF_MESSAGE)
+        {
+            ndef = &tlvs[i];
+            break;
+        }
+    }
+    TEST_CHECK(ndef != NULL);
+    if(ndef == NULL)
+        return;
+
+    ndef_index_init(&ref, ref_mem, TEST_MAX_RECS);
+    TEST_CHECK(ndef_index_build(&ref, ndef->value, ndef->length) == NDEF_OK);
+
+    TEST_CHECK((op->ndef.msg_len == ref.msg_len) && (memcmp(op->ndef.msg, ref.msg, ref.msg_len) == 0));
+    TEST_CHECK(op->ndef.rec_cnt == ref.rec_cnt);
+    for(uint32_t i = 0; (i < ref.rec_cnt) && (i < op->ndef.rec_cnt); i++)
+    {
+        TEST_CHECK(op->ndef.rec_offset[i] == ref.rec_offset[i]);
+        TEST_CHECK(op->ndef.payload_offset[i] == ref.payload_offset[i]);
+        TEST_CHECK(op->ndef.payload_len[i] == ref.payload_len[i]);
+    }
+}
+
+/*
+ * @brief Read every corpus image over the simulated transport.
+ */
+static void test_sim(void)
+{
+    for(int k = 0; k < NFC_CORPUS_KIND_CNT; k++)
+    {
+        nfc_corpus_t corpus;
+
+        TEST_CHECK(nfc_corpus_generate(&corpus, (nfc_corpus_kind_t)k, TEST_PER_KIND, k + 3) == 0);
+
+        size_t  raw_size = corpus.image_size + T2T_READ_SIZE;
+        uint8_t *raw     = malloc(raw_size);
+        uint8_t *copy    = malloc(corpus.image_size);
+
+        for(size_t n = 0; n < corpus.image_cnt; n++)
+        {
+            tlv_t                 tlvs[TEST_MAX_TLVS];
+            type_2_tag_t          tag  = { .max_tlv_blocks = TEST_MAX_TLVS, .p_tlv_block_array = tlvs };
+            test_wait_t           wait = { .reports = 0 };
+            nfc_t2t_emu_t         emu;
+            nfc_async_sim_t       sim;
+            nfc_async_transport_t transport;
+            nfc_async_read_t      op;
+
+            memcpy(copy, nfc_corpus_image(&corpus, n), corpus.image_size);
+            pthread_mutex_init(&wait.lock, NULL);
+            pthread_cond_init(&wait.cond, NULL);
+
+            TEST_CHECK(nfc_t2t_emu_init(&emu, nfc_corpus_image(&corpus, n), corpus.image_size, &tag, NULL) ==
+                       NFC_T2T_EMU_OK);
+            TEST_CHECK(nfc_async_sim_init(&sim, &emu, &transport) == NFC_ASYNC_OK);
+            TEST_CHECK(nfc_async_read_init(&op, &transport, raw, raw_size, test_idx_mem, TEST_MAX_RECS,
+                                           test_done, &wait) == NFC_ASYNC_OK);
+
+            TEST_CHECK(test_run(&op, &wait, 1) == NFC_ASYNC_OK);
+            TEST_CHECK(wait.reports == 1);
+            test_compare(&op, copy);
+
+            nfc_async_read_deinit(&op);
+            nfc_async_sim_deinit(&sim);
+            nfc_t2t_emu_deinit(&emu);
+            pthread_cond_destroy(&wait.cond);
+            pthread_mutex_destroy(&wait.lock);
+        }
+
+        free(copy);
+        free(raw);
+        nfc_corpus_free(&corpus);
+    }
+}
+
+/*
+ * @brief Synchronous and failing transports, and restarts from the callback.
+ */
+static void test_transports(void)
+{
+    nfc_corpus_t          corpus;
+    tlv_t                 tlvs[TEST_MAX_TLVS];
+    type_2_tag_t          tag  = { .max_tlv_blocks = TEST_MAX_TLVS, .p_tlv_block_array = tlvs };
+    test_wait_t           wait = { .reports = 0 };
+    nfc_t2t_emu_t         emu;
+    test_sync_t           sync = { &emu, 0, ~0u, ~0u };
+    nfc_async_transport_t transport = { &sync, test_sync_read };
+    nfc_async_read_t      op;
+
+    TEST_CHECK(nfc_corpus_generate(&corpus, NFC_CORPUS_NTAG216, 1, 11) == 0);
+
+    size_t  raw_size = corpus.image_size + T2T_READ_SIZE;
+    uint8_t *raw     = malloc(raw_size);
+    uint8_t *copy    = malloc(corpus.image_size);
+
+    memcpy(copy, nfc_corpus_image(&corpus, 0), corpus.image_size);
+    pthread_mutex_init(&wait.lock, NULL);
+    pthread_cond_init(&wait.cond, NULL);
+
+    TEST_CHECK(nfc_t2t_emu_init(&emu, nfc_corpus_image(&corpus, 0), corpus.image_size, &tag, NULL) == NFC_T2T_EMU_OK);
+    TEST_CHECK(nfc_async_read_init(&op, &transport, raw, raw_size, test_idx_mem, TEST_MAX_RECS,
+                                   test_done, &wait) == NFC_ASYNC_OK);
+
+    /* Every READ completes inside 'read', so the whole read nests in start. */
+    TEST_CHECK(test_run(&op, &wait, 1) == NFC_ASYNC_OK);
+    TEST_CHECK(wait.reports == 1);
+    test_compare(&op, copy);
+
+    unsigned reads = sync.reads;
+    TEST_CHECK(reads > 2);
+
+    /* A READ that completes with an error ends the read once. */
+    for(unsigned f = 0; f < reads; f++)
+    {
+        sync.reads     = 0;
+        sync.fail_done = f;
+        TEST_CHECK(test_run(&op, &wait, wait.reports + 1) == NFC_ASYNC_E_TRANSPORT);
+    }
+    sync.fail_done = ~0u;
+    TEST_CHECK(wait.reports == reads + 1);
+
+    /* A refused first READ fails start and is not reported; a later one is. */
+    sync.reads       = 0;
+    sync.fail_submit = 0;
+    TEST_CHECK(nfc_async_read_start(&op) == NFC_ASYNC_E_BUSY);
+    TEST_CHECK(wait.reports == reads + 1);
+
+    sync.reads       = 0;
+    sync.fail_submit = 2;
+    TEST_CHECK(test_run(&op, &wait, wait.reports + 1) == NFC_ASYNC_E_TRANSPORT);
+    TEST_CHECK(wait.reports == reads + 2);
+
+    sync.reads       = 0;
+    sync.fail_submit = ~0u;
+    TEST_CHECK(test_run(&op, &wait, wait.reports + 1) == NFC_ASYNC_OK);
+    test_compare(&op, copy);
+    nfc_async_read_deinit(&op);
+
+    /* Restarts from the callback, with completions on the simulated transport's thread. */
+    nfc_async_sim_t sim;
+    nfc_stats_t     stats;
+
+    nfc_stats_reset();
+    TEST_CHECK(nfc_async_sim_init(&sim, &emu, &transport) == NFC_ASYNC_OK);
+    TEST_CHECK(nfc_async_read_init(&op, &transport, raw, raw_size, test_idx_mem, TEST_MAX_RECS,
+                                   test_done, &wait) == NFC_ASYNC_OK);
+
+    wait.reports  = 0;
+    wait.restarts = TEST_RESTARTS;
+    TEST_CHECK(test_run(&op, &wait, TEST_RESTARTS + 1) == NFC_ASYNC_OK);
+    TEST_CHECK((wait.reports == TEST_RESTARTS + 1) && (wait.restart_err == 0));
+    test_compare(&op, copy);
+
+    nfc_async_read_deinit(&op);
+    nfc_async_sim_deinit(&sim);
+
+#ifdef NFC_STATS
+    /* The records were indexed on the transport's completion thread. */
+    nfc_stats_global(&stats);
+    TEST_CHECK(stats.counters[NFC_STATS_NDEF_MESSAGES] >= TEST_RESTARTS + 1);
+    TEST_CHECK(stats.counters[NFC_STATS_NDEF_RECORDS] >= (TEST_RESTARTS + 1) * (uint64_t)op.ndef.rec_cnt);
+#else
+    (void)stats;
+#endif
+
+    nfc_t2t_emu_deinit(&emu);
+    pthread_cond_destroy(&wait.cond);
+    pthread_mutex_destroy(&wait.lock);
+    free(copy);
+    free(raw);
+    nfc_corpus_free(&corpus);
+}
+
+int main(void)
+{
+    test_sim();
+    test_transports();
+
+    return test_report("nfc_async_test");
+}
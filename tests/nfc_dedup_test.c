@@ -0,0 +1,136 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_dedup_test.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_dedup_test.c
+ * @brief Fingerprints and the time-windowed dedup table.
+ */
+#include <string.h>
+
+#include "nfc_dedup.h"
+#include "nfc_test.h"
+#include "nfc_tlv_block.h"
+
+static uint64_t test_fp(const void *data, size_t len)
+{
+    nfc_dedup_fp_t fp;
+
+    nfc_dedup_fp_init(&fp);
+    nfc_dedup_fp_update(&fp, data, len);
+    return nfc_dedup_fp_final(&fp);
+}
+
+/*
+ * @brief The hash is XXH64 with seed 0, however the input is split.
+ */
+static void test_hash(void)
+{
+    static uint8_t big[5000];
+
+    TEST_CHECK(test_fp("", 0) == 0xEF46DB3751D8E999ULL);
+    TEST_CHECK(test_fp("a", 1) == 0xD24EC4F1A98C6E5BULL);
+    TEST_CHECK(test_fp("abc", 3) == 0x44BC2CF5AD770999ULL);
+
+    for(size_t i = 0; i < sizeof(big); i++)
+        big[i] = (uint8_t)(i * 31 + 7);
+
+    uint64_t whole = test_fp(big, sizeof(big));
+
+    for(size_t step = 1; step < 70; step++)
+    {
+        nfc_dedup_fp_t fp;
+
+        nfc_dedup_fp_init(&fp);
+        for(size_t o = 0; o < sizeof(big); o += step)
+            nfc_dedup_fp_update(&fp, big + o, (sizeof(big) - o < step) ? sizeof(big) - o : step);
+        TEST_CHECK(nfc_dedup_fp_final(&fp) == whole);
+    }
+}
+
+/*
+ * @brief Equal content gives equal fingerprints, whatever its encoding.
+ */
+static void test_fingerprint(void)
+{
+    uint8_t short_rec[] = { 0xD1, 1, 5, 'U', 0x04, 'a', 'b', '.', 'c' };
+    uint8_t long_rec[]  = { 0xC1, 1, 0, 0, 0, 5, 'U', 0x04, 'a', 'b', '.', 'c' };
+    uint8_t area[]      = { TLV_NULL, TLV_NULL, TLV_LOCK_CONTROL, 3, 0xA0, 0x10, 0x44,
+                            TLV_NDEF_MESSAGE, 9, 0xD1, 1, 5, 'U', 0x04, 'a', 'b', '.', 'c', TLV_TERMINATOR };
+    uint8_t empty[]     = { TLV_NULL, TLV_TERMINATOR };
+    uint64_t fp_short, fp_long, fp_tlv, fp_changed;
+
+    TEST_CHECK(nfc_dedup_fingerprint_msg(short_rec, sizeof(short_rec), &fp_short) == NFC_DEDUP_OK);
+    TEST_CHECK(nfc_dedup_fingerprint_msg(long_rec, sizeof(long_rec), &fp_long) == NFC_DEDUP_OK);
+    TEST_CHECK(nfc_dedup_fingerprint_tlv(area, sizeof(area), &fp_tlv) == NFC_DEDUP_OK);
+    TEST_CHECK(fp_short == fp_long);
+    TEST_CHECK(fp_short == fp_tlv);
+
+    short_rec[8] = 'd';
+    TEST_CHECK(nfc_dedup_fingerprint_msg(short_rec, sizeof(short_rec), &fp_changed) == NFC_DEDUP_OK);
+    TEST_CHECK(fp_changed != fp_short);
+
+    TEST_CHECK(nfc_dedup_fingerprint_tlv(empty, sizeof(empty), &fp_changed) == NFC_DEDUP_E_NOT_FOUND);
+}
+
+static void test_table(void)
+{
+    static nfc_dedup_entry_t entries[64 * NFC_DEDUP_WAYS];
+    nfc_dedup_table_t        table = { .set_cnt = 64, .window = 500, .entries = entries };
+    const uint64_t           a     = test_fp("a", 1);
+    const uint64_t           b     = test_fp("b", 1);
+
+    TEST_CHECK(nfc_dedup_init(&table) == NFC_DEDUP_OK);
+
+    /* Every event refreshes the time, so a tag held in the field stays dropped. */
+    TEST_CHECK(nfc_dedup_check(&table, a, 1000) == NFC_DEDUP_OK);
+    TEST_CHECK(nfc_dedup_check(&table, a, 1200) == NFC_DEDUP_E_DUPLICATE);
+    TEST_CHECK(nfc_dedup_check(&table, a, 1650) == NFC_DEDUP_E_DUPLICATE);
+    TEST_CHECK(nfc_dedup_check(&table, a, 2200) == NFC_DEDUP_OK);
+    TEST_CHECK(nfc_dedup_check(&table, b, 2200) == NFC_DEDUP_OK);
+    TEST_CHECK(nfc_dedup_check(&table, a, 2300) == NFC_DEDUP_E_DUPLICATE);
+    TEST_CHECK((table.passed == 3) && (table.dropped == 3));
+
+    /* Far more fingerprints than entries: the latest of each set survives. */
+    for(uint64_t i = 1; i <= 10000; i++)
+        TEST_CHECK(nfc_dedup_check(&table, test_fp(&i, sizeof(i)), 10000 + i) == NFC_DEDUP_OK);
+
+    uint64_t last = 10000;
+    TEST_CHECK(nfc_dedup_check(&table, test_fp(&last, sizeof(last)), 20001) == NFC_DEDUP_E_DUPLICATE);
+
+    nfc_dedup_table_t bad = { .set_cnt = 48, .window = 500, .entries = entries };
+    TEST_CHECK(nfc_dedup_init(&bad) == NFC_DEDUP_E_INVALID_ARGS);
+}
+
+int main(void)
+{
+    test_hash();
+    test_fingerprint();
+    test_table();
+
+    return test_report("nfc_dedup_test");
+}
@@ -0,0 +1,225 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_filter_test.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_filter_test.c
+ * @brief Record filter compilation, matching and message scans.
+ */
+#include <string.h>
+
+#include "nfc_filter.h"
+#include "nfc_test.h"
+
+#define TEST_P_URI      (1ULL << 0)
+#define TEST_P_TEXT     (1ULL << 1)
+#define TEST_P_EXT      (1ULL << 2)
+#define TEST_P_UNKNOWN  (1ULL << 3)
+#define TEST_P_TEXT_UC  (1ULL << 4)
+
+static const nfc_filter_pattern_t test_patterns[] =
+{
+    { TNF_WELL_KNOWN,    (const uint8_t *)"U",               1  },
+    { TNF_MEDIA_TYPE,    (const uint8_t *)"text/plain",      10 },
+    { TNF_EXTERNAL_TYPE, (const uint8_t *)"example.com:foo", 15 },
+    { TNF_UNKNOWN_TYPE,  NULL,                               0  },
+    { TNF_MEDIA_TYPE,    (const uint8_t *)"TEXT/PLAIN",      10 },
+};
+
+/* Short records; the chunked media record is split in three. */
+static uint8_t test_msg[] =
+{
+    0x91, 1, 1, 'U', 'x',                                           /* 0: MB, well-known "U"        */
+    0x11, 1, 1, 'u', 'y',                                           /* 1: well-known "u"            */
+    0x12, 10, 2, 'T', 'e', 'x', 't', '/', 'P', 'l', 'a', 'i', 'n',  /* 2: media "Text/Plain"        */
+    'h', 'i',
+    0x14, 15, 1, 'E', 'x', 'a', 'm', 'p', 'l', 'e', '.', 'c', 'o',  /* 3: external, mixed case      */
+    'm', ':', 'F', 'o', 'o', 'z',
+    0x32, 10, 2, 't', 'e', 'x', 't', '/', 'p', 'l', 'a', 'i', 'n',  /* 4: CF, media "text/plain"    */
+    'c', '1',
+    0x36, 0, 2, 'c', '2',                                           /* 5: CF, unchanged             */
+    0x16, 0, 1, '3',                                                /* 6: last chunk                */
+    0x31, 1, 1, 'T', 'a',                                           /* 7: CF, well-known "T"        */
+    0x16, 0, 1, 'b',                                                /* 8: its last chunk            */
+    0x55, 0, 1, 'q',                                                /* 9: ME, unknown               */
+};
+
+static const struct
+{
+    uint32_t rec_no;
+    uint64_t mask;
+    size_t   offset;    /* Payload offset in test_msg */
+    size_t   len;
+} test_expect[] =
+{
+    { 0, TEST_P_URI,                   4,  1 },
+    { 2, TEST_P_TEXT | TEST_P_TEXT_UC, 23, 2 },
+    { 3, TEST_P_EXT,                   43, 1 },
+    { 4, TEST_P_TEXT | TEST_P_TEXT_UC, 57, 2 },
+    { 5, TEST_P_TEXT | TEST_P_TEXT_UC, 62, 2 },
+    { 6, TEST_P_TEXT | TEST_P_TEXT_UC, 67, 1 },
+    { 9, TEST_P_UNKNOWN,               80, 1 },
+};
+
+#define TEST_EXPECT_CNT     (sizeof(test_expect) / sizeof(test_expect[0]))
+
+static nfc_filter_slot_t test_slots[8];
+static nfc_filter_t      test_filter = { .slots = test_slots, .slot_cnt = 8 };
+
+static void test_compile(void)
+{
+    nfc_filter_slot_t          slots[4];
+    nfc_filter_t               filter = { .slots = slots, .slot_cnt = 3 };
+    const nfc_filter_pattern_t bad[]  =
+    {
+        { TNF_UNCHANGED,  NULL, 0 },
+        { TNF_WELL_KNOWN, NULL, 1 },
+    };
+
+    TEST_CHECK(nfc_filter_compile(&filter, test_patterns, 2) == NFC_FILTER_E_NO_MEM);
+    filter.slot_cnt = 4;
+    TEST_CHECK(nfc_filter_compile(&filter, test_patterns, 4) == NFC_FILTER_E_NO_MEM);
+    TEST_CHECK(nfc_filter_compile(&filter, bad, 1) == NFC_FILTER_E_INVALID_ARGS);
+    TEST_CHECK(nfc_filter_compile(&filter, bad + 1, 1) == NFC_FILTER_E_INVALID_ARGS);
+
+    TEST_CHECK(nfc_filter_compile(&test_filter, test_patterns,
+                                  sizeof(test_patterns) / sizeof(test_patterns[0])) == NFC_FILTER_OK);
+}
+
+/*
+ * @brief Case is folded for media and external types only.
+ */
+static void test_match(void)
+{
+    ndef_record_t rec = { 0 };
+
+    rec.header   = TNF_WELL_KNOWN;
+    rec.type     = (uint8_t *)"U";
+    rec.type_len = 1;
+    TEST_CHECK(nfc_filter_match(&test_filter, &rec) == TEST_P_URI);
+
+    rec.type = (uint8_t *)"u";
+    TEST_CHECK(nfc_filter_match(&test_filter, &rec) == 0);
+
+    rec.header   = TNF_MEDIA_TYPE;
+    rec.type     = (uint8_t *)"tExT/pLaIn";
+    rec.type_len = 10;
+    TEST_CHECK(nfc_filter_match(&test_filter, &rec) == (TEST_P_TEXT | TEST_P_TEXT_UC));
+
+    rec.type_len = 9;
+    TEST_CHECK(nfc_filter_match(&test_filter, &rec) == 0);
+
+    rec.header   = TNF_EXTERNAL_TYPE;
+    rec.type     = (uint8_t *)"EXAMPLE.COM:FOO";
+    rec.type_len = 15;
+    TEST_CHECK(nfc_filter_match(&test_filter, &rec) == TEST_P_EXT);
+
+    /* A NULL-type pattern matches any type of its TNF, and no other TNF. */
+    rec.header = TNF_UNKNOWN_TYPE;
+    TEST_CHECK(nfc_filter_match(&test_filter, &rec) == TEST_P_UNKNOWN);
+    rec.type     = NULL;
+    rec.type_len = 0;
+    TEST_CHECK(nfc_filter_match(&test_filter, &rec) == TEST_P_UNKNOWN);
+    rec.header = TNF_EMPTY;
+    TEST_CHECK(nfc_filter_match(&test_filter, &rec) == 0);
+}
+
+/*
+ * @brief Matches of a scan of test_msg starting at 'first'.
+ */
+static void test_check_matches(const nfc_filter_match_t *matches, size_t first, size_t cnt, uint32_t msg_no)
+{
+    for(size_t i = 0; i < cnt; i++)
+    {
+        const nfc_filter_match_t *m = &matches[i];
+
+        TEST_CHECK(m->msg_no == msg_no);
+        TEST_CHECK(m->rec_no == test_expect[first + i].rec_no);
+        TEST_CHECK(m->mask == test_expect[first + i].mask);
+        TEST_CHECK(m->payload == test_msg + test_expect[first + i].offset);
+        TEST_CHECK(m->payload_len == test_expect[first + i].len);
+    }
+}
+
+static void test_scan(void)
+{
+    nfc_filter_match_t matches[16];
+    size_t             cnt;
+
+    /* Continuation chunks carry the mask of their initial chunk, matching or not. */
+    TEST_CHECK(nfc_filter_scan(&test_filter, test_msg, sizeof(test_msg), matches, 16, &cnt) == NFC_FILTER_OK);
+    TEST_CHECK(cnt == TEST_EXPECT_CNT);
+    test_check_matches(matches, 0, cnt, 0);
+
+    /* Too little match storage keeps the first matches. */
+    TEST_CHECK(nfc_filter_scan(&test_filter, test_msg, sizeof(test_msg), matches, 3, &cnt) == NFC_FILTER_E_NO_MEM);
+    TEST_CHECK(cnt == 3);
+    test_check_matches(matches, 0, cnt, 0);
+
+    TEST_CHECK(nfc_filter_scan(&test_filter, test_msg, sizeof(test_msg), NULL, 0, &cnt) == NFC_FILTER_E_NO_MEM);
+    TEST_CHECK(cnt == 0);
+}
+
+/*
+ * @brief A malformed message keeps its earlier matches and the batch carries on.
+ */
+static void test_scan_batch(void)
+{
+    uint8_t            bad[]  = { 0x91, 1, 1, 'U', 'a', 0x52, 10, 5, 't', 'e' };
+    uint8_t            last[] = { 0xD1, 1, 1, 'U', 'b' };
+    uint8_t *const     msgs[] = { test_msg, bad, last };
+    const size_t       lens[] = { sizeof(test_msg), sizeof(bad), sizeof(last) };
+    nfc_filter_match_t matches[16];
+    size_t             cnt;
+
+    TEST_CHECK(nfc_filter_scan_batch(&test_filter, msgs, lens, 3, matches, 16, &cnt) == NFC_FILTER_E_INVALID_DATA);
+    TEST_CHECK(cnt == TEST_EXPECT_CNT + 2);
+    test_check_matches(matches, 0, TEST_EXPECT_CNT, 0);
+
+    const nfc_filter_match_t *m = &matches[TEST_EXPECT_CNT];
+
+    TEST_CHECK((m[0].msg_no == 1) && (m[0].rec_no == 0) && (m[0].payload == bad + 4));
+    TEST_CHECK((m[1].msg_no == 2) && (m[1].rec_no == 0) && (m[1].payload == last + 4));
+
+    /* Running out of match storage stops the whole batch. */
+    TEST_CHECK(nfc_filter_scan_batch(&test_filter, msgs, lens, 3, matches, TEST_EXPECT_CNT + 1, &cnt) ==
+               NFC_FILTER_E_NO_MEM);
+    TEST_CHECK(cnt == TEST_EXPECT_CNT + 1);
+
+    TEST_CHECK(nfc_filter_scan_batch(&test_filter, msgs, lens, 0, matches, 16, &cnt) == NFC_FILTER_OK);
+    TEST_CHECK(cnt == 0);
+}
+
+int main(void)
+{
+    test_compile();
+    test_match();
+    test_scan();
+    test_scan_batch();
+
+    return test_report("nfc_filter_test");
+}
@@ -0,0 +1,191 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_ring_test.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_ring_test.c
+ * @brief Multi-producer, multi-consumer stress test of the image ring.
+ */
+
+/*
+ * Every image carries its producer and sequence number and a pattern
+ * derived from them, so a consumer can tell a torn or stale slot from a
+ * good one and every image can be checked off exactly once.
+ *
+ * Run it under ThreadSanitizer too ("make tsan"), which checks that
+ * publishing a slot orders the producer's writes before the consumer's
+ * reads.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "nfc_ring.h"
+#include "nfc_test.h"
+
+#define TEST_PRODUCERS      3
+#define TEST_CONSUMERS      3
+#define TEST_PER_PRODUCER   20000
+#define TEST_SLOTS          64
+#define TEST_SLOT_SIZE      NFC_RING_SLOT_SIZE(872)
+#define TEST_BATCH          16
+
+static nfc_ring_t    *test_ring;
+static atomic_uchar  test_seen[TEST_PRODUCERS * TEST_PER_PRODUCER];
+static atomic_size_t test_consumed;
+static atomic_int    test_bad;
+
+static uint8_t test_byte(uint32_t id, uint32_t seq, size_t i)
+{
+    return (uint8_t)(seq * 31 + id * 7 + i);
+}
+
+/*
+ * @brief Image length, varied so stale lengths are caught too.
+ */
+static size_t test_len(uint32_t seq)
+{
+    return 64 + (seq % (TEST_SLOT_SIZE - 63));
+}
+
+static void *test_producer(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    for(uint32_t seq = 0; seq < TEST_PER_PRODUCER; seq++)
+    {
+        uint32_t    slot;
+        nfc_image_t image;
+
+        while(nfc_ring_acquire(test_ring, &slot, &image) != NFC_RING_OK)
+            sched_yield();
+
+        size_t len = test_len(seq);
+        memcpy(image.data, &id, sizeof(id));
+        memcpy(image.data + 4, &seq, sizeof(seq));
+        for(size_t i = 8; i < len; i++)
+            image.data[i] = test_byte(id, seq, i);
+
+        nfc_ring_publish(test_ring, slot, len);
+    }
+
+    return NULL;
+}
+
+/*
+ * @brief Check an image and tick it off.
+ */
+static void test_check_image(const nfc_image_t *image)
+{
+    uint32_t id, seq;
+
+    memcpy(&id, image->data, sizeof(id));
+    memcpy(&seq, image->data + 4, sizeof(seq));
+
+    int ok = (id < TEST_PRODUCERS) && (seq < TEST_PER_PRODUCER) && (image->len == test_len(seq));
+
+    for(size_t i = 8; ok && (i < image->len); i++)
+        ok = (image->data[i] == test_byte(id, seq, i));
+
+    if(!ok || (atomic_fetch_add(&test_seen[id * TEST_PER_PRODUCER + seq], 1) != 0))
+        atomic_fetch_add(&test_bad, 1);
+}
+
+/*
+ * @brief Consumer taking batches if 'arg' is non-NULL, single images otherwise.
+ */
+static void *test_consumer(void *arg)
+{
+    const size_t total = (size_t)TEST_PRODUCERS * TEST_PER_PRODUCER;
+
+    while(atomic_load(&test_consumed) < total)
+    {
+        uint32_t    slots[TEST_BATCH];
+        nfc_image_t images[TEST_BATCH];
+        size_t      cnt = 1;
+
+        nfc_ring_status_t rslt = (arg != NULL) ?
+                                 nfc_ring_consume_batch(test_ring, slots, images, TEST_BATCH, &cnt) :
+                                 nfc_ring_consume(test_ring, &slots[0], &images[0]);
+
+        if(rslt != NFC_RING_OK)
+        {
+            sched_yield();
+            continue;
+        }
+
+        for(size_t i = 0; i < cnt; i++)
+            test_check_image(&images[i]);
+
+        if(arg != NULL)
+            nfc_ring_release_batch(test_ring, slots, cnt);
+        else
+            nfc_ring_release(test_ring, slots[0]);
+
+        atomic_fetch_add(&test_consumed, cnt);
+    }
+
+    return NULL;
+}
+
+int main(void)
+{
+    nfc_ring_t *bad;
+
+    TEST_CHECK(nfc_ring_create(&bad, 48, TEST_SLOT_SIZE) == NFC_RING_E_INVALID_ARGS);
+    TEST_CHECK(nfc_ring_create(&test_ring, TEST_SLOTS, TEST_SLOT_SIZE) == NFC_RING_OK);
+
+    pthread_t threads[TEST_PRODUCERS + TEST_CONSUMERS];
+
+    for(uintptr_t i = 0; i < TEST_PRODUCERS; i++)
+        TEST_CHECK(pthread_create(&threads[i], NULL, test_producer, (void *)i) == 0);
+    for(uintptr_t i = 0; i < TEST_CONSUMERS; i++)
+        TEST_CHECK(pthread_create(&threads[TEST_PRODUCERS + i], NULL, test_consumer,
+                                  (i % 2 == 0) ? (void *)1 : NULL) == 0);
+    for(size_t i = 0; i < TEST_PRODUCERS + TEST_CONSUMERS; i++)
+        pthread_join(threads[i], NULL);
+
+    TEST_CHECK(atomic_load(&test_bad) == 0);
+    TEST_CHECK(atomic_load(&test_consumed) == (size_t)TEST_PRODUCERS * TEST_PER_PRODUCER);
+
+    /* Every slot is free again and nothing is left to consume. */
+    uint32_t    slot;
+    nfc_image_t image;
+    size_t      free_cnt = 0;
+
+    TEST_CHECK(nfc_ring_consume(test_ring, &slot, &image) == NFC_RING_E_EMPTY);
+    while(nfc_ring_acquire(test_ring, &slot, &image) == NFC_RING_OK)
+        free_cnt++;
+    TEST_CHECK(free_cnt == TEST_SLOTS);
+
+    nfc_ring_destroy(test_ring);
+
+    return test_report("nfc_ring_test");
+}
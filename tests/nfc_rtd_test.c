@@ -0,0 +1,385 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_rtd_test.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_rtd_test.c
+ * @brief UTF-8 validation and UTF-16 conversion against scalar references.
+ */
+
+/*
+ * The vector paths change with ARCH, so run the tests in each build:
+ *
+ *     make test && make BUILD=build/native ARCH=-march=native test
+ */
+#include <string.h>
+
+#include "nfc_rtd.h"
+#include "nfc_test.h"
+
+#define TEST_ROUNDS     20000
+#define TEST_MAX_TEXT   600
+
+static uint32_t test_seed = 12345;
+
+static uint32_t test_rand(void)
+{
+    test_seed ^= test_seed << 13;
+    test_seed ^= test_seed >> 17;
+    test_seed ^= test_seed << 5;
+    return test_seed;
+}
+
+/*
+ * @brief Reference UTF-8 validator.
+ *
+ * @return Length of the longest valid prefix.
+ */
+static size_t test_utf8_valid(const uint8_t *s, size_t n)
+{
+    size_t i = 0;
+
+    while(i < n)
+    {
+        uint8_t  c = s[i];
+        uint32_t cp;
+        size_t   k;
+
+        if(c < 0x80)
+        {
+            i++;
+            continue;
+        }
+        else if((c & 0xE0) == 0xC0)
+        {
+            k  = 1;
+            cp = c & 0x1F;
+        }
+        else if((c & 0xF0) == 0xE0)
+        {
+            k  = 2;
+            cp = c & 0x0F;
+        }
+        else if((c & 0xF8) == 0xF0)
+        {
+            k  = 3;
+            cp = c & 0x07;
+        }
+        else
+        {
+            return i;
+        }
+
+        if(i + k >= n)
+            return i;
+        for(size_t j = 1; j <= k; j++)
+        {
+            if((s[i + j] & 0xC0) != 0x80)
+                return i;
+            cp = (cp << 6) | (s[i + j] & 0x3F);
+        }
+        if(((k == 1) && (cp < 0x80)) || ((k == 2) && (cp < 0x800)) || ((k == 3) && (cp < 0x10000)) ||
+           (cp > 0x10FFFF) || ((cp >= 0xD800) && (cp <= 0xDFFF)))
+            return i;
+        i += k + 1;
+    }
+
+    return n;
+}
+
+static size_t test_utf8_put(uint32_t cp, uint8_t *o)
+{
+    if(cp < 0x80)
+    {
+        o[0] = (uint8_t)cp;
+        return 1;
+    }
+    if(cp < 0x800)
+    {
+        o[0] = (uint8_t)(0xC0 | (cp >> 6));
+        o[1] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if(cp < 0x10000)
+    {
+        o[0] = (uint8_t)(0xE0 | (cp >> 12));
+        o[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+        o[2] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    o[0] = (uint8_t)(0xF0 | (cp >> 18));
+    o[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+    o[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+    o[3] = (uint8_t)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static void test_utf16_put(uint16_t u, int le, uint8_t *o)
+{
+    o[le ? 1 : 0] = (uint8_t)(u >> 8);
+    o[le ? 0 : 1] = (uint8_t)u;
+}
+
+/*
+ * @brief Reference UTF-16 to UTF-8 conversion.
+ *
+ * @return Number of bytes written, or (size_t)-1 if the text is not valid UTF-16.
+ */
+static size_t test_utf16_conv(const uint8_t *s, size_t n, int le, uint8_t *out)
+{
+    size_t o = 0;
+
+    if(n & 1)
+        return (size_t)-1;
+
+    for(size_t i = 0; i < n; i += 2)
+    {
+        uint32_t cp = le ? (uint32_t)(s[i] | (s[i + 1] << 8)) : (uint32_t)((s[i] << 8) | s[i + 1]);
+
+        if((cp >= 0xDC00) && (cp <= 0xDFFF))
+            return (size_t)-1;
+        if((cp >= 0xD800) && (cp <= 0xDBFF))
+        {
+            if(i + 4 > n)
+                return (size_t)-1;
+
+            uint32_t lo = le ? (uint32_t)(s[i + 2] | (s[i + 3] << 8)) : (uint32_t)((s[i + 2] << 8) | s[i + 3]);
+
+            if((lo < 0xDC00) || (lo > 0xDFFF))
+                return (size_t)-1;
+            cp  = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            i  += 2;
+        }
+        o += test_utf8_put(cp, out + o);
+    }
+
+    return o;
+}
+
+/*
+ * @brief Random code point: ASCII, 2-byte, 3-byte or 4-byte in UTF-8, or any (mode 4).
+ */
+static uint32_t test_code_point(unsigned mode)
+{
+    switch((mode == 4) ? test_rand() % 4 : mode)
+    {
+        case 0:
+            return test_rand() % 0x80;
+        case 1:
+            return 0x80 + test_rand() % 0x780;
+        case 2:
+        {
+            uint32_t cp;
+
+            do
+                cp = 0x800 + test_rand() % 0xF800;
+            while((cp >= 0xD800) && (cp < 0xE000));
+            return cp;
+        }
+        default:
+            return 0x10000 + test_rand() % 0x100000;
+    }
+}
+
+/*
+ * @brief Random text in both encodings, converted, mutated and checked again.
+ */
+static void test_random(void)
+{
+    static uint8_t utf8[TEST_MAX_TEXT], utf16[2 * TEST_MAX_TEXT];
+    static uint8_t out[RTD_TEXT_UTF8_MAX_SIZE(2 * TEST_MAX_TEXT)], ref[sizeof(out)];
+
+    for(int round = 0; round < TEST_ROUNDS; round++)
+    {
+        unsigned mode   = test_rand() % 6;
+        size_t   target = test_rand() % 300;
+        int      le     = test_rand() & 1;
+        size_t   n      = 0;
+        size_t   m      = 0;
+
+        /* Mode 5 is mostly ASCII with the odd wider character. */
+        while(n < target)
+        {
+            uint32_t cp = (mode == 5) ? ((test_rand() % 3) ? test_rand() % 0x80 : test_code_point(4)) :
+                                        test_code_point(mode);
+
+            if(n + 4 > sizeof(utf8))
+                break;
+            n += test_utf8_put(cp, utf8 + n);
+            if(cp < 0x10000)
+            {
+                test_utf16_put((uint16_t)cp, le, utf16 + m);
+                m += 2;
+            }
+            else
+            {
+                test_utf16_put((uint16_t)(0xD800 | ((cp - 0x10000) >> 10)), le, utf16 + m);
+                test_utf16_put((uint16_t)(0xDC00 | ((cp - 0x10000) & 0x3FF)), le, utf16 + m + 2);
+                m += 4;
+            }
+        }
+
+        size_t       bw = 0;
+        size_t       valid;
+        rtd_status_t rslt;
+
+        rslt = rtd_utf16_to_utf8(utf16, m, (uint8_t)le, (char *)out, RTD_TEXT_UTF8_MAX_SIZE(m), &bw);
+        TEST_CHECK((rslt == RTD_OK) && (bw == n) && (memcmp(out, utf8, n) == 0));
+        TEST_CHECK((rtd_utf8_validate(utf8, n, &valid) == RTD_OK) && (valid == n));
+
+        /* Flip a few bytes, to random values or to continuation bytes, and maybe truncate. */
+        for(unsigned q = test_rand() % 3; (q > 0) && (n > 0); q--)
+            utf8[test_rand() % n] = (test_rand() & 1) ? (uint8_t)test_rand() : (uint8_t)(0x80 | test_rand() % 64);
+        if((test_rand() % 4 == 0) && (n > 3))
+            n -= test_rand() % 4;
+
+        size_t expect = test_utf8_valid(utf8, n);
+
+        rslt = rtd_utf8_validate(utf8, n, &valid);
+        TEST_CHECK(valid == expect);
+        TEST_CHECK((rslt == RTD_OK) == (expect == n));
+
+        /* Turn a code unit into a high surrogate, which may leave it unpaired. */
+        if(m >= 4)
+        {
+            utf16[(test_rand() % (m / 2)) * 2 + (le ? 1 : 0)] = (uint8_t)(0xD8 | (test_rand() & 7));
+
+            expect = test_utf16_conv(utf16, m, le, ref);
+            rslt   = rtd_utf16_to_utf8(utf16, m, (uint8_t)le, (char *)out, RTD_TEXT_UTF8_MAX_SIZE(m), &bw);
+            if(expect == (size_t)-1)
+                TEST_CHECK(rslt == RTD_E_INVALID_TEXT);
+            else
+                TEST_CHECK((rslt == RTD_OK) && (bw == expect) && (memcmp(out, ref, expect) == 0));
+        }
+    }
+}
+
+/*
+ * @brief A bad sequence at every offset around the 16- and 32-byte blocks.
+ */
+static void test_utf8_edges(void)
+{
+    static const uint8_t c2s[]  = { 0x00, 0x41, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xC2, 0xE0, 0xF0, 0xFF };
+    static const uint8_t c3s[]  = { 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0x41, 0xC0 };
+    static const uint8_t c4s[]  = { 0x80, 0xBF, 0x41 };
+    static const size_t  offs[] = { 0, 14, 15, 30, 31, 61, 62, 63 };
+    static const size_t  lens[] = { 64, 62, 70 };
+    uint8_t              b[80];
+
+    for(unsigned c1 = 0x80; c1 < 0x100; c1++)
+        for(size_t i2 = 0; i2 < sizeof(c2s); i2++)
+            for(size_t i3 = 0; i3 < sizeof(c3s); i3++)
+                for(size_t i4 = 0; i4 < sizeof(c4s); i4++)
+                    for(size_t o = 0; o < sizeof(offs) / sizeof(offs[0]); o++)
+                        for(size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++)
+                        {
+                            const uint8_t q[4] = { (uint8_t)c1, c2s[i2], c3s[i3], c4s[i4] };
+                            size_t        len  = lens[l];
+                            size_t        off  = offs[o];
+                            size_t        valid;
+
+                            if(off >= len)
+                                continue;
+
+                            memset(b, 'a', sizeof(b));
+                            for(size_t k = 0; (k < 4) && (off + k < len); k++)
+                                b[off + k] = q[k];
+
+                            rtd_utf8_validate(b, len, &valid);
+                            TEST_CHECK(valid == test_utf8_valid(b, len));
+                        }
+}
+
+/*
+ * @brief Runs of ASCII and 2-byte characters, which take the vector paths.
+ */
+static void test_utf16_runs(void)
+{
+    static uint8_t utf16[512], out[1024], ref[1024];
+
+    for(int round = 0; round < TEST_ROUNDS; round++)
+    {
+        size_t n  = test_rand() % 200;
+        size_t r  = 0;
+        int    le = test_rand() & 1;
+
+        for(size_t i = 0; i < n; i++)
+        {
+            uint16_t cp = (test_rand() & 1) ? test_rand() % 0x80 : 0x80 + test_rand() % 0x780;
+
+            test_utf16_put(cp, le, utf16 + 2 * i);
+            r += test_utf8_put(cp, ref + r);
+        }
+
+        /* Sometimes an output buffer of the exact size. */
+        size_t cap = r + ((test_rand() % 3 == 0) ? 0 : test_rand() % 40);
+        size_t bw  = 0;
+
+        TEST_CHECK(rtd_utf16_to_utf8(utf16, 2 * n, (uint8_t)le, (char *)out, cap, &bw) == RTD_OK);
+        TEST_CHECK((bw == r) && (memcmp(out, ref, r) == 0));
+    }
+}
+
+static void test_text(void)
+{
+    uint8_t       ascii[32] = { 0 };
+    uint8_t       payload[] = { 0x82, 'e', 'n', 0xFF, 0xFE, 'H', 0, 'i', 0, 0xAC, 0x20 };
+    char          out[32];
+    size_t        bw;
+    ndef_record_t rec;
+    rtd_text_t    text;
+
+    for(size_t i = 0; i < sizeof(ascii); i += 2)
+        ascii[i + 1] = 'a';
+
+    TEST_CHECK(rtd_utf16_to_utf8(ascii, sizeof(ascii), 0, out, 15, &bw) == RTD_E_INVALID_ARGS);
+    TEST_CHECK(rtd_utf16_to_utf8((const uint8_t *)"\xDC\x00", 2, 0, out, sizeof(out), &bw) == RTD_E_INVALID_TEXT);
+    TEST_CHECK(rtd_utf16_to_utf8((const uint8_t *)"\x00", 1, 0, out, sizeof(out), &bw) == RTD_E_INVALID_TEXT);
+
+    /* UTF-16LE with a byte order mark: "Hi" and the euro sign. */
+    memset(&rec, 0, sizeof(rec));
+    rec.header      = TNF_WELL_KNOWN;
+    rec.type        = (uint8_t *)"T";
+    rec.type_len    = 1;
+    rec.payload     = payload;
+    rec.payload_len = sizeof(payload);
+
+    TEST_CHECK(rtd_text_decode(&rec, &text) == RTD_OK);
+    TEST_CHECK(text.utf16 && (text.lang.len == 2));
+    TEST_CHECK(rtd_text_to_utf8(&text, out, sizeof(out), &bw) == RTD_OK);
+    TEST_CHECK((bw == 5) && (memcmp(out, "Hi\xE2\x82\xAC", 5) == 0));
+}
+
+int main(void)
+{
+    test_random();
+    test_utf8_edges();
+    test_utf16_runs();
+    test_text();
+
+    return test_report("nfc_rtd_test");
+}
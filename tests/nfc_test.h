@@ -0,0 +1,65 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_test.h
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_test.h
+ * @brief Minimal check helpers shared by the tests.
+ */
+#ifndef _NFC_TEST_H_
+#define _NFC_TEST_H_
+
+#include <stdio.h>
+
+/*
+ * @brief Record a failed check and carry on, so one run reports every failure.
+ */
+#define TEST_CHECK(__C__)   test_check((__C__) != 0, #__C__, __FILE__, __LINE__)
+
+static int test_failures;
+
+static inline void test_check(int ok, const char *expr, const char *file, int line)
+{
+    if(!ok)
+    {
+        test_failures++;
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    }
+}
+
+/*
+ * @brief Print the outcome of a test program.
+ *
+ * @return Exit status of the program: 0 when every check passed.
+ */
+static inline int test_report(const char *name)
+{
+    printf("%-20s %s\n", name, (test_failures == 0) ? "ok" : "FAILED");
+    return test_failures != 0;
+}
+
+#endif /* _NFC_TEST_H_ */
@@ -0,0 +1,340 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        type_2_tag_test.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file type_2_tag_test.c
+ * @brief Type 2 Tag write planner, checked WRITE by WRITE on an emulated tag.
+ */
+#include <string.h>
+
+#include "nfc_corpus.h"
+#include "nfc_t2t_emu.h"
+#include "nfc_test.h"
+#include "nfc_tlv_block.h"
+#include "type_2_tag.h"
+
+#define TEST_PER_KIND       4
+#define TEST_MAX_TLVS       16
+#define TEST_MAX_AREAS      8
+#define TEST_MAX_WRITES     256
+#define TEST_IMAGE_SIZE     1024
+#define TEST_SMALL_SIZE     80      /* Hand-built tag: 64-byte data area */
+
+/*
+ * @brief NDEF message found on the tag after a WRITE.
+ */
+typedef enum
+{
+    TEST_OLD,
+    TEST_NEW,
+    TEST_EMPTY,     /* NDEF TLV of length 0        */
+    TEST_NONE,      /* No NDEF TLV                 */
+    TEST_BAD        /* Unparsable or another message */
+} test_state_t;
+
+typedef struct
+{
+    const uint8_t *data;
+    size_t        len;
+} test_msg_t;
+
+static void test_fill(uint8_t *buf, size_t len, uint32_t seed)
+{
+    for(size_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)(seed * 131 + i * 7);
+}
+
+static int test_msg_eq(const test_msg_t *msg, const uint8_t *data, size_t len)
+{
+    return (msg->len == len) && ((len == 0) || (memcmp(msg->data, data, len) == 0));
+}
+
+static test_state_t test_state(uint8_t *image, const test_msg_t *old, const test_msg_t *new)
+{
+    tlv_t        tlvs[TEST_MAX_TLVS];
+    type_2_tag_t tag = { .max_tlv_blocks = TEST_MAX_TLVS, .p_tlv_block_array = tlvs };
+    uint8_t      msg[TEST_IMAGE_SIZE];
+    size_t       len;
+
+    if(type_2_tag_parse(&tag, image) != T2T_OK)
+        return TEST_BAD;
+
+    type_2_tag_status_t rslt = type_2_tag_ndef_copy(image, msg, sizeof(msg), &len);
+
+    if(rslt == T2T_E_NOT_FOUND)
+        return TEST_NONE;
+    if(rslt != T2T_OK)
+        return TEST_BAD;
+    if(test_msg_eq(new, msg, len))
+        return TEST_NEW;
+    if(test_msg_eq(old, msg, len))
+        return TEST_OLD;
+
+    return (len == 0) ? TEST_EMPTY : TEST_BAD;
+}
+
+/*
+ * @brief Store a message on a tag image, checking the message the tag holds after every WRITE.
+ *
+ * @param[in,out] image     : Tag image, updated on success.
+ * @param[in]     size      : Size of the image.
+ * @param[in]     allow_none: Whether an interrupted update may leave no NDEF TLV.
+ *
+ * @return Status of the planner.
+ */
+static type_2_tag_status_t test_update(uint8_t *image, size_t size, const uint8_t *msg, size_t msg_len,
+                                       int allow_none)
+{
+    static type_2_tag_write_t writes[TEST_MAX_WRITES];
+    static uint8_t            new_image[TEST_IMAGE_SIZE];
+    static uint8_t            work[TEST_IMAGE_SIZE];
+    static uint8_t            old_data[TEST_IMAGE_SIZE];
+
+    size_t     old_len  = 0;
+    test_msg_t old      = { old_data, 0 };
+    test_msg_t new      = { msg, msg_len };
+    size_t     cnt;
+
+    if(type_2_tag_ndef_copy(image, old_data, sizeof(old_data), &old_len) == T2T_OK)
+        old.len = old_len;
+
+    type_2_tag_status_t rslt = type_2_tag_write_plan(image, msg, msg_len, new_image, writes, TEST_MAX_WRITES, &cnt);
+    if(rslt != T2T_OK)
+        return rslt;
+
+    tlv_t         tlvs[TEST_MAX_TLVS];
+    type_2_tag_t  tag = { .max_tlv_blocks = TEST_MAX_TLVS, .p_tlv_block_array = tlvs };
+    nfc_t2t_emu_t emu;
+
+    memcpy(work, image, size);
+    TEST_CHECK(nfc_t2t_emu_init(&emu, work, size, &tag, NULL) == NFC_T2T_EMU_OK);
+    TEST_CHECK(test_state(work, &old, &new) == (test_msg_eq(&old, msg, msg_len) ? TEST_NEW : TEST_OLD));
+
+    for(size_t i = 0; i < cnt; i++)
+    {
+        TEST_CHECK(writes[i].block_no < NFC_T2T_EMU_SECTOR_BLOCKS);
+        TEST_CHECK(nfc_t2t_emu_write(&emu, (uint8_t)writes[i].block_no, writes[i].data) == NFC_T2T_EMU_OK);
+
+        test_state_t state = test_state(work, &old, &new);
+
+        if((i + 1 == cnt) || ((allow_none && (state == TEST_NONE))))
+            continue;
+
+        TEST_CHECK((state == TEST_OLD) || (state == TEST_NEW) || (state == TEST_EMPTY));
+
+        /* The first of several WRITE commands takes the old message down. */
+        if((i == 0) && (cnt > 1) && (old.len != 0))
+            TEST_CHECK(state != TEST_OLD);
+    }
+
+    TEST_CHECK(test_state(work, &old, &new) == TEST_NEW);
+    TEST_CHECK(memcmp(work, new_image, size) == 0);
+
+    nfc_t2t_emu_deinit(&emu);
+    memcpy(image, work, size);
+
+    return T2T_OK;
+}
+
+/*
+ * @brief Rewrite corpus images with messages growing and shrinking across both length formats.
+ */
+static void test_corpus(void)
+{
+    static const size_t ntag_lens[]  = { 307, 123, 0, 254, 255, 1, 876, 40, 600 };
+    static const size_t light_lens[] = { 30, 0, 44, 12, 45, 1 };
+
+    uint8_t msg[TEST_IMAGE_SIZE];
+
+    for(int kind = 0; kind < NFC_CORPUS_KIND_CNT; kind++)
+    {
+        nfc_corpus_t corpus;
+
+        TEST_CHECK(nfc_corpus_generate(&corpus, (nfc_corpus_kind_t)kind, TEST_PER_KIND, 7 + kind) == 0);
+
+        const size_t *lens = (kind == NFC_CORPUS_ULTRALIGHT) ? light_lens : ntag_lens;
+        size_t        cnt  = (kind == NFC_CORPUS_ULTRALIGHT) ? sizeof(light_lens) / sizeof(light_lens[0]) :
+                                                               sizeof(ntag_lens) / sizeof(ntag_lens[0]);
+
+        for(size_t n = 0; n < corpus.image_cnt; n++)
+        {
+            for(size_t i = 0; i < cnt; i++)
+            {
+                test_fill(msg, lens[i], (uint32_t)(n * 16 + i));
+                TEST_CHECK(test_update(nfc_corpus_image(&corpus, n), corpus.image_size, msg, lens[i], 0) == T2T_OK);
+            }
+        }
+
+        nfc_corpus_free(&corpus);
+    }
+}
+
+/*
+ * @brief Capacity and WRITE count limits.
+ */
+static void test_limits(void)
+{
+    static type_2_tag_write_t writes[TEST_MAX_WRITES];
+    static uint8_t            new_image[TEST_IMAGE_SIZE];
+
+    nfc_corpus_t corpus;
+    uint8_t      msg[TEST_IMAGE_SIZE];
+    size_t       cnt;
+
+    TEST_CHECK(nfc_corpus_generate(&corpus, NFC_CORPUS_NTAG216, 1, 3) == 0);
+    uint8_t *image = nfc_corpus_image(&corpus, 0);
+
+    /* 888 bytes less the Lock Control TLV, 3 bytes of padding and a 4-byte header. */
+    test_fill(msg, sizeof(msg), 1);
+    TEST_CHECK(type_2_tag_write_plan(image, msg, 877, new_image, writes, TEST_MAX_WRITES, &cnt) == T2T_E_NO_MEM);
+    TEST_CHECK(type_2_tag_write_plan(image, msg, 876, new_image, writes, TEST_MAX_WRITES, &cnt) == T2T_OK);
+
+    TEST_CHECK(type_2_tag_write_plan(image, msg, 100, new_image, writes, 2, &cnt) == T2T_E_NO_MEM);
+    TEST_CHECK(cnt > 2);
+    TEST_CHECK(type_2_tag_write_plan(image, msg, 100, new_image, NULL, 0, &cnt) == T2T_E_NO_MEM);
+    TEST_CHECK(type_2_tag_write_plan(image, msg, 100, new_image, writes, cnt, &cnt) == T2T_OK);
+
+    /* Storing the same message again takes no WRITE command. */
+    TEST_CHECK(test_update(image, corpus.image_size, msg, 100, 0) == T2T_OK);
+    TEST_CHECK(type_2_tag_write_plan(image, msg, 100, new_image, writes, TEST_MAX_WRITES, &cnt) == T2T_OK);
+    TEST_CHECK(cnt == 0);
+
+    nfc_corpus_free(&corpus);
+}
+
+/*
+ * @brief Store bytes in the data area of a hand-built tag, around its reserved areas.
+ */
+static void test_put(const type_2_tag_vmem_t *vmem, size_t offset, const uint8_t *data, size_t len)
+{
+    while(len > 0)
+    {
+        uint8_t *p;
+        size_t  run = type_2_tag_vmem_span(vmem, offset, &p);
+
+        TEST_CHECK(run != 0);
+        if(run == 0)
+            return;
+        if(run > len)
+            run = len;
+
+        memcpy(p, data, run);
+        offset += run;
+        data   += run;
+        len    -= run;
+    }
+}
+
+/*
+ * @brief Build a tag with a 64-byte data area, the given control TLVs and a 20-byte message after them.
+ */
+static void test_build(uint8_t *image, const uint8_t *ctrl, size_t ctrl_len)
+{
+    static const uint8_t head[T2T_FIRST_DATA_BLOCK_OFFSET] =
+    {
+        0x04, 0x11, 0x22, 0x88 ^ 0x04 ^ 0x11 ^ 0x22,
+        0x33, 0x44, 0x55, 0x66, 0x33 ^ 0x44 ^ 0x55 ^ 0x66, 0x48, 0x00, 0x00,
+        T2T_NFC_FORUM_DEFINED_DATA, 0x10, 64 / T2T_DATA_AREA_SIZE_UNIT, 0x00
+    };
+
+    memset(image, 0, TEST_SMALL_SIZE);
+    memcpy(image, head, sizeof(head));
+    memcpy(image + T2T_FIRST_DATA_BLOCK_OFFSET, ctrl, ctrl_len);
+
+    tlv_t                 tlvs[TEST_MAX_TLVS];
+    type_2_tag_t          tag = { .max_tlv_blocks = TEST_MAX_TLVS, .p_tlv_block_array = tlvs };
+    type_2_tag_reserved_t areas[TEST_MAX_AREAS];
+    uint8_t               area_cnt;
+    type_2_tag_vmem_t     vmem;
+    uint8_t               tlv[2 + 20 + 1] = { TLV_NDEF_MESSAGE, 20 };
+
+    TEST_CHECK(type_2_tag_parse(&tag, image) == T2T_OK);
+    TEST_CHECK(type_2_tag_reserved_map(&tag, areas, TEST_MAX_AREAS, &area_cnt) == T2T_OK);
+    TEST_CHECK(type_2_tag_vmem_init(&vmem, image, TEST_SMALL_SIZE, areas, area_cnt) == T2T_OK);
+
+    test_fill(tlv + 2, 20, 99);
+    tlv[sizeof(tlv) - 1] = TLV_TERMINATOR;
+    test_put(&vmem, ctrl_len, tlv, sizeof(tlv));
+}
+
+/*
+ * @brief Tags whose reserved areas or control TLVs push the NDEF TLV around.
+ */
+static void test_reserved(void)
+{
+    /* Reserved bytes 28-31 split the old message; the new TLV starts block 6. */
+    static const uint8_t split[] = { TLV_MEMORY_CONTROL, 3, 0x1C, 4, 0x04 };
+    /* Reserved bytes 24-25 sit where the header would go; the new TLV starts block 7. */
+    static const uint8_t shifted[] = { TLV_MEMORY_CONTROL, 3, 0x18, 2, 0x04 };
+    /* The old TLV starts 2 bytes before the end of block 6. */
+    static const uint8_t late[] =
+    {
+        TLV_MEMORY_CONTROL, 3, 0x1C, 4, 0x04, TLV_MEMORY_CONTROL, 3, 0x3C, 2, 0x04
+    };
+
+    static const struct
+    {
+        const uint8_t *ctrl;
+        size_t        ctrl_len;
+        int           allow_none;
+        size_t        max_len;      /* Longest message that fits */
+    } tags[] =
+    {
+        { split,   sizeof(split),   0, 64 - 4 - 8 - 2 },
+        { shifted, sizeof(shifted), 0, 64 - 2 - 10 - 2 },
+        { late,    sizeof(late),    1, 64 - 6 - 12 - 2 },
+    };
+
+    uint8_t image[TEST_SMALL_SIZE];
+    uint8_t msg[64];
+
+    for(size_t t = 0; t < sizeof(tags) / sizeof(tags[0]); t++)
+    {
+        size_t lens[] = { 30, 0, tags[t].max_len, 5, 17 };
+
+        test_build(image, tags[t].ctrl, tags[t].ctrl_len);
+
+        for(size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++)
+        {
+            test_fill(msg, lens[i], (uint32_t)(t * 8 + i));
+            TEST_CHECK(test_update(image, TEST_SMALL_SIZE, msg, lens[i], tags[t].allow_none) == T2T_OK);
+        }
+
+        test_fill(msg, sizeof(msg), 5);
+        TEST_CHECK(test_update(image, TEST_SMALL_SIZE, msg, tags[t].max_len + 1, 0) == T2T_E_NO_MEM);
+    }
+}
+
+int main(void)
+{
+    test_corpus();
+    test_limits();
+    test_reserved();
+
+    return test_report("type_2_tag_test");
+}
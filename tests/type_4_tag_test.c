@@ -0,0 +1,231 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        type_4_tag_test.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file type_4_tag_test.c
+ * @brief Type 4 Tag CC parsing and read planner against a simulated tag.
+ */
+#include <string.h>
+
+#include "nfc_test.h"
+#include "type_4_tag.h"
+
+#define TEST_FILE_SIZE  70000   /* Largest NDEF file of the simulated tags. */
+
+static uint8_t test_file[TEST_FILE_SIZE];
+static uint8_t test_raw[TEST_FILE_SIZE];
+static uint8_t test_rsp[TEST_FILE_SIZE + 8];
+
+/*
+ * @brief Layout of the simulated tag.
+ */
+typedef struct
+{
+    uint8_t  ext;           /* Version 3 CC with an ENDEF File Control TLV */
+    uint16_t mle;
+    uint32_t reader_le;     /* Largest response the reader accepts         */
+    uint32_t msg_len;
+    uint32_t file_size;
+} test_t4t_t;
+
+static uint32_t test_be(const uint8_t *p, size_t n)
+{
+    uint32_t v = 0;
+
+    for(size_t i = 0; i < n; i++)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+/*
+ * @brief Answer a READ BINARY APDU from the NDEF file.
+ *
+ * @return Length of the response APDU, or 0 if the command is malformed.
+ */
+static size_t test_t4t_serve(const uint8_t *apdu, size_t len)
+{
+    uint32_t offset, le;
+    size_t   p = 0;
+
+    if(apdu[1] == T4T_INS_READ_BINARY)
+    {
+        offset = test_be(apdu + 2, 2);
+        if(len == 5)
+            le = (apdu[4] != 0) ? apdu[4] : 256;
+        else if((len == 7) && (apdu[4] == 0))
+            le = (test_be(apdu + 5, 2) != 0) ? test_be(apdu + 5, 2) : 65536;
+        else
+            return 0;
+
+        if(offset + le > TEST_FILE_SIZE)
+            return 0;
+        memcpy(test_rsp, test_file + offset, le);
+        p = le;
+    }
+    else
+    {
+        /* B1: offset data object 54 03 xx xx xx, response wrapped in a 53 object. */
+        int    ext = (apdu[4] == 0);
+        size_t q   = ext ? 7 : 5;
+
+        if((apdu[q] != 0x54) || (apdu[q + 1] != 3))
+            return 0;
+        offset = test_be(apdu + q + 2, 3);
+        q     += 5;
+
+        if(ext)
+        {
+            le = test_be(apdu + q, 2);
+            q += 2;
+        }
+        else
+        {
+            le = (apdu[q] != 0) ? apdu[q] : 256;
+            q++;
+        }
+        if(q != len)
+            return 0;
+
+        /* Return as much data as fits in Le together with the object header. */
+        uint32_t n = (le <= 0x81) ? le - 2 : (le <= 0x102) ? le - 3 : le - 4;
+
+        if(offset + n > TEST_FILE_SIZE)
+            return 0;
+
+        test_rsp[p++] = 0x53;
+        if(n < 0x80)
+        {
+            test_rsp[p++] = (uint8_t)n;
+        }
+        else if(n <= 0xFF)
+        {
+            test_rsp[p++] = 0x81;
+            test_rsp[p++] = (uint8_t)n;
+        }
+        else
+        {
+            test_rsp[p++] = 0x82;
+            test_rsp[p++] = (uint8_t)(n >> 8);
+            test_rsp[p++] = (uint8_t)n;
+        }
+        memcpy(test_rsp + p, test_file + offset, n);
+        p += n;
+    }
+
+    test_rsp[p++] = (uint8_t)(T4T_SW_OK >> 8);
+    test_rsp[p++] = (uint8_t)T4T_SW_OK;
+    return p;
+}
+
+/*
+ * @brief Read the NDEF message of a simulated tag with the planner.
+ */
+static void test_t4t_read(const test_t4t_t *t)
+{
+    uint8_t cc[T4T_CC_EXT_SIZE] = { 0, 0, 0, (uint8_t)(t->mle >> 8), (uint8_t)t->mle, 0, 0xFF };
+    size_t  nlen;
+
+    if(t->ext)
+    {
+        const uint8_t ctrl[] = { T4T_ENDEF_FILE_CTRL_TLV, 8, 0xE1, 0x04,
+                                 (uint8_t)(t->file_size >> 24), (uint8_t)(t->file_size >> 16),
+                                 (uint8_t)(t->file_size >> 8), (uint8_t)t->file_size, 0, 0 };
+        cc[1] = T4T_CC_EXT_SIZE;
+        cc[2] = 0x30;
+        memcpy(cc + 7, ctrl, sizeof(ctrl));
+        nlen = T4T_ENLEN_SIZE;
+    }
+    else
+    {
+        const uint8_t ctrl[] = { T4T_NDEF_FILE_CTRL_TLV, 6, 0xE1, 0x04,
+                                 (uint8_t)(t->file_size >> 8), (uint8_t)t->file_size, 0, 0 };
+        cc[1] = T4T_CC_SIZE;
+        cc[2] = 0x20;
+        memcpy(cc + 7, ctrl, sizeof(ctrl));
+        nlen = T4T_NLEN_SIZE;
+    }
+
+    type_4_tag_capability_container_t cap;
+
+    TEST_CHECK(type_4_tag_cc_parse(&cap, cc, cc[1]) == T4T_OK);
+    TEST_CHECK(cap.nlen_size == nlen);
+    TEST_CHECK(cap.max_file_size == t->file_size);
+
+    memset(test_file, 0, sizeof(test_file));
+    memset(test_raw, 0xAA, sizeof(test_raw));
+    for(size_t i = 0; i < nlen; i++)
+        test_file[i] = (uint8_t)(t->msg_len >> (8 * (nlen - 1 - i)));
+    for(uint32_t i = 0; i < t->msg_len; i++)
+        test_file[nlen + i] = (uint8_t)(i * 13 + 5);
+
+    type_4_tag_read_plan_t plan;
+    type_4_tag_status_t    rslt;
+    uint32_t               offset, length;
+
+    type_4_tag_read_plan_init(&plan, &cap, sizeof(test_raw), t->reader_le);
+
+    while(((rslt = type_4_tag_read_plan_next(&plan, test_raw, &offset, &length)) == T4T_OK) && !plan.done)
+    {
+        uint8_t apdu[T4T_MAX_APDU_SIZE];
+        size_t  apdu_len;
+
+        TEST_CHECK(length <= t->reader_le);
+        TEST_CHECK(type_4_tag_read_binary_apdu(&plan, apdu, sizeof(apdu), &apdu_len) == T4T_OK);
+
+        size_t rsp_len = test_t4t_serve(apdu, apdu_len);
+        TEST_CHECK(rsp_len != 0);
+        if(rsp_len == 0)
+            return;
+        TEST_CHECK(type_4_tag_read_binary_rsp(&plan, test_rsp, rsp_len, test_raw) == T4T_OK);
+    }
+
+    TEST_CHECK(rslt == T4T_OK);
+    TEST_CHECK(plan.ndef_offset == nlen);
+    TEST_CHECK(plan.ndef_length == t->msg_len);
+    TEST_CHECK(memcmp(test_raw + nlen, test_file + nlen, t->msg_len) == 0);
+}
+
+int main(void)
+{
+    static const test_t4t_t tags[] =
+    {
+        /* Version 2: short and extended Le, offsets within B0 range. */
+        { 0, 0xFF,   256,   1000,  0x1000 },
+        { 0, 0xFFFF, 65536, 30000, 0x8000 },
+        { 0, 0xFF,   256,   10,    0x1000 },
+        /* Version 3: offsets past 0x7FFF need B1. */
+        { 1, 0xFFFF, 65536, 60000, TEST_FILE_SIZE - 8 },
+        { 1, 0xFF,   256,   40000, TEST_FILE_SIZE - 8 },
+        { 1, 0xFFFF, 1024,  50000, 60000 },
+    };
+
+    for(size_t i = 0; i < sizeof(tags) / sizeof(tags[0]); i++)
+        test_t4t_read(&tags[i]);
+
+    return test_report("type_4_tag_test");
+}
@@ -0,0 +1,195 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        type_5_tag_test.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file type_5_tag_test.c
+ * @brief Type 5 Tag read planner against a simulated tag.
+ */
+#include <string.h>
+
+#include "nfc_test.h"
+#include "type_5_tag.h"
+
+#define TEST_MEM_SIZE   70000   /* Tag memory, enough for an 8-byte CC and a 64000-byte data area. */
+
+static uint8_t test_mem[TEST_MEM_SIZE];
+static uint8_t test_raw[TEST_MEM_SIZE];
+
+static const uint8_t test_uid[T5T_UID_SIZE] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+/*
+ * @brief Layout of the simulated tag.
+ */
+typedef struct
+{
+    uint8_t  cc_mlen;       /* MLEN of a 4-byte CC, or 0 for an 8-byte CC */
+    uint16_t ext_mlen;      /* MLEN of an 8-byte CC                        */
+    uint16_t block_size;
+    size_t   max_read;      /* Largest READ response the reader accepts    */
+    size_t   msg_len;
+    size_t   skip;          /* Proprietary TLV bytes ahead of the NDEF TLV */
+    uint8_t  mbread;        /* READ MULTIPLE BLOCKS supported              */
+} test_t5t_t;
+
+/*
+ * @brief Answer a READ command frame from the tag memory.
+ *
+ * @return Number of bytes returned, or 0 if the frame is malformed.
+ */
+static size_t test_t5t_serve(const uint8_t *cmd, size_t len, uint16_t block_size, uint8_t *out)
+{
+    int    ext   = (cmd[1] == T5T_CMD_EXT_READ_SINGLE_BLOCK) || (cmd[1] == T5T_CMD_EXT_READ_MULTIPLE_BLOCKS);
+    int    multi = (cmd[1] == T5T_CMD_READ_MULTIPLE_BLOCKS) || (cmd[1] == T5T_CMD_EXT_READ_MULTIPLE_BLOCKS);
+    size_t p     = 2;
+
+    if(cmd[0] & T5T_FLAG_ADDRESSED)
+    {
+        if(memcmp(cmd + p, test_uid, T5T_UID_SIZE) != 0)
+            return 0;
+        p += T5T_UID_SIZE;
+    }
+
+    size_t block = cmd[p++];
+    if(ext)
+        block |= (size_t)cmd[p++] << 8;
+
+    size_t cnt = 1;
+    if(multi)
+    {
+        cnt = (size_t)cmd[p++] + 1;
+        if(ext)
+            cnt += (size_t)cmd[p++] << 8;
+    }
+
+    if((p != len) || ((block + cnt) * block_size > TEST_MEM_SIZE))
+        return 0;
+
+    memcpy(out, test_mem + block * block_size, cnt * block_size);
+    return cnt * block_size;
+}
+
+/*
+ * @brief Read the NDEF message of a simulated tag with the planner.
+ */
+static void test_t5t_read(const test_t5t_t *t)
+{
+    size_t o;
+
+    memset(test_mem, 0, sizeof(test_mem));
+    memset(test_raw, 0xAA, sizeof(test_raw));
+
+    if(t->cc_mlen != 0)
+    {
+        const uint8_t cc[] = { T5T_CC_MAGIC_1_BYTE_ADDR, 0x40, t->cc_mlen, t->mbread };
+        memcpy(test_mem, cc, sizeof(cc));
+        o = sizeof(cc);
+    }
+    else
+    {
+        const uint8_t cc[] = { T5T_CC_MAGIC_2_BYTE_ADDR, 0x40, 0, t->mbread, 0, 0,
+                               (uint8_t)(t->ext_mlen >> 8), (uint8_t)t->ext_mlen };
+        memcpy(test_mem, cc, sizeof(cc));
+        o = sizeof(cc);
+    }
+
+    if(t->skip != 0)
+    {
+        test_mem[o++] = TLV_PROPRIETARY;
+        test_mem[o++] = 0xFF;
+        test_mem[o++] = (uint8_t)(t->skip >> 8);
+        test_mem[o++] = (uint8_t)t->skip;
+        memset(test_mem + o, 0x5A, t->skip);
+        o += t->skip;
+    }
+
+    test_mem[o++] = TLV_NULL;
+    test_mem[o++] = TLV_NDEF_MESSAGE;
+    if(t->msg_len < 0xFF)
+    {
+        test_mem[o++] = (uint8_t)t->msg_len;
+    }
+    else
+    {
+        test_mem[o++] = 0xFF;
+        test_mem[o++] = (uint8_t)(t->msg_len >> 8);
+        test_mem[o++] = (uint8_t)t->msg_len;
+    }
+
+    size_t msg_offset = o;
+    for(size_t i = 0; i < t->msg_len; i++)
+        test_mem[o++] = (uint8_t)(i * 7 + 1);
+    test_mem[o] = TLV_TERMINATOR;
+
+    type_5_tag_read_plan_t plan;
+    type_5_tag_status_t    rslt;
+    uint16_t               block, cnt;
+
+    type_5_tag_read_plan_init(&plan, sizeof(test_raw), t->block_size, t->max_read);
+
+    while(((rslt = type_5_tag_read_plan_next(&plan, test_raw, &block, &cnt)) == T5T_OK) && !plan.done)
+    {
+        uint8_t cmd[T5T_MAX_CMD_SIZE];
+        size_t  cmd_len;
+
+        /* Alternate between addressed and non-addressed frames. */
+        TEST_CHECK(type_5_tag_read_cmd(&plan, (plan.read_count & 1) ? test_uid : NULL,
+                                       cmd, sizeof(cmd), &cmd_len) == T5T_OK);
+
+        size_t n = test_t5t_serve(cmd, cmd_len, t->block_size, test_raw + (size_t)block * t->block_size);
+        TEST_CHECK(n == (size_t)cnt * t->block_size);
+        TEST_CHECK(n <= t->max_read);
+        if(n == 0)
+            return;
+    }
+
+    TEST_CHECK(rslt == T5T_OK);
+    TEST_CHECK(plan.ndef_offset == msg_offset);
+    TEST_CHECK(plan.ndef_length == t->msg_len);
+    TEST_CHECK(memcmp(test_raw + msg_offset, test_mem + msg_offset, t->msg_len) == 0);
+}
+
+int main(void)
+{
+    static const test_t5t_t tags[] =
+    {
+        /* 4-byte CC, 2040-byte data area. */
+        { 0xFF, 0,    4,  256,  1500,  0,   1 },
+        { 0xFF, 0,    4,  256,  1500,  0,   0 },
+        { 0xFF, 0,    4,  64,   20,    0,   1 },
+        { 0xFF, 0,    4,  1024, 1500,  300, 1 },
+        /* 8-byte CC, 64000-byte data area past block 255. */
+        { 0,    8000, 4,  1024, 60000, 0,   1 },
+        { 0,    8000, 32, 8192, 60000, 40,  1 },
+        { 0,    8000, 4,  1024, 3,     0,   0 },
+    };
+
+    for(size_t i = 0; i < sizeof(tags) / sizeof(tags[0]); i++)
+        test_t5t_read(&tags[i]);
+
+    return test_report("type_5_tag_test");
+}
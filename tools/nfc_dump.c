@@ -0,0 +1,500 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 Sean Farrelly
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * File        nfc_dump.c
+ * Created by  Sean Farrelly
+ * Version     1.0
+ * 
+ */
+
+/*! @file nfc_dump.c
+ * @brief Bulk processor for archives of raw tag images.
+ */
+
+/*
+ * Build from the repository root with "make nfc_dump"; the binary is
+ * build/nfc_dump.
+ *
+ * Usage: nfc_dump [--format jsonl|csv] [--size N|auto] [--trailer N]
+ *                 [--threads N] [--window N] [--archive OUT] ARCHIVE
+ *
+ * The archive is a concatenation of raw Type 2 Tag images, each starting at
+ * block 0. With --size N every image is N bytes (fixed-size dumps). With
+ * --size auto (the default) the size of each image is read from its CC:
+ * blocks 0-3 plus the data area, as written by libnfc, plus --trailer bytes
+ * of configuration pages if the dumps include them.
+ *
+ * The archive is mapped read-only and parsed in place. Images are processed
+ * a window at a time, so when printing summaries memory use is bounded by the
+ * window and not by the size of the archive, and the summaries are written in
+ * archive order.
+ *
+ * With --archive OUT no summaries are printed; every image becomes a row of
+ * a columnar archive (nfc_archive.h) written to OUT, so later queries read
+ * the columns they need instead of parsing the images again. This mode is
+ * NOT bounded by the window: the columns are built in memory and only written
+ * once the last image is parsed. The column buffers grow by doubling, so it
+ * needs between one and two times the size of OUT (the UIDs, CC fields,
+ * record headers and every NDEF payload).
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nfc_archive.h"
+#include "nfc_batch.h"
+#include "nfc_ndef.h"
+#include "nfc_tlv_block.h"
+#include "type_2_tag.h"
+
+#define DUMP_MAX_TLVS       16
+#define DUMP_MAX_RECORDS    64
+#define DUMP_WINDOW         4096    /* Images parsed per batch by default. */
+#define DUMP_UID_LEN        7
+#define DUMP_MAX_NDEF_LEN   (0xFF * T2T_DATA_AREA_SIZE_UNIT)   /* Largest CC data area. */
+
+typedef enum
+{
+    DUMP_FORMAT_JSONL,
+    DUMP_FORMAT_CSV
+} dump_format_t;
+
+typedef struct
+{
+    dump_format_t format;
+    size_t        image_size;   /* 0 for the size given by the CC */
+    size_t        trailer;      /* Bytes after the data area in auto mode */
+    unsigned      threads;      /* 1 parses on the calling thread */
+    size_t        window;
+    const char    *archive;     /* Columnar archive to write, or NULL to print summaries */
+    const char    *path;
+} dump_opts_t;
+
+static void dump_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--format jsonl|csv] [--size N|auto] [--trailer N]\n"
+            "       %*s [--threads N] [--window N] [--archive OUT] ARCHIVE\n"
+            "\n"
+            "--window bounds the memory used for summaries. --archive OUT keeps the\n"
+            "whole columnar archive in memory until it is written: up to twice the size of OUT.\n",
+            prog, (int)strlen(prog), "");
+}
+
+static int dump_parse_size(const char *s, size_t *p_val)
+{
+    char               *end;
+    unsigned long long val = strtoull(s, &end, 0);
+
+    if((*s == '\0') || (*end != '\0'))
+        return -1;
+
+    *p_val = (size_t)val;
+    return 0;
+}
+
+static int dump_parse_opts(int argc, char **argv, dump_opts_t *opts)
+{
+    opts->format     = DUMP_FORMAT_JSONL;
+    opts->image_size = 0;
+    opts->trailer    = 0;
+    opts->threads    = 1;
+    opts->window     = DUMP_WINDOW;
+    opts->archive    = NULL;
+    opts->path       = NULL;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        size_t     num;
+
+        if((strcmp(arg, "--format") == 0) && (val != NULL))
+        {
+            if(strcmp(val, "jsonl") == 0)
+                opts->format = DUMP_FORMAT_JSONL;
+            else if(strcmp(val, "csv") == 0)
+                opts->format = DUMP_FORMAT_CSV;
+            else
+                return -1;
+            i++;
+        }
+        else if((strcmp(arg, "--size") == 0) && (val != NULL))
+        {
+            if(strcmp(val, "auto") == 0)
+                opts->image_size = 0;
+            else if((dump_parse_size(val, &num) != 0) || (num < T2T_FIRST_DATA_BLOCK_OFFSET))
+                return -1;
+            else
+                opts->image_size = num;
+            i++;
+        }
+        else if((strcmp(arg, "--trailer") == 0) && (val != NULL))
+        {
+            if(dump_parse_size(val, &opts->trailer) != 0)
+                return -1;
+            i++;
+        }
+        else if((strcmp(arg, "--threads") == 0) && (val != NULL))
+        {
+            if(dump_parse_size(val, &num) != 0)
+                return -1;
+            opts->threads = (unsigned)num;
+            i++;
+        }
+        else if((strcmp(arg, "--window") == 0) && (val != NULL))
+        {
+            if((dump_parse_size(val, &opts->window) != 0) || (opts->window == 0))
+                return -1;
+            i++;
+        }
+        else if((strcmp(arg, "--archive") == 0) && (val != NULL))
+        {
+            opts->archive = val;
+            i++;
+        }
+        else if((arg[0] != '-') && (opts->path == NULL))
+        {
+            opts->path = arg;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+
+    return (opts->path != NULL) ? 0 : -1;
+}
+
+/*
+ * @brief Print a record type, escaping bytes that are not safe in JSON or CSV.
+ */
+static void dump_print_type(const uint8_t *type, uint8_t len, dump_format_t format)
+{
+    for(uint8_t i = 0; i < len; i++)
+    {
+        uint8_t c = type[i];
+
+        if((c < 0x20) || (c >= 0x7F) || (c == '"') || (c == '\\') || (c == ',') || (c == ';'))
+        {
+            if(format == DUMP_FORMAT_JSONL)
+                printf("\\u%04x", c);
+            else
+                printf("%%%02X", c);
+        }
+        else
+        {
+            putchar(c);
+        }
+    }
+}
+
+static void dump_print_uid(const nfc_image_t *image)
+{
+    if(image->len < T2T_CC_BLOCK_OFFSET)
+        return;
+
+    static const uint8_t uid_offsets[DUMP_UID_LEN] = { 0, 1, 2, 4, 5, 6, 7 };
+
+    for(size_t i = 0; i < DUMP_UID_LEN; i++)
+        printf("%02X", image->data[uid_offsets[i]]);
+}
+
+static void dump_print_result(const dump_opts_t *opts, size_t n, size_t offset,
+                              const nfc_image_t *image, const nfc_batch_result_t *result)
+{
+    ndef_record_t rec;
+
+    if(opts->format == DUMP_FORMAT_CSV)
+    {
+        printf("%zu,%zu,%zu,", n, offset, image->len);
+        dump_print_uid(image);
+        printf(",%d,%u,%d,%lu,", (int)result->tag_status, result->tlv_cnt, (int)result->ndef_status,
+               (unsigned long)result->ndef.rec_cnt);
+
+        for(uint32_t i = 0; i < result->ndef.rec_cnt; i++)
+        {
+            if(ndef_index_get(&result->ndef, i, &rec) != NDEF_OK)
+                break;
+            if(i != 0)
+                putchar(';');
+            printf("%u:", rec.header & NDEF_RECORD_FLAG_TNF_Msk);
+            dump_print_type(rec.type, rec.type_len, opts->format);
+        }
+        putchar('\n');
+        return;
+    }
+
+    printf("{\"image\":%zu,\"offset\":%zu,\"length\":%zu,\"uid\":\"", n, offset, image->len);
+    dump_print_uid(image);
+    printf("\",\"tag_status\":%d,\"tlvs\":[", (int)result->tag_status);
+
+    for(uint16_t i = 0; i < result->tlv_cnt; i++)
+    {
+        printf("%s{\"type\":%u,\"length\":%lu}", (i != 0) ? "," : "",
+               result->tlvs[i].type, (unsigned long)result->tlvs[i].length);
+    }
+
+    printf("],\"ndef_status\":%d,\"records\":[", (int)result->ndef_status);
+
+    for(uint32_t i = 0; i < result->ndef.rec_cnt; i++)
+    {
+        if(ndef_index_get(&result->ndef, i, &rec) != NDEF_OK)
+            break;
+        printf("%s{\"tnf\":%u,\"type\":\"", (i != 0) ? "," : "", rec.header & NDEF_RECORD_FLAG_TNF_Msk);
+        dump_print_type(rec.type, rec.type_len, opts->format);
+        printf("\",\"payload_length\":%lu}", (unsigned long)rec.payload_len);
+    }
+
+    printf("]}\n");
+}
+
+/*
+ * @brief Index an NDEF message that a reserved area splits in the image.
+ *
+ * The batch parser leaves the value of such a message NULL. It is gathered
+ * into 'buf', which must stay untouched until the result has been printed
+ * or archived.
+ */
+static void dump_gather_ndef(const nfc_image_t *image, nfc_batch_result_t *result, uint8_t *buf)
+{
+    size_t len;
+
+    for(uint16_t i = 0; i < result->tlv_cnt; i++)
+    {
+        if(result->tlvs[i].type != TLV_NDEF_MESSAGE)
+            continue;
+
+        if((result->tlvs[i].value == NULL) && (result->tlvs[i].length != 0) &&
+           (type_2_tag_ndef_copy(image->data, buf, DUMP_MAX_NDEF_LEN, &len) == T2T_OK))
+            result->ndef_status = ndef_index_build(&result->ndef, buf, len);
+        return;
+    }
+}
+
+/*
+ * @brief Add a parsed image to the columnar archive.
+ *
+ * Images that failed to parse still get a row, so rows match image numbers.
+ */
+static int dump_archive_result(nfc_archive_writer_t *writer, const nfc_image_t *image,
+                               const nfc_batch_result_t *result)
+{
+    nfc_archive_tag_t tag;
+
+    if(image->len >= T2T_FIRST_DATA_BLOCK_OFFSET)
+        nfc_archive_tag_from_t2t(&tag, image->data);
+    else
+        memset(&tag, 0, sizeof(tag));
+
+    return (nfc_archive_add(writer, &tag, (result->ndef_status == NDEF_OK) ? &result->ndef : NULL) ==
+            NFC_ARCHIVE_OK) ? 0 : -1;
+}
+
+static int dump_archive_write(void *ctx, const void *data, size_t len)
+{
+    return (fwrite(data, 1, len, ctx) == len) ? 0 : -1;
+}
+
+/*
+ * @brief Size of the image starting at 'offset', or 0 if it cannot be determined.
+ */
+static size_t dump_image_size(const dump_opts_t *opts, const uint8_t *map, size_t map_len, size_t offset)
+{
+    size_t left = map_len - offset;
+    size_t size = opts->image_size;
+
+    if(size == 0)
+    {
+        if((left < T2T_FIRST_DATA_BLOCK_OFFSET) ||
+           (map[offset + T2T_CC_BLOCK_OFFSET] != T2T_NFC_FORUM_DEFINED_DATA))
+            return 0;
+
+        size = T2T_FIRST_DATA_BLOCK_OFFSET +
+               (size_t)map[offset + T2T_CC_BLOCK_OFFSET + 2] * T2T_DATA_AREA_SIZE_UNIT + opts->trailer;
+    }
+
+    /* A truncated last image is still reported; parsing it fails cleanly. */
+    return (size < left) ? size : left;
+}
+
+int main(int argc, char **argv)
+{
+    dump_opts_t opts;
+
+    if(dump_parse_opts(argc, argv, &opts) != 0)
+    {
+        dump_usage(argv[0]);
+        return 2;
+    }
+
+    int fd = open(opts.path, O_RDONLY);
+    if(fd < 0)
+    {
+        perror(opts.path);
+        return 1;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        perror(opts.path);
+        close(fd);
+        return 1;
+    }
+
+    size_t  map_len = (size_t)st.st_size;
+    uint8_t *map    = NULL;
+
+    if(map_len != 0)
+    {
+        /* Read-only mapping: the parsers never write to the image. */
+        void *p = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p == MAP_FAILED)
+        {
+            perror("mmap");
+            close(fd);
+            return 1;
+        }
+        map = p;
+        madvise(map, map_len, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    nfc_image_t        *images  = malloc(opts.window * sizeof(*images));
+    size_t             *offsets = malloc(opts.window * sizeof(*offsets));
+    nfc_batch_result_t *results = malloc(opts.window * sizeof(*results));
+    nfc_batch_storage_t storage =
+    {
+        .max_tlvs      = DUMP_MAX_TLVS,
+        .max_records   = DUMP_MAX_RECORDS,
+        .tlv_storage   = malloc(opts.window * DUMP_MAX_TLVS * sizeof(tlv_t)),
+        .index_storage = malloc(opts.window * NDEF_INDEX_STORAGE_WORDS(DUMP_MAX_RECORDS) * sizeof(uint32_t))
+    };
+
+    nfc_archive_writer_t *writer = NULL;
+    int                  ret     = 0;
+    static uint8_t       ndef_buf[DUMP_MAX_NDEF_LEN];
+
+    if((images == NULL) || (offsets == NULL) || (results == NULL) ||
+       (storage.tlv_storage == NULL) || (storage.index_storage == NULL) ||
+       ((opts.archive != NULL) && (nfc_archive_writer_create(&writer) != NFC_ARCHIVE_OK)))
+    {
+        fprintf(stderr, "out of memory\n");
+        ret = 1;
+    }
+
+    if((opts.archive == NULL) && (opts.format == DUMP_FORMAT_CSV))
+        printf("image,offset,length,uid,tag_status,tlv_count,ndef_status,record_count,records\n");
+
+    size_t offset = 0, image_no = 0;
+
+    while((ret == 0) && (offset < map_len))
+    {
+        size_t cnt = 0;
+
+        while((cnt < opts.window) && (offset < map_len))
+        {
+            size_t size = dump_image_size(&opts, map, map_len, offset);
+            if(size == 0)
+            {
+                fprintf(stderr, "%s: no Type 2 Tag CC at offset %zu, use --size\n", opts.path, offset);
+                ret = 1;
+                break;
+            }
+
+            images[cnt].data = map + offset;
+            images[cnt].len  = size;
+            offsets[cnt]     = offset;
+            offset          += size;
+            cnt++;
+        }
+
+        nfc_batch_status_t rslt = (opts.threads == 1) ?
+                                  nfc_batch_parse(images, cnt, results, &storage) :
+                                  nfc_batch_parse_parallel(images, cnt, results, &storage, opts.threads);
+        if(rslt != NFC_BATCH_OK)
+        {
+            fprintf(stderr, "batch parse failed (%d)\n", (int)rslt);
+            ret = 1;
+            break;
+        }
+
+        for(size_t i = 0; (ret == 0) && (i < cnt); i++)
+        {
+            dump_gather_ndef(&images[i], &results[i], ndef_buf);
+
+            if(writer == NULL)
+                dump_print_result(&opts, image_no + i, offsets[i], &images[i], &results[i]);
+            else if(dump_archive_result(writer, &images[i], &results[i]) != 0)
+            {
+                fprintf(stderr, "%s: cannot archive image %zu\n", opts.archive, image_no + i);
+                ret = 1;
+            }
+        }
+
+        image_no += cnt;
+
+        /* Pages of the finished window are not needed again. */
+        if(cnt != 0)
+        {
+            long   page  = sysconf(_SC_PAGESIZE);
+            size_t start = (offsets[0] / (size_t)page) * (size_t)page;
+            size_t end   = (offset / (size_t)page) * (size_t)page;
+            if(end > start)
+                madvise(map + start, end - start, MADV_DONTNEED);
+        }
+    }
+
+    if((ret == 0) && (writer != NULL))
+    {
+        FILE *out = fopen(opts.archive, "wb");
+        int  err  = (out == NULL) || (nfc_archive_write(writer, dump_archive_write, out) != NFC_ARCHIVE_OK);
+
+        if(((out != NULL) && (fclose(out) != 0)) || err)
+        {
+            perror(opts.archive);
+            ret = 1;
+        }
+    }
+
+    if(map != NULL)
+        munmap(map, map_len);
+
+    nfc_archive_writer_destroy(writer);
+
+    free(images);
+    free(offsets);
+    free(results);
+    free(storage.tlv_storage);
+    free(storage.index_storage);
+
+    return (fflush(stdout) == 0) ? ret : 1;
+}
@@ -0,0 +1,1071 @@
+#include "type_2_tag.h"
+#include "nfc_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define T2T_UID_BYTE_0_OFFSET       0   /* Offset of the manufacturer ID byte. */
+#define T2T_CHECK_BYTE_0_OFFSET     3   /* Offset of the first check byte. */
+#define T2T_UID_PART_2_OFFSET       4   /* Offset of bytes 3-0 of the UID. */
+#define T2T_CHECK_BYTE_1_OFFSET     8   /* Offset of the second check byte. */
+#define T2T_INTERNAL_OFFSET         9   /* Offset of the internal byte. */
+#define T2T_LOCK_BYTES_OFFSET       10  /* Offset of the static lock bytes. */
+
+#define T2T_MAX_BLOCK_NO            0xFF    /* READ commands address at most 256 blocks. */
+#define T2T_MAX_RESERVED_AREAS      8       /* Control TLVs kept by the write planner. */
+#define T2T_WRITE_ACCESS_GRANTED    0x0     /* CC write access value granting write access. */
+
+/**
+ * @brief Function for decoding the serial number, lock bytes and CC (blocks 0-3).
+ */
+static type_2_tag_status_t type_2_tag_header_parse(type_2_tag_t * p_type_2_tag, uint8_t * p_raw_data)
+{
+    type_2_tag_serial_number_t        * p_sn = &p_type_2_tag->sn;
+    type_2_tag_capability_container_t * p_cc = &p_type_2_tag->cc;
+
+    p_sn->manufacturer_id      = p_raw_data[T2T_UID_BYTE_0_OFFSET];
+    p_sn->serial_number_part_1 = (uint16_t)((p_raw_data[1] << 8) | p_raw_data[2]);
+    p_sn->check_byte_0         = p_raw_data[T2T_CHECK_BYTE_0_OFFSET];
+    p_sn->serial_number_part_2 = ((uint32_t)p_raw_data[T2T_UID_PART_2_OFFSET]     << 24) |
+                                 ((uint32_t)p_raw_data[T2T_UID_PART_2_OFFSET + 1] << 16) |
+                                 ((uint32_t)p_raw_data[T2T_UID_PART_2_OFFSET + 2] << 8)  |
+                                  (uint32_t)p_raw_data[T2T_UID_PART_2_OFFSET + 3];
+    p_sn->check_byte_1         = p_raw_data[T2T_CHECK_BYTE_1_OFFSET];
+    p_sn->internal             = p_raw_data[T2T_INTERNAL_OFFSET];
+
+    p_type_2_tag->lock_bytes = (uint16_t)((p_raw_data[T2T_LOCK_BYTES_OFFSET] << 8) |
+                                          p_raw_data[T2T_LOCK_BYTES_OFFSET + 1]);
+
+    /* BCC0 = CT ^ UID0 ^ UID1 ^ UID2, BCC1 = UID3 ^ UID4 ^ UID5 ^ UID6 */
+    uint8_t bcc0 = T2T_CASCADE_TAG ^ p_raw_data[0] ^ p_raw_data[1] ^ p_raw_data[2];
+    uint8_t bcc1 = p_raw_data[4] ^ p_raw_data[5] ^ p_raw_data[6] ^ p_raw_data[7];
+
+    if((bcc0 != p_sn->check_byte_0) || (bcc1 != p_sn->check_byte_1))
+    {
+        NFC_STATS_ERROR(NFC_STATS_ERR_T2T_BCC);
+        return T2T_E_INVALID_DATA;
+    }
+
+    uint8_t * p_cc_raw = p_raw_data + T2T_CC_BLOCK_OFFSET;
+
+    if(p_cc_raw[0] != T2T_NFC_FORUM_DEFINED_DATA)
+    {
+        NFC_STATS_ERROR(NFC_STATS_ERR_T2T_CC_MAGIC);
+        return T2T_E_INVALID_DATA;
+    }
+
+    p_cc->major_version  = p_cc_raw[1] >> 4;
+    p_cc->minor_version  = p_cc_raw[1] & 0x0F;
+    p_cc->data_area_size = (uint16_t)(p_cc_raw[2] * T2T_DATA_AREA_SIZE_UNIT);
+    p_cc->read_access    = p_cc_raw[3] >> 4;
+    p_cc->write_access   = p_cc_raw[3] & 0x0F;
+
+    if(p_cc->major_version > T2T_SUPPORTED_MAJOR_VERSION)
+    {
+        NFC_STATS_ERROR(NFC_STATS_ERR_T2T_VERSION);
+        return T2T_E_NOT_SUPPORTED;
+    }
+
+    return T2T_OK;
+}
+
+/**
+ * @brief Function for decoding the header of a TLV block without requiring its value.
+ *
+ * @retval 0 if the buffer ends inside the header, otherwise the header length.
+ */
+static size_t type_2_tag_tlv_header(uint8_t * p_buf, size_t len, size_t * p_value_len)
+{
+    if(len < TLV_T_LENGTH + TLV_L_SHORT_LENGTH)
+        return 0;
+
+    if((p_buf[0] == TLV_NDEF_MESSAGE || p_buf[0] == TLV_PROPRIETARY) && (p_buf[1] == TLV_L_FORMAT_FLAG))
+    {
+        if(len < TLV_T_LENGTH + TLV_L_LONG_LENGTH)
+            return 0;
+
+        *p_value_len = (size_t)((p_buf[2] << 8) | p_buf[3]);
+        return TLV_T_LENGTH + TLV_L_LONG_LENGTH;
+    }
+
+    *p_value_len = p_buf[1];
+    return TLV_T_LENGTH + TLV_L_SHORT_LENGTH;
+}
+
+/**
+ * @brief Function for collecting the Lock and Memory Control TLVs leading the data area.
+ *
+ * NULL padding between them is skipped. @p p_prefix receives the offset of the
+ * first block that is not a control TLV and @p p_ctrl_end, if not NULL, the
+ * offset following the last control TLV.
+ *
+ * @retval T2T_OK        If the reserved areas were stored.
+ * @retval T2T_E_NO_MEM  If the tag holds more than T2T_MAX_RESERVED_AREAS control TLVs.
+ */
+static type_2_tag_status_t type_2_tag_ctrl_prefix(uint8_t               * p_raw_data,
+                                                  size_t                  data_end,
+                                                  type_2_tag_reserved_t * p_areas,
+                                                  uint8_t               * p_area_cnt,
+                                                  size_t                * p_prefix,
+                                                  size_t                * p_ctrl_end)
+{
+    size_t prefix   = T2T_FIRST_DATA_BLOCK_OFFSET;
+    size_t ctrl_end = T2T_FIRST_DATA_BLOCK_OFFSET;
+
+    *p_area_cnt = 0;
+
+    while(prefix < data_end)
+    {
+        prefix += tlv_skip_null(p_raw_data + prefix, data_end - prefix);
+        if((prefix == data_end) ||
+           ((p_raw_data[prefix] != TLV_LOCK_CONTROL) && (p_raw_data[prefix] != TLV_MEMORY_CONTROL)))
+            break;
+
+        tlv_t  tlv;
+        size_t br = 0;
+
+        if(t2t_parse_next_tlv(p_raw_data + prefix, data_end - prefix, &tlv, &br) != TLV_OK)
+            break;
+
+        if(*p_area_cnt >= T2T_MAX_RESERVED_AREAS)
+            return T2T_E_NO_MEM;
+
+        if(type_2_tag_ctrl_tlv_decode(&tlv, &p_areas[*p_area_cnt]) == T2T_OK)
+            (*p_area_cnt)++;
+
+        prefix  += br;
+        ctrl_end = prefix;
+    }
+
+    *p_prefix = prefix;
+    if(p_ctrl_end != NULL)
+        *p_ctrl_end = ctrl_end;
+
+    return T2T_OK;
+}
+
+void type_2_tag_clear(type_2_tag_t * p_type_2_tag)
+{
+    if(p_type_2_tag == NULL)
+        return;
+
+    p_type_2_tag->tlv_count = 0;
+    memset(&p_type_2_tag->sn, 0, sizeof(p_type_2_tag->sn));
+    memset(&p_type_2_tag->cc, 0, sizeof(p_type_2_tag->cc));
+    p_type_2_tag->lock_bytes = 0;
+
+    if(p_type_2_tag->p_tlv_block_array != NULL)
+        memset(p_type_2_tag->p_tlv_block_array, 0, p_type_2_tag->max_tlv_blocks * sizeof(tlv_t));
+}
+
+/**
+ * @brief Function for parsing the TLV blocks of a data area holding reserved areas.
+ *
+ * Blocks lying inside one run of data between reserved areas are parsed in
+ * place; only a block straddling an area is decoded through the view. Values
+ * split by a reserved area are stored with a NULL value pointer.
+ */
+static type_2_tag_status_t type_2_tag_parse_vmem(type_2_tag_t            * p_type_2_tag,
+                                                 const type_2_tag_vmem_t * p_vmem)
+{
+    size_t offset = 0;
+
+    while(offset < p_vmem->size)
+    {
+        uint8_t * p_data;
+        size_t    run     = type_2_tag_vmem_span(p_vmem, offset, &p_data);
+        size_t    padding = tlv_skip_null(p_data, run);
+
+        if(padding != 0)
+        {
+            offset += padding;
+            continue;
+        }
+
+        tlv_t        tlv;
+        size_t       br = 0;
+        tlv_status_t rslt = t2t_parse_next_tlv(p_data, run, &tlv, &br);
+
+        if(rslt == TLV_E_INCOMPLETE)
+        {
+            size_t value_offset;
+            type_2_tag_status_t err_code = type_2_tag_vmem_next_tlv(p_vmem, &offset, &tlv, &value_offset);
+
+            if(err_code == T2T_E_NOT_FOUND)
+                continue;
+            if(err_code != T2T_OK)
+            {
+                NFC_STATS_ERROR(NFC_STATS_ERR_T2T_TLV_OVERRUN);
+                return T2T_E_INVALID_DATA;
+            }
+        }
+        else if(rslt == TLV_E_NOT_FOUND)
+        {
+            /* Unknown byte, continue with the next one. */
+            offset += br;
+            continue;
+        }
+        else if(rslt != TLV_OK)
+        {
+            NFC_STATS_ERROR(NFC_STATS_ERR_T2T_TLV_OVERRUN);
+            return T2T_E_INVALID_DATA;
+        }
+        else
+        {
+            offset += br;
+        }
+
+        if(tlv.type == TLV_TERMINATOR)
+            break;
+        if(tlv.type == TLV_NULL)
+            continue;
+
+        if(p_type_2_tag->tlv_count >= p_type_2_tag->max_tlv_blocks)
+        {
+            NFC_STATS_ERROR(NFC_STATS_ERR_T2T_TLV_ARRAY_FULL);
+            return T2T_E_NO_MEM;
+        }
+
+        p_type_2_tag->p_tlv_block_array[p_type_2_tag->tlv_count++] = tlv;
+    }
+
+    return T2T_OK;
+}
+
+/**
+ * @brief Function for checking whether a control TLV reserves bytes inside the data area.
+ */
+static uint8_t type_2_tag_ctrl_in_data_area(const tlv_t * p_tlv, size_t data_end)
+{
+    type_2_tag_reserved_t area;
+
+    return (type_2_tag_ctrl_tlv_decode(p_tlv, &area) == T2T_OK) &&
+           (area.offset < data_end) &&
+           ((size_t)area.offset + area.size > T2T_FIRST_DATA_BLOCK_OFFSET);
+}
+
+/**
+ * @brief Function for parsing the TLV blocks again around the reserved areas of the leading control TLVs.
+ */
+static type_2_tag_status_t type_2_tag_parse_reserved(type_2_tag_t * p_type_2_tag, uint8_t * p_raw_data, uint16_t data_end)
+{
+    type_2_tag_reserved_t areas[T2T_MAX_RESERVED_AREAS];
+    uint8_t               area_cnt;
+    size_t                prefix;
+    type_2_tag_vmem_t     vmem;
+
+    type_2_tag_status_t err_code = type_2_tag_ctrl_prefix(p_raw_data, data_end, areas, &area_cnt, &prefix, NULL);
+    if(err_code != T2T_OK)
+        return err_code;
+
+    err_code = type_2_tag_vmem_init(&vmem, p_raw_data, data_end, areas, area_cnt);
+    if(err_code != T2T_OK)
+        return err_code;
+
+    p_type_2_tag->tlv_count = 0;
+
+    return type_2_tag_parse_vmem(p_type_2_tag, &vmem);
+}
+
+/**
+ * @brief Function for parsing the header and TLV blocks of a tag.
+ */
+static type_2_tag_status_t type_2_tag_parse_blocks(type_2_tag_t * p_type_2_tag, uint8_t * p_raw_data)
+{
+    type_2_tag_clear(p_type_2_tag);
+
+    type_2_tag_status_t err_code = type_2_tag_header_parse(p_type_2_tag, p_raw_data);
+    if(err_code != T2T_OK)
+        return err_code;
+
+    size_t offset   = T2T_FIRST_DATA_BLOCK_OFFSET;
+    size_t data_end = T2T_FIRST_DATA_BLOCK_OFFSET + p_type_2_tag->cc.data_area_size;
+
+    while(offset < data_end)
+    {
+        offset += tlv_skip_null(p_raw_data + offset, data_end - offset);
+        if(offset == data_end)
+            break;
+
+        tlv_t        tlv;
+        size_t       br = 0;
+        tlv_status_t rslt = t2t_parse_next_tlv(p_raw_data + offset, data_end - offset, &tlv, &br);
+
+        if(rslt == TLV_E_NOT_FOUND)
+        {
+            /* Unknown byte, continue with the next one. */
+            offset += br;
+            continue;
+        }
+        else if(rslt != TLV_OK)
+        {
+            /* The whole data area is available, so a partial block is final. */
+            NFC_STATS_ERROR(NFC_STATS_ERR_TLV_INCOMPLETE);
+            NFC_STATS_ERROR(NFC_STATS_ERR_T2T_TLV_OVERRUN);
+            return T2T_E_INVALID_DATA;
+        }
+
+        offset += br;
+
+        if(tlv.type == TLV_TERMINATOR)
+            break;
+        if(tlv.type == TLV_NULL)
+            continue;
+
+        /* Reserved areas inside the data area are not part of the TLV stream, walk around them. */
+        if(((tlv.type == TLV_LOCK_CONTROL) || (tlv.type == TLV_MEMORY_CONTROL)) &&
+           type_2_tag_ctrl_in_data_area(&tlv, data_end))
+            return type_2_tag_parse_reserved(p_type_2_tag, p_raw_data, (uint16_t)data_end);
+
+        if(p_type_2_tag->tlv_count >= p_type_2_tag->max_tlv_blocks)
+        {
+            NFC_STATS_ERROR(NFC_STATS_ERR_T2T_TLV_ARRAY_FULL);
+            return T2T_E_NO_MEM;
+        }
+
+        p_type_2_tag->p_tlv_block_array[p_type_2_tag->tlv_count++] = tlv;
+    }
+
+    return T2T_OK;
+}
+
+type_2_tag_status_t type_2_tag_parse(type_2_tag_t * p_type_2_tag, uint8_t * p_raw_data)
+{
+    if((p_type_2_tag == NULL) || (p_raw_data == NULL))
+        return T2T_E_INVALID_ARGS;
+
+    NFC_STATS_TIMER_START(start);
+
+    type_2_tag_status_t err_code = type_2_tag_parse_blocks(p_type_2_tag, p_raw_data);
+
+    NFC_STATS_TIMER_STOP(NFC_STATS_HIST_TAG_PARSE_NS, start);
+    NFC_STATS_INC(NFC_STATS_TAGS);
+
+    return err_code;
+}
+
+void type_2_tag_printout(type_2_tag_t * p_type_2_tag)
+{
+    if(p_type_2_tag == NULL)
+        return;
+
+    type_2_tag_serial_number_t        * p_sn = &p_type_2_tag->sn;
+    type_2_tag_capability_container_t * p_cc = &p_type_2_tag->cc;
+
+    printf("======== TYPE 2 TAG ========\n");
+    printf("UID: %02X %04X %08lX\n",
+           p_sn->manufacturer_id,
+           p_sn->serial_number_part_1,
+           (unsigned long)p_sn->serial_number_part_2);
+    printf("CHECK BYTES: 0x%02X 0x%02X\n", p_sn->check_byte_0, p_sn->check_byte_1);
+    printf("INTERNAL: 0x%02X\n", p_sn->internal);
+    printf("LOCK BYTES: 0x%04X\n", p_type_2_tag->lock_bytes);
+    printf("CC: VERSION %u.%u, DATA AREA %u bytes, READ 0x%X, WRITE 0x%X\n",
+           p_cc->major_version, p_cc->minor_version, p_cc->data_area_size,
+           p_cc->read_access, p_cc->write_access);
+
+    for(uint16_t i = 0; i < p_type_2_tag->tlv_count; i++)
+    {
+        tlv_t * p_tlv = &p_type_2_tag->p_tlv_block_array[i];
+        printf("TLV %u: TYPE 0x%02X, LENGTH %lu\n", i, p_tlv->type, (unsigned long)p_tlv->length);
+    }
+
+    printf("============================\n");
+}
+
+void type_2_tag_read_plan_init(type_2_tag_read_plan_t * p_plan, size_t raw_size)
+{
+    if(p_plan == NULL)
+        return;
+
+    memset(p_plan, 0, sizeof(*p_plan));
+    p_plan->raw_size = raw_size;
+}
+
+type_2_tag_status_t type_2_tag_read_plan_next(type_2_tag_read_plan_t * p_plan,
+                                              uint8_t                * p_raw_data,
+                                              uint8_t                * p_block_no)
+{
+    if((p_plan == NULL) || (p_raw_data == NULL) || (p_block_no == NULL))
+        return T2T_E_INVALID_ARGS;
+
+    if(p_plan->done)
+        return (p_plan->ndef_offset != 0) ? T2T_OK : T2T_E_NOT_FOUND;
+
+    if(p_plan->read_count == 0)
+    {
+        /* Blocks 0-3 hold the UID, lock bytes and CC. */
+        if(p_plan->raw_size < T2T_RAW_DATA_SIZE(0))
+            return T2T_E_NO_MEM;
+
+        p_plan->next_block = 0;
+        p_plan->read_count++;
+        *p_block_no = 0;
+        return T2T_OK;
+    }
+
+    /* Account for the bytes returned by the previous READ. */
+    uint16_t read_start = (uint16_t)(p_plan->next_block * T2T_BLOCK_SIZE);
+    uint16_t read_end   = (uint16_t)(read_start + T2T_READ_SIZE);
+
+    if((read_start >= p_plan->valid_start) && (read_start <= p_plan->valid_end))
+    {
+        if(read_end > p_plan->valid_end)
+            p_plan->valid_end = read_end;
+    }
+    else
+    {
+        p_plan->valid_start = read_start;
+        p_plan->valid_end   = read_end;
+    }
+
+    if(p_plan->data_end == 0)
+    {
+        type_2_tag_t header = { .max_tlv_blocks = 0 };
+
+        type_2_tag_status_t err_code = type_2_tag_header_parse(&header, p_raw_data);
+        if(err_code != T2T_OK)
+        {
+            p_plan->done = 1;
+            return err_code;
+        }
+
+        if((size_t)T2T_RAW_DATA_SIZE(header.cc.data_area_size) > p_plan->raw_size)
+        {
+            p_plan->done = 1;
+            return T2T_E_NO_MEM;
+        }
+
+        p_plan->data_end   = (uint16_t)(T2T_FIRST_DATA_BLOCK_OFFSET + header.cc.data_area_size);
+        p_plan->tlv_offset = T2T_FIRST_DATA_BLOCK_OFFSET;
+    }
+
+    while(p_plan->tlv_offset < p_plan->data_end)
+    {
+        uint16_t offset = p_plan->tlv_offset;
+
+        if((offset < p_plan->valid_start) || (offset >= p_plan->valid_end))
+            break;
+
+        uint16_t avail_end = (p_plan->valid_end < p_plan->data_end) ? p_plan->valid_end : p_plan->data_end;
+        size_t   padding   = tlv_skip_null(p_raw_data + offset, avail_end - offset);
+
+        if(padding != 0)
+        {
+            p_plan->tlv_offset = (uint16_t)(offset + padding);
+            continue;
+        }
+
+        size_t   avail     = avail_end - offset;
+        tlv_t    tlv;
+        size_t   br = 0;
+
+        tlv_status_t rslt = t2t_parse_next_tlv(p_raw_data + offset, avail, &tlv, &br);
+
+        if(rslt == TLV_OK)
+        {
+            if(tlv.type == TLV_NDEF_MESSAGE)
+            {
+                p_plan->ndef_offset = (uint16_t)(tlv.value - p_raw_data);
+                p_plan->ndef_length = (uint16_t)tlv.length;
+                p_plan->done        = 1;
+                return T2T_OK;
+            }
+
+            if(tlv.type == TLV_TERMINATOR)
+            {
+                p_plan->done = 1;
+                return T2T_E_NOT_FOUND;
+            }
+
+            p_plan->tlv_offset = (uint16_t)(offset + br);
+            continue;
+        }
+        else if(rslt == TLV_E_NOT_FOUND)
+        {
+            p_plan->tlv_offset = (uint16_t)(offset + br);
+            continue;
+        }
+        else if(rslt != TLV_E_INCOMPLETE)
+        {
+            p_plan->done = 1;
+            return T2T_E_INVALID_DATA;
+        }
+
+        if(avail_end == p_plan->data_end)
+        {
+            /* TLV block runs past the end of the data area. */
+            NFC_STATS_ERROR(NFC_STATS_ERR_TLV_INCOMPLETE);
+            NFC_STATS_ERROR(NFC_STATS_ERR_T2T_TLV_OVERRUN);
+            p_plan->done = 1;
+            return T2T_E_INVALID_DATA;
+        }
+
+        size_t value_len;
+        size_t header_len = type_2_tag_tlv_header(p_raw_data + offset, avail, &value_len);
+
+        if((header_len != 0) && (p_raw_data[offset] != TLV_NDEF_MESSAGE))
+        {
+            /* Value of this block is not needed, skip the pages it covers. */
+            size_t next = offset + header_len + value_len;
+            if(next > p_plan->data_end)
+            {
+                p_plan->done = 1;
+                return T2T_E_INVALID_DATA;
+            }
+            p_plan->tlv_offset = (uint16_t)next;
+            continue;
+        }
+
+        if(header_len != 0)
+        {
+            /* Publish the NDEF value location so it can be decoded while the rest is read. */
+            if(offset + header_len + value_len > p_plan->data_end)
+            {
+                p_plan->done = 1;
+                return T2T_E_INVALID_DATA;
+            }
+            p_plan->ndef_offset = (uint16_t)(offset + header_len);
+            p_plan->ndef_length = (uint16_t)value_len;
+        }
+
+        /* Header or NDEF value incomplete, continue reading sequentially. */
+        break;
+    }
+
+    if(p_plan->tlv_offset >= p_plan->data_end)
+    {
+        p_plan->done = 1;
+        return T2T_E_NOT_FOUND;
+    }
+
+    uint16_t next_offset = p_plan->tlv_offset;
+
+    if((next_offset >= p_plan->valid_start) && (next_offset < p_plan->valid_end))
+        next_offset = p_plan->valid_end;
+
+    if((next_offset / T2T_BLOCK_SIZE) > T2T_MAX_BLOCK_NO)
+    {
+        p_plan->done = 1;
+        return T2T_E_NO_MEM;
+    }
+
+    p_plan->next_block = (uint8_t)(next_offset / T2T_BLOCK_SIZE);
+    p_plan->read_count++;
+    *p_block_no = p_plan->next_block;
+
+    return T2T_OK;
+}
+
+type_2_tag_status_t type_2_tag_ctrl_tlv_decode(const tlv_t * p_tlv, type_2_tag_reserved_t * p_area)
+{
+    if((p_tlv == NULL) || (p_area == NULL) || (p_tlv->value == NULL) ||
+       ((p_tlv->type != TLV_LOCK_CONTROL) && (p_tlv->type != TLV_MEMORY_CONTROL)) ||
+       (p_tlv->length != TLV_LOCK_MEMORY_CTRL_LEN))
+        return T2T_E_INVALID_ARGS;
+
+    uint8_t  page_addr   = p_tlv->value[0] >> 4;
+    uint8_t  byte_offset = p_tlv->value[0] & 0x0F;
+    uint16_t size        = (p_tlv->value[1] == 0) ? 256 : p_tlv->value[1];
+    uint8_t  page_size   = p_tlv->value[2] & 0x0F;
+
+    p_area->type          = p_tlv->type;
+    p_area->offset        = (uint16_t)((page_addr << page_size) + byte_offset);
+    p_area->bytes_per_bit = 0;
+
+    if(p_tlv->type == TLV_LOCK_CONTROL)
+    {
+        /* Size is a number of dynamic lock bits. */
+        p_area->size          = (uint16_t)((size + 7) / 8);
+        p_area->bytes_per_bit = (uint16_t)(1 << (p_tlv->value[2] >> 4));
+    }
+    else
+    {
+        p_area->size = size;
+    }
+
+    return T2T_OK;
+}
+
+type_2_tag_status_t type_2_tag_reserved_map(const type_2_tag_t    * p_type_2_tag,
+                                            type_2_tag_reserved_t * p_areas,
+                                            uint8_t                 max_areas,
+                                            uint8_t               * p_area_cnt)
+{
+    if((p_type_2_tag == NULL) || (p_area_cnt == NULL) || ((p_areas == NULL) && (max_areas != 0)))
+        return T2T_E_INVALID_ARGS;
+
+    *p_area_cnt = 0;
+
+    for(uint16_t i = 0; i < p_type_2_tag->tlv_count; i++)
+    {
+        const tlv_t * p_tlv = &p_type_2_tag->p_tlv_block_array[i];
+
+        if((p_tlv->type != TLV_LOCK_CONTROL) && (p_tlv->type != TLV_MEMORY_CONTROL))
+            continue;
+
+        if(*p_area_cnt >= max_areas)
+            return T2T_E_NO_MEM;
+
+        if(type_2_tag_ctrl_tlv_decode(p_tlv, &p_areas[*p_area_cnt]) == T2T_OK)
+            (*p_area_cnt)++;
+    }
+
+    return T2T_OK;
+}
+
+type_2_tag_status_t type_2_tag_vmem_init(type_2_tag_vmem_t     * p_vmem,
+                                         uint8_t               * p_raw_data,
+                                         uint16_t                data_end,
+                                         type_2_tag_reserved_t * p_areas,
+                                         uint8_t                 area_cnt)
+{
+    if((p_vmem == NULL) || (p_raw_data == NULL) || ((p_areas == NULL) && (area_cnt != 0)) ||
+       (data_end < T2T_FIRST_DATA_BLOCK_OFFSET))
+        return T2T_E_INVALID_ARGS;
+
+    /* Insertion sort by offset; there are only ever a handful of areas. */
+    for(uint8_t i = 1; i < area_cnt; i++)
+    {
+        type_2_tag_reserved_t area = p_areas[i];
+        uint8_t               j    = i;
+
+        while((j > 0) && (p_areas[j - 1].offset > area.offset))
+        {
+            p_areas[j] = p_areas[j - 1];
+            j--;
+        }
+        p_areas[j] = area;
+    }
+
+    /* Clip to the data area and merge overlapping or adjacent areas. */
+    uint8_t  cnt      = 0;
+    uint16_t reserved = 0;
+
+    for(uint8_t i = 0; i < area_cnt; i++)
+    {
+        uint32_t start = p_areas[i].offset;
+        uint32_t end   = start + p_areas[i].size;
+
+        if(start < T2T_FIRST_DATA_BLOCK_OFFSET)
+            start = T2T_FIRST_DATA_BLOCK_OFFSET;
+        if(end > data_end)
+            end = data_end;
+        if(start >= end)
+            continue;
+
+        if((cnt > 0) && (start <= (uint32_t)p_areas[cnt - 1].offset + p_areas[cnt - 1].size))
+        {
+            uint32_t prev_end = (uint32_t)p_areas[cnt - 1].offset + p_areas[cnt - 1].size;
+            if(end > prev_end)
+            {
+                reserved = (uint16_t)(reserved + (end - prev_end));
+                p_areas[cnt - 1].size = (uint16_t)(end - p_areas[cnt - 1].offset);
+            }
+            continue;
+        }
+
+        p_areas[cnt]        = p_areas[i];
+        p_areas[cnt].offset = (uint16_t)start;
+        p_areas[cnt].size   = (uint16_t)(end - start);
+        reserved            = (uint16_t)(reserved + (end - start));
+        cnt++;
+    }
+
+    p_vmem->p_raw_data = p_raw_data;
+    p_vmem->data_end   = data_end;
+    p_vmem->p_areas    = p_areas;
+    p_vmem->area_cnt   = cnt;
+    p_vmem->size       = (uint16_t)(data_end - T2T_FIRST_DATA_BLOCK_OFFSET - reserved);
+
+    return T2T_OK;
+}
+
+size_t type_2_tag_vmem_span(const type_2_tag_vmem_t * p_vmem, size_t offset, uint8_t ** pp_data)
+{
+    if((p_vmem == NULL) || (pp_data == NULL) || (offset >= p_vmem->size))
+        return 0;
+
+    size_t phys = T2T_FIRST_DATA_BLOCK_OFFSET + offset;
+    size_t next = p_vmem->data_end;
+
+    /* Areas are sorted: each one starting at or before the position shifts it. */
+    for(uint8_t i = 0; i < p_vmem->area_cnt; i++)
+    {
+        if(p_vmem->p_areas[i].offset <= phys)
+        {
+            phys += p_vmem->p_areas[i].size;
+        }
+        else
+        {
+            next = p_vmem->p_areas[i].offset;
+            break;
+        }
+    }
+
+    *pp_data = p_vmem->p_raw_data + phys;
+
+    return next - phys;
+}
+
+/**
+ * @brief Function for reading a single byte of the virtual data area.
+ */
+static int type_2_tag_vmem_byte(const type_2_tag_vmem_t * p_vmem, size_t offset)
+{
+    uint8_t * p_data;
+
+    return (type_2_tag_vmem_span(p_vmem, offset, &p_data) != 0) ? *p_data : -1;
+}
+
+type_2_tag_status_t type_2_tag_vmem_next_tlv(const type_2_tag_vmem_t * p_vmem,
+                                             size_t                  * p_offset,
+                                             tlv_t                   * p_tlv,
+                                             size_t                  * p_value_offset)
+{
+    if((p_vmem == NULL) || (p_offset == NULL) || (p_tlv == NULL) || (p_value_offset == NULL))
+        return T2T_E_INVALID_ARGS;
+
+    size_t offset = *p_offset;
+    int    type   = type_2_tag_vmem_byte(p_vmem, offset);
+
+    if(type < 0)
+        return T2T_E_INVALID_DATA;
+
+    p_tlv->type   = (uint8_t)type;
+    p_tlv->length = 0;
+    p_tlv->value  = NULL;
+    offset       += TLV_T_LENGTH;
+
+    if((type == TLV_NULL) || (type == TLV_TERMINATOR))
+    {
+        *p_value_offset = offset;
+        *p_offset       = offset;
+        return T2T_OK;
+    }
+
+    if((type != TLV_LOCK_CONTROL) && (type != TLV_MEMORY_CONTROL) &&
+       (type != TLV_NDEF_MESSAGE) && (type != TLV_PROPRIETARY))
+    {
+        *p_offset = offset;
+        return T2T_E_NOT_FOUND;
+    }
+
+    int length = type_2_tag_vmem_byte(p_vmem, offset++);
+    if(length < 0)
+        return T2T_E_INVALID_DATA;
+
+    if((length == TLV_L_FORMAT_FLAG) && ((type == TLV_NDEF_MESSAGE) || (type == TLV_PROPRIETARY)))
+    {
+        int hi = type_2_tag_vmem_byte(p_vmem, offset++);
+        int lo = type_2_tag_vmem_byte(p_vmem, offset++);
+        if((hi < 0) || (lo < 0))
+            return T2T_E_INVALID_DATA;
+        length = (hi << 8) | lo;
+    }
+
+    if(((type == TLV_LOCK_CONTROL) || (type == TLV_MEMORY_CONTROL)) && (length != TLV_LOCK_MEMORY_CTRL_LEN))
+    {
+        *p_offset = *p_offset + 1;
+        return T2T_E_NOT_FOUND;
+    }
+
+    if((size_t)length > p_vmem->size - offset)
+        return T2T_E_INVALID_DATA;
+
+    p_tlv->length   = (size_t)length;
+    *p_value_offset = offset;
+
+    uint8_t * p_data;
+    if((length != 0) && (type_2_tag_vmem_span(p_vmem, offset, &p_data) >= (size_t)length))
+        p_tlv->value = p_data;
+
+    *p_offset = offset + (size_t)length;
+
+    return T2T_OK;
+}
+
+/**
+ * @brief Function for copying bytes out of the virtual data area.
+ */
+static void type_2_tag_vmem_read(const type_2_tag_vmem_t * p_vmem, size_t offset, uint8_t * p_dst, size_t len)
+{
+    while(len > 0)
+    {
+        uint8_t * p_data = NULL;
+        size_t    run    = type_2_tag_vmem_span(p_vmem, offset, &p_data);
+
+        if(run == 0)
+            break;
+        if(run > len)
+            run = len;
+
+        memcpy(p_dst, p_data, run);
+        offset += run;
+        p_dst  += run;
+        len    -= run;
+    }
+}
+
+/**
+ * @brief Function for copying bytes into the virtual data area.
+ */
+static void type_2_tag_vmem_write(const type_2_tag_vmem_t * p_vmem, size_t offset, const uint8_t * p_src, size_t len)
+{
+    while(len > 0)
+    {
+        uint8_t * p_data = NULL;
+        size_t    run    = type_2_tag_vmem_span(p_vmem, offset, &p_data);
+
+        if(run == 0)
+            break;
+        if(run > len)
+            run = len;
+
+        memcpy(p_data, p_src, run);
+        offset += run;
+        p_src  += run;
+        len    -= run;
+    }
+}
+
+/**
+ * @brief Function for converting a raw data offset inside the data area to a virtual offset.
+ *
+ * An offset inside a reserved area maps to the first byte following the area.
+ */
+static size_t type_2_tag_vmem_offset(const type_2_tag_vmem_t * p_vmem, size_t pos)
+{
+    size_t offset = pos - T2T_FIRST_DATA_BLOCK_OFFSET;
+
+    for(uint8_t i = 0; (i < p_vmem->area_cnt) && (p_vmem->p_areas[i].offset < pos); i++)
+    {
+        size_t end = (size_t)p_vmem->p_areas[i].offset + p_vmem->p_areas[i].size;
+        offset -= ((end < pos) ? end : pos) - p_vmem->p_areas[i].offset;
+    }
+
+    return offset;
+}
+
+/**
+ * @brief Function for appending a WRITE command if it is not already satisfied by @p p_current.
+ */
+static void type_2_tag_write_add(type_2_tag_write_t * p_writes,
+                                 size_t               max_writes,
+                                 size_t             * p_write_cnt,
+                                 uint16_t             block_no,
+                                 uint8_t            * p_current,
+                                 const uint8_t      * p_data)
+{
+    if(memcmp(p_current, p_data, T2T_BLOCK_SIZE) == 0)
+        return;
+
+    memcpy(p_current, p_data, T2T_BLOCK_SIZE);
+
+    if(*p_write_cnt < max_writes)
+    {
+        p_writes[*p_write_cnt].block_no = block_no;
+        memcpy(p_writes[*p_write_cnt].data, p_data, T2T_BLOCK_SIZE);
+    }
+    (*p_write_cnt)++;
+}
+
+type_2_tag_status_t type_2_tag_write_plan(uint8_t            * p_raw_data,
+                                          const uint8_t      * p_msg,
+                                          size_t               msg_len,
+                                          uint8_t            * p_new_raw_data,
+                                          type_2_tag_write_t * p_writes,
+                                          size_t               max_writes,
+                                          size_t             * p_write_cnt)
+{
+    if((p_raw_data == NULL) || ((p_msg == NULL) && (msg_len != 0)) || (p_new_raw_data == NULL) ||
+       ((p_writes == NULL) && (max_writes != 0)) || (p_write_cnt == NULL))
+        return T2T_E_INVALID_ARGS;
+
+    *p_write_cnt = 0;
+
+    type_2_tag_t        header = { .max_tlv_blocks = 0 };
+    type_2_tag_status_t err_code = type_2_tag_header_parse(&header, p_raw_data);
+    if(err_code != T2T_OK)
+        return err_code;
+
+    if(header.cc.write_access != T2T_WRITE_ACCESS_GRANTED)
+        return T2T_E_NOT_SUPPORTED;
+
+    uint16_t data_end = (uint16_t)(T2T_FIRST_DATA_BLOCK_OFFSET + header.cc.data_area_size);
+
+    /* Keep the control TLVs leading the data area. */
+    type_2_tag_reserved_t areas[T2T_MAX_RESERVED_AREAS];
+    uint8_t               area_cnt;
+    size_t                prefix;
+    size_t                ctrl_end;
+
+    err_code = type_2_tag_ctrl_prefix(p_raw_data, data_end, areas, &area_cnt, &prefix, &ctrl_end);
+    if(err_code != T2T_OK)
+        return err_code;
+
+    memcpy(p_new_raw_data, p_raw_data, data_end);
+
+    type_2_tag_vmem_t vmem;
+    err_code = type_2_tag_vmem_init(&vmem, p_new_raw_data, data_end, areas, area_cnt);
+    if(err_code != T2T_OK)
+        return err_code;
+
+    /* The NDEF TLV starts the first whole block of data after the control TLVs,
+     * so its type and length bytes share one block in either length format. */
+    size_t    pad_offset  = type_2_tag_vmem_offset(&vmem, ctrl_end);
+    size_t    ndef_offset = pad_offset;
+    size_t    run;
+    uint8_t * p_data;
+
+    while((run = type_2_tag_vmem_span(&vmem, ndef_offset, &p_data)) != 0)
+    {
+        size_t misalign = (size_t)(p_data - p_new_raw_data) % T2T_BLOCK_SIZE;
+
+        if((misalign == 0) && (run >= T2T_BLOCK_SIZE))
+            break;
+
+        size_t skip = (misalign == 0) ? run : T2T_BLOCK_SIZE - misalign;
+        ndef_offset += (skip < run) ? skip : run;
+    }
+
+    uint8_t tlv_header[TLV_T_LENGTH + TLV_L_LONG_LENGTH];
+    size_t  header_len;
+
+    if((run == 0) || (msg_len >= 0xFFFF) ||
+       (tlv_encode_header(TLV_NDEF_MESSAGE, msg_len, tlv_header, sizeof(tlv_header), &header_len) != TLV_OK) ||
+       (ndef_offset + header_len + msg_len > vmem.size))
+        return T2T_E_NO_MEM;
+
+    for(size_t offset = pad_offset; offset < ndef_offset; offset++)
+    {
+        uint8_t null_tlv = TLV_NULL;
+        type_2_tag_vmem_write(&vmem, offset, &null_tlv, 1);
+    }
+
+    type_2_tag_vmem_write(&vmem, ndef_offset, tlv_header, header_len);
+    type_2_tag_vmem_write(&vmem, ndef_offset + header_len, p_msg, msg_len);
+
+    if(ndef_offset + header_len + msg_len < vmem.size)
+    {
+        uint8_t terminator = TLV_TERMINATOR;
+        type_2_tag_vmem_write(&vmem, ndef_offset + header_len + msg_len, &terminator, 1);
+    }
+
+    /* The first TLV the tag holds after its control TLVs: the old one, or the
+     * new NDEF TLV if the old one lies past it (only NULL padding before it). */
+    size_t old_offset = type_2_tag_vmem_offset(&vmem, prefix);
+    size_t mark_run   = type_2_tag_vmem_span(&vmem, (old_offset < ndef_offset) ? old_offset : ndef_offset, &p_data);
+    size_t mark_pos   = (size_t)(p_data - p_new_raw_data);
+    uint16_t mark_block = (uint16_t)(mark_pos / T2T_BLOCK_SIZE);
+
+    uint16_t first_block = T2T_FIRST_DATA_BLOCK_OFFSET / T2T_BLOCK_SIZE;
+    uint16_t end_block   = (uint16_t)(data_end / T2T_BLOCK_SIZE);
+    uint8_t  content_changed = 0;
+
+    for(uint16_t block_no = first_block; (block_no < end_block) && !content_changed; block_no++)
+    {
+        size_t pos = (size_t)block_no * T2T_BLOCK_SIZE;
+
+        if((block_no != mark_block) && (memcmp(p_raw_data + pos, p_new_raw_data + pos, T2T_BLOCK_SIZE) != 0))
+            content_changed = 1;
+    }
+
+    /* The current content of the block holding that TLV, as the plan progresses. */
+    uint8_t current[T2T_BLOCK_SIZE];
+    memcpy(current, p_raw_data + (size_t)mark_block * T2T_BLOCK_SIZE, T2T_BLOCK_SIZE);
+
+    if(content_changed)
+    {
+        /* Replace that TLV with an empty NDEF message before touching the content;
+         * with fewer than three bytes left in its block, end the data area there. */
+        static const uint8_t empty_ndef[] = { TLV_NDEF_MESSAGE, 0, TLV_TERMINATOR };
+
+        uint8_t interim[T2T_BLOCK_SIZE];
+        size_t  mark_offset = mark_pos % T2T_BLOCK_SIZE;
+
+        memcpy(interim, p_new_raw_data + (size_t)mark_block * T2T_BLOCK_SIZE, T2T_BLOCK_SIZE);
+
+        if((mark_offset + sizeof(empty_ndef) <= T2T_BLOCK_SIZE) && (mark_run >= sizeof(empty_ndef)))
+            memcpy(interim + mark_offset, empty_ndef, sizeof(empty_ndef));
+        else
+            interim[mark_offset] = TLV_TERMINATOR;
+
+        type_2_tag_write_add(p_writes, max_writes, p_write_cnt, mark_block, current, interim);
+
+        for(uint16_t block_no = first_block; block_no < end_block; block_no++)
+        {
+            size_t pos = (size_t)block_no * T2T_BLOCK_SIZE;
+
+            if(block_no != mark_block)
+            {
+                uint8_t old[T2T_BLOCK_SIZE];
+                memcpy(old, p_raw_data + pos, T2T_BLOCK_SIZE);
+                type_2_tag_write_add(p_writes, max_writes, p_write_cnt, block_no, old, p_new_raw_data + pos);
+            }
+        }
+    }
+
+    /* Expose the new NDEF TLV last. */
+    type_2_tag_write_add(p_writes, max_writes, p_write_cnt, mark_block, current,
+                         p_new_raw_data + (size_t)mark_block * T2T_BLOCK_SIZE);
+
+    return (*p_write_cnt > max_writes) ? T2T_E_NO_MEM : T2T_OK;
+}
+
+type_2_tag_status_t type_2_tag_ndef_copy(uint8_t * p_raw_data, uint8_t * p_buf, size_t buf_len, size_t * p_len)
+{
+    if((p_raw_data == NULL) || ((p_buf == NULL) && (buf_len != 0)) || (p_len == NULL))
+        return T2T_E_INVALID_ARGS;
+
+    *p_len = 0;
+
+    type_2_tag_t        header = { .max_tlv_blocks = 0 };
+    type_2_tag_status_t err_code = type_2_tag_header_parse(&header, p_raw_data);
+    if(err_code != T2T_OK)
+        return err_code;
+
+    uint16_t              data_end = (uint16_t)(T2T_FIRST_DATA_BLOCK_OFFSET + header.cc.data_area_size);
+    type_2_tag_reserved_t areas[T2T_MAX_RESERVED_AREAS];
+    uint8_t               area_cnt;
+    size_t                prefix;
+
+    err_code = type_2_tag_ctrl_prefix(p_raw_data, data_end, areas, &area_cnt, &prefix, NULL);
+    if(err_code != T2T_OK)
+        return err_code;
+
+    type_2_tag_vmem_t vmem;
+    err_code = type_2_tag_vmem_init(&vmem, p_raw_data, data_end, areas, area_cnt);
+    if(err_code != T2T_OK)
+        return err_code;
+
+    size_t offset = 0;
+
+    while(offset < vmem.size)
+    {
+        tlv_t  tlv;
+        size_t value_offset;
+
+        err_code = type_2_tag_vmem_next_tlv(&vmem, &offset, &tlv, &value_offset);
+
+        if(err_code == T2T_E_NOT_FOUND)
+            continue;
+        else if(err_code != T2T_OK)
+            return err_code;
+
+        if(tlv.type == TLV_TERMINATOR)
+            break;
+        if(tlv.type != TLV_NDEF_MESSAGE)
+            continue;
+
+        if(tlv.length > buf_len)
+            return T2T_E_NO_MEM;
+
+        type_2_tag_vmem_read(&vmem, value_offset, p_buf, tlv.length);
+        *p_len = tlv.length;
+
+        return T2T_OK;
+    }
+
+    return T2T_E_NOT_FOUND;
+}
@@ -1,7 +1,15 @@
 #ifndef _TYPE_2_TAG_H_
 #define _TYPE_2_TAG_H_
 
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
 
+#include <stdint.h>
+#include <stddef.h>
+
+#include "nfc_tlv_block.h"
 
 #define T2T_SUPPORTED_MAJOR_VERSION 1   /* Supported major version of the Type 2 Tag specification. */
 
@@ -13,6 +21,35 @@
 
 #define T2T_FIRST_DATA_BLOCK_OFFSET 16  /* Offset of the data area in the Type 2 Tag. */
 
+#define T2T_READ_SIZE               16  /* Number of bytes returned by a single READ command. */
+
+#define T2T_CASCADE_TAG             0x88    /* Cascade tag byte included in the first check byte. */
+
+#define T2T_NFC_FORUM_DEFINED_DATA  0xE1    /* CC magic number indicating NDEF data is present. */
+
+#define T2T_DATA_AREA_SIZE_UNIT     8   /* The CC data area size byte is expressed in multiples of 8 bytes. */
+
+/**
+ * @brief Size of a raw data buffer able to hold a tag with the given data area size.
+ *
+ * READ commands always return 16 bytes, so the buffer is padded to absorb the
+ * final READ running past the end of the data area.
+ */
+#define T2T_RAW_DATA_SIZE(__DATA_AREA_SIZE__)   (T2T_FIRST_DATA_BLOCK_OFFSET + (__DATA_AREA_SIZE__) + T2T_READ_SIZE)
+
+/**
+ * @brief Type 2 Tag API status codes.
+ */
+typedef enum
+{
+    T2T_OK,                 /* Success                                         */
+    T2T_E_NOT_FOUND,        /* No NDEF message TLV found in the data area       */
+    T2T_E_INVALID_ARGS,     /* Invalid function arguments                      */
+    T2T_E_NO_MEM,           /* Not enough memory for the TLV blocks or raw data */
+    T2T_E_INVALID_DATA,     /* Check byte, CC or TLV data is invalid           */
+    T2T_E_NOT_SUPPORTED,    /* Unsupported Type 2 Tag specification version    */
+} type_2_tag_status_t;
+
 
 
 /**
@@ -50,11 +87,83 @@ typedef struct
     type_2_tag_capability_container_t   cc;                 ///< Values within the Capability Container area of the tag.
 
     uint16_t                      const max_tlv_blocks;     ///< Maximum number of TLV blocks that can be stored.
-    tlv_block_t                       * p_tlv_block_array;  ///< Pointer to the array for TLV blocks.
+    tlv_t                             * p_tlv_block_array;  ///< Pointer to the array for TLV blocks.
     uint16_t                            tlv_count;          ///< Number of TLV blocks stored in the Type 2 Tag.
 
 } type_2_tag_t;
 
+/**
+ * @brief Memory area reserved by a Lock Control or Memory Control TLV.
+ */
+typedef struct
+{
+    uint8_t     type;           ///< TLV_LOCK_CONTROL or TLV_MEMORY_CONTROL.
+    uint16_t    offset;         ///< Byte address of the area, from the start of block 0.
+    uint16_t    size;           ///< Size of the area in bytes.
+    uint16_t    bytes_per_bit;  ///< Bytes locked by each lock bit (Lock Control only).
+} type_2_tag_reserved_t;
+
+/**
+ * @brief Virtual view of the data area with the reserved areas removed.
+ *
+ * Virtual offset 0 is the first byte of the data area. Bytes are not
+ * copied: each virtual offset maps to a byte of the raw data.
+ */
+typedef struct
+{
+    uint8_t                     * p_raw_data;   ///< Raw data of the tag, from block 0.
+    uint16_t                      data_end;     ///< Offset one past the end of the data area.
+    type_2_tag_reserved_t       * p_areas;      ///< Reserved areas, sorted and merged by init.
+    uint8_t                       area_cnt;     ///< Number of reserved areas inside the data area.
+    uint16_t                      size;         ///< Size of the virtual data area in bytes.
+} type_2_tag_vmem_t;
+
+/**
+ * @brief Single WRITE command produced by the write planner.
+ */
+typedef struct
+{
+    uint16_t    block_no;               ///< Block number, counted from block 0.
+    uint8_t     data[T2T_BLOCK_SIZE];   ///< Data to write to the block.
+} type_2_tag_write_t;
+
+/**
+ * @brief Macro for creating and initializing a Type 2 Tag descriptor.
+ *
+ * @param[in] __NAME__          Name of the descriptor.
+ * @param[in] __MAX_BLOCKS__    Maximum number of TLV blocks that can be stored.
+ */
+#define TYPE_2_TAG_DEF(__NAME__, __MAX_BLOCKS__)                    \
+    static tlv_t __NAME__##_tlv_block_array[__MAX_BLOCKS__];        \
+    static type_2_tag_t __NAME__ =                                  \
+    {                                                               \
+        .max_tlv_blocks    = (__MAX_BLOCKS__),                      \
+        .p_tlv_block_array = __NAME__##_tlv_block_array,            \
+        .tlv_count         = 0                                      \
+    }
+
+/**
+ * @brief State of the minimal-read planner.
+ *
+ * The planner decides which 16-byte READ commands are needed to fetch the
+ * first NDEF message TLV of a tag. It reads blocks 0-3 first, uses the CC to
+ * bound the data area and then follows the TLV lengths, skipping the pages
+ * that only hold the value of TLV blocks it does not need.
+ */
+typedef struct
+{
+    size_t      raw_size;       ///< Size of the raw data buffer.
+    uint16_t    data_end;       ///< Offset one past the end of the data area (0 until the CC has been read).
+    uint16_t    tlv_offset;     ///< Offset of the next TLV block to decode.
+    uint16_t    valid_start;    ///< Start offset of the window of bytes read so far.
+    uint16_t    valid_end;      ///< End offset of the window of bytes read so far.
+    uint16_t    ndef_offset;    ///< Offset of the NDEF message TLV value field, once its header has been read.
+    uint16_t    ndef_length;    ///< Length of the NDEF message TLV value field, once its header has been read.
+    uint16_t    read_count;     ///< Number of READ commands issued so far.
+    uint8_t     next_block;     ///< Block number for the next READ command.
+    uint8_t     done;           ///< Set once no more READ commands are needed.
+} type_2_tag_read_plan_t;
+
 
 /**
  * @brief Function for clearing the @ref type_2_tag_t structure.
@@ -74,12 +183,26 @@ void type_2_tag_clear(type_2_tag_t * p_type_2_tag);
  * @param[in]  p_raw_data       Pointer to the buffer with raw data from the tag (should
  *                              point at the first byte of the first block of the tag).
  *
- * @retval     NRF_SUCCESS      If the data was parsed successfully.
- * @retval     NRF_ERROR_NO_MEM If there is not enough memory to store all of the TLV blocks.
- * @retval     Other            If an error occurred during the parsing operation.
+ * Only the TLV blocks reachable by following the TLV lengths are inspected, so
+ * value fields the read planner skipped are never looked at. The planner stops
+ * at the NDEF message TLV, though, and parsing carries on past it: a buffer
+ * filled through the planner must have been zeroed before the first READ so
+ * the unread rest of the data area reads as NULL blocks. Callers that only
+ * need the message can take it from the planner's ndef_offset and ndef_length
+ * instead of parsing. NULL blocks are not stored and parsing stops at the
+ * TERMINATOR block or the end of the data area given by the CC. When Lock or
+ * Memory Control TLVs lead the data area, the blocks are walked through a
+ * @ref type_2_tag_vmem_t view so the reserved areas they describe are skipped.
+ * A value split by a reserved area is stored with a NULL value pointer; use
+ * @ref type_2_tag_ndef_copy to read such an NDEF message.
+ *
+ * @retval     T2T_OK             If the data was parsed successfully.
+ * @retval     T2T_E_NO_MEM       If there is not enough memory to store all of the TLV blocks,
+ *                                or the tag holds more than 8 control TLVs.
+ * @retval     Other              If an error occurred during the parsing operation.
  *
  */
-ret_code_t type_2_tag_parse(type_2_tag_t * p_type_2_tag, uint8_t * p_raw_data);
+type_2_tag_status_t type_2_tag_parse(type_2_tag_t * p_type_2_tag, uint8_t * p_raw_data);
 
 /**
  * @brief Function for printing parsed contents of the Type 2 Tag.
@@ -89,5 +212,180 @@ ret_code_t type_2_tag_parse(type_2_tag_t * p_type_2_tag, uint8_t * p_raw_data);
  */
 void type_2_tag_printout(type_2_tag_t * p_type_2_tag);
 
+/**
+ * @brief Function for initializing the minimal-read planner.
+ *
+ * @param[out] p_plan       Pointer to the planner state.
+ * @param[in]  raw_size     Size of the raw data buffer the READ responses are stored in.
+ *
+ */
+void type_2_tag_read_plan_init(type_2_tag_read_plan_t * p_plan, size_t raw_size);
+
+/**
+ * @brief Function for getting the next READ command needed to fetch the NDEF message.
+ *
+ * The first call returns block 0. Before each following call the caller must
+ * have stored the 16 bytes returned by READ of the previous block number at
+ * @p p_raw_data + block number * @ref T2T_BLOCK_SIZE. Once @p p_plan->done is
+ * set the NDEF message TLV value lies at @p p_plan->ndef_offset in the raw data.
+ * Lock and Memory Control TLVs are skipped like any other block, so the
+ * planner only serves tags whose NDEF message is not split by a reserved area.
+ *
+ * @param[in,out] p_plan        Pointer to the planner state.
+ * @param[in]     p_raw_data    Pointer to the buffer with raw data read so far.
+ * @param[out]    p_block_no    Block number for the next READ command (valid while not done).
+ *
+ * @retval     T2T_OK             If a READ is needed, or the NDEF message TLV has been fully read.
+ * @retval     T2T_E_NOT_FOUND    If the data area holds no NDEF message TLV.
+ * @retval     T2T_E_NO_MEM       If the data area does not fit in the raw data buffer.
+ * @retval     Other              If the header or TLV data is invalid.
+ *
+ */
+type_2_tag_status_t type_2_tag_read_plan_next(type_2_tag_read_plan_t * p_plan,
+                                              uint8_t                * p_raw_data,
+                                              uint8_t                * p_block_no);
+
+/**
+ * @brief Function for decoding a Lock Control or Memory Control TLV block.
+ *
+ * @param[in]  p_tlv    Pointer to the TLV block.
+ * @param[out] p_area   Pointer to the reserved area described by the block.
+ *
+ * @retval     T2T_OK             If the block was decoded.
+ * @retval     T2T_E_INVALID_ARGS If the block is not a control TLV of length 3.
+ *
+ */
+type_2_tag_status_t type_2_tag_ctrl_tlv_decode(const tlv_t * p_tlv, type_2_tag_reserved_t * p_area);
+
+/**
+ * @brief Function for building the reserved-area map of a parsed tag.
+ *
+ * @param[in]  p_type_2_tag Pointer to a parsed tag.
+ * @param[out] p_areas      Array receiving one area per control TLV.
+ * @param[in]  max_areas    Capacity of @p p_areas.
+ * @param[out] p_area_cnt   Number of areas stored.
+ *
+ * @retval     T2T_OK             If all control TLVs were decoded.
+ * @retval     T2T_E_NO_MEM       If the tag holds more control TLVs than @p max_areas.
+ *
+ */
+type_2_tag_status_t type_2_tag_reserved_map(const type_2_tag_t    * p_type_2_tag,
+                                            type_2_tag_reserved_t * p_areas,
+                                            uint8_t                 max_areas,
+                                            uint8_t               * p_area_cnt);
+
+/**
+ * @brief Function for initializing a virtual data area view.
+ *
+ * The areas are sorted, merged and clipped to the data area in place.
+ *
+ * @param[out]    p_vmem        Pointer to the view.
+ * @param[in]     p_raw_data    Raw data of the tag, from block 0.
+ * @param[in]     data_end      Offset one past the end of the data area.
+ * @param[in,out] p_areas       Reserved areas (may be NULL if @p area_cnt is 0).
+ * @param[in]     area_cnt      Number of reserved areas.
+ *
+ */
+type_2_tag_status_t type_2_tag_vmem_init(type_2_tag_vmem_t     * p_vmem,
+                                         uint8_t               * p_raw_data,
+                                         uint16_t                data_end,
+                                         type_2_tag_reserved_t * p_areas,
+                                         uint8_t                 area_cnt);
+
+/**
+ * @brief Function for getting the contiguous run of raw bytes at a virtual offset.
+ *
+ * @param[in]  p_vmem   Pointer to the view.
+ * @param[in]  offset   Virtual offset.
+ * @param[out] pp_data  Pointer to the raw byte at @p offset.
+ *
+ * @return Number of bytes up to the next reserved area or the end of the data area (0 past the end).
+ *
+ */
+size_t type_2_tag_vmem_span(const type_2_tag_vmem_t * p_vmem, size_t offset, uint8_t ** pp_data);
+
+/**
+ * @brief Function for parsing the TLV block at a virtual offset.
+ *
+ * Header fields may straddle reserved areas. The value pointer is only set
+ * when the value is contiguous in the raw data; otherwise it is NULL and the
+ * value is read with @ref type_2_tag_vmem_span from @p p_value_offset.
+ *
+ * @param[in]     p_vmem          Pointer to the view.
+ * @param[in,out] p_offset        Virtual offset of the block, advanced past it.
+ * @param[out]    p_tlv           Pointer to the parsed block.
+ * @param[out]    p_value_offset  Virtual offset of the value field.
+ *
+ * @retval     T2T_OK             If a block was parsed.
+ * @retval     T2T_E_NOT_FOUND    If an unknown byte was skipped.
+ * @retval     T2T_E_INVALID_DATA If the block runs past the end of the data area.
+ *
+ */
+type_2_tag_status_t type_2_tag_vmem_next_tlv(const type_2_tag_vmem_t * p_vmem,
+                                             size_t                  * p_offset,
+                                             tlv_t                   * p_tlv,
+                                             size_t                  * p_value_offset);
+
+/**
+ * @brief Function for planning the WRITE commands that store a new NDEF message on a tag.
+ *
+ * Lock Control and Memory Control TLVs at the start of the data area are kept
+ * and the NDEF message TLV is laid out from the first whole block after them,
+ * NULL padding in between, followed by a TERMINATOR block if it fits. Reserved
+ * areas are skipped. Only blocks whose content changes are written.
+ *
+ * The type and length bytes of the NDEF TLV thus share one block. If any other
+ * block changes, the first WRITE replaces the first TLV following the control
+ * TLVs with an empty NDEF message and the last WRITE exposes the new one, so an
+ * interrupted update leaves the old message, an empty one or the new one. If
+ * the old TLV starts in the last two bytes of a block, the first WRITE puts a
+ * TERMINATOR block there instead and an interrupted update leaves no NDEF
+ * message rather than an empty one.
+ *
+ * @param[in]  p_raw_data       Raw data currently on the tag, from block 0.
+ * @param[in]  p_msg            Encoded NDEF message.
+ * @param[in]  msg_len          Length of the NDEF message.
+ * @param[out] p_new_raw_data   Buffer receiving the tag image after the update
+ *                              (at least the size of @p p_raw_data).
+ * @param[out] p_writes         Array receiving the WRITE commands, in order.
+ * @param[in]  max_writes       Capacity of @p p_writes.
+ * @param[out] p_write_cnt      Number of WRITE commands required.
+ *
+ * @retval     T2T_OK               If the plan was stored.
+ * @retval     T2T_E_NOT_SUPPORTED  If the CC does not grant write access.
+ * @retval     T2T_E_NO_MEM         If the message does not fit the data area or
+ *                                  more than @p max_writes commands are required.
+ *
+ */
+type_2_tag_status_t type_2_tag_write_plan(uint8_t            * p_raw_data,
+                                          const uint8_t      * p_msg,
+                                          size_t               msg_len,
+                                          uint8_t            * p_new_raw_data,
+                                          type_2_tag_write_t * p_writes,
+                                          size_t               max_writes,
+                                          size_t             * p_write_cnt);
+
+/**
+ * @brief Function for copying the first NDEF message of a tag into a contiguous buffer.
+ *
+ * The data area is walked like @ref type_2_tag_parse does, and the message
+ * bytes are gathered around any reserved areas. Use it for messages that
+ * @ref type_2_tag_parse stored with a NULL value pointer.
+ *
+ * @param[in]  p_raw_data   Raw data of the tag, from block 0.
+ * @param[out] p_buf        Buffer receiving the NDEF message.
+ * @param[in]  buf_len      Size of @p p_buf.
+ * @param[out] p_len        Length of the NDEF message.
+ *
+ * @retval     T2T_OK             If the message was copied.
+ * @retval     T2T_E_NOT_FOUND    If the data area holds no NDEF message TLV.
+ * @retval     T2T_E_NO_MEM       If the message does not fit in @p p_buf.
+ * @retval     Other              If the header or TLV data is invalid.
+ *
+ */
+type_2_tag_status_t type_2_tag_ndef_copy(uint8_t * p_raw_data, uint8_t * p_buf, size_t buf_len, size_t * p_len);
 
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
 #endif
\ No newline at end of file
@@ -0,0 +1,339 @@
+#include "type_4_tag.h"
+
+#include <string.h>
+
+#define T4T_CC_LEN_OFFSET           0   /* Offset of CCLEN. */
+#define T4T_CC_VERSION_OFFSET       2   /* Offset of the mapping version. */
+#define T4T_CC_MLE_OFFSET           3   /* Offset of MLe. */
+#define T4T_CC_MLC_OFFSET           5   /* Offset of MLc. */
+#define T4T_CC_CTRL_TLV_OFFSET      7   /* Offset of the (E)NDEF File Control TLV. */
+
+#define T4T_NDEF_CTRL_TLV_LEN       6   /* Length of the NDEF File Control TLV value. */
+#define T4T_ENDEF_CTRL_TLV_LEN      8   /* Length of the ENDEF File Control TLV value. */
+
+#define T4T_ODO_OFFSET_TAG          0x54    /* Offset data object tag. */
+#define T4T_ODO_DATA_TAG            0x53    /* Discretionary data object tag. */
+#define T4T_ODO_OFFSET_LEN          3       /* Length of the offset data object value. */
+
+/**
+ * @brief Function for reading a big-endian field.
+ */
+static uint32_t type_4_tag_be(const uint8_t * p_buf, size_t len)
+{
+    uint32_t value = 0;
+
+    for(size_t i = 0; i < len; i++)
+        value = (value << 8) | p_buf[i];
+
+    return value;
+}
+
+/**
+ * @brief Function for ending a plan on an error.
+ */
+static type_4_tag_status_t type_4_tag_plan_fail(type_4_tag_read_plan_t * p_plan, type_4_tag_status_t err_code)
+{
+    p_plan->done        = 1;
+    p_plan->ndef_offset = 0;
+    p_plan->ndef_length = 0;
+
+    return err_code;
+}
+
+/**
+ * @brief Function for getting the size of the data object header wrapping a B1 response.
+ */
+static uint32_t type_4_tag_odo_header_size(uint32_t length)
+{
+    if(length < 0x80)
+        return 2;
+    if(length <= 0xFF)
+        return 3;
+    return T4T_ODO_RSP_OVERHEAD;
+}
+
+/**
+ * @brief Function for encoding Le in short or extended form.
+ */
+static size_t type_4_tag_le(uint32_t le, uint8_t extended, uint8_t * p_buf)
+{
+    if(!extended)
+    {
+        p_buf[0] = (uint8_t)(le & 0xFF);    /* 256 is encoded as 0x00 */
+        return 1;
+    }
+
+    p_buf[0] = (uint8_t)((le >> 8) & 0xFF); /* 65536 is encoded as 0x0000 */
+    p_buf[1] = (uint8_t)(le & 0xFF);
+    return 2;
+}
+
+type_4_tag_status_t type_4_tag_cc_parse(type_4_tag_capability_container_t * p_cc,
+                                        const uint8_t                     * p_data,
+                                        size_t                              len)
+{
+    if((p_cc == NULL) || (p_data == NULL))
+        return T4T_E_INVALID_ARGS;
+
+    if(len < T4T_CC_SIZE)
+        return T4T_E_NO_MEM;
+
+    const uint8_t * p_tlv = p_data + T4T_CC_CTRL_TLV_OFFSET;
+
+    p_cc->cc_len        = (uint16_t)type_4_tag_be(p_data + T4T_CC_LEN_OFFSET, 2);
+    p_cc->major_version = p_data[T4T_CC_VERSION_OFFSET] >> 4;
+    p_cc->minor_version = p_data[T4T_CC_VERSION_OFFSET] & 0x0F;
+    p_cc->mle           = (uint16_t)type_4_tag_be(p_data + T4T_CC_MLE_OFFSET, 2);
+    p_cc->mlc           = (uint16_t)type_4_tag_be(p_data + T4T_CC_MLC_OFFSET, 2);
+
+    if(p_cc->major_version > T4T_SUPPORTED_MAJOR_VERSION)
+        return T4T_E_NOT_SUPPORTED;
+
+    if((p_cc->mle < T4T_MIN_MLE) || (p_cc->mlc == 0))
+        return T4T_E_INVALID_DATA;
+
+    if((p_tlv[0] == T4T_NDEF_FILE_CTRL_TLV) && (p_tlv[1] == T4T_NDEF_CTRL_TLV_LEN))
+    {
+        p_cc->file_id       = (uint16_t)type_4_tag_be(p_tlv + 2, 2);
+        p_cc->max_file_size = type_4_tag_be(p_tlv + 4, 2);
+        p_cc->read_access   = p_tlv[6];
+        p_cc->write_access  = p_tlv[7];
+        p_cc->nlen_size     = T4T_NLEN_SIZE;
+    }
+    else if((p_tlv[0] == T4T_ENDEF_FILE_CTRL_TLV) && (p_tlv[1] == T4T_ENDEF_CTRL_TLV_LEN))
+    {
+        if(len < T4T_CC_EXT_SIZE)
+            return T4T_E_NO_MEM;
+
+        p_cc->file_id       = (uint16_t)type_4_tag_be(p_tlv + 2, 2);
+        p_cc->max_file_size = type_4_tag_be(p_tlv + 4, 4);
+        p_cc->read_access   = p_tlv[8];
+        p_cc->write_access  = p_tlv[9];
+        p_cc->nlen_size     = T4T_ENLEN_SIZE;
+    }
+    else
+    {
+        return T4T_E_INVALID_DATA;
+    }
+
+    if(p_cc->max_file_size <= p_cc->nlen_size)
+        return T4T_E_INVALID_DATA;
+
+    return T4T_OK;
+}
+
+void type_4_tag_read_plan_init(type_4_tag_read_plan_t                  * p_plan,
+                               const type_4_tag_capability_container_t * p_cc,
+                               size_t                                    raw_size,
+                               uint32_t                                  reader_le)
+{
+    if((p_plan == NULL) || (p_cc == NULL))
+        return;
+
+    memset(p_plan, 0, sizeof(*p_plan));
+    p_plan->raw_size      = raw_size;
+    p_plan->max_file_size = p_cc->max_file_size;
+    p_plan->nlen_size     = p_cc->nlen_size;
+
+    uint32_t max_le = (reader_le < p_cc->mle) ? reader_le : p_cc->mle;
+
+    if(max_le > T4T_MAX_EXT_LE)
+        max_le = T4T_MAX_EXT_LE;
+
+    p_plan->max_le = max_le;
+}
+
+type_4_tag_status_t type_4_tag_read_plan_next(type_4_tag_read_plan_t * p_plan,
+                                              uint8_t                * p_raw_data,
+                                              uint32_t               * p_offset,
+                                              uint32_t               * p_length)
+{
+    if((p_plan == NULL) || (p_raw_data == NULL) || (p_offset == NULL) || (p_length == NULL))
+        return T4T_E_INVALID_ARGS;
+
+    if(p_plan->done)
+        return (p_plan->ndef_offset != 0) ? T4T_OK : T4T_E_NOT_FOUND;
+
+    if(p_plan->read_count != 0)
+    {
+        /* Account for the data returned by the previous command. */
+        p_plan->valid_end = p_plan->next_offset + p_plan->next_length;
+    }
+    else if((p_plan->max_le <= T4T_ODO_RSP_OVERHEAD) || (p_plan->nlen_size == 0))
+    {
+        return type_4_tag_plan_fail(p_plan, T4T_E_INVALID_ARGS);
+    }
+
+    if((p_plan->ndef_offset == 0) && (p_plan->valid_end >= p_plan->nlen_size))
+    {
+        uint32_t nlen = type_4_tag_be(p_raw_data, p_plan->nlen_size);
+
+        if(nlen == 0)
+            return type_4_tag_plan_fail(p_plan, T4T_E_NOT_FOUND);
+
+        if(nlen > p_plan->max_file_size - p_plan->nlen_size)
+            return type_4_tag_plan_fail(p_plan, T4T_E_INVALID_DATA);
+
+        if((size_t)p_plan->nlen_size + nlen > p_plan->raw_size)
+            return type_4_tag_plan_fail(p_plan, T4T_E_NO_MEM);
+
+        p_plan->ndef_offset = p_plan->nlen_size;
+        p_plan->ndef_length = nlen;
+    }
+
+    uint32_t want_end;
+
+    if(p_plan->ndef_offset != 0)
+    {
+        want_end = p_plan->ndef_offset + p_plan->ndef_length;
+
+        if(p_plan->valid_end >= want_end)
+        {
+            p_plan->done = 1;
+            return T4T_OK;
+        }
+    }
+    else
+    {
+        /* Length field and, for short messages, the whole message in one command. */
+        want_end = p_plan->nlen_size + T4T_PROBE_SIZE;
+
+        if(want_end > p_plan->max_file_size)
+            want_end = p_plan->max_file_size;
+        if(want_end > p_plan->raw_size)
+            want_end = (uint32_t)p_plan->raw_size;
+        if(want_end <= p_plan->valid_end)
+            return type_4_tag_plan_fail(p_plan, T4T_E_NO_MEM);
+    }
+
+    uint32_t offset = p_plan->valid_end;
+    uint32_t max_le = p_plan->max_le;
+
+    /* Past the B0 offset range the response is wrapped in a data object. */
+    if(offset > T4T_MAX_SHORT_OFFSET)
+        max_le -= T4T_ODO_RSP_OVERHEAD;
+
+    uint32_t length = want_end - offset;
+
+    if(length > max_le)
+        length = max_le;
+
+    p_plan->next_offset = offset;
+    p_plan->next_length = length;
+    p_plan->read_count++;
+    *p_offset = offset;
+    *p_length = length;
+
+    return T4T_OK;
+}
+
+type_4_tag_status_t type_4_tag_read_binary_apdu(const type_4_tag_read_plan_t * p_plan,
+                                                uint8_t                      * p_buf,
+                                                size_t                         len,
+                                                size_t                       * p_bw)
+{
+    if((p_plan == NULL) || (p_buf == NULL) || (p_bw == NULL) || (p_plan->next_length == 0))
+        return T4T_E_INVALID_ARGS;
+
+    uint32_t offset = p_plan->next_offset;
+    size_t   pos    = 0;
+
+    if(offset <= T4T_MAX_SHORT_OFFSET)
+    {
+        uint32_t le       = p_plan->next_length;
+        uint8_t  extended = (le > T4T_MAX_SHORT_LE);
+
+        if(len < (size_t)(extended ? 7 : 5))
+            return T4T_E_NO_MEM;
+
+        p_buf[pos++] = T4T_CLA;
+        p_buf[pos++] = T4T_INS_READ_BINARY;
+        p_buf[pos++] = (uint8_t)(offset >> 8);
+        p_buf[pos++] = (uint8_t)(offset & 0xFF);
+        if(extended)
+            p_buf[pos++] = 0x00;
+        pos += type_4_tag_le(le, extended, p_buf + pos);
+    }
+    else
+    {
+        uint32_t le       = p_plan->next_length + type_4_tag_odo_header_size(p_plan->next_length);
+        uint8_t  extended = (le > T4T_MAX_SHORT_LE);
+
+        if(len < (size_t)(extended ? 14 : 11))
+            return T4T_E_NO_MEM;
+
+        p_buf[pos++] = T4T_CLA;
+        p_buf[pos++] = T4T_INS_READ_BINARY_ODO;
+        p_buf[pos++] = 0x00;
+        p_buf[pos++] = 0x00;
+
+        /* Lc: extended when Le is, as both length fields must use the same form. */
+        if(extended)
+        {
+            p_buf[pos++] = 0x00;
+            p_buf[pos++] = 0x00;
+        }
+        p_buf[pos++] = 2 + T4T_ODO_OFFSET_LEN;
+
+        p_buf[pos++] = T4T_ODO_OFFSET_TAG;
+        p_buf[pos++] = T4T_ODO_OFFSET_LEN;
+        p_buf[pos++] = (uint8_t)(offset >> 16);
+        p_buf[pos++] = (uint8_t)(offset >> 8);
+        p_buf[pos++] = (uint8_t)(offset & 0xFF);
+        pos += type_4_tag_le(le, extended, p_buf + pos);
+    }
+
+    *p_bw = pos;
+
+    return T4T_OK;
+}
+
+type_4_tag_status_t type_4_tag_read_binary_rsp(const type_4_tag_read_plan_t * p_plan,
+                                               const uint8_t                * p_rsp,
+                                               size_t                         rsp_len,
+                                               uint8_t                      * p_raw_data)
+{
+    if((p_plan == NULL) || (p_rsp == NULL) || (p_raw_data == NULL))
+        return T4T_E_INVALID_ARGS;
+
+    if((rsp_len < 2) || (type_4_tag_be(p_rsp + rsp_len - 2, 2) != T4T_SW_OK))
+        return T4T_E_INVALID_DATA;
+
+    const uint8_t * p_data   = p_rsp;
+    size_t          data_len = rsp_len - 2;
+
+    if(p_plan->next_offset > T4T_MAX_SHORT_OFFSET)
+    {
+        /* 53 L data, with L in BER form: L, 81 L or 82 LL LL. */
+        if((data_len < 2) || (p_data[0] != T4T_ODO_DATA_TAG))
+            return T4T_E_INVALID_DATA;
+
+        size_t header_len = 2;
+        size_t value_len  = p_data[1];
+
+        if(p_data[1] == 0x81)
+            header_len = 3;
+        else if(p_data[1] == 0x82)
+            header_len = 4;
+        else if(p_data[1] >= 0x80)
+            return T4T_E_INVALID_DATA;
+
+        if(data_len < header_len)
+            return T4T_E_INVALID_DATA;
+        if(header_len > 2)
+            value_len = type_4_tag_be(p_data + 2, header_len - 2);
+
+        if(value_len != data_len - header_len)
+            return T4T_E_INVALID_DATA;
+
+        p_data   += header_len;
+        data_len  = value_len;
+    }
+
+    if(data_len != p_plan->next_length)
+        return T4T_E_INVALID_DATA;
+
+    memcpy(p_raw_data + p_plan->next_offset, p_data, data_len);
+
+    return T4T_OK;
+}
@@ -0,0 +1,201 @@
+#ifndef _TYPE_4_TAG_H_
+#define _TYPE_4_TAG_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define T4T_SUPPORTED_MAJOR_VERSION 3       /* Supported major version of the Type 4 Tag specification. */
+
+#define T4T_CC_FILE_ID              0xE103  /* File identifier of the Capability Container. */
+
+#define T4T_CC_SIZE                 15      /* Size of a CC holding an NDEF File Control TLV. */
+
+#define T4T_CC_EXT_SIZE             17      /* Size of a CC holding an ENDEF File Control TLV (version 3). */
+
+#define T4T_NDEF_FILE_CTRL_TLV      0x04    /* NDEF File Control TLV: 16-bit file size, 2-byte NLEN. */
+
+#define T4T_ENDEF_FILE_CTRL_TLV     0x06    /* ENDEF File Control TLV: 32-bit file size, 4-byte ENLEN. */
+
+#define T4T_NLEN_SIZE               2       /* Size of the NLEN field of an NDEF file. */
+
+#define T4T_ENLEN_SIZE              4       /* Size of the ENLEN field of an ENDEF file. */
+
+#define T4T_MIN_MLE                 0x000F  /* Smallest valid MLe. */
+
+#define T4T_MAX_SHORT_LE            256     /* Largest Le of a short APDU. */
+
+#define T4T_MAX_EXT_LE              65536   /* Largest Le of an extended-length APDU. */
+
+#define T4T_MAX_SHORT_OFFSET        0x7FFF  /* Largest offset READ BINARY (B0) can address. */
+
+#define T4T_ODO_RSP_OVERHEAD        4       /* Largest discretionary data object header in an odd-INS response. */
+
+#define T4T_PROBE_SIZE              64      /* Bytes requested by the first READ BINARY. */
+
+#define T4T_MAX_APDU_SIZE           14      /* Largest READ BINARY command APDU. */
+
+#define T4T_CLA                     0x00
+#define T4T_INS_READ_BINARY         0xB0
+#define T4T_INS_READ_BINARY_ODO     0xB1    /* READ BINARY with an offset data object, for offsets past 0x7FFF. */
+#define T4T_SW_OK                   0x9000  /* Status word of a successful command. */
+
+/**
+ * @brief Type 4 Tag API status codes.
+ */
+typedef enum
+{
+    T4T_OK,                 /* Success                                          */
+    T4T_E_NOT_FOUND,        /* NDEF file holds no NDEF message                   */
+    T4T_E_INVALID_ARGS,     /* Invalid function arguments                       */
+    T4T_E_NO_MEM,           /* Not enough memory for the raw data or command    */
+    T4T_E_INVALID_DATA,     /* CC, NLEN or response data is invalid             */
+    T4T_E_NOT_SUPPORTED,    /* Unsupported Type 4 Tag specification version     */
+} type_4_tag_status_t;
+
+/**
+ * @brief Descriptor for the Capability Container (CC) file of a Type 4 Tag.
+ */
+typedef struct
+{
+    uint16_t    cc_len;             ///< Size of the CC file in bytes.
+    uint8_t     major_version;      ///< Major version of the mapping.
+    uint8_t     minor_version;      ///< Minor version of the mapping.
+    uint16_t    mle;                ///< Largest R-APDU data size of READ BINARY.
+    uint16_t    mlc;                ///< Largest C-APDU data size of UPDATE BINARY.
+    uint16_t    file_id;            ///< File identifier of the NDEF file.
+    uint32_t    max_file_size;      ///< Size of the NDEF file, length field included.
+    uint8_t     read_access;        ///< Read access condition of the NDEF file.
+    uint8_t     write_access;       ///< Write access condition of the NDEF file.
+    uint8_t     nlen_size;          ///< Size of the length field at the start of the NDEF file (2 or 4).
+} type_4_tag_capability_container_t;
+
+/**
+ * @brief State of the Type 4 Tag read planner.
+ *
+ * The planner decides which READ BINARY commands are needed to fetch the
+ * NDEF file after it has been selected. The first command reads the length
+ * field and the start of the message; the rest of the message is then read
+ * with the largest response both the tag (MLe) and the reader accept, using
+ * extended-length APDUs when that is above 256 bytes.
+ */
+typedef struct
+{
+    size_t      raw_size;       ///< Size of the raw data buffer.
+    uint32_t    max_le;         ///< Largest data size per READ BINARY.
+    uint32_t    max_file_size;  ///< Size of the NDEF file from the CC.
+    uint8_t     nlen_size;      ///< Size of the length field of the NDEF file.
+    uint32_t    valid_end;      ///< Number of leading file bytes read so far.
+    uint32_t    ndef_offset;    ///< Offset of the NDEF message in the file, once the length field has been read.
+    uint32_t    ndef_length;    ///< Length of the NDEF message, once the length field has been read.
+    uint16_t    read_count;     ///< Number of READ BINARY commands issued so far.
+    uint32_t    next_offset;    ///< File offset of the next READ BINARY command.
+    uint32_t    next_length;    ///< Data size of the next READ BINARY command.
+    uint8_t     done;           ///< Set once no more READ BINARY commands are needed.
+} type_4_tag_read_plan_t;
+
+/**
+ * @brief Function for parsing the Capability Container file of a Type 4 Tag.
+ *
+ * @param[out] p_cc     Pointer to the structure receiving the CC.
+ * @param[in]  p_data   Pointer to the CC file contents.
+ * @param[in]  len      Number of bytes available at @p p_data.
+ *
+ * @retval     T4T_OK              If the CC was parsed.
+ * @retval     T4T_E_NO_MEM        If @p len does not cover the whole CC.
+ * @retval     T4T_E_INVALID_DATA  If a field of the CC is invalid.
+ * @retval     T4T_E_NOT_SUPPORTED If the major version is not supported.
+ *
+ */
+type_4_tag_status_t type_4_tag_cc_parse(type_4_tag_capability_container_t * p_cc,
+                                        const uint8_t                     * p_data,
+                                        size_t                              len);
+
+/**
+ * @brief Function for initializing the Type 4 Tag read planner.
+ *
+ * @param[out] p_plan       Pointer to the planner state.
+ * @param[in]  p_cc         Pointer to the parsed CC.
+ * @param[in]  raw_size     Size of the raw data buffer receiving the NDEF file.
+ * @param[in]  reader_le    Largest response data size the reader accepts; above
+ *                          @ref T4T_MAX_SHORT_LE the reader must support extended-length APDUs.
+ *
+ */
+void type_4_tag_read_plan_init(type_4_tag_read_plan_t                  * p_plan,
+                               const type_4_tag_capability_container_t * p_cc,
+                               size_t                                    raw_size,
+                               uint32_t                                  reader_le);
+
+/**
+ * @brief Function for getting the next READ BINARY command needed to fetch the NDEF message.
+ *
+ * Before each call but the first the caller must have stored the data
+ * returned by the previous command at @p p_raw_data + offset, for instance
+ * with @ref type_4_tag_read_binary_rsp. Once @p p_plan->done is set the NDEF
+ * message lies at @p p_plan->ndef_offset in the raw data.
+ *
+ * @param[in,out] p_plan        Pointer to the planner state.
+ * @param[in]     p_raw_data    Pointer to the buffer with the file data read so far.
+ * @param[out]    p_offset      File offset of the next command (valid while not done).
+ * @param[out]    p_length      Data size of the next command (valid while not done).
+ *
+ * @retval     T4T_OK             If a command is needed, or the NDEF message has been fully read.
+ * @retval     T4T_E_NOT_FOUND    If the NDEF file is empty.
+ * @retval     T4T_E_NO_MEM       If the message does not fit in the raw data buffer.
+ * @retval     T4T_E_INVALID_DATA If the length field exceeds the file size.
+ *
+ */
+type_4_tag_status_t type_4_tag_read_plan_next(type_4_tag_read_plan_t * p_plan,
+                                              uint8_t                * p_raw_data,
+                                              uint32_t               * p_offset,
+                                              uint32_t               * p_length);
+
+/**
+ * @brief Function for encoding the next READ BINARY command of a plan.
+ *
+ * Offsets up to @ref T4T_MAX_SHORT_OFFSET use READ BINARY (B0), larger ones
+ * READ BINARY with an offset data object (B1). Le is encoded in extended
+ * length when it exceeds @ref T4T_MAX_SHORT_LE.
+ *
+ * @param[in]  p_plan   Pointer to a planner state holding a pending command.
+ * @param[out] p_buf    Buffer receiving the command APDU.
+ * @param[in]  len      Size of @p p_buf, at least @ref T4T_MAX_APDU_SIZE is enough.
+ * @param[out] p_bw     Number of bytes written.
+ *
+ * @retval     T4T_OK             If the command was encoded.
+ * @retval     T4T_E_NO_MEM       If the buffer is too small.
+ *
+ */
+type_4_tag_status_t type_4_tag_read_binary_apdu(const type_4_tag_read_plan_t * p_plan,
+                                                uint8_t                      * p_buf,
+                                                size_t                         len,
+                                                size_t                       * p_bw);
+
+/**
+ * @brief Function for storing the response to the pending READ BINARY command of a plan.
+ *
+ * Checks the status word, removes the data object wrapping a B1 response and
+ * copies the data to @p p_raw_data + offset.
+ *
+ * @param[in]  p_plan       Pointer to a planner state holding a pending command.
+ * @param[in]  p_rsp        Pointer to the response APDU, status word included.
+ * @param[in]  rsp_len      Length of the response APDU.
+ * @param[out] p_raw_data   Pointer to the buffer receiving the file data.
+ *
+ * @retval     T4T_OK             If the data was stored.
+ * @retval     T4T_E_INVALID_DATA If the status word or the data length is wrong.
+ *
+ */
+type_4_tag_status_t type_4_tag_read_binary_rsp(const type_4_tag_read_plan_t * p_plan,
+                                               const uint8_t                * p_rsp,
+                                               size_t                         rsp_len,
+                                               uint8_t                      * p_raw_data);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif
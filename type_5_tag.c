@@ -0,0 +1,376 @@
+#include "type_5_tag.h"
+#include "nfc_stats.h"
+
+#include <string.h>
+
+#define T5T_CC_MAGIC_OFFSET         0   /* Offset of the CC magic number. */
+#define T5T_CC_VERSION_OFFSET       1   /* Offset of the version and access byte. */
+#define T5T_CC_MLEN_OFFSET          2   /* Offset of the 8-bit MLEN (0 for an 8-byte CC). */
+#define T5T_CC_FEATURES_OFFSET      3   /* Offset of the feature byte. */
+#define T5T_CC_EXT_MLEN_OFFSET      6   /* Offset of the 16-bit MLEN of an 8-byte CC. */
+
+#define T5T_MAX_BLOCK_NO            0xFF    /* Largest block address of the non-extended commands. */
+#define T5T_MAX_EXT_BLOCK_NO        0xFFFF  /* Largest block address of the extended commands. */
+
+/**
+ * @brief Function for decoding the header of a TLV block without requiring its value.
+ *
+ * @retval 0 if the buffer ends inside the header, otherwise the header length.
+ */
+static size_t type_5_tag_tlv_header(const uint8_t * p_buf, size_t len, size_t * p_value_len)
+{
+    if(len < TLV_T_LENGTH + TLV_L_SHORT_LENGTH)
+        return 0;
+
+    if(p_buf[1] == TLV_L_FORMAT_FLAG)
+    {
+        if(len < TLV_T_LENGTH + TLV_L_LONG_LENGTH)
+            return 0;
+
+        *p_value_len = (size_t)((p_buf[2] << 8) | p_buf[3]);
+        return TLV_T_LENGTH + TLV_L_LONG_LENGTH;
+    }
+
+    *p_value_len = p_buf[1];
+    return TLV_T_LENGTH + TLV_L_SHORT_LENGTH;
+}
+
+/**
+ * @brief Function for ending a plan on an error.
+ */
+static type_5_tag_status_t type_5_tag_plan_fail(type_5_tag_read_plan_t * p_plan, type_5_tag_status_t err_code)
+{
+    p_plan->done        = 1;
+    p_plan->ndef_offset = 0;
+    p_plan->ndef_length = 0;
+
+    return err_code;
+}
+
+type_5_tag_status_t type_5_tag_cc_parse(type_5_tag_capability_container_t * p_cc,
+                                        const uint8_t                     * p_raw_data,
+                                        size_t                              len)
+{
+    if((p_cc == NULL) || (p_raw_data == NULL))
+        return T5T_E_INVALID_ARGS;
+
+    if(len < T5T_CC_SIZE)
+        return T5T_E_NO_MEM;
+
+    uint8_t magic = p_raw_data[T5T_CC_MAGIC_OFFSET];
+
+    if((magic != T5T_CC_MAGIC_1_BYTE_ADDR) && (magic != T5T_CC_MAGIC_2_BYTE_ADDR))
+        return T5T_E_INVALID_DATA;
+
+    uint8_t version = p_raw_data[T5T_CC_VERSION_OFFSET];
+
+    p_cc->magic         = magic;
+    p_cc->major_version = version >> 6;
+    p_cc->minor_version = (version >> 4) & 0x03;
+    p_cc->read_access   = (version >> 2) & 0x03;
+    p_cc->write_access  = version & 0x03;
+    p_cc->features      = p_raw_data[T5T_CC_FEATURES_OFFSET];
+
+    if(p_raw_data[T5T_CC_MLEN_OFFSET] != 0)
+    {
+        p_cc->cc_size        = T5T_CC_SIZE;
+        p_cc->data_area_size = (uint32_t)p_raw_data[T5T_CC_MLEN_OFFSET] * T5T_DATA_AREA_SIZE_UNIT;
+    }
+    else
+    {
+        if(len < T5T_CC_EXT_SIZE)
+            return T5T_E_NO_MEM;
+
+        uint32_t mlen = ((uint32_t)p_raw_data[T5T_CC_EXT_MLEN_OFFSET] << 8) |
+                         (uint32_t)p_raw_data[T5T_CC_EXT_MLEN_OFFSET + 1];
+
+        p_cc->cc_size        = T5T_CC_EXT_SIZE;
+        p_cc->data_area_size = mlen * T5T_DATA_AREA_SIZE_UNIT;
+    }
+
+    if(p_cc->data_area_size == 0)
+        return T5T_E_INVALID_DATA;
+
+    if(p_cc->major_version > T5T_SUPPORTED_MAJOR_VERSION)
+        return T5T_E_NOT_SUPPORTED;
+
+    return T5T_OK;
+}
+
+void type_5_tag_read_plan_init(type_5_tag_read_plan_t * p_plan,
+                               size_t                   raw_size,
+                               uint16_t                 block_size,
+                               size_t                   max_read_size)
+{
+    if(p_plan == NULL)
+        return;
+
+    memset(p_plan, 0, sizeof(*p_plan));
+    p_plan->raw_size   = raw_size;
+    p_plan->block_size = block_size;
+
+    size_t max_blocks = (block_size != 0) ? max_read_size / block_size : 0;
+
+    if(max_blocks > T5T_MAX_BLOCKS_PER_READ)
+        max_blocks = T5T_MAX_BLOCKS_PER_READ;
+    if(max_blocks == 0)
+        max_blocks = 1;
+
+    p_plan->max_blocks = (uint16_t)max_blocks;
+}
+
+type_5_tag_status_t type_5_tag_read_plan_next(type_5_tag_read_plan_t * p_plan,
+                                              uint8_t                * p_raw_data,
+                                              uint16_t               * p_block_no,
+                                              uint16_t               * p_block_cnt)
+{
+    if((p_plan == NULL) || (p_raw_data == NULL) || (p_block_no == NULL) || (p_block_cnt == NULL))
+        return T5T_E_INVALID_ARGS;
+
+    if(p_plan->done)
+        return (p_plan->ndef_offset != 0) ? T5T_OK : T5T_E_NOT_FOUND;
+
+    uint32_t block_size = p_plan->block_size;
+
+    if(p_plan->read_count == 0)
+    {
+        if((block_size < T5T_CC_SIZE) || (block_size > T5T_MAX_BLOCK_SIZE))
+            return type_5_tag_plan_fail(p_plan, T5T_E_INVALID_ARGS);
+        if(p_plan->raw_size < block_size)
+            return type_5_tag_plan_fail(p_plan, T5T_E_NO_MEM);
+
+        /* READ MULTIPLE BLOCKS support is unknown until the CC has been read. */
+        p_plan->next_block = 0;
+        p_plan->next_count = 1;
+        p_plan->read_count++;
+        *p_block_no  = 0;
+        *p_block_cnt = 1;
+        return T5T_OK;
+    }
+
+    /* Account for the blocks returned by the previous READ. */
+    uint32_t read_start = (uint32_t)p_plan->next_block * block_size;
+    uint32_t read_end   = read_start + (uint32_t)p_plan->next_count * block_size;
+
+    if((read_start >= p_plan->valid_start) && (read_start <= p_plan->valid_end))
+    {
+        if(read_end > p_plan->valid_end)
+            p_plan->valid_end = read_end;
+    }
+    else
+    {
+        p_plan->valid_start = read_start;
+        p_plan->valid_end   = read_end;
+    }
+
+    uint32_t max_blocks = p_plan->max_blocks;
+
+    if(p_plan->data_end == 0)
+    {
+        type_5_tag_status_t err_code = type_5_tag_cc_parse(&p_plan->cc, p_raw_data, p_plan->valid_end);
+
+        if(err_code == T5T_OK)
+        {
+            uint32_t data_end = p_plan->cc.cc_size + p_plan->cc.data_area_size;
+            size_t   raw_end  = ((data_end + block_size - 1) / block_size) * block_size;
+
+            if(raw_end > p_plan->raw_size)
+                return type_5_tag_plan_fail(p_plan, T5T_E_NO_MEM);
+
+            if(!(p_plan->cc.features & T5T_FEATURE_MBREAD))
+                p_plan->max_blocks = 1;
+
+            p_plan->data_end   = data_end;
+            p_plan->tlv_offset = p_plan->cc.cc_size;
+        }
+        else if(err_code != T5T_E_NO_MEM)
+        {
+            return type_5_tag_plan_fail(p_plan, err_code);
+        }
+        else if(!(p_raw_data[T5T_CC_FEATURES_OFFSET] & T5T_FEATURE_MBREAD))
+        {
+            /* Rest of an 8-byte CC, one block at a time. */
+            max_blocks = 1;
+        }
+    }
+
+    while((p_plan->data_end != 0) && (p_plan->tlv_offset < p_plan->data_end))
+    {
+        uint32_t offset = p_plan->tlv_offset;
+
+        if((offset < p_plan->valid_start) || (offset >= p_plan->valid_end))
+            break;
+
+        uint32_t avail_end = (p_plan->valid_end < p_plan->data_end) ? p_plan->valid_end : p_plan->data_end;
+        size_t   padding   = tlv_skip_null(p_raw_data + offset, avail_end - offset);
+
+        if(padding != 0)
+        {
+            p_plan->tlv_offset = (uint32_t)(offset + padding);
+            continue;
+        }
+
+        size_t   avail     = avail_end - offset;
+        tlv_t    tlv;
+        size_t   br = 0;
+
+        tlv_status_t rslt = t2t_parse_next_tlv(p_raw_data + offset, avail, &tlv, &br);
+
+        if(rslt == TLV_OK)
+        {
+            if(tlv.type == TLV_NDEF_MESSAGE)
+            {
+                p_plan->ndef_offset = (uint32_t)(tlv.value - p_raw_data);
+                p_plan->ndef_length = tlv.length;
+                p_plan->done        = 1;
+                return T5T_OK;
+            }
+
+            if(tlv.type == TLV_TERMINATOR)
+                return type_5_tag_plan_fail(p_plan, T5T_E_NOT_FOUND);
+
+            p_plan->tlv_offset = (uint32_t)(offset + br);
+            continue;
+        }
+        else if(rslt == TLV_E_NOT_FOUND)
+        {
+            p_plan->tlv_offset = (uint32_t)(offset + br);
+            continue;
+        }
+        else if(rslt != TLV_E_INCOMPLETE)
+        {
+            return type_5_tag_plan_fail(p_plan, T5T_E_INVALID_DATA);
+        }
+
+        if(avail_end == p_plan->data_end)
+        {
+            /* TLV block runs past the end of the data area. */
+            NFC_STATS_ERROR(NFC_STATS_ERR_TLV_INCOMPLETE);
+            return type_5_tag_plan_fail(p_plan, T5T_E_INVALID_DATA);
+        }
+
+        size_t value_len;
+        size_t header_len = type_5_tag_tlv_header(p_raw_data + offset, avail, &value_len);
+
+        if((header_len != 0) && (offset + header_len + value_len > p_plan->data_end))
+            return type_5_tag_plan_fail(p_plan, T5T_E_INVALID_DATA);
+
+        if((header_len != 0) && (p_raw_data[offset] != TLV_NDEF_MESSAGE))
+        {
+            /* Value of this block is not needed, skip the blocks it covers. */
+            p_plan->tlv_offset = (uint32_t)(offset + header_len + value_len);
+            continue;
+        }
+
+        if(header_len != 0)
+        {
+            /* Publish the NDEF value location so it can be decoded while the rest is read. */
+            p_plan->ndef_offset = (uint32_t)(offset + header_len);
+            p_plan->ndef_length = (uint32_t)value_len;
+        }
+
+        /* Header or NDEF value incomplete, continue reading sequentially. */
+        break;
+    }
+
+    if((p_plan->data_end != 0) && (p_plan->tlv_offset >= p_plan->data_end))
+        return type_5_tag_plan_fail(p_plan, T5T_E_NOT_FOUND);
+
+    uint32_t next_offset = p_plan->tlv_offset;
+
+    if((next_offset >= p_plan->valid_start) && (next_offset < p_plan->valid_end))
+        next_offset = p_plan->valid_end;
+
+    /* Read up to the end of the NDEF value once known, otherwise probe for the next header. */
+    uint32_t want_end;
+
+    if(p_plan->data_end == 0)
+        want_end = T5T_CC_EXT_SIZE + T5T_PROBE_SIZE;
+    else if(p_plan->ndef_offset != 0)
+        want_end = p_plan->ndef_offset + p_plan->ndef_length;
+    else
+        want_end = next_offset + T5T_PROBE_SIZE;
+
+    if((p_plan->data_end != 0) && (want_end > p_plan->data_end))
+        want_end = p_plan->data_end;
+
+    uint32_t first_block = next_offset / block_size;
+    uint32_t block_cnt   = (want_end > first_block * block_size) ?
+                           (want_end - first_block * block_size + block_size - 1) / block_size : 1;
+
+    if(block_cnt > p_plan->max_blocks)
+        block_cnt = p_plan->max_blocks;
+    if(block_cnt > max_blocks)
+        block_cnt = max_blocks;
+
+    /* Stay inside the raw data buffer. */
+    size_t raw_blocks = p_plan->raw_size / block_size;
+
+    if(first_block >= raw_blocks)
+        return type_5_tag_plan_fail(p_plan, T5T_E_NO_MEM);
+    if(first_block + block_cnt > raw_blocks)
+        block_cnt = (uint32_t)(raw_blocks - first_block);
+
+    if(first_block + block_cnt - 1 > T5T_MAX_EXT_BLOCK_NO)
+        return type_5_tag_plan_fail(p_plan, T5T_E_NO_MEM);
+
+    p_plan->next_block = (uint16_t)first_block;
+    p_plan->next_count = (uint16_t)block_cnt;
+    p_plan->read_count++;
+    *p_block_no  = p_plan->next_block;
+    *p_block_cnt = p_plan->next_count;
+
+    return T5T_OK;
+}
+
+type_5_tag_status_t type_5_tag_read_cmd(const type_5_tag_read_plan_t * p_plan,
+                                        const uint8_t                * p_uid,
+                                        uint8_t                      * p_buf,
+                                        size_t                         len,
+                                        size_t                       * p_bw)
+{
+    if((p_plan == NULL) || (p_buf == NULL) || (p_bw == NULL) || (p_plan->next_count == 0))
+        return T5T_E_INVALID_ARGS;
+
+    uint32_t last_block = (uint32_t)p_plan->next_block + p_plan->next_count - 1;
+    uint8_t  extended   = (p_plan->cc.magic == T5T_CC_MAGIC_2_BYTE_ADDR) || (last_block > T5T_MAX_BLOCK_NO);
+    uint8_t  multiple   = (p_plan->next_count > 1);
+    size_t   size       = 2 + ((p_uid != NULL) ? T5T_UID_SIZE : 0) +
+                          (extended ? 2 : 1) + (multiple ? (extended ? 2 : 1) : 0);
+
+    if(len < size)
+        return T5T_E_NO_MEM;
+
+    size_t pos = 0;
+
+    p_buf[pos++] = T5T_FLAG_HIGH_DATA_RATE | ((p_uid != NULL) ? T5T_FLAG_ADDRESSED : 0);
+
+    if(extended)
+        p_buf[pos++] = multiple ? T5T_CMD_EXT_READ_MULTIPLE_BLOCKS : T5T_CMD_EXT_READ_SINGLE_BLOCK;
+    else
+        p_buf[pos++] = multiple ? T5T_CMD_READ_MULTIPLE_BLOCKS : T5T_CMD_READ_SINGLE_BLOCK;
+
+    if(p_uid != NULL)
+    {
+        memcpy(p_buf + pos, p_uid, T5T_UID_SIZE);
+        pos += T5T_UID_SIZE;
+    }
+
+    /* Block numbers and counts are sent least significant byte first; the count is N - 1. */
+    p_buf[pos++] = (uint8_t)(p_plan->next_block & 0xFF);
+    if(extended)
+        p_buf[pos++] = (uint8_t)(p_plan->next_block >> 8);
+
+    if(multiple)
+    {
+        uint16_t cnt = (uint16_t)(p_plan->next_count - 1);
+
+        p_buf[pos++] = (uint8_t)(cnt & 0xFF);
+        if(extended)
+            p_buf[pos++] = (uint8_t)(cnt >> 8);
+    }
+
+    *p_bw = pos;
+
+    return T5T_OK;
+}
@@ -0,0 +1,186 @@
+#ifndef _TYPE_5_TAG_H_
+#define _TYPE_5_TAG_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "nfc_tlv_block.h"
+
+#define T5T_SUPPORTED_MAJOR_VERSION 1       /* Supported major version of the Type 5 Tag specification. */
+
+#define T5T_CC_MAGIC_1_BYTE_ADDR    0xE1    /* CC magic number, blocks fit in 8-bit addresses. */
+
+#define T5T_CC_MAGIC_2_BYTE_ADDR    0xE2    /* CC magic number, blocks need 16-bit addresses (extended commands). */
+
+#define T5T_CC_SIZE                 4       /* Size of a 4-byte Capability Container. */
+
+#define T5T_CC_EXT_SIZE             8       /* Size of an 8-byte Capability Container (MLEN byte set to 0). */
+
+#define T5T_DATA_AREA_SIZE_UNIT     8       /* MLEN is expressed in multiples of 8 bytes. */
+
+#define T5T_FEATURE_MBREAD          0x01    /* CC feature bit: READ MULTIPLE BLOCKS is supported. */
+
+#define T5T_FEATURE_LOCK_BLOCK      0x08    /* CC feature bit: LOCK BLOCK is supported. */
+
+#define T5T_FEATURE_SPECIAL_FRAME   0x10    /* CC feature bit: special frame format is required for writes. */
+
+#define T5T_MAX_BLOCK_SIZE          32      /* Largest block size allowed by ISO/IEC 15693. */
+
+#define T5T_MAX_BLOCKS_PER_READ     256     /* Largest block count of a single READ MULTIPLE BLOCKS command. */
+
+#define T5T_PROBE_SIZE              32      /* Bytes requested while the next TLV header is unknown. */
+
+#define T5T_UID_SIZE                8       /* Size of the tag UID. */
+
+#define T5T_MAX_CMD_SIZE            (2 + T5T_UID_SIZE + 4)  /* Largest READ command frame, without CRC. */
+
+#define T5T_CMD_READ_SINGLE_BLOCK           0x20
+#define T5T_CMD_READ_MULTIPLE_BLOCKS        0x23
+#define T5T_CMD_EXT_READ_SINGLE_BLOCK       0x30
+#define T5T_CMD_EXT_READ_MULTIPLE_BLOCKS    0x33
+
+#define T5T_FLAG_HIGH_DATA_RATE     0x02    /* Request flag: high data rate. */
+#define T5T_FLAG_ADDRESSED          0x20    /* Request flag: addressed mode (UID follows the command code). */
+
+/**
+ * @brief Type 5 Tag API status codes.
+ */
+typedef enum
+{
+    T5T_OK,                 /* Success                                          */
+    T5T_E_NOT_FOUND,        /* No NDEF message TLV found in the data area        */
+    T5T_E_INVALID_ARGS,     /* Invalid function arguments                       */
+    T5T_E_NO_MEM,           /* Not enough memory for the raw data or command    */
+    T5T_E_INVALID_DATA,     /* CC or TLV data is invalid                        */
+    T5T_E_NOT_SUPPORTED,    /* Unsupported Type 5 Tag specification version     */
+} type_5_tag_status_t;
+
+/**
+ * @brief Descriptor for the Capability Container (CC) bytes of a Type 5 Tag.
+ */
+typedef struct
+{
+    uint8_t     magic;              ///< CC magic number, selects the addressing mode.
+    uint8_t     major_version;      ///< Major version of the supported Type 5 Tag specification.
+    uint8_t     minor_version;      ///< Minor version of the supported Type 5 Tag specification.
+    uint8_t     read_access;        ///< Read access for the data area.
+    uint8_t     write_access;       ///< Write access for the data area.
+    uint8_t     features;           ///< Additional feature bits (T5T_FEATURE_*).
+    uint8_t     cc_size;            ///< Size of the CC in bytes (4 or 8); the data area follows it.
+    uint32_t    data_area_size;     ///< Size of the data area (T5T_Area) in bytes.
+} type_5_tag_capability_container_t;
+
+/**
+ * @brief State of the Type 5 Tag read planner.
+ *
+ * The planner decides which READ commands are needed to fetch the first NDEF
+ * message TLV of a tag. Block 0 is read with READ SINGLE BLOCK; once the CC
+ * shows READ MULTIPLE BLOCKS is supported, every following command reads as
+ * many blocks as the reader can take, so large messages need few commands.
+ * TLV blocks whose value is not needed are skipped.
+ */
+typedef struct
+{
+    size_t                              raw_size;       ///< Size of the raw data buffer.
+    uint16_t                            block_size;     ///< Tag block size in bytes.
+    uint16_t                            max_blocks;     ///< Largest block count per READ command.
+    type_5_tag_capability_container_t   cc;             ///< CC, valid once data_end is set.
+    uint32_t                            data_end;       ///< Offset one past the end of the data area (0 until the CC has been read).
+    uint32_t                            tlv_offset;     ///< Offset of the next TLV block to decode.
+    uint32_t                            valid_start;    ///< Start offset of the window of bytes read so far.
+    uint32_t                            valid_end;      ///< End offset of the window of bytes read so far.
+    uint32_t                            ndef_offset;    ///< Offset of the NDEF message TLV value field, once its header has been read.
+    uint32_t                            ndef_length;    ///< Length of the NDEF message TLV value field, once its header has been read.
+    uint16_t                            read_count;     ///< Number of READ commands issued so far.
+    uint16_t                            next_block;     ///< First block of the next READ command.
+    uint16_t                            next_count;     ///< Number of blocks of the next READ command.
+    uint8_t                             done;           ///< Set once no more READ commands are needed.
+} type_5_tag_read_plan_t;
+
+/**
+ * @brief Function for parsing the Capability Container of a Type 5 Tag.
+ *
+ * @param[out] p_cc         Pointer to the structure receiving the CC.
+ * @param[in]  p_raw_data   Pointer to the first byte of block 0.
+ * @param[in]  len          Number of bytes available at @p p_raw_data.
+ *
+ * @retval     T5T_OK              If the CC was parsed.
+ * @retval     T5T_E_NO_MEM        If @p len does not cover the whole CC.
+ * @retval     T5T_E_INVALID_DATA  If the magic number or the data area size is invalid.
+ * @retval     T5T_E_NOT_SUPPORTED If the major version is not supported.
+ *
+ */
+type_5_tag_status_t type_5_tag_cc_parse(type_5_tag_capability_container_t * p_cc,
+                                        const uint8_t                     * p_raw_data,
+                                        size_t                              len);
+
+/**
+ * @brief Function for initializing the Type 5 Tag read planner.
+ *
+ * @param[out] p_plan           Pointer to the planner state.
+ * @param[in]  raw_size         Size of the raw data buffer the READ responses are stored in.
+ * @param[in]  block_size       Tag block size in bytes (from GET SYSTEM INFO, usually 4).
+ * @param[in]  max_read_size    Largest response payload the reader accepts, in bytes.
+ *
+ */
+void type_5_tag_read_plan_init(type_5_tag_read_plan_t * p_plan,
+                               size_t                   raw_size,
+                               uint16_t                 block_size,
+                               size_t                   max_read_size);
+
+/**
+ * @brief Function for getting the next READ command needed to fetch the NDEF message.
+ *
+ * Before each call but the first the caller must have stored the blocks
+ * returned by the previous READ at @p p_raw_data + block number * block size.
+ * Once @p p_plan->done is set the NDEF message TLV value lies at
+ * @p p_plan->ndef_offset in the raw data.
+ *
+ * @param[in,out] p_plan        Pointer to the planner state.
+ * @param[in]     p_raw_data    Pointer to the buffer with raw data read so far.
+ * @param[out]    p_block_no    First block of the next READ command (valid while not done).
+ * @param[out]    p_block_cnt   Number of blocks of the next READ command (valid while not done).
+ *
+ * @retval     T5T_OK             If a READ is needed, or the NDEF message TLV has been fully read.
+ * @retval     T5T_E_NOT_FOUND    If the data area holds no NDEF message TLV.
+ * @retval     T5T_E_NO_MEM       If the data area does not fit in the raw data buffer.
+ * @retval     Other              If the CC or TLV data is invalid.
+ *
+ */
+type_5_tag_status_t type_5_tag_read_plan_next(type_5_tag_read_plan_t * p_plan,
+                                              uint8_t                * p_raw_data,
+                                              uint16_t               * p_block_no,
+                                              uint16_t               * p_block_cnt);
+
+/**
+ * @brief Function for encoding the next READ command of a plan.
+ *
+ * READ SINGLE BLOCK is used for one block and READ MULTIPLE BLOCKS otherwise.
+ * The extended commands (16-bit block addresses) are used when the CC magic
+ * number requires them or the blocks lie past block 255.
+ *
+ * @param[in]  p_plan   Pointer to a planner state holding a pending READ.
+ * @param[in]  p_uid    UID in transmission order for addressed mode, or NULL.
+ * @param[out] p_buf    Buffer receiving the command frame (without CRC).
+ * @param[in]  len      Size of @p p_buf, at least @ref T5T_MAX_CMD_SIZE is enough.
+ * @param[out] p_bw     Number of bytes written.
+ *
+ * @retval     T5T_OK             If the command was encoded.
+ * @retval     T5T_E_NO_MEM       If the buffer is too small.
+ *
+ */
+type_5_tag_status_t type_5_tag_read_cmd(const type_5_tag_read_plan_t * p_plan,
+                                        const uint8_t                * p_uid,
+                                        uint8_t                      * p_buf,
+                                        size_t                         len,
+                                        size_t                       * p_bw);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif